@@ -31,6 +31,8 @@ using namespace csci5570;
 DEFINE_string(config_file, "", "The config file path");
 DEFINE_string(my_id, "", "Local node id");
 DEFINE_string(input, "", "The hdfs input url");
+DEFINE_int32(num_compute_threads, 1, "The number of threads of each worker computing the gradients");
+DEFINE_int32(num_load_threads, 1, "The number of threads of each node reading and parsing its input");
 
 void get_nodes_from_config(std::string config_file, std::vector<Node>& nodes) {
   std::ifstream infile(config_file);
@@ -97,7 +99,7 @@ int main(int argc, char** argv) {
   engine.Barrier();
 
   data_loader.load(url, hdfs_namenode, master_host, worker_host, hdfs_namenode_port, master_port, n_features,
-                   parser, &data_store, id, nodes.size());
+                   parser, &data_store, id, nodes.size(), FLAGS_num_load_threads);
 
 
   // 1.1 Create table
@@ -121,24 +123,26 @@ int main(int argc, char** argv) {
   task.SetLambda([kTableId, &data_store](const Info& info) {
 //    LOG(INFO) << info.DebugString();
 
-      // the maximum data range used by current worker
+      // the shard of the local samples owned by this worker, copied on its own thread
+      auto range = info.GetLocalShard(data_store.size());
+      DataStore shard(data_store.begin() + range.first, data_store.begin() + range.second);
 
-      SVM<double> svm(&data_store);
+      SVM<double> svm(&shard);
 
       std::vector<Key> keys;
       svm.get_keys(keys);
 
       KVClientTable<double> table = info.CreateKVClientTable<double>(kTableId);
-
+      lib::ThreadPool pool(FLAGS_num_compute_threads);
 
       for (int i = 0; i < 10e2; ++i) {
         // parameters from server
         std::vector<double> theta;
         table.Get(keys, &theta);
 
-        auto correct_ratio = svm.correct_rate(data_store, keys, theta);
+        auto correct_ratio = svm.correct_rate(shard, keys, theta);
 
-        auto res =  svm.compute_gradients(data_store, keys, theta, 0.1);
+        auto res =  svm.compute_gradients(shard, keys, theta, 0.1, &pool);
 
         table.Add(keys, res);
         LOG(INFO) << "Correct Ratio\t" << correct_ratio;
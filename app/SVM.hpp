@@ -9,7 +9,9 @@
 #include <vector>
 #include <Eigen/Dense>
 #include <cmath>
+#include "lib/sparse_kernels.hpp"
 #include "lib/svm_sample.hpp"
+#include "lib/thread_pool.hpp"
 
 using namespace Eigen;
 using namespace csci5570;
@@ -29,53 +31,50 @@ public:
         }
       }
     }
+    /**
+     * Compute the updates of the parameters <vals> of sorted <keys>, the last one being the bias, over <samples>
+     *
+     * With a pool, each of its threads accumulates the updates of a range of the samples into its own buffer,
+     * and the buffers are then summed over ranges of keys.
+     *
+     * The samples are laid out once as CSR rows over the positions of their features in <keys>, and the layout
+     * is kept while the same unchanged samples come with the same keys, e.g., the shard of the worker.
+     */
     std::vector<double> compute_gradients(const std::vector<lib::SVMSample>& samples, const std::vector<Key>& keys,
-                                          const std::vector<double>& vals, double alpha) {
+                                          const std::vector<double>& vals, double alpha,
+                                          lib::ThreadPool* pool = nullptr) {
+      prepare_layout(samples, keys);
       std::vector<double> deltas(keys.size(), 0.);
-      for (auto sample : samples) {
-        auto& x = sample.x_;
-        double y = sample.y_;
-        double predict = 0.;
-        int idx = 0;
-        for (auto& field : x) {
-          while (keys[idx] < field.first)
-            ++idx;
-          predict += vals[idx] * field.second;
-        }
-        predict += vals.back();
-        int predictLabel;
-        if (predict >= 0) {
-          predictLabel = 1;
-        } else {
-          predictLabel = -1;
-        }
-
-        idx = 0;
-        for (auto& field : x) {
-          while (keys[idx] < field.first)
-            ++idx;
-          deltas[idx] += alpha * field.second * (y - predictLabel);
-        }
-        deltas[deltas.size() - 1] += alpha * (y - predictLabel);
+      if (pool == nullptr) {
+        accumulate_gradients(0, samples.size(), vals, alpha, deltas.data());
+        return deltas;
       }
+      int num_threads = pool->GetNumThreads();
+      partials_.resize(num_threads);
+      for (int t = 1; t < num_threads; ++t) {
+        partials_[t].assign(keys.size(), 0.);
+      }
+      pool->ParallelFor(samples.size(), [&](int tid, size_t begin, size_t end) {
+        accumulate_gradients(begin, end, vals, alpha, tid == 0 ? deltas.data() : partials_[tid].data());
+      });
+      pool->ParallelFor(keys.size(), [&](int, size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+          for (int t = 1; t < num_threads; ++t) {
+            deltas[j] += partials_[t][j];
+          }
+        }
+      });
       return deltas;
     }
 
     double correct_rate(const std::vector<lib::SVMSample>& samples, const std::vector<Key>& keys,
                         const std::vector<double>& vals) {
+      prepare_layout(samples, keys);
       int total = samples.size();
       double n = 0;
-      for (auto sample : samples) {
-        auto& x = sample.x_;
-        double y = sample.y_;
-        double predict = 0.;
-        int idx = 0;
-        for (auto& field : x) {
-          while (keys[idx] < field.first)
-            ++idx;
-          predict += vals[idx] * field.second;
-        }
-        predict += vals.back();
+      for (size_t i = 0; i < samples.size(); ++i) {
+        double y = layout_labels_[i];
+        double predict = predict_row(i, vals);
         int predict_;
         if (predict >= 0) {
           predict_ = 1;
@@ -97,9 +96,76 @@ public:
     }
 
 private:
+    /**
+     * Lay out <samples> as CSR rows over the positions of their features in sorted <keys>, unless done already
+     */
+    void prepare_layout(const std::vector<lib::SVMSample>& samples, const std::vector<Key>& keys) {
+      if (layout_samples_ == &samples && layout_cols_.size() == layout_nnz(samples) && layout_keys_ == keys) {
+        return;
+      }
+      layout_samples_ = &samples;
+      layout_keys_ = keys;
+      layout_cols_.clear();
+      layout_values_.clear();
+      layout_labels_.clear();
+      layout_indptr_.assign(1, 0);
+      for (auto& sample : samples) {
+        int idx = 0;
+        for (auto& field : sample.x_) {
+          while (keys[idx] < field.first)
+            ++idx;
+          layout_cols_.push_back(idx);
+          layout_values_.push_back(field.second);
+        }
+        layout_labels_.push_back(sample.y_);
+        layout_indptr_.push_back(layout_cols_.size());
+      }
+    }
+
+    static size_t layout_nnz(const std::vector<lib::SVMSample>& samples) {
+      size_t nnz = 0;
+      for (auto& sample : samples) {
+        nnz += sample.x_.size();
+      }
+      return nnz;
+    }
+
+    double predict_row(size_t i, const std::vector<double>& vals) const {
+      size_t begin = layout_indptr_[i];
+      return lib::SparseDot(layout_cols_.data() + begin, layout_values_.data() + begin, layout_indptr_[i + 1] - begin,
+                            vals.data()) + vals.back();
+    }
+
+    void accumulate_gradients(size_t begin, size_t end, const std::vector<double>& vals, double alpha,
+                              double* deltas) const {
+      for (size_t i = begin; i < end; ++i) {
+        double y = layout_labels_[i];
+        double predict = predict_row(i, vals);
+        int predictLabel;
+        if (predict >= 0) {
+          predictLabel = 1;
+        } else {
+          predictLabel = -1;
+        }
+
+        size_t row = layout_indptr_[i];
+        lib::SparseAxpy(alpha * (y - predictLabel), layout_cols_.data() + row, layout_values_.data() + row,
+                        layout_indptr_[i + 1] - row, deltas);
+        deltas[vals.size() - 1] += alpha * (y - predictLabel);
+      }
+    }
+
     DataStore* data_store_;
     std::map<Key, T> theta_;
     std::map<Key, T> grad_;
+    std::vector<std::vector<double>> partials_;  // the updates of the pool threads but the first
+    // the samples laid out over the keys
+    const std::vector<lib::SVMSample>* layout_samples_ = nullptr;
+    std::vector<Key> layout_keys_;
+    std::vector<uint32_t> layout_cols_;
+    std::vector<double> layout_values_;
+    std::vector<size_t> layout_indptr_;
+    std::vector<double> layout_labels_;
 };
 
 
@@ -6,101 +6,186 @@
 #define CSCI5570_LOGITSTIC_REGRESSION_HPP
 
 #include "base/magic.hpp"
-#include <vector>
-#include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
-#include "lib/svm_sample.hpp"
+#include <cstdint>
+#include <vector>
+#include "glog/logging.h"
+#include "lib/csr_dataset.hpp"
+#include "lib/sparse_kernels.hpp"
+#include "lib/thread_pool.hpp"
 
-using namespace Eigen;
 using namespace csci5570;
-using DataStore = std::vector<lib::SVMSample>;
+using DataStore = lib::CSRDataset;
 
-template <typename T>
+/**
+ * Logistic regression trained by mini-batch SGD on the parameter server
+ *
+ * The features of the dataset are remapped once to dense local columns, the positions of their keys in the
+ * sorted keys of the dataset. A mini-batch then only needs the sorted unique keys of its rows: prepare_batch
+ * collects them and a dense slot for each, so that the gradient is computed over a dense array of the batch
+ * parameters and only the keys touched are pulled and pushed. Labels may be 0/1 or -1/+1.
+ *
+ * The dataset is a CSRDataset, or a MappedCSRDataset read in place from a cache file.
+ */
+template <typename T, typename Dataset = DataStore>
 class LogisticRegression {
 public:
-  LogisticRegression(DataStore* data_store, float learning_rate=0.001)
+  LogisticRegression(Dataset* data_store, float learning_rate=0.001)
     : data_store_(data_store), learning_rate_(learning_rate) {
-    // initialize theta
-    for(auto& row : (*data_store_)) {
-      for(auto& col : row.x_) {
-        theta_[col.first] = 0.0;
-        grad_[col.first] = 0.0;
-      }
+    // the features of the rows are contiguous in both datasets
+    indices_ = data_store_->empty() ? nullptr : data_store_->row(0).indices;
+    keys_.assign(indices_, indices_ + data_store_->nnz());
+    std::sort(keys_.begin(), keys_.end());
+    keys_.erase(std::unique(keys_.begin(), keys_.end()), keys_.end());
+    cols_.reserve(data_store_->nnz());
+    for (size_t i = 0; i < data_store_->nnz(); i++) {
+      cols_.push_back(std::lower_bound(keys_.begin(), keys_.end(), indices_[i]) - keys_.begin());
     }
+    theta_.assign(keys_.size(), 0.0);
+    slots_.assign(keys_.size(), -1);
   }
 
-  double predict(lib::SVMSample sample) {
-    double z = 0;
-    for(auto& col : sample.x_) {
-      Key key = col.first;
-      auto x = col.second;
-      z += x * theta_[key];
-    }
-    return 1.0 / (1 + std::exp(-z));
+  double predict(const lib::CSRRow& row) const {
+    return sigmoid(lib::SparseDot(row_cols(row), row.values, row.nnz, theta_.data()));
   }
 
-  double get_loss() {
+  double get_loss() const {
     double loss = 0;
-    for (auto& row : (*data_store_)) {
-      int y = row.y_ <= 0 ? 0 : 1;
-      double pred = predict(row);
+    for (size_t i = 0; i < data_store_->size(); i++) {
+      auto row = data_store_->row(i);
+      int y = row.label <= 0 ? 0 : 1;
+      // clamp to keep log finite
+      double pred = std::min(std::max(predict(row), 1e-15), 1 - 1e-15);
       loss += (-1 * y * std::log(pred) - (1 - y) * std::log(1 - pred));
     }
     return loss/data_store_->size();
   }
 
-  void compute_gradient(std::vector<T>& grad) {
-    for(auto& g : grad_) {
-      g.second = 0.0;
+  /**
+   * Collect the sorted unique keys of the rows of <batch>, the parameters to Get for compute_batch_gradient
+   */
+  void prepare_batch(const typename Dataset::Batch& batch, std::vector<Key>* keys) {
+    batch_ = batch;
+    for (uint32_t col : batch_cols_) {
+      slots_[col] = -1;
+    }
+    batch_cols_.clear();
+    for (size_t i = 0; i < batch.size(); i++) {
+      auto row = batch.row(i);
+      const uint32_t* cols = row_cols(row);
+      for(size_t k = 0; k < row.nnz; k++) {
+        if (slots_[cols[k]] < 0) {
+          slots_[cols[k]] = 0;
+          batch_cols_.push_back(cols[k]);
+        }
+      }
+    }
+    // the columns are ordered as the keys
+    std::sort(batch_cols_.begin(), batch_cols_.end());
+    keys->resize(batch_cols_.size());
+    for (size_t j = 0; j < batch_cols_.size(); j++) {
+      slots_[batch_cols_[j]] = j;
+      (*keys)[j] = keys_[batch_cols_[j]];
+    }
+    // the slots of the features of the rows, for the kernels
+    batch_slots_.clear();
+    batch_indptr_.assign(1, 0);
+    for (size_t i = 0; i < batch.size(); i++) {
+      auto row = batch.row(i);
+      const uint32_t* cols = row_cols(row);
+      for(size_t k = 0; k < row.nnz; k++) {
+        batch_slots_.push_back(slots_[cols[k]]);
+      }
+      batch_indptr_.push_back(batch_slots_.size());
+    }
+  }
+
+  /**
+   * Compute the update of the batch parameters <vals>, got for the keys of prepare_batch, i.e., the gradient
+   * of the mean loss over the batch scaled by -learning_rate
+   *
+   * With a pool, each of its threads accumulates the gradient of a range of the batch rows into its own buffer
+   * over the batch keys, and the buffers are then summed over ranges of keys, so that the worker pushes once.
+   */
+  void compute_batch_gradient(const std::vector<T>& vals, std::vector<T>* grad, lib::ThreadPool* pool = nullptr) {
+    CHECK_EQ(vals.size(), batch_cols_.size());
+    int num_threads = pool == nullptr ? 1 : pool->GetNumThreads();
+    grad->assign(vals.size(), 0.0);
+    partials_.resize(num_threads);
+    for (int t = 1; t < num_threads; t++) {
+      partials_[t].assign(vals.size(), 0.0);
     }
-    for (auto& row : (*data_store_)) {
-      // NOTICE that row.y_ maybe +1/-1
-      auto y = row.y_ <= 0 ? 0 : 1;
-      auto z = 0;
-      for(auto& col : row.x_) {
-        Key key = col.first;
-        auto x = col.second;
-        z += x * theta_[key];
+    z_.resize(batch_.size());
+    auto accumulate = [this, &vals, grad](int tid, size_t begin, size_t end) {
+      T* out = tid == 0 ? grad->data() : partials_[tid].data();
+      for (size_t i = begin; i < end; i++) {
+        auto row = batch_.row(i);
+        z_[i] = lib::SparseDot(batch_slots_.data() + batch_indptr_[i], row.values, row.nnz, vals.data());
+      }
+      lib::Sigmoid(z_.data() + begin, end - begin, z_.data() + begin);
+      for (size_t i = begin; i < end; i++) {
+        auto row = batch_.row(i);
+        // NOTICE that row.label maybe +1/-1
+        int y = row.label <= 0 ? 0 : 1;
+        lib::SparseAxpy(z_[i] - y, batch_slots_.data() + batch_indptr_[i], row.values, row.nnz, out);
       }
-      auto g = 1 / (1 + std::exp(-z));
-      for(auto& col : row.x_) {
-        Key key = col.first;
-        auto x = col.second;
-        grad_[key] += -learning_rate_ * x * (g - y);
+    };
+    double scale = batch_.size() == 0 ? 0 : -learning_rate_ / batch_.size();
+    auto reduce = [this, &vals, grad, num_threads, scale](int, size_t begin, size_t end) {
+      for (size_t j = begin; j < end; j++) {
+        for (int t = 1; t < num_threads; t++) {
+          (*grad)[j] += partials_[t][j];
+        }
+        (*grad)[j] *= scale;
+        // keep the latest parameters seen for predict
+        theta_[batch_cols_[j]] = vals[j];
       }
+    };
+    if (pool == nullptr) {
+      accumulate(0, 0, batch_.size());
+      reduce(0, 0, vals.size());
+    } else {
+      pool->ParallelFor(batch_.size(), accumulate);
+      pool->ParallelFor(vals.size(), reduce);
+    }
+  }
+
+  /**
+   * Compute the update of all the parameters over the whole dataset, for the keys of get_keys
+   */
+  void compute_gradient(std::vector<T>& grad) {
+    grad.assign(keys_.size(), 0.0);
+    for (size_t i = 0; i < data_store_->size(); i++) {
+      auto row = data_store_->row(i);
+      int y = row.label <= 0 ? 0 : 1;
+      lib::SparseAxpy(predict(row) - y, row_cols(row), row.values, row.nnz, grad.data());
     }
-    for(auto& g : grad_) {
-      grad.push_back(g.second / data_store_->size());
+    for (auto& g : grad) {
+      g *= -learning_rate_ / data_store_->size();
     }
-//    Matrix<T, Dynamic, 1> Z = (*X_) * theta_;
-//    Matrix<T, Dynamic, 1> G = Z.unaryExpr([](T z){
-//      return 1 / (1 + std::exp(-z));
-//    });
-//    grad = -learning_rate_ * X_->transpose() * (G - (*Y_));
   }
 
+  /**
+   * Set the parameters of sorted <keys>, e.g., all those of get_keys, those of other keys are ignored
+   */
   void update_theta(const std::vector<Key>& keys, const std::vector<T>& vals) {
-    uint32_t size = keys.size();
-    for(uint32_t i = 0; i < size; i++) {
-      if (theta_.find(keys[i]) == theta_.end()) {continue;}
-      theta_[keys[i]] = vals[i];
+    auto it = keys_.begin();
+    for(size_t i = 0; i < keys.size(); i++) {
+      it = std::lower_bound(it, keys_.end(), keys[i]);
+      if (it == keys_.end()) {break;}
+      if (*it == keys[i]) {theta_[it - keys_.begin()] = vals[i];}
     }
   }
 
-  float test_acc() {
+  float test_acc() const {
     float correct = 0;
     uint32_t total = 0;
-    for (auto& row : (*data_store_)) {
-      // NOTICE that row.y_ maybe +1/-1
-      auto y = row.y_ <= 0 ? 0 : 1;
-      auto z = 0;
-      for(auto& col : row.x_) {
-        Key key = col.first;
-        auto x = col.second;
-        z += x * theta_[key];
-      }
-      auto g = 1 / (1 + std::exp(-z));
-      auto y_pred = g <= 0.5 ? 0 : 1;
+    for (size_t i = 0; i < data_store_->size(); i++) {
+      auto row = data_store_->row(i);
+      // NOTICE that row.label maybe +1/-1
+      auto y = row.label <= 0 ? 0 : 1;
+      auto y_pred = predict(row) <= 0.5 ? 0 : 1;
       if (y_pred == y) {correct++;}
       total++;
     }
@@ -110,17 +195,38 @@ public:
     return correct / total;
   }
 
-  void get_keys(std::vector<Key>& keys) {
-    for(auto& kv : theta_) {
-      keys.push_back(kv.first);
-    }
+  /**
+   * All the keys of the dataset, sorted
+   */
+  void get_keys(std::vector<Key>& keys) const {
+    keys.insert(keys.end(), keys_.begin(), keys_.end());
   }
 
 private:
-  DataStore* data_store_;
-  std::map<Key, T> theta_;
-  std::map<Key, T> grad_;
+  static double sigmoid(double z) {
+    lib::Sigmoid(&z, 1, &z);
+    return z;
+  }
+
+  // the local columns of the features of a row of the dataset
+  const uint32_t* row_cols(const lib::CSRRow& row) const {
+    return cols_.data() + (row.indices - indices_);
+  }
+
+  Dataset* data_store_;
+  const Key* indices_;           // the features of the dataset
   float learning_rate_;
+  std::vector<Key> keys_;        // the sorted unique keys of the dataset
+  std::vector<uint32_t> cols_;   // the column of each feature of the dataset, i.e., its key in keys_
+  std::vector<T> theta_;         // the parameters by column
+  // the current batch
+  typename Dataset::Batch batch_{nullptr, 0, 0};
+  std::vector<uint32_t> batch_cols_;  // the columns of the batch, sorted
+  std::vector<int64_t> slots_;        // the position of each column in batch_cols_, -1 if absent
+  std::vector<uint32_t> batch_slots_;  // the slot of each feature of the batch rows
+  std::vector<size_t> batch_indptr_;   // batch row i spans [batch_indptr_[i], batch_indptr_[i + 1])
+  std::vector<double> z_;              // the predictions of the batch rows
+  std::vector<std::vector<T>> partials_;  // the gradients of the pool threads but the first, by batch slot
 };
 
 
@@ -0,0 +1,164 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "app/logitstic_regression.hpp"
+#include "lib/csr_cache.hpp"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace csci5570 {
+namespace {
+
+class TestLogisticRegression : public testing::Test {
+ protected:
+  void SetUp() {
+    // label 1 iff feature 7 is present, with noise features
+    std::mt19937 gen(0);
+    for (int i = 0; i < 200; ++i) {
+      std::vector<std::pair<Key, double>> x;
+      bool positive = i % 2 == 0;
+      if (positive) {
+        x.push_back({7, 1});
+      }
+      x.push_back({static_cast<Key>(100 + gen() % 20), 0.5});
+      x.push_back({static_cast<Key>(1000 + gen() % 20), 0.5});
+      dataset_.push_back(x, positive ? 1 : -1);
+    }
+  }
+
+  lib::CSRDataset dataset_;
+};
+
+TEST_F(TestLogisticRegression, BatchKeys) {
+  lib::CSRDataset dataset;
+  dataset.push_back(std::vector<std::pair<Key, double>>{{5, 1}, {9, 1}}, 1);
+  dataset.push_back(std::vector<std::pair<Key, double>>{{2, 1}, {9, 1}}, 0);
+  dataset.push_back(std::vector<std::pair<Key, double>>{{4, 1}}, 0);
+  LogisticRegression<double> lr(&dataset, 1);
+  std::vector<Key> keys;
+  lr.get_keys(keys);
+  EXPECT_EQ(keys, (std::vector<Key>{2, 4, 5, 9}));
+  std::vector<Key> batch_keys;
+  lr.prepare_batch(dataset.batch(0, 2), &batch_keys);
+  EXPECT_EQ(batch_keys, (std::vector<Key>{2, 5, 9}));
+  lr.prepare_batch(dataset.batch(1, 2), &batch_keys);
+  EXPECT_EQ(batch_keys, (std::vector<Key>{4}));
+}
+
+TEST_F(TestLogisticRegression, BatchGradient) {
+  // a batch of the whole dataset gives the full gradient
+  LogisticRegression<double> lr(&dataset_, 0.1);
+  std::vector<Key> keys;
+  lr.get_keys(keys);
+  std::vector<double> theta(keys.size());
+  for (size_t i = 0; i < theta.size(); ++i) {
+    theta[i] = 0.1 * (i % 5) - 0.2;  // fractional dot products
+  }
+  lr.update_theta(keys, theta);
+  std::vector<double> full;
+  lr.compute_gradient(full);
+
+  std::vector<Key> batch_keys;
+  std::vector<double> grad;
+  lr.prepare_batch(dataset_.batch(0, dataset_.size()), &batch_keys);
+  ASSERT_EQ(batch_keys, keys);
+  lr.compute_batch_gradient(theta, &grad);
+  ASSERT_EQ(grad.size(), full.size());
+  for (size_t i = 0; i < grad.size(); ++i) {
+    EXPECT_NEAR(grad[i], full[i], 1e-12);
+  }
+}
+
+TEST_F(TestLogisticRegression, ParallelBatchGradient) {
+  LogisticRegression<double> lr(&dataset_, 0.1);
+  std::vector<Key> batch_keys;
+  lr.prepare_batch(dataset_.batch(1, 64), &batch_keys);
+  std::vector<double> vals(batch_keys.size());
+  for (size_t i = 0; i < vals.size(); ++i) {
+    vals[i] = 0.05 * (i % 7) - 0.1;
+  }
+  std::vector<double> expected;
+  lr.compute_batch_gradient(vals, &expected);
+  for (int num_threads : {1, 2, 3}) {
+    lib::ThreadPool pool(num_threads);
+    std::vector<double> grad;
+    lr.compute_batch_gradient(vals, &grad, &pool);
+    ASSERT_EQ(grad.size(), expected.size());
+    for (size_t i = 0; i < grad.size(); ++i) {
+      EXPECT_NEAR(grad[i], expected[i], 1e-12) << num_threads << " threads";
+    }
+  }
+}
+
+TEST_F(TestLogisticRegression, MappedDataset) {
+  char dir[] = "/tmp/csci5570_lr_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  std::string path = std::string(dir) + "/data.csr";
+  ASSERT_GT(lib::CSRCache::Write(path, dataset_, 16), 0);
+  // the second half of the blocks, rows [96, 200)
+  lib::MappedCSRDataset mapped;
+  ASSERT_TRUE(lib::CSRCache::Map(path, 1, 2, &mapped));
+  lib::CSRDataset part = dataset_.slice(mapped.first_row(), mapped.first_row() + mapped.size());
+
+  LogisticRegression<double, lib::MappedCSRDataset> mapped_lr(&mapped, 0.1);
+  LogisticRegression<double> lr(&part, 0.1);
+  std::vector<Key> keys, mapped_keys;
+  lr.get_keys(keys);
+  mapped_lr.get_keys(mapped_keys);
+  EXPECT_EQ(mapped_keys, keys);
+
+  std::vector<Key> batch_keys, mapped_batch_keys;
+  std::vector<double> grad, mapped_grad;
+  lr.prepare_batch(part.batch(2, 32), &batch_keys);
+  mapped_lr.prepare_batch(mapped.batch(2, 32), &mapped_batch_keys);
+  ASSERT_EQ(mapped_batch_keys, batch_keys);
+  std::vector<double> vals(batch_keys.size());
+  for (size_t i = 0; i < vals.size(); ++i) {
+    vals[i] = 0.05 * (i % 7) - 0.1;
+  }
+  lr.compute_batch_gradient(vals, &grad);
+  mapped_lr.compute_batch_gradient(vals, &mapped_grad);
+  EXPECT_EQ(mapped_grad, grad);
+  EXPECT_DOUBLE_EQ(mapped_lr.get_loss(), lr.get_loss());
+
+  std::string cmd = std::string("rm -rf ") + dir;
+  system(cmd.c_str());
+}
+
+TEST_F(TestLogisticRegression, Train) {
+  LogisticRegression<double> lr(&dataset_, 1);
+  std::vector<Key> keys;
+  lr.get_keys(keys);
+  // the parameters of a local table
+  std::vector<double> theta(keys.size(), 0);
+  double initial_loss = lr.get_loss();
+  std::mt19937 gen(0);
+  std::vector<Key> batch_keys;
+  std::vector<double> vals, grad;
+  for (int epoch = 0; epoch < 20; ++epoch) {
+    dataset_.shuffle(gen);
+    for (size_t b = 0; b < dataset_.num_batches(16); ++b) {
+      lr.prepare_batch(dataset_.batch(b, 16), &batch_keys);
+      vals.clear();
+      for (Key key : batch_keys) {
+        vals.push_back(theta[std::lower_bound(keys.begin(), keys.end(), key) - keys.begin()]);
+      }
+      lr.compute_batch_gradient(vals, &grad);
+      for (size_t j = 0; j < batch_keys.size(); ++j) {
+        theta[std::lower_bound(keys.begin(), keys.end(), batch_keys[j]) - keys.begin()] += grad[j];
+      }
+    }
+  }
+  lr.update_theta(keys, theta);
+  EXPECT_LT(lr.get_loss(), initial_loss / 2);
+  EXPECT_FLOAT_EQ(lr.test_acc(), 1);
+}
+
+}  // namespace
+}  // namespace csci5570
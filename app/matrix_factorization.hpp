@@ -0,0 +1,163 @@
+#ifndef CSCI5570_MATRIX_FACTORIZATION_HPP
+#define CSCI5570_MATRIX_FACTORIZATION_HPP
+
+#include "base/magic.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "glog/logging.h"
+#include "lib/embedding.hpp"
+#include "lib/rating.hpp"
+
+using namespace csci5570;
+
+/**
+ * Matrix factorization of sparse ratings trained by mini-batch SGD on the parameter server
+ *
+ * A rating r of item i by user u is predicted by the dot product of the factors p_u and q_i, both embeddings of
+ * N dimensions stored as the values of one table, user u under key 2u and item i under key 2i + 1. A factor is a
+ * small random initial value derived from its key plus the value in the table, so that the table starts empty
+ * and every worker agrees on the initial factors. A mini-batch only needs the factors of its users and items:
+ * prepare_batch collects their sorted unique keys, the factors to Get for compute_batch_update.
+ */
+template <size_t N>
+class MatrixFactorization {
+public:
+  using Factor = lib::Embedding<N>;
+
+  /**
+   * @param ratings       the ratings to train on
+   * @param learning_rate the step of SGD
+   * @param lambda        the L2 regularization of the factors
+   * @param init_scale    the initial factors are uniform in [-init_scale, init_scale]
+   */
+  MatrixFactorization(const std::vector<lib::Rating>* ratings, float learning_rate = 0.01, float lambda = 0.05,
+                      float init_scale = 0.1)
+    : ratings_(ratings), learning_rate_(learning_rate), lambda_(lambda), init_scale_(init_scale) {}
+
+  static Key user_key(uint32_t user) { return 2 * user; }
+  static Key item_key(uint32_t item) { return 2 * item + 1; }
+
+  /**
+   * The initial factor of <key>, the same on all the workers
+   */
+  Factor init_factor(Key key) const {
+    Factor factor;
+    uint64_t state = key;
+    for (size_t j = 0; j < N; j++) {
+      // splitmix64
+      uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      z ^= z >> 31;
+      factor[j] = init_scale_ * (2 * static_cast<float>(z >> 40) / (1 << 24) - 1);
+    }
+    return factor;
+  }
+
+  /**
+   * Collect the sorted unique keys of the users and items of ratings [begin, end), the factors to Get for
+   * compute_batch_update
+   */
+  void prepare_batch(size_t begin, size_t end, std::vector<Key>* keys) {
+    CHECK_LE(end, ratings_->size());
+    batch_begin_ = begin;
+    batch_end_ = end;
+    keys->clear();
+    for (size_t i = begin; i < end; i++) {
+      keys->push_back(user_key((*ratings_)[i].user));
+      keys->push_back(item_key((*ratings_)[i].item));
+    }
+    std::sort(keys->begin(), keys->end());
+    keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+    batch_slots_.clear();
+    for (size_t i = begin; i < end; i++) {
+      const auto& rating = (*ratings_)[i];
+      batch_slots_.push_back(std::lower_bound(keys->begin(), keys->end(), user_key(rating.user)) - keys->begin());
+      batch_slots_.push_back(std::lower_bound(keys->begin(), keys->end(), item_key(rating.item)) - keys->begin());
+    }
+    batch_keys_ = *keys;
+  }
+
+  /**
+   * Compute the updates of the factors <vals> in the table, got for the keys of prepare_batch, i.e., the gradient
+   * of the squared error plus the regularization of the ratings of the batch scaled by -learning_rate
+   */
+  void compute_batch_update(const std::vector<Factor>& vals, std::vector<Factor>* updates) {
+    CHECK_EQ(vals.size(), batch_keys_.size());
+    factors_.resize(vals.size());
+    for (size_t j = 0; j < vals.size(); j++) {
+      factors_[j] = init_factor(batch_keys_[j]) + vals[j];
+    }
+    updates->assign(vals.size(), Factor());
+    for (size_t i = batch_begin_; i < batch_end_; i++) {
+      size_t u = batch_slots_[2 * (i - batch_begin_)];
+      size_t v = batch_slots_[2 * (i - batch_begin_) + 1];
+      const Factor& p = factors_[u];
+      const Factor& q = factors_[v];
+      float err = (*ratings_)[i].value - dot(p, q);
+      Factor& dp = (*updates)[u];
+      Factor& dq = (*updates)[v];
+      for (size_t j = 0; j < N; j++) {
+        dp[j] += learning_rate_ * (err * q[j] - lambda_ * p[j]);
+        dq[j] += learning_rate_ * (err * p[j] - lambda_ * q[j]);
+      }
+    }
+  }
+
+  /**
+   * The root mean squared error over all the ratings given the values in the table of the keys of get_keys
+   */
+  double rmse(const std::vector<Key>& keys, const std::vector<Factor>& vals) const {
+    CHECK_EQ(keys.size(), vals.size());
+    if (ratings_->empty()) {
+      return 0;
+    }
+    double sum = 0;
+    for (const auto& rating : *ratings_) {
+      size_t u = std::lower_bound(keys.begin(), keys.end(), user_key(rating.user)) - keys.begin();
+      size_t v = std::lower_bound(keys.begin(), keys.end(), item_key(rating.item)) - keys.begin();
+      double err = rating.value - dot(init_factor(keys[u]) + vals[u], init_factor(keys[v]) + vals[v]);
+      sum += err * err;
+    }
+    return std::sqrt(sum / ratings_->size());
+  }
+
+  /**
+   * All the keys of the users and items of the ratings, sorted
+   */
+  void get_keys(std::vector<Key>& keys) const {
+    std::vector<Key> all;
+    for (const auto& rating : *ratings_) {
+      all.push_back(user_key(rating.user));
+      all.push_back(item_key(rating.item));
+    }
+    std::sort(all.begin(), all.end());
+    all.erase(std::unique(all.begin(), all.end()), all.end());
+    keys.insert(keys.end(), all.begin(), all.end());
+  }
+
+private:
+  static float dot(const Factor& p, const Factor& q) {
+    float sum = 0;
+    for (size_t j = 0; j < N; j++) {
+      sum += p[j] * q[j];
+    }
+    return sum;
+  }
+
+  const std::vector<lib::Rating>* ratings_;
+  float learning_rate_;
+  float lambda_;
+  float init_scale_;
+  // the current batch
+  size_t batch_begin_ = 0;
+  size_t batch_end_ = 0;
+  std::vector<Key> batch_keys_;      // the keys of prepare_batch
+  std::vector<size_t> batch_slots_;  // the slots of the user and item of each rating in batch_keys_
+  std::vector<Factor> factors_;      // the factors of the batch keys
+};
+
+
+#endif //CSCI5570_MATRIX_FACTORIZATION_HPP
@@ -0,0 +1,125 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "app/matrix_factorization.hpp"
+
+#include <map>
+#include <random>
+#include <vector>
+
+namespace csci5570 {
+namespace {
+
+class TestMatrixFactorization : public testing::Test {
+ protected:
+  void SetUp() {
+    // the ratings of rank 2 between 30 users and 20 items, about a half of them observed
+    std::mt19937 gen(0);
+    std::normal_distribution<float> normal(0, 1);
+    std::vector<float> users(30 * 2), items(20 * 2);
+    for (auto& x : users) {
+      x = normal(gen);
+    }
+    for (auto& x : items) {
+      x = normal(gen);
+    }
+    for (uint32_t u = 0; u < 30; ++u) {
+      for (uint32_t i = 0; i < 20; ++i) {
+        if (gen() % 2 == 0) {
+          lib::Rating rating;
+          rating.user = u;
+          rating.item = i;
+          rating.value = users[2 * u] * items[2 * i] + users[2 * u + 1] * items[2 * i + 1];
+          ratings_.push_back(rating);
+        }
+      }
+    }
+  }
+
+  std::vector<lib::Rating> ratings_;
+};
+
+TEST_F(TestMatrixFactorization, BatchKeys) {
+  std::vector<lib::Rating> ratings(3);
+  ratings[0].user = 4;
+  ratings[0].item = 1;
+  ratings[1].user = 0;
+  ratings[1].item = 1;
+  ratings[2].user = 4;
+  ratings[2].item = 9;
+  MatrixFactorization<4> mf(&ratings);
+  std::vector<Key> keys;
+  mf.get_keys(keys);
+  EXPECT_EQ(keys, (std::vector<Key>{0, 3, 8, 19}));
+  // the users 4 and 0, and the item 1
+  mf.prepare_batch(0, 2, &keys);
+  EXPECT_EQ(keys, (std::vector<Key>{0, 3, 8}));
+  // the initial factors depend on the key only
+  MatrixFactorization<4> other(&ratings);
+  EXPECT_EQ(mf.init_factor(3), other.init_factor(3));
+  EXPECT_FALSE(mf.init_factor(3) == mf.init_factor(8));
+}
+
+TEST_F(TestMatrixFactorization, BatchUpdate) {
+  std::vector<lib::Rating> ratings(1);
+  ratings[0].user = 2;
+  ratings[0].item = 5;
+  ratings[0].value = 3;
+  MatrixFactorization<2> mf(&ratings, 0.5, 0);
+  std::vector<Key> keys;
+  mf.prepare_batch(0, 1, &keys);
+  ASSERT_EQ(keys, (std::vector<Key>{4, 11}));
+  // the factors are {1, 0} and {2, 1} once added to the initial ones, the error is 3 - 2 = 1
+  std::vector<MatrixFactorization<2>::Factor> vals(2), updates;
+  auto p = mf.init_factor(4), q = mf.init_factor(11);
+  vals[0][0] = 1 - p[0];
+  vals[0][1] = -p[1];
+  vals[1][0] = 2 - q[0];
+  vals[1][1] = 1 - q[1];
+  mf.compute_batch_update(vals, &updates);
+  ASSERT_EQ(updates.size(), 2);
+  EXPECT_NEAR(updates[0][0], 1, 1e-6);
+  EXPECT_NEAR(updates[0][1], 0.5, 1e-6);
+  EXPECT_NEAR(updates[1][0], 0.5, 1e-6);
+  EXPECT_NEAR(updates[1][1], 0, 1e-6);
+}
+
+TEST_F(TestMatrixFactorization, Train) {
+  using Factor = MatrixFactorization<4>::Factor;
+  MatrixFactorization<4> mf(&ratings_, 0.05, 0.001);
+  // the table on the servers
+  std::map<Key, Factor> table;
+  std::vector<Key> all_keys;
+  mf.get_keys(all_keys);
+  auto get = [&table](const std::vector<Key>& keys, std::vector<Factor>* vals) {
+    vals->clear();
+    for (Key key : keys) {
+      vals->push_back(table[key]);
+    }
+  };
+  std::vector<Factor> vals, updates;
+  get(all_keys, &vals);
+  double initial = mf.rmse(all_keys, vals);
+
+  std::mt19937 gen(0);
+  const size_t batch_size = 20;
+  std::vector<Key> keys;
+  for (int epoch = 0; epoch < 300; ++epoch) {
+    std::shuffle(ratings_.begin(), ratings_.end(), gen);
+    for (size_t begin = 0; begin < ratings_.size(); begin += batch_size) {
+      mf.prepare_batch(begin, std::min(begin + batch_size, ratings_.size()), &keys);
+      get(keys, &vals);
+      mf.compute_batch_update(vals, &updates);
+      for (size_t j = 0; j < keys.size(); ++j) {
+        table[keys[j]] += updates[j];
+      }
+    }
+  }
+  get(all_keys, &vals);
+  double trained = mf.rmse(all_keys, vals);
+  EXPECT_GT(initial, 1);
+  EXPECT_LT(trained, 0.1);
+}
+
+}  // namespace
+}  // namespace csci5570
@@ -12,6 +12,7 @@
 //#include "lib/labeled_sample.hpp"
 //#include "lib/parser.hpp"
 #include "app/logitstic_regression.hpp"
+#include "lib/csr_cache.hpp"
 
 #include <boost/algorithm/string.hpp>
 #include <boost/range/algorithm_ext.hpp>
@@ -25,6 +26,55 @@ using namespace csci5570;
 DEFINE_string(config_file, "", "The config file path");
 DEFINE_string(my_id, "", "Local node id");
 DEFINE_string(input, "", "The hdfs input url");
+DEFINE_int32(num_workers_per_node, 1, "The number of worker threads per node, each training on its own shard");
+DEFINE_int32(batch_size, 1000, "The number of samples per mini-batch");
+DEFINE_int32(num_compute_threads, 1, "The number of threads of each worker computing the gradient of a mini-batch");
+DEFINE_int32(num_iters, 1000, "The number of mini-batches per worker");
+DEFINE_int32(num_load_threads, 1, "The number of threads of each node reading and parsing its input");
+DEFINE_int32(report_interval, 100, "The number of iterations between accuracy and loss reports");
+DEFINE_string(cache, "", "The local path of a binary cache of the samples of this node: written after the first "
+              "load, then mapped by the workers instead of loading the input. Use it on all nodes or on none");
+
+/**
+ * Train on the shard of a worker, a CSRDataset or a MappedCSRDataset
+ */
+template <typename Dataset>
+void Train(const Info& info, uint32_t table_id, Dataset* shard) {
+  // algorithm helper
+  LogisticRegression<double, Dataset> lr(shard, 0.00001);
+  // key for parameters
+  std::vector<Key> keys;
+  lr.get_keys(keys);
+  LOG(INFO) << "parameter size: " << keys.size();
+
+  KVClientTable<double> table = info.CreateKVClientTable<double>(table_id);
+
+  lib::ThreadPool pool(FLAGS_num_compute_threads);
+  std::mt19937 gen(info.worker_id);
+  size_t num_batches = std::max<size_t>(shard->num_batches(FLAGS_batch_size), 1);
+  std::vector<Key> batch_keys;
+  std::vector<double> vals, grad;
+  for (int i = 0; i < FLAGS_num_iters; ++i) {
+    if (i % num_batches == 0) {
+      shard->shuffle(gen);
+    }
+    // only the parameters of the features in the batch
+    lr.prepare_batch(shard->batch(i % num_batches, FLAGS_batch_size), &batch_keys);
+    // Get appends to the values
+    vals.clear();
+    table.Get(batch_keys, &vals);
+    lr.compute_batch_gradient(vals, &grad, &pool);
+    table.Add(batch_keys, grad);
+    table.Clock();
+    if (i % FLAGS_report_interval == 0) {
+      std::vector<double> theta;
+      table.Get(keys, &theta);
+      lr.update_theta(keys, theta);
+      LOG(INFO) << "Current accuracy: " << lr.test_acc();
+      LOG(INFO) << "Current loss: " << lr.get_loss();
+    }
+  }
+}
 
 void get_nodes_from_config(std::string config_file, std::vector<Node>& nodes) {
   std::ifstream infile(config_file);
@@ -45,7 +95,6 @@ int main(int argc, char** argv) {
   google::InitGoogleLogging(argv[0]);
   FLAGS_stderrthreshold = 0;
   FLAGS_colorlogtostderr = true;
-  using DataStore = std::vector<lib::SVMSample>;
   DataStore data_store;
 
   LOG(INFO) << FLAGS_config_file;
@@ -78,10 +127,23 @@ int main(int argc, char** argv) {
    */
 
 
-  lib::Parser<lib::SVMSample, DataStore> parser;
-  lib::DataLoader<lib::SVMSample, DataStore> data_loader;
-  data_loader.load(url, hdfs_namenode, master_host, worker_host, hdfs_namenode_port, master_port, n_features,
-                                parser, &data_store, id, nodes.size());
+  // the text input is parsed once, later runs map the cache
+  lib::CSRCacheHeader cache_header;
+  std::vector<lib::CSRCacheBlock> cache_blocks;
+  bool use_cache = !FLAGS_cache.empty() && lib::CSRCache::ReadHeader(FLAGS_cache, &cache_header, &cache_blocks);
+  if (use_cache) {
+    LOG(INFO) << "Use the cache " << FLAGS_cache << " of " << cache_header.num_rows << " samples";
+  } else {
+    lib::Parser<lib::SVMSample, DataStore> parser;
+    lib::DataLoader<lib::SVMSample, DataStore> data_loader;
+    data_loader.load(url, hdfs_namenode, master_host, worker_host, hdfs_namenode_port, master_port, n_features,
+                                  parser, &data_store, id, nodes.size(), FLAGS_num_load_threads);
+    if (!FLAGS_cache.empty() && lib::CSRCache::Write(FLAGS_cache, data_store) > 0) {
+      // the workers map their blocks of the cache, the pages are shared and can be evicted
+      use_cache = true;
+      data_store = DataStore();
+    }
+  }
 
 //  lib::SVMSample sample;
 //  sample.x_ = std::vector<std::pair<int, int>>({{0, 2}, {3, 1}});
@@ -107,34 +169,27 @@ int main(int argc, char** argv) {
   MLTask task;
   std::vector<WorkerAlloc> worker_alloc;
   for (auto node : nodes) {
-    worker_alloc.push_back({node.id, 1});  // node_id, worker_num
+    worker_alloc.push_back({node.id, static_cast<uint32_t>(FLAGS_num_workers_per_node)});  // node_id, worker_num
   }
   task.SetWorkerAlloc(worker_alloc);
   task.SetTables({kTableId});     // Use table 0
-  task.SetLambda([kTableId, &data_store](const Info& info) {
+  task.SetLambda([kTableId, &data_store, use_cache](const Info& info) {
     LOG(INFO) << info.DebugString();
-    // algorithm helper
-    LogisticRegression<double> lr(&data_store, 0.00001);
-    // key for parameters
-    std::vector<Key> keys;
-    lr.get_keys(keys);
-    LOG(INFO) << "parameter size: " << keys.size();
-
-    KVClientTable<double> table = info.CreateKVClientTable<double>(kTableId);
-
-    for (int i = 0; i < 10e2; ++i) {
-      // parameters from server
-      std::vector<double> theta;
-      table.Get(keys, &theta);
-      lr.update_theta(keys, theta);
-      std::vector<double> grad;
-      lr.compute_gradient(grad);
-      table.Add(keys, grad);
-      table.Clock();
-      if(i % 5 == 0) {
-        LOG(INFO) << "Current accuracy: " << lr.test_acc();
-        LOG(INFO) << "Current loss: " << lr.get_loss();
-      }
+    if (use_cache) {
+      // the blocks of the cache owned by this worker, mapped in place
+      lib::MappedCSRDataset shard;
+      CHECK(lib::CSRCache::Map(FLAGS_cache, info.local_id, info.num_local_workers, &shard))
+          << "Cannot map the cache " << FLAGS_cache;
+      LOG(INFO) << "Worker " << info.worker_id << " trains on " << shard.size() << " samples mapped from "
+                << FLAGS_cache;
+      Train(info, kTableId, &shard);
+    } else {
+      // the shard of the local samples owned by this worker, copied on its own thread
+      auto range = info.GetLocalShard(data_store.size());
+      DataStore shard = data_store.slice(range.first, range.second);
+      LOG(INFO) << "Worker " << info.worker_id << " trains on " << shard.size() << " of " << data_store.size()
+                << " local samples";
+      Train(info, kTableId, &shard);
     }
     // print theta
     /*
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <random>
+#include <thread>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "driver/engine.hpp"
+#include "app/matrix_factorization.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <fstream>
+#include <lib/svm_loader.hpp>
+
+using namespace csci5570;
+
+DEFINE_string(config_file, "", "The config file path");
+DEFINE_string(my_id, "", "Local node id");
+DEFINE_string(input, "", "The hdfs input url of the ratings, lines of <user> <item> <rating>");
+DEFINE_int32(num_workers_per_node, 1, "The number of worker threads per node, each training on its own shard");
+DEFINE_int32(batch_size, 1000, "The number of ratings per mini-batch");
+DEFINE_int32(num_iters, 1000, "The number of mini-batches per worker");
+DEFINE_int32(num_load_threads, 1, "The number of threads of each node reading and parsing its input");
+DEFINE_int32(report_interval, 100, "The number of iterations between RMSE reports");
+DEFINE_double(learning_rate, 0.01, "The learning rate of SGD");
+DEFINE_double(lambda, 0.05, "The L2 regularization of the factors");
+
+// the dimension of the factors, the size of the values of the table
+const size_t kDim = 16;
+using MF = MatrixFactorization<kDim>;
+using Ratings = std::vector<lib::Rating>;
+
+void get_nodes_from_config(std::string config_file, std::vector<Node>& nodes) {
+  std::ifstream infile(config_file);
+  std::string line;
+  while (std::getline(infile, line)) {
+    std::vector<std::string> cols;
+    boost::split(cols, line, [](char c){return c == ':';});
+    uint32_t node_id = std::stoi(cols[0]);
+    std::string host_name = cols[1];
+    boost::trim(host_name);
+    int port = std::stoi(cols[2]);
+    nodes.push_back(Node({node_id, host_name, port}));
+  }
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+  Ratings ratings;
+
+  std::vector<Node> nodes;
+  get_nodes_from_config(FLAGS_config_file, nodes);
+  uint32_t my_id = std::stoi(FLAGS_my_id);
+  auto node = std::find_if(nodes.begin(), nodes.end(), [my_id](Node& n){return n.id == my_id;});
+  if (node == nodes.end()) {
+    LOG(INFO) << "My_id not in nodes list.";
+    return -1;
+  }
+
+  /*
+   * Begin IO config
+   */
+  std::string url = FLAGS_input;
+  std::string hdfs_namenode = "proj10";      // Do not change
+  std::string master_host = "proj10";        // Set to worker name
+  std::string worker_host = node->hostname;  // Set to worker name
+  uint32_t id = node->id;
+  int hdfs_namenode_port = 9000;
+  int master_port = 19817;  // use a random port number to avoid collision with other users
+  /*
+   * End IO config
+   */
+
+  lib::Parser<lib::Rating, Ratings> parser;
+  lib::DataLoader<lib::Rating, Ratings> data_loader;
+  data_loader.load(url, hdfs_namenode, master_host, worker_host, hdfs_namenode_port, master_port, 0, parser,
+                   &ratings, id, nodes.size(), FLAGS_num_load_threads);
+
+  Engine engine(*node, nodes);
+
+  // 1. Start system
+  engine.StartEverything();
+
+  // 1.1 Create table, the factors of the users and items
+  const auto kTableId = engine.CreateTable<MF::Factor>(ModelType::ASP, StorageType::Map);  // table 0
+
+  // 1.2 Load data
+  engine.Barrier();
+
+  // 2. Start training task
+  MLTask task;
+  std::vector<WorkerAlloc> worker_alloc;
+  for (auto node : nodes) {
+    worker_alloc.push_back({node.id, static_cast<uint32_t>(FLAGS_num_workers_per_node)});  // node_id, worker_num
+  }
+  task.SetWorkerAlloc(worker_alloc);
+  task.SetTables({kTableId});     // Use table 0
+  task.SetLambda([kTableId, &ratings](const Info& info) {
+    LOG(INFO) << info.DebugString();
+    // the shard of the local ratings owned by this worker, copied on its own thread
+    auto range = info.GetLocalShard(ratings.size());
+    Ratings shard(ratings.begin() + range.first, ratings.begin() + range.second);
+    LOG(INFO) << "Worker " << info.worker_id << " trains on " << shard.size() << " of " << ratings.size()
+              << " local ratings";
+    MF mf(&shard, FLAGS_learning_rate, FLAGS_lambda);
+    std::vector<Key> keys;
+    mf.get_keys(keys);
+    LOG(INFO) << "Number of factors: " << keys.size();
+
+    KVClientTable<MF::Factor> table = info.CreateKVClientTable<MF::Factor>(kTableId);
+
+    std::mt19937 gen(info.worker_id);
+    size_t batch_size = std::max(FLAGS_batch_size, 1);
+    size_t num_batches = std::max<size_t>((shard.size() + batch_size - 1) / batch_size, 1);
+    std::vector<Key> batch_keys;
+    std::vector<MF::Factor> vals, updates;
+    for (int i = 0; i < FLAGS_num_iters; ++i) {
+      if (i % num_batches == 0) {
+        std::shuffle(shard.begin(), shard.end(), gen);
+      }
+      // only the factors of the users and items in the batch
+      size_t begin = std::min(i % num_batches * batch_size, shard.size());
+      mf.prepare_batch(begin, std::min(begin + batch_size, shard.size()), &batch_keys);
+      // Get appends to the values
+      vals.clear();
+      table.Get(batch_keys, &vals);
+      mf.compute_batch_update(vals, &updates);
+      table.Add(batch_keys, updates);
+      table.Clock();
+      if (i % FLAGS_report_interval == 0) {
+        std::vector<MF::Factor> factors;
+        table.Get(keys, &factors);
+        LOG(INFO) << "Current RMSE: " << mf.rmse(keys, factors);
+      }
+    }
+    LOG(INFO) << "Task completed.";
+  });
+
+  engine.Run(task);
+
+  // 3. Stop
+  engine.StopEverything();
+  return 0;
+}
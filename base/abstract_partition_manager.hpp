@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <cinttypes>
+#include <map>
+#include <mutex>
 #include <vector>
 
 #include "base/magic.hpp"
@@ -29,8 +32,35 @@ class AbstractPartitionManager {
   // slice key-value pairs into <server_id, key_value_partition> pairs
   virtual void Slice(const KVPairs& kvs, std::vector<std::pair<int, KVPairs>>* sliced) const = 0;
 
+  // send the keys of server <from> to server <to> from now on, e.g., when <to> takes over the shard of a failed <from>
+  void Redirect(uint32_t from, uint32_t to) {
+    std::lock_guard<std::mutex> lk(redirect_mu_);
+    for (auto& kv : redirects_) {
+      if (kv.second == from) {
+        kv.second = to;
+      }
+    }
+    redirects_[from] = to;
+    has_redirects_ = true;
+  }
+
+  // the server currently holding the shard of <server_id>
+  uint32_t Route(uint32_t server_id) const {
+    if (!has_redirects_) {
+      return server_id;
+    }
+    std::lock_guard<std::mutex> lk(redirect_mu_);
+    auto it = redirects_.find(server_id);
+    return it == redirects_.end() ? server_id : it->second;
+  }
+
  protected:
   std::vector<uint32_t> server_thread_ids_;
+
+ private:
+  std::atomic<bool> has_redirects_{false};
+  mutable std::mutex redirect_mu_;
+  std::map<uint32_t, uint32_t> redirects_;
 };  // class AbstractPartitionManager
 
 }  // namespace csci5570
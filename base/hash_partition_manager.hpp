@@ -23,7 +23,7 @@ class HashPartitionManager : public AbstractPartitionManager {
     uint32_t server_id_num = server_thread_ids_.size();
     std::unordered_map<uint32_t, Keys> server2keys;
     for (uint32_t key : keys) {
-        uint32_t server_id = server_thread_ids_[key % server_id_num];
+        uint32_t server_id = Route(server_thread_ids_[key % server_id_num]);
 
         if (server2keys.find(server_id) != server2keys.end()) {
             server2keys[server_id].push_back(key);
@@ -42,7 +42,7 @@ class HashPartitionManager : public AbstractPartitionManager {
       for (uint32_t i = 0; i < kvs.first.size(); i++) {
           uint32_t key = kvs.first[i];
           double val = kvs.second[i];
-          uint32_t server_id = server_thread_ids_[key % server_id_num];
+          uint32_t server_id = Route(server_thread_ids_[key % server_id_num]);
 
           if (server2kvs.find(server_id) != server2kvs.end()) {
               server2kvs[server_id].first.push_back(key);
@@ -11,14 +11,17 @@ namespace csci5570 {
 
 struct Control {};
 
-enum class Flag : char { kExit, kBarrier, kResetWorkerInModel, kClock, kAdd, kGet };
-static const char* FlagName[] = {"kExit", "kBarrier", "kResetWorkerInModel", "kClock", "kAdd", "kGet"};
+enum class Flag : char {
+  kExit, kBarrier, kResetWorkerInModel, kClock, kAdd, kGet, kHeartbeat, kReplicate, kReplicateAck, kFailover
+};
+static const char* FlagName[] = {"kExit", "kBarrier", "kResetWorkerInModel", "kClock", "kAdd", "kGet", "kHeartbeat",
+                                 "kReplicate", "kReplicateAck", "kFailover"};
 
 struct Meta {
   int sender;
   int recver;
   int model_id;
-  Flag flag;  // {kExit, kBarrier, kResetWorkerInModel, kClock, kAdd, kGet}
+  Flag flag;  // {kExit, kBarrier, kResetWorkerInModel, kClock, kAdd, kGet, kHeartbeat, kReplicate, ...}
 
   std::string DebugString() const {
     std::stringstream ss;
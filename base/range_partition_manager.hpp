@@ -26,7 +26,7 @@ class RangePartitionManager : public AbstractPartitionManager {
       }
       i++;
     }
-    return server_thread_ids_[i];
+    return Route(server_thread_ids_[i]);
   }
 
   void Slice(const Keys& keys, std::vector<std::pair<int, Keys>>* sliced) const override {
@@ -55,4 +55,26 @@ TEST_F(TestRangePartitionManager, SliceKVs) {
   EXPECT_DOUBLE_EQ(sliced[2].second.second[0], .9);
 }
 
+TEST_F(TestRangePartitionManager, Redirect) {
+  RangePartitionManager pm({0, 1, 2}, {{0, 4}, {4, 8}, {8, 10}});
+  pm.Redirect(1, 2);
+  third_party::SArray<Key> keys({2, 5, 9});
+  std::vector<std::pair<int, AbstractPartitionManager::Keys>> sliced;
+  pm.Slice(keys, &sliced);
+
+  ASSERT_EQ(sliced.size(), 2);  // the keys of server 1 go to server 2
+  EXPECT_EQ(sliced[0].first, 0);
+  EXPECT_EQ(sliced[1].first, 2);
+  ASSERT_EQ(sliced[1].second.size(), 2);  // keys 5, 9
+  EXPECT_EQ(sliced[1].second[0], 5);
+  EXPECT_EQ(sliced[1].second[1], 9);
+
+  pm.Redirect(2, 0);  // server 2 fails as well
+  sliced.clear();
+  pm.Slice(keys, &sliced);
+  ASSERT_EQ(sliced.size(), 1);
+  EXPECT_EQ(sliced[0].first, 0);
+  EXPECT_EQ(sliced[0].second.size(), 3);
+}
+
 }  // namespace csci5570
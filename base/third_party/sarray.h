@@ -51,9 +51,9 @@ class SArray {
   /**
    * \brief Create an array with length n with initialized value
    * \param size the length
-   * \param val the initial length (0 in default)
+   * \param val the initial length (V() in default, e.g. 0)
    */
-  explicit SArray(size_t size, V val = 0) { resize(size, val); }
+  explicit SArray(size_t size, V val = V()) { resize(size, val); }
 
 
   /**
@@ -176,7 +176,7 @@ class SArray {
    * If size <= capacity_, then only change the size. otherwise, append size -
    * current_size entries, and then set new value to val
    */
-  void resize(size_t size, V val = 0) {
+  void resize(size_t size, V val = V()) {
     size_t cur_n = size_;
     if (capacity_ >= size) {
       size_ = size;
@@ -187,7 +187,9 @@ class SArray {
     }
     if (size <= cur_n) return;
     V* p = data() + cur_n;
-    if (val == 0) {
+    // compare the bytes so that V needs no operator==, e.g. a vector value
+    V zero = V();
+    if (memcmp(&val, &zero, sizeof(V)) == 0) {
       memset(p, 0, (size - cur_n)*sizeof(V));
     } else {
       for (size_t i = 0; i < size - cur_n; ++i) { *p = val; ++p; }
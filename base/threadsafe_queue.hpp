@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -31,6 +32,18 @@ class ThreadsafeQueue {
     queue_.pop();
   }
 
+  // Return false if the queue is still empty after <timeout>
+  template <typename Rep, typename Period>
+  bool WaitAndPopFor(T* elem, const std::chrono::duration<Rep, Period>& timeout) {
+    std::unique_lock<std::mutex> lk(mu_);
+    if (!cond_.wait_for(lk, timeout, [this] { return !queue_.empty(); })) {
+      return false;
+    }
+    *elem = std::move(queue_.front());
+    queue_.pop();
+    return true;
+  }
+
   int Size() {
     std::lock_guard<std::mutex> lk(mu_);
     return queue_.size();
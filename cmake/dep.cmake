@@ -22,3 +22,35 @@ if(WITHOUT_HDFS)
     unset(LIBHDFS3_FOUND)
     message(STATUS "Not using libhdfs3 due to WITHOUT_HDFS option")
 endif(WITHOUT_HDFS)
+
+### Compression libraries, for compressed input ###
+
+find_path(ZLIB_INCLUDE_DIR NAMES zlib.h)
+find_library(ZLIB_LIBRARY NAMES z)
+if(ZLIB_INCLUDE_DIR AND ZLIB_LIBRARY)
+    set(ZLIB_FOUND true)
+    set(ZLIB_DEFINITION "-DWITH_GZIP")
+    message (STATUS "Found zlib: ${ZLIB_LIBRARY}")
+else(ZLIB_INCLUDE_DIR AND ZLIB_LIBRARY)
+    message(STATUS "Could NOT find zlib, gzip input is not supported")
+endif(ZLIB_INCLUDE_DIR AND ZLIB_LIBRARY)
+
+find_path(ZSTD_INCLUDE_DIR NAMES zstd.h)
+find_library(ZSTD_LIBRARY NAMES zstd)
+if(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    set(ZSTD_FOUND true)
+    set(ZSTD_DEFINITION "-DWITH_ZSTD")
+    message (STATUS "Found zstd: ${ZSTD_LIBRARY}")
+else(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+    message(STATUS "Could NOT find zstd, zstd input is not supported")
+endif(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+
+find_path(LZ4_INCLUDE_DIR NAMES lz4frame.h)
+find_library(LZ4_LIBRARY NAMES lz4)
+if(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+    set(LZ4_FOUND true)
+    set(LZ4_DEFINITION "-DWITH_LZ4")
+    message (STATUS "Found lz4: ${LZ4_LIBRARY}")
+else(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
+    message(STATUS "Could NOT find lz4, lz4 input is not supported")
+endif(LZ4_INCLUDE_DIR AND LZ4_LIBRARY)
@@ -82,7 +82,9 @@ void Mailbox::CloseSockets() {
   CHECK(rc == 0 || errno == ETERM);
   CHECK_EQ(zmq_close(receiver_), 0);
   for (auto& it : senders_) {
-    int rc = zmq_setsockopt(it.second, ZMQ_LINGER, &linger, sizeof(linger));
+    // pending messages to a dead node would never be sent
+    int node_linger = dead_nodes_.count(it.first) ? 0 : linger;
+    int rc = zmq_setsockopt(it.second, ZMQ_LINGER, &node_linger, sizeof(node_linger));
     CHECK(rc == 0 || errno == ETERM);
     CHECK_EQ(zmq_close(it.second), 0);
   }
@@ -131,14 +133,23 @@ void Mailbox::Receiving() {
       break;
     } else if (msg.meta.flag == Flag::kBarrier) {
       std::unique_lock<std::mutex> lk(mu_);
+      if (dead_nodes_.count(msg.meta.sender)) {
+        continue;
+      }
       barrier_count_ += 1;
-      if (barrier_count_ == nodes_.size()) {
+      if (barrier_count_ == NumLiveNodes()) {
         VLOG(1) << "Collected " << nodes_.size() << " barrier, Node:"
           << node_.id << " unblocking main thread";
         barrier_cond_.notify_one();
       }
     } else {
       CHECK(queue_map_.find(msg.meta.recver) != queue_map_.end());
+      // a reply arriving late from a dead node is dropped, its requests were sent again to the new owners
+      std::lock_guard<std::mutex> lk(mu_);
+      if (dead_nodes_.count(id_mapper_->GetNodeIdForThread(msg.meta.sender))) {
+        VLOG(1) << "drop message from dead node";
+        continue;
+      }
       queue_map_[msg.meta.recver]->Push(std::move(msg));
     }
   }
@@ -154,6 +165,10 @@ int Mailbox::Send(const Message& msg) {
   } else {
     id = id_mapper_->GetNodeIdForThread(msg.meta.recver);
   }
+  if (dead_nodes_.count(id)) {
+    VLOG(1) << "drop message to dead node " << id;
+    return -1;
+  }
   auto it = senders_.find(id);
   if (it == senders_.end()) {
     LOG(WARNING) << "there is no socket to node " << id;
@@ -269,8 +284,22 @@ void Mailbox::Barrier() {
   }
   std::unique_lock<std::mutex> lk(mu_);
   // Very tricky. Consider to use all-one-all method instead of all-all.
-  barrier_cond_.wait(lk, [this]() { return barrier_count_ >= nodes_.size(); });
-  barrier_count_ -= nodes_.size();
+  barrier_cond_.wait(lk, [this]() { return barrier_count_ >= NumLiveNodes(); });
+  barrier_count_ -= NumLiveNodes();
+}
+
+void Mailbox::MarkDead(uint32_t node_id) {
+  std::lock_guard<std::mutex> lk(mu_);
+  if (node_id == node_.id || !dead_nodes_.insert(node_id).second) {
+    return;
+  }
+  LOG(WARNING) << "Node " << node_.id << " marks node " << node_id << " as dead";
+  // a barrier may be waiting for the dead node
+  barrier_cond_.notify_one();
+}
+
+size_t Mailbox::NumLiveNodes() const {
+  return nodes_.size() - dead_nodes_.size();
 }
 
 }  // namespace csci5570
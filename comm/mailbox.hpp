@@ -6,6 +6,7 @@
 
 #include <atomic>
 #include <map>
+#include <set>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -24,6 +25,8 @@ class Mailbox : public AbstractMailbox {
   void Stop();
   size_t GetQueueMapSize() const;
   void Barrier();
+  // Stop sending to a failed node and stop waiting for it in barriers
+  void MarkDead(uint32_t node_id);
 
   // For testing only
   void ConnectAndBind();
@@ -35,6 +38,8 @@ class Mailbox : public AbstractMailbox {
   void Bind(const Node& node);
 
   void Receiving();
+  // The number of nodes not marked dead, should be called with mu_ held
+  size_t NumLiveNodes() const;
 
   std::map<uint32_t, ThreadsafeQueue<Message>* const> queue_map_;
   // Not owned
@@ -51,6 +56,7 @@ class Mailbox : public AbstractMailbox {
   std::unordered_map<uint32_t, void*> senders_;
   void* receiver_ = nullptr;
   std::mutex mu_;
+  std::set<uint32_t> dead_nodes_;
 
   // barrier
   std::mutex barrier_mu_;
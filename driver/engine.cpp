@@ -21,6 +21,7 @@ void Engine::StartEverything(int num_server_threads_per_node) {
   StartSender();
   StartServerThreads();
   StartWorkerThreads();
+  StartHeartbeatThread();
   StartMailbox();
 }
 void Engine::CreateIdMapper(int num_server_threads_per_node) {
@@ -49,6 +50,98 @@ void Engine::StartWorkerThreads() {
     worker_thread_group_.push_back(std::move(worker_thread));
   }
 }
+void Engine::StartHeartbeatThread() {
+  if (heartbeat_interval_.count() == 0) {return;}
+  std::map<uint32_t, uint32_t> peers;
+  for (const auto& node : nodes_) {
+    if (node.id != node_.id) {
+      peers[node.id] = node.id * SimpleIdMapper::kMaxThreadsPerNode + SimpleIdMapper::kHeartbeatThreadId;
+    }
+  }
+  uint32_t heartbeat_id = node_.id * SimpleIdMapper::kMaxThreadsPerNode + SimpleIdMapper::kHeartbeatThreadId;
+  auto on_failure = [this, heartbeat_id](uint32_t node_id, const std::vector<uint32_t>& tids) {
+    mailbox_->MarkDead(node_id);
+    // drop the threads from every table on the local servers, the replies come back to the heartbeat thread
+    third_party::SArray<uint32_t> dead_tids(tids);
+    size_t model_count = model_count_;
+    for (auto& server_thread : server_thread_group_) {
+      for (uint32_t model_id = 0; model_id < model_count; ++model_id) {
+        Message reset_msg;
+        reset_msg.meta.model_id = model_id;
+        reset_msg.meta.flag = Flag::kResetWorkerInModel;
+        reset_msg.meta.recver = server_thread->GetServerId();
+        reset_msg.meta.sender = heartbeat_id;
+        reset_msg.AddData(third_party::SArray<uint32_t>());
+        reset_msg.AddData(dead_tids);
+        server_thread->GetWorkQueue()->Push(reset_msg);
+      }
+    }
+    if (num_backups_ > 0) {
+      Failover(node_id, heartbeat_id);
+    }
+  };
+  heartbeat_thread_.reset(new HeartbeatThread(heartbeat_id, peers, sender_->GetMessageQueue(), heartbeat_interval_,
+                                              heartbeat_timeout_, on_failure));
+  heartbeat_thread_->Start();
+  mailbox_->RegisterQueue(heartbeat_id, heartbeat_thread_->GetWorkQueue());
+}
+void Engine::Failover(uint32_t node_id, uint32_t heartbeat_id) {
+  dead_nodes_.insert(node_id);
+  size_t model_count = model_count_;
+  std::lock_guard<std::mutex> lk(partition_manager_mu_);
+  for (uint32_t model_id = 0; model_id < model_count; ++model_id) {
+    AbstractPartitionManager* pm = partition_manager_map_.at(model_id).get();
+    const std::vector<uint32_t>& server_ids = pm->GetServerThreadIds();
+    third_party::SArray<uint32_t> failed_ids;
+    std::map<uint32_t, third_party::SArray<uint32_t>> promoted;  // {local server: the shards it takes over}
+    for (uint32_t sid : server_ids) {
+      if (sid / SimpleIdMapper::kMaxThreadsPerNode != node_id) {continue;}
+      failed_ids.push_back(sid);
+      bool taken_over = false;
+      for (uint32_t backup_id : GetBackupServers(sid, server_ids)) {
+        uint32_t backup_node = backup_id / SimpleIdMapper::kMaxThreadsPerNode;
+        if (dead_nodes_.find(backup_node) != dead_nodes_.end()) {continue;}
+        pm->Redirect(sid, backup_id);
+        if (backup_node == node_.id) {
+          promoted[backup_id].push_back(sid);
+        }
+        taken_over = true;
+        break;
+      }
+      if (!taken_over) {
+        LOG(WARNING) << "The shard of model " << model_id << " on server " << sid << " is lost with all its backups";
+      }
+    }
+    for (auto& server_thread : server_thread_group_) {
+      Message failover_msg;
+      failover_msg.meta.model_id = model_id;
+      failover_msg.meta.flag = Flag::kFailover;
+      failover_msg.meta.recver = server_thread->GetServerId();
+      failover_msg.meta.sender = heartbeat_id;
+      failover_msg.AddData(failed_ids);
+      failover_msg.AddData(promoted[server_thread->GetServerId()]);
+      server_thread->GetWorkQueue()->Push(failover_msg);
+    }
+    // the local workers send their outstanding requests to the failed servers again, after the redirects above
+    std::lock_guard<std::mutex> threads_lk(local_threads_mu_);
+    for (uint32_t thread_id : local_threads_) {
+      Message failover_msg;
+      failover_msg.meta.model_id = model_id;
+      failover_msg.meta.flag = Flag::kFailover;
+      failover_msg.meta.recver = thread_id;
+      failover_msg.meta.sender = heartbeat_id;
+      failover_msg.AddData(failed_ids);
+      // through the queue of the helper thread, after the replies it already received
+      uint32_t helper_thread_id = id_mapper_->GetHelperForWorker(thread_id);
+      for (auto& helper_thread : worker_thread_group_) {
+        if (helper_thread->GetId() == helper_thread_id) {
+          helper_thread->GetWorkQueue()->Push(failover_msg);
+          break;
+        }
+      }
+    }
+  }
+}
 void Engine::StartMailbox() {
   mailbox_->Start();
 }
@@ -81,9 +174,19 @@ void Engine::StopWorkerThreads() {
 }
 void Engine::StopSender() {
   mailbox_->Barrier();
+  // all nodes are done, silence is no longer a failure
+  StopHeartbeatThread();
   sender_->Stop();
   LOG(INFO) << "StopSender";
 }
+void Engine::StopHeartbeatThread() {
+  if (!heartbeat_thread_) {return;}
+  Message exit_msg;
+  exit_msg.meta.flag = Flag::kExit;
+  heartbeat_thread_->GetWorkQueue()->Push(exit_msg);
+  heartbeat_thread_->Stop();
+  LOG(INFO) << "StopHeartbeatThread";
+}
 void Engine::StopMailbox() {
   mailbox_->Stop();
   LOG(INFO) << "StopMailbox";
@@ -150,15 +253,25 @@ void Engine::Run(const MLTask& task) {
   for (uint32_t table_id : tables) {
     InitTable(table_id, thread_ids);
   }
+  if (heartbeat_thread_) {
+    heartbeat_thread_->SetLocalThreads(thread_ids);
+  }
+  {
+    std::lock_guard<std::mutex> lk(local_threads_mu_);
+    local_threads_ = thread_ids;
+  }
   for(uint32_t i = 0; i < worker_ids.size(); i++) {
     uint32_t thread_id = thread_ids[i];
     uint32_t worker_id = worker_ids[i];
+    uint32_t num_local_workers = worker_ids.size();
 
     std::thread thread(
-      [thread_id, worker_id, &task, this]() {
+      [thread_id, worker_id, i, num_local_workers, &task, this]() {
         Info info;
         info.thread_id = thread_id;
         info.worker_id = worker_id;
+        info.local_id = i;
+        info.num_local_workers = num_local_workers;
         info.send_queue = sender_->GetMessageQueue();
         for(auto& kv : partition_manager_map_) {
           info.partition_manager_map[kv.first] = kv.second.get();
@@ -175,10 +288,39 @@ void Engine::Run(const MLTask& task) {
       th.join();
     }
   }
+  if (heartbeat_thread_) {
+    heartbeat_thread_->SetLocalThreads({});
+  }
+  std::lock_guard<std::mutex> lk(local_threads_mu_);
+  local_threads_.clear();
 }
 
 void Engine::RegisterPartitionManager(uint32_t table_id, std::unique_ptr<AbstractPartitionManager>&& partition_manager) {
+  std::lock_guard<std::mutex> lk(partition_manager_mu_);
   partition_manager_map_[table_id] = std::move(partition_manager);
 }
 
+std::vector<uint32_t> Engine::GetBackupServers(uint32_t primary_id, const std::vector<uint32_t>& server_ids) const {
+  std::map<uint32_t, std::vector<uint32_t>> node_servers;  // {node id: the servers of the table on it}
+  for (uint32_t sid : server_ids) {
+    node_servers[sid / SimpleIdMapper::kMaxThreadsPerNode].push_back(sid);
+  }
+  uint32_t primary_node = primary_id / SimpleIdMapper::kMaxThreadsPerNode;
+  const std::vector<uint32_t>& primaries = node_servers[primary_node];
+  size_t index = std::find(primaries.begin(), primaries.end(), primary_id) - primaries.begin();
+  CHECK_LT(index, primaries.size()) << "Server " << primary_id << " does not hold the table";
+  size_t pos = 0;
+  while (pos < nodes_.size() && nodes_[pos].id != primary_node) {
+    ++pos;
+  }
+  CHECK_LT(pos, nodes_.size());
+  std::vector<uint32_t> backup_ids;
+  for (size_t i = 1; i < nodes_.size() && backup_ids.size() < static_cast<size_t>(num_backups_); ++i) {
+    auto it = node_servers.find(nodes_[(pos + i) % nodes_.size()].id);
+    if (it == node_servers.end()) {continue;}
+    backup_ids.push_back(it->second[index % it->second.size()]);
+  }
+  return backup_ids;
+}
+
 }  // namespace csci5570
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
 #include <vector>
 
 #include "base/abstract_partition_manager.hpp"
@@ -9,11 +15,14 @@
 #include "server/consistency/ssp_model.hpp"
 #include "server/consistency/asp_model.hpp"
 #include "server/consistency/bsp_model.hpp"
+#include "server/consistency/key_ssp_model.hpp"
 #include "server/abstract_storage.hpp"
 #include "server/map_storage.hpp"
+#include "server/snapshot_storage.hpp"
 #include "base/node.hpp"
 #include "comm/mailbox.hpp"
 #include "comm/sender.hpp"
+#include "driver/heartbeat_thread.hpp"
 #include "driver/ml_task.hpp"
 #include "driver/simple_id_mapper.hpp"
 #include "driver/worker_spec.hpp"
@@ -24,8 +33,8 @@
 
 namespace csci5570 {
 
-enum class ModelType { SSP, BSP, ASP };
-enum class StorageType { Map };  // May have Vector
+enum class ModelType { SSP, BSP, ASP, KeySSP, AdaptiveSSP };
+enum class StorageType { Map, Snapshot };  // May have Vector
 
 class Engine {
  public:
@@ -55,6 +64,7 @@ class Engine {
   void StartWorkerThreads();
   void StartMailbox();
   void StartSender();
+  void StartHeartbeatThread();
 
   /**
    * The flow of stopping the engine:
@@ -68,6 +78,7 @@ class Engine {
   void StopWorkerThreads();
   void StopSender();
   void StopMailbox();
+  void StopHeartbeatThread();
 
   /**
    * Synchronization barrier for processes
@@ -80,44 +91,105 @@ class Engine {
    */
   WorkerSpec AllocateWorkers(const std::vector<WorkerAlloc>& worker_alloc);
 
+  /**
+   * Checkpoint the tables created afterwards under <dir> every <interval> clocks,
+   * and restore them from the checkpoints already there
+   *
+   * @param dir         the checkpoint directory on the local disk of each node
+   * @param interval    the number of clocks between two checkpoints, all but the first write only the
+   *                    updated parameters
+   * @param compact_every the number of such delta checkpoints merged into a full one at once
+   */
+  void SetCheckpoint(const std::string& dir, int interval,
+                     int compact_every = Checkpointer::kDefaultCompactEvery) {
+    checkpoint_dir_ = dir;
+    checkpoint_interval_ = interval;
+    checkpoint_compact_every_ = compact_every;
+  }
+
+  /**
+   * Detect failed nodes by heartbeats, should be called before StartEverything() with the same
+   * arguments on all nodes.
+   *
+   * When a node stays silent for <timeout>, its app threads are dropped from all the tables on the
+   * local servers, so that the others are no longer held back by their frozen progress, and the
+   * node is no longer waited for in barriers.
+   *
+   * @param interval    the time between two heartbeats
+   * @param timeout     the silence after which a node is considered dead
+   */
+  void SetFailureDetection(std::chrono::milliseconds interval, std::chrono::milliseconds timeout) {
+    heartbeat_interval_ = interval;
+    heartbeat_timeout_ = timeout;
+  }
+
+  /**
+   * Replicate the shard of each table created afterwards to <num_backups> server threads on the
+   * following nodes, should be called before creating the tables with the same arguments on all nodes.
+   *
+   * The updates are shipped to the backups in one batch per clock. A server waits for its backups
+   * once they lag more than <max_lag> clocks behind. With failure detection enabled, the shards of a
+   * failed node are taken over by their first live backups and the workers are redirected to them.
+   *
+   * @param num_backups the number of backups of each shard
+   * @param max_lag     the number of clocks the backups may lag behind
+   */
+  void SetReplication(int num_backups, int max_lag = Replicator::kDefaultMaxLag) {
+    num_backups_ = num_backups;
+    replication_max_lag_ = max_lag;
+  }
+
+  /**
+   * Returns the server threads holding the backups of the shard of <primary_id>: one on each of the
+   * next nodes, at the same position among the servers of the node as <primary_id> among its own
+   *
+   * @param primary_id  the server thread holding the shard
+   * @param server_ids  the server threads of the table
+   */
+  std::vector<uint32_t> GetBackupServers(uint32_t primary_id, const std::vector<uint32_t>& server_ids) const;
+
+  /**
+   * Serve the Gets of each shard of the snapshot tables created afterwards with <num_readers> threads, should be
+   * called before creating the tables
+   *
+   * @param num_readers the number of reader threads per shard, off the server thread
+   */
+  void SetSnapshotReaders(int num_readers) { snapshot_num_readers_ = num_readers; }
+
   /**
    * Create the partitions of a model on the local servers
    * 1. Assign a table id (incremental and consecutive)
    * 2. Register the partition manager to the model
    * 3. For each local server thread maintained by the engine
    *    a. Create a storage according to <storage_type>
-   *    b. Create a model according to <model_type>
-   *    c. Register the model to the server thread
+   *    b. Create a model according to <model_type>, its storage and clocks restored from the checkpoint if any
+   *    c. Register the model (and its checkpointer) to the server thread
+   *    d. Register the replicator of the shard and the backups held for other servers, if replicated
    *
    * @param partition_manager   the model partition manager
-   * @param model_type          the consistency of model - bsp, ssp, asp
-   * @param storage_type        the storage type - map, vector...
-   * @param model_staleness     the staleness for ssp model
+   * @param model_type          the consistency of model - bsp, ssp, asp, key_ssp (staleness bounded per key range),
+   *                            adaptive_ssp (staleness adapted to stragglers)
+   * @param storage_type        the storage type - map, snapshot (Gets served by reader threads, see
+   *                            SetSnapshotReaders), vector...
+   * @param model_staleness     the staleness for ssp and key_ssp model, the min staleness for adaptive_ssp model
+   * @param model_max_staleness the max staleness for adaptive_ssp model
    * @return                    the created table(model) id
    */
   template <typename Val>
   uint32_t CreateTable(std::unique_ptr<AbstractPartitionManager>&& partition_manager, ModelType model_type,
-                       StorageType storage_type, int model_staleness = 0) {
+                       StorageType storage_type, int model_staleness = 0, int model_max_staleness = 0) {
     // TODO: support vector storage
     // 1. Assign a table id (incremental and consecutive)
-    uint32_t model_id = model_count_++;
+    uint32_t model_id = model_count_;
     // 2. Register the partition manager to the model
+    const std::vector<uint32_t> server_ids = partition_manager->GetServerThreadIds();
     RegisterPartitionManager(model_id, std::move(partition_manager));
     // 3. Register model for each local server thread
-    using StoragePtr = std::unique_ptr<AbstractStorage>;
     using ModelPtr = std::unique_ptr<AbstractModel>;
     for (auto& server_thread : server_thread_group_) {
-      StoragePtr storage;
+      std::unique_ptr<AbstractStorage> storage = CreateStorage<Val>(storage_type);
       ModelPtr model;
       ThreadsafeQueue<Message>* reply_queue = sender_->GetMessageQueue();
-      switch(storage_type) {
-        case StorageType::Map:
-          storage = std::move(static_cast<StoragePtr>(new MapStorage<Val>()));
-          break;
-        default:
-          storage = std::move(static_cast<StoragePtr>(new MapStorage<Val>()));
-          break;
-      }
       switch(model_type) {
         case ModelType::SSP:
           model = std::move(static_cast<ModelPtr>(
@@ -131,14 +203,49 @@ class Engine {
           model = std::move(static_cast<ModelPtr>(
                                     new BSPModel(model_id, std::move(storage), reply_queue)));
           break;
+        case ModelType::KeySSP:
+          model = std::move(static_cast<ModelPtr>(
+                                    new KeySSPModel(model_id, std::move(storage), model_staleness, reply_queue)));
+          break;
+        case ModelType::AdaptiveSSP:
+          model = std::move(static_cast<ModelPtr>(
+                                    new SSPModel(model_id, std::move(storage), model_staleness,
+                                                 std::max(model_staleness, model_max_staleness), reply_queue)));
+          break;
         default:
           model = std::move(static_cast<ModelPtr>(
                                     new SSPModel(model_id, std::move(storage), model_staleness, reply_queue)));
           break;
       }
+      if (!checkpoint_dir_.empty()) {
+        // the workers resume from the clocks of the checkpoint when they register to the model
+        Checkpointer::Restore(checkpoint_dir_, model_id, server_thread->GetServerId(), server_ids, sizeof(Val),
+                              model->GetStorage(), model->GetProgressTracker());
+      }
       server_thread->RegisterModel(model_id, std::move(model));
+      if (!checkpoint_dir_.empty()) {
+        server_thread->RegisterCheckpointer(model_id, std::unique_ptr<Checkpointer>(new Checkpointer(
+            checkpoint_dir_, model_id, server_thread->GetServerId(), server_ids, sizeof(Val), checkpoint_interval_,
+            checkpoint_compact_every_)));
+      }
+      // d. Replicate the shard to the backups on other nodes, and hold the backups of others
+      if (num_backups_ > 0) {
+        uint32_t sid = server_thread->GetServerId();
+        if (std::find(server_ids.begin(), server_ids.end(), sid) != server_ids.end()) {
+          server_thread->RegisterReplicator(model_id, std::unique_ptr<Replicator>(new Replicator(
+              model_id, sid, GetBackupServers(sid, server_ids), reply_queue, replication_max_lag_)));
+        }
+        for (uint32_t primary_id : server_ids) {
+          auto backup_ids = GetBackupServers(primary_id, server_ids);
+          if (std::find(backup_ids.begin(), backup_ids.end(), sid) != backup_ids.end()) {
+            server_thread->RegisterBackup(model_id, primary_id, std::unique_ptr<Backup>(new Backup(
+                CreateStorage<Val>(storage_type), reply_queue)));
+          }
+        }
+      }
     }
-
+    // published once the model is on all the local servers
+    model_count_ = model_id + 1;
     return model_id;
   }
 
@@ -147,16 +254,18 @@ class Engine {
    * 1. Create a default partition manager
    * 2. Create a table with the partition manager
    *
-   * @param model_type          the consistency of model - bsp, ssp, asp
-   * @param storage_type        the storage type - map, vector...
-   * @param model_staleness     the staleness for ssp model
+   * @param model_type          the consistency of model - bsp, ssp, asp, key_ssp, adaptive_ssp
+   * @param storage_type        the storage type - map, snapshot, vector...
+   * @param model_staleness     the staleness for ssp and key_ssp model, the min staleness for adaptive_ssp model
+   * @param model_max_staleness the max staleness for adaptive_ssp model
    * @return                    the created table(model) id
    */
   template <typename Val>
-  uint32_t CreateTable(ModelType model_type, StorageType storage_type, int model_staleness = 0) {
+  uint32_t CreateTable(ModelType model_type, StorageType storage_type, int model_staleness = 0,
+                       int model_max_staleness = 0) {
     std::vector<uint32_t> server_ids = id_mapper_->GetAllServerThreads();
     std::unique_ptr<AbstractPartitionManager> pm(new HashPartitionManager(server_ids));
-    return CreateTable<Val>(std::move(pm), model_type, storage_type, model_staleness);
+    return CreateTable<Val>(std::move(pm), model_type, storage_type, model_staleness, model_max_staleness);
   }
 
   /**
@@ -187,7 +296,41 @@ class Engine {
    */
   void RegisterPartitionManager(uint32_t table_id, std::unique_ptr<AbstractPartitionManager>&& partition_manager);
 
+  template <typename Val>
+  std::unique_ptr<AbstractStorage> CreateStorage(StorageType storage_type) const {
+    switch(storage_type) {
+      case StorageType::Map:
+        return std::unique_ptr<AbstractStorage>(new MapStorage<Val>());
+      case StorageType::Snapshot:
+        return std::unique_ptr<AbstractStorage>(new SnapshotStorage<Val>(snapshot_num_readers_));
+      default:
+        return std::unique_ptr<AbstractStorage>(new MapStorage<Val>());
+    }
+  }
+
+  /**
+   * Redirect the shards of the servers on a failed node to their first live backups, tell the
+   * local servers to drop the failed backups and take over the shards, and the local workers to
+   * send their outstanding requests again
+   */
+  void Failover(uint32_t node_id, uint32_t heartbeat_id);
+
   std::map<uint32_t, std::unique_ptr<AbstractPartitionManager>> partition_manager_map_;
+  std::mutex partition_manager_mu_;  // the failure handler looks up the partition managers
+  // checkpoint
+  std::string checkpoint_dir_;
+  int checkpoint_interval_ = 0;
+  int checkpoint_compact_every_ = Checkpointer::kDefaultCompactEvery;
+  // failure detection, disabled if the interval is 0
+  std::chrono::milliseconds heartbeat_interval_{0};
+  std::chrono::milliseconds heartbeat_timeout_{0};
+  std::unique_ptr<HeartbeatThread> heartbeat_thread_;
+  std::set<uint32_t> dead_nodes_;  // only accessed by the heartbeat thread
+  // replication, disabled if there is no backup
+  int num_backups_ = 0;
+  int replication_max_lag_ = Replicator::kDefaultMaxLag;
+  // snapshot storage
+  int snapshot_num_readers_ = ReaderPool::kDefaultNumThreads;
   // nodes
   Node node_;
   std::vector<Node> nodes_;
@@ -199,9 +342,11 @@ class Engine {
   std::unique_ptr<AbstractCallbackRunner> callback_runner_;
 //  std::unique_ptr<WorkerThread> worker_thread_;
   std::vector<std::unique_ptr<WorkerHelperThread>> worker_thread_group_;
+  std::vector<uint32_t> local_threads_;  // the user worker threads of the running task
+  std::mutex local_threads_mu_;          // the failure handler notifies them
   // server elements
   std::vector<std::unique_ptr<ServerThread>> server_thread_group_;
-  size_t model_count_ = 0;
+  std::atomic<size_t> model_count_{0};  // also read by the heartbeat thread
 };
 
 }  // namespace csci5570
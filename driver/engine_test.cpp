@@ -4,6 +4,10 @@
 #include "driver/engine.hpp"
 #include "worker/kv_client_table.hpp"
 
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 namespace csci5570 {
 namespace {
 
@@ -37,6 +41,18 @@ TEST_F(TestEngine, Construct) {
   Engine engine(node, {node});
 }
 
+TEST_F(TestEngine, GetBackupServers) {
+  std::vector<Node> nodes{{0, "localhost", 12353}, {1, "localhost", 12354}, {2, "localhost", 12355}};
+  Engine engine(nodes[0], nodes);
+  engine.SetReplication(2);
+  std::vector<uint32_t> server_ids{0, 1, 1000, 1001, 2000};
+  EXPECT_EQ(engine.GetBackupServers(0, server_ids), (std::vector<uint32_t>{1000, 2000}));
+  EXPECT_EQ(engine.GetBackupServers(1001, server_ids), (std::vector<uint32_t>{2000, 1}));
+  EXPECT_EQ(engine.GetBackupServers(2000, server_ids), (std::vector<uint32_t>{0, 1000}));
+  engine.SetReplication(5);  // at most one backup on each other node
+  EXPECT_EQ(engine.GetBackupServers(1, server_ids), (std::vector<uint32_t>{1001, 2000}));
+}
+
 TEST_F(TestEngine, StartMailbox) {
   Node node{0, "localhost", 12353};
   Engine engine(node, {node});
@@ -88,6 +104,30 @@ TEST_F(TestEngine, SimpleTaskMapStorage) {
   engine.StopEverything();
 }
 
+TEST_F(TestEngine, LocalShards) {
+  Node node{0, "localhost", 12353};
+  Engine engine(node, {node});
+  engine.StartEverything();
+
+  auto table_id = engine.CreateTable<double>(ModelType::SSP, StorageType::Map);
+  engine.Barrier();
+  MLTask task;
+  task.SetWorkerAlloc({{0, 3}});
+  task.SetTables({table_id});
+  std::mutex mu;
+  std::map<uint32_t, std::pair<size_t, size_t>> shards;  // {local_id: the shard of 10 samples}
+  task.SetLambda([&mu, &shards](const Info& info) {
+    EXPECT_EQ(info.num_local_workers, 3);
+    std::lock_guard<std::mutex> lk(mu);
+    shards[info.local_id] = info.GetLocalShard(10);
+  });
+  engine.Run(task);
+  engine.StopEverything();
+
+  std::map<uint32_t, std::pair<size_t, size_t>> expected{{0, {0, 4}}, {1, {4, 7}}, {2, {7, 10}}};
+  EXPECT_EQ(shards, expected);
+}
+
 TEST_F(TestEngine, MultipleTasks) {  // simulate multiple instances of engine running a distributed task
   std::vector<Node> nodes{{0, "localhost", 12353}, {1, "localhost", 12354}, {2, "localhost", 12355}};
 
@@ -149,5 +189,98 @@ TEST_F(TestEngine, KVClientTableMapStorage) {
   engine.StopEverything();
 }
 
+TEST_F(TestEngine, FailureDetection) {  // kill the process of node 1, node 0 goes on without its worker
+  std::vector<Node> nodes{{0, "localhost", 12353}, {1, "localhost", 12354}};
+  const int kIters = 10;
+  auto run_node = [&nodes](int i, int iters) {
+    Engine engine(nodes[i], nodes);
+    engine.SetFailureDetection(std::chrono::milliseconds(100), std::chrono::milliseconds(1000));
+    engine.StartEverything();
+    // the parameters live on the server of node 0 only, which survives
+    std::unique_ptr<AbstractPartitionManager> pm(new RangePartitionManager({0}, {{0, 100}}));
+    const auto kTableId = engine.CreateTable<double>(std::move(pm), ModelType::SSP, StorageType::Map, 1);
+    engine.Barrier();
+    MLTask task;
+    task.SetWorkerAlloc({{0, 1}, {1, 1}});  // 1 worker on each node
+    task.SetTables({kTableId});
+    task.SetLambda([kTableId, iters](const Info& info) {
+      KVClientTable<double> table(info.thread_id, kTableId, info.send_queue,
+                                  info.partition_manager_map.find(kTableId)->second, info.callback_runner);
+      for (int iter = 0; iter < iters; ++iter) {
+        std::vector<Key> keys{1};
+        std::vector<double> vals{1.0};
+        std::vector<double> ret;
+        table.Get(keys, &ret);
+        table.Add(keys, vals);
+        table.Clock();
+      }
+      if (info.thread_id / SimpleIdMapper::kMaxThreadsPerNode == 1) {
+        raise(SIGKILL);  // the worker of node 1 dies after 2 clocks without saying goodbye
+      }
+    });
+    engine.Run(task);
+    engine.StopEverything();  // the barrier does not wait for a dead node
+  };
+
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    run_node(1, 2);
+    _exit(0);
+  }
+  // without failure detection, node 0 would wait for node 1 forever once 2 clocks ahead
+  run_node(0, kIters);
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFSIGNALED(status));
+}
+
+TEST_F(TestEngine, FailoverPendingGet) {  // kill node 1 while the Gets of node 0 wait on its server
+  std::vector<Node> nodes{{0, "localhost", 12353}, {1, "localhost", 12354}};
+  const int kIters = 10;
+  auto run_node = [&nodes](int i, int iters) {
+    Engine engine(nodes[i], nodes);
+    engine.SetFailureDetection(std::chrono::milliseconds(100), std::chrono::milliseconds(1000));
+    engine.SetReplication(1);  // the server of each node backs up the other
+    engine.StartEverything();
+    std::unique_ptr<AbstractPartitionManager> pm(new RangePartitionManager({0, 1000}, {{0, 50}, {50, 100}}));
+    const auto kTableId = engine.CreateTable<double>(std::move(pm), ModelType::SSP, StorageType::Map, 1);
+    engine.Barrier();
+    MLTask task;
+    task.SetWorkerAlloc({{0, 1}, {1, 1}});  // 1 worker on each node
+    task.SetTables({kTableId});
+    task.SetLambda([kTableId, iters](const Info& info) {
+      KVClientTable<double> table(info.thread_id, kTableId, info.send_queue,
+                                  info.partition_manager_map.find(kTableId)->second, info.callback_runner);
+      for (int iter = 0; iter < iters; ++iter) {
+        std::vector<Key> keys{1, 60};  // one key on each server
+        std::vector<double> vals{1.0, 1.0};
+        std::vector<double> ret;
+        table.Get(keys, &ret);
+        EXPECT_EQ(ret.size(), 2);
+        table.Add(keys, vals);
+        table.Clock();
+      }
+      if (info.thread_id / SimpleIdMapper::kMaxThreadsPerNode == 1) {
+        raise(SIGKILL);  // server 1000 dies with the Gets of node 0 it holds back
+      }
+    });
+    engine.Run(task);
+    engine.StopEverything();
+  };
+
+  pid_t pid = fork();
+  ASSERT_NE(pid, -1);
+  if (pid == 0) {
+    run_node(1, 2);
+    _exit(0);
+  }
+  // without the Gets sent again to server 0 taking over, node 0 would wait for the dead server forever
+  run_node(0, kIters);
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFSIGNALED(status));
+}
+
 }  // namespace
 }  // namespace csci5570
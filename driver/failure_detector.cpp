@@ -0,0 +1,47 @@
+#include "driver/failure_detector.hpp"
+
+#include "glog/logging.h"
+
+namespace csci5570 {
+
+FailureDetector::FailureDetector(const std::vector<uint32_t>& node_ids, Clock::duration timeout,
+                                 Clock::time_point now)
+    : timeout_(timeout) {
+  for (uint32_t node_id : node_ids) {
+    peers_[node_id].last_heartbeat = now;
+  }
+}
+
+void FailureDetector::OnHeartbeat(uint32_t node_id, const std::vector<uint32_t>& tids, Clock::time_point now) {
+  auto it = peers_.find(node_id);
+  if (it == peers_.end() || !it->second.alive) {
+    return;
+  }
+  it->second.last_heartbeat = now;
+  it->second.tids = tids;
+}
+
+std::vector<uint32_t> FailureDetector::CheckTimeout(Clock::time_point now) {
+  std::vector<uint32_t> dead_nodes;
+  for (auto& kv : peers_) {
+    Peer& peer = kv.second;
+    if (peer.alive && now - peer.last_heartbeat > timeout_) {
+      peer.alive = false;
+      dead_nodes.push_back(kv.first);
+    }
+  }
+  return dead_nodes;
+}
+
+std::vector<uint32_t> FailureDetector::GetThreads(uint32_t node_id) const {
+  auto it = peers_.find(node_id);
+  CHECK(it != peers_.end()) << "Node " << node_id << " is not watched";
+  return it->second.tids;
+}
+
+bool FailureDetector::IsAlive(uint32_t node_id) const {
+  auto it = peers_.find(node_id);
+  return it != peers_.end() && it->second.alive;
+}
+
+}  // namespace csci5570
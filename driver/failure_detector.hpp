@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cinttypes>
+#include <map>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * A timeout-based failure detector over the heartbeats of the other nodes.
+ *
+ * A node is suspected to be dead once no heartbeat arrived from it for <timeout>. The decision is
+ * final: a node reported dead is never reported alive again, its later heartbeats are ignored.
+ * Time is passed in by the caller, so that the detector can be tested without sleeping.
+ */
+class FailureDetector {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @param node_ids  the nodes to watch
+   * @param timeout   the silence after which a node is considered dead
+   * @param now       the start time, the nodes are considered alive until now + timeout
+   */
+  FailureDetector(const std::vector<uint32_t>& node_ids, Clock::duration timeout, Clock::time_point now);
+
+  /**
+   * Record a heartbeat with the app threads alive on the node
+   */
+  void OnHeartbeat(uint32_t node_id, const std::vector<uint32_t>& tids, Clock::time_point now);
+
+  /**
+   * Return the nodes that timed out since the last check
+   */
+  std::vector<uint32_t> CheckTimeout(Clock::time_point now);
+
+  /**
+   * Return the app threads reported by the last heartbeat of the node
+   */
+  std::vector<uint32_t> GetThreads(uint32_t node_id) const;
+
+  bool IsAlive(uint32_t node_id) const;
+
+ private:
+  struct Peer {
+    Clock::time_point last_heartbeat;
+    std::vector<uint32_t> tids;
+    bool alive = true;
+  };
+
+  Clock::duration timeout_;
+  std::map<uint32_t, Peer> peers_;
+};
+
+}  // namespace csci5570
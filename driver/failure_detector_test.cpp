@@ -0,0 +1,45 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "driver/failure_detector.hpp"
+
+namespace csci5570 {
+namespace {
+
+class TestFailureDetector : public testing::Test {
+ public:
+  TestFailureDetector() {}
+  ~TestFailureDetector() {}
+
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+TEST_F(TestFailureDetector, Timeout) {
+  using ms = std::chrono::milliseconds;
+  auto start = FailureDetector::Clock::now();
+  FailureDetector detector({1, 2}, ms(100), start);
+  EXPECT_TRUE(detector.CheckTimeout(start + ms(50)).empty());
+  detector.OnHeartbeat(1, {1100, 1101}, start + ms(80));
+  detector.OnHeartbeat(2, {2100}, start + ms(90));
+  EXPECT_TRUE(detector.CheckTimeout(start + ms(150)).empty());
+  detector.OnHeartbeat(1, {1100}, start + ms(160));
+
+  // node 2 is silent for longer than the timeout
+  EXPECT_EQ(detector.CheckTimeout(start + ms(200)), std::vector<uint32_t>({2}));
+  EXPECT_FALSE(detector.IsAlive(2));
+  EXPECT_TRUE(detector.IsAlive(1));
+  EXPECT_EQ(detector.GetThreads(2), std::vector<uint32_t>({2100}));
+  EXPECT_EQ(detector.GetThreads(1), std::vector<uint32_t>({1100}));
+
+  // reported once, late heartbeats are ignored
+  detector.OnHeartbeat(2, {2100, 2101}, start + ms(210));
+  EXPECT_TRUE(detector.CheckTimeout(start + ms(220)).empty());
+  EXPECT_FALSE(detector.IsAlive(2));
+  EXPECT_EQ(detector.GetThreads(2), std::vector<uint32_t>({2100}));
+  EXPECT_FALSE(detector.IsAlive(3));
+}
+
+}  // namespace
+}  // namespace csci5570
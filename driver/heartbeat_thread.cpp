@@ -0,0 +1,78 @@
+#include "driver/heartbeat_thread.hpp"
+
+#include "glog/logging.h"
+
+namespace csci5570 {
+
+HeartbeatThread::HeartbeatThread(uint32_t id, const std::map<uint32_t, uint32_t>& peers,
+                                 ThreadsafeQueue<Message>* send_queue, std::chrono::milliseconds interval,
+                                 std::chrono::milliseconds timeout, FailureHandler handler)
+    : Actor(id), peers_(peers), send_queue_(send_queue), interval_(interval), timeout_(timeout),
+      handler_(handler) {
+  CHECK_GT(timeout_.count(), interval_.count()) << "The timeout should span several heartbeats";
+  for (const auto& kv : peers_) {
+    peer_nodes_[kv.second] = kv.first;
+  }
+}
+
+void HeartbeatThread::SetLocalThreads(const std::vector<uint32_t>& tids) {
+  std::lock_guard<std::mutex> lk(mu_);
+  local_tids_ = tids;
+}
+
+void HeartbeatThread::SendHeartbeats() {
+  third_party::SArray<uint32_t> tids;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    tids = third_party::SArray<uint32_t>(local_tids_);
+  }
+  for (const auto& kv : peers_) {
+    Message msg;
+    msg.meta.sender = id_;
+    msg.meta.recver = kv.second;
+    msg.meta.flag = Flag::kHeartbeat;
+    msg.AddData(tids);
+    send_queue_->Push(std::move(msg));
+  }
+}
+
+void HeartbeatThread::Main() {
+  std::vector<uint32_t> node_ids;
+  for (const auto& kv : peers_) {
+    node_ids.push_back(kv.first);
+  }
+  FailureDetector detector(node_ids, timeout_, FailureDetector::Clock::now());
+  auto next_heartbeat = FailureDetector::Clock::now();
+  while (true) {
+    auto now = FailureDetector::Clock::now();
+    if (now >= next_heartbeat) {
+      SendHeartbeats();
+      next_heartbeat = now + interval_;
+    }
+    for (uint32_t node_id : detector.CheckTimeout(now)) {
+      std::vector<uint32_t> tids = detector.GetThreads(node_id);
+      LOG(WARNING) << "No heartbeat from node " << node_id << " for " << timeout_.count() << "ms, drop its "
+                   << tids.size() << " app threads";
+      handler_(node_id, tids);
+    }
+
+    Message msg;
+    if (!work_queue_.WaitAndPopFor(&msg, next_heartbeat - FailureDetector::Clock::now())) {
+      continue;
+    }
+    if (msg.meta.flag == Flag::kExit) {
+      break;
+    }
+    if (msg.meta.flag == Flag::kHeartbeat) {
+      auto it = peer_nodes_.find(msg.meta.sender);
+      if (it == peer_nodes_.end()) {
+        continue;
+      }
+      auto tids = third_party::SArray<uint32_t>(msg.data[0]);
+      detector.OnHeartbeat(it->second, std::vector<uint32_t>(tids.begin(), tids.end()),
+                           FailureDetector::Clock::now());
+    }
+  }
+}
+
+}  // namespace csci5570
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base/actor_model.hpp"
+#include "base/message.hpp"
+#include "base/threadsafe_queue.hpp"
+#include "driver/failure_detector.hpp"
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * Sends heartbeats to the heartbeat threads of the other nodes and watches theirs.
+ *
+ * Each heartbeat carries the app threads running on the node. When a node stops sending heartbeats
+ * for longer than the timeout, the failure handler is called once with its last reported threads.
+ * Other messages, e.g., the replies of the servers to the handler, are ignored.
+ */
+class HeartbeatThread : public Actor {
+ public:
+  using FailureHandler = std::function<void(uint32_t node_id, const std::vector<uint32_t>& tids)>;
+
+  /**
+   * @param id          the thread id of this heartbeat thread
+   * @param peers       {node id: heartbeat thread id} of the other nodes
+   * @param send_queue  the queue of the sender
+   * @param interval    the time between two heartbeats
+   * @param timeout     the silence after which a node is considered dead, a few intervals
+   * @param handler     called on the heartbeat thread when a node is considered dead
+   */
+  HeartbeatThread(uint32_t id, const std::map<uint32_t, uint32_t>& peers, ThreadsafeQueue<Message>* send_queue,
+                  std::chrono::milliseconds interval, std::chrono::milliseconds timeout, FailureHandler handler);
+
+  /**
+   * Set the app threads running on this node, reported by the next heartbeats
+   */
+  void SetLocalThreads(const std::vector<uint32_t>& tids);
+
+ protected:
+  void Main() override;
+
+ private:
+  void SendHeartbeats();
+
+  std::map<uint32_t, uint32_t> peers_;
+  std::map<uint32_t, uint32_t> peer_nodes_;  // {heartbeat thread id: node id}
+  ThreadsafeQueue<Message>* send_queue_;
+  std::chrono::milliseconds interval_;
+  std::chrono::milliseconds timeout_;
+  FailureHandler handler_;
+
+  std::mutex mu_;
+  std::vector<uint32_t> local_tids_;
+};
+
+}  // namespace csci5570
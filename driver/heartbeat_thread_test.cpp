@@ -0,0 +1,73 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "driver/heartbeat_thread.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace csci5570 {
+namespace {
+
+class TestHeartbeatThread : public testing::Test {
+ public:
+  TestHeartbeatThread() {}
+  ~TestHeartbeatThread() {}
+
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+TEST_F(TestHeartbeatThread, DetectFailure) {
+  ThreadsafeQueue<Message> send_queue;
+  std::mutex mu;
+  std::condition_variable cond;
+  uint32_t dead_node = 0;
+  std::vector<uint32_t> dead_tids;
+  auto on_failure = [&](uint32_t node_id, const std::vector<uint32_t>& tids) {
+    std::lock_guard<std::mutex> lk(mu);
+    dead_node = node_id;
+    dead_tids = tids;
+    cond.notify_one();
+  };
+  // node 0 watches node 1
+  HeartbeatThread heartbeat_thread(99, {{1, 1099}}, &send_queue, std::chrono::milliseconds(10),
+                                   std::chrono::milliseconds(50), on_failure);
+  heartbeat_thread.SetLocalThreads({100, 101});
+  heartbeat_thread.Start();
+
+  Message heartbeat;
+  send_queue.WaitAndPop(&heartbeat);
+  EXPECT_EQ(heartbeat.meta.flag, Flag::kHeartbeat);
+  EXPECT_EQ(heartbeat.meta.sender, 99);
+  EXPECT_EQ(heartbeat.meta.recver, 1099);
+  auto local_tids = third_party::SArray<uint32_t>(heartbeat.data[0]);
+  EXPECT_EQ(std::vector<uint32_t>(local_tids.begin(), local_tids.end()), std::vector<uint32_t>({100, 101}));
+
+  // node 1 sends a few heartbeats and dies
+  for (int i = 0; i < 3; ++i) {
+    Message msg;
+    msg.meta.sender = 1099;
+    msg.meta.recver = 99;
+    msg.meta.flag = Flag::kHeartbeat;
+    msg.AddData(third_party::SArray<uint32_t>({1100}));
+    heartbeat_thread.GetWorkQueue()->Push(msg);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  {
+    std::unique_lock<std::mutex> lk(mu);
+    cond.wait(lk, [&] { return dead_node != 0; });
+  }
+  EXPECT_EQ(dead_node, 1);
+  EXPECT_EQ(dead_tids, std::vector<uint32_t>({1100}));
+
+  Message exit_msg;
+  exit_msg.meta.flag = Flag::kExit;
+  heartbeat_thread.GetWorkQueue()->Push(exit_msg);
+  heartbeat_thread.Stop();
+  EXPECT_GT(send_queue.Size(), 0);
+}
+
+}  // namespace
+}  // namespace csci5570
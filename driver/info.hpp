@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <sstream>
+#include <utility>
 
 #include "base/abstract_partition_manager.hpp"
 #include "base/threadsafe_queue.hpp"
@@ -17,15 +19,31 @@ namespace csci5570 {
 struct Info {
   uint32_t thread_id;
   uint32_t worker_id;
+  uint32_t local_id = 0;           // the index of the worker among those of the task on the local process
+  uint32_t num_local_workers = 1;  // the number of workers of the task on the local process
   ThreadsafeQueue<Message>* send_queue;
   std::map<uint32_t, AbstractPartitionManager*> partition_manager_map;
   AbstractCallbackRunner* callback_runner;
   std::string DebugString() const {
     std::stringstream ss;
-    ss << "thread_id: " << thread_id << " worker_id: " << worker_id;
+    ss << "thread_id: " << thread_id << " worker_id: " << worker_id << " local_id: " << local_id << "/"
+       << num_local_workers;
     return ss.str();
   }
 
+  /**
+   * The [begin, end) range of the samples owned by this worker among the <num_samples> loaded by the process,
+   * so that the local workers train on disjoint, balanced shards. Copying the shard from the worker thread
+   * places it in the memory of the node the thread runs on.
+   */
+  std::pair<size_t, size_t> GetLocalShard(size_t num_samples) const {
+    CHECK_LT(local_id, num_local_workers);
+    size_t base = num_samples / num_local_workers;
+    size_t extra = num_samples % num_local_workers;
+    size_t begin = local_id * base + std::min<size_t>(local_id, extra);
+    return {begin, begin + base + (local_id < extra ? 1 : 0)};
+  }
+
   /**
    * The wrapper function (helper) creates a KVClientTable with the Info, so that users do not need to call the
    * KVClientTable constructor with so many arguments.
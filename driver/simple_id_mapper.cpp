@@ -31,7 +31,7 @@ void SimpleIdMapper::Init(int num_server_threads_per_node) {
     node2server_[node_id] = server_thread_ids;
     // worker_threads
     std::vector<uint32_t> worker_thread_ids;
-    for (uint32_t wid = id_base + kWorkerHelperThreadId; wid < id_base + kMaxBgThreadsPerNode; wid++) {
+    for (uint32_t wid = id_base + kWorkerHelperThreadId; wid < id_base + kHeartbeatThreadId; wid++) {
       worker_thread_ids.push_back(wid);
     }
     node2worker_helper_[node_id] = worker_thread_ids;
@@ -117,5 +117,6 @@ const uint32_t SimpleIdMapper::kMaxNodeId;
 const uint32_t SimpleIdMapper::kMaxThreadsPerNode;
 const uint32_t SimpleIdMapper::kMaxBgThreadsPerNode;
 const uint32_t SimpleIdMapper::kWorkerHelperThreadId;
+const uint32_t SimpleIdMapper::kHeartbeatThreadId;
 
 }  // namespace csci5570
@@ -93,8 +93,10 @@ class SimpleIdMapper : public AbstractIdMapper {
   // Their ids are [0, 100) for node id 0.
   static const uint32_t kMaxBgThreadsPerNode = 100;
   // The server thread id for node 0 is in [0, 50)
-  // The worker thread id for node id 0 is in [50, 100)
+  // The worker thread id for node id 0 is in [50, 99)
   static const uint32_t kWorkerHelperThreadId = 50;
+  // The heartbeat thread id for node id 0 is 99
+  static const uint32_t kHeartbeatThreadId = 99;
 
  private:
   // The server thread's id in each node
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "boost/utility/string_ref.hpp"
+
+namespace csci5570 {
+
+/**
+ * Reads the blocks of the files under a url that are assigned to a worker, for LineInputFormat
+ */
+class AbstractFileSplitter {
+ public:
+  virtual ~AbstractFileSplitter() {}
+
+  /**
+   * Prepare to read the files under <url>, given without its scheme
+   */
+  virtual void load(std::string url) = 0;
+
+  /**
+   * Fetch data of the files
+   *
+   * @param is_next  false to fetch a new block assigned to the worker, true to fetch the data following the
+   *                 current one in the same file, e.g., to complete its last line
+   * @return         the data, empty if there is no more block or at the end of the file
+   */
+  virtual boost::string_ref fetch_block(bool is_next = false) = 0;
+
+  /**
+   * The offset of the current block in its file
+   */
+  virtual size_t get_offset() = 0;
+
+ protected:
+  /**
+   * How long to wait before asking the master again when it has no block to assign now but some are left
+   */
+  static std::chrono::milliseconds retry_interval() { return std::chrono::milliseconds(100); }
+};
+
+}  // namespace csci5570
@@ -0,0 +1,238 @@
+#include "io/block_assignment_policy.hpp"
+
+#include <string>
+
+#include "glog/logging.h"
+
+namespace csci5570 {
+
+void BlockAssignmentPolicy::add_block(const Block& block) {
+  int id = blocks_.size();
+  auto key = std::make_pair(block.filename, block.offset);
+  CHECK(block_ids_.find(key) == block_ids_.end()) << "Duplicated block " << block.filename << "@" << block.offset;
+  block_ids_[key] = id;
+  blocks_.push_back(BlockState());
+  blocks_.back().block = block;
+  unassigned_.insert(id);
+  total_bytes_ += block.length;
+  unassigned_bytes_ += block.length;
+  for (size_t i = 0; i < block.hosts.size(); ++i) {
+    const std::string& host = block.hosts[i];
+    host_blocks_[host].insert(id);
+    host_bytes_[host] += block.length;
+    if (i < block.racks.size() && !block.racks[i].empty()) {
+      rack_blocks_[block.racks[i]].insert(id);
+      host_racks_[host] = block.racks[i];
+    }
+  }
+  if (block.hosts.empty()) {
+    unlocated_blocks_.insert(id);
+  }
+}
+
+BlockAssignmentPolicy::Assignment BlockAssignmentPolicy::assign(const std::string& host, double now) {
+  hosts_.insert(host);
+  if (unassigned_.empty()) {
+    // 5. speculative
+    int id = pick_speculative(host, now);
+    if (id != -1) {
+      return take(id, host, now, true);
+    }
+    waiting_hosts_.erase(host);
+    finished_hosts_.insert(host);
+    return Assignment{"", 0, false, false};
+  }
+  // the blocks are left to the others only if one of them still reads
+  bool may_wait = has_other_reader(host);
+  if (options_.rate_aware && may_wait && is_tail(host, now)) {
+    return wait(host);
+  }
+  // 1. local
+  auto local = host_blocks_.find(host);
+  if (local != host_blocks_.end() && !local->second.empty()) {
+    return take(*local->second.begin(), host, now, false);
+  }
+  // 2. rack-local
+  if (options_.rack_aware) {
+    auto rack = host_racks_.find(host);
+    if (rack != host_racks_.end()) {
+      auto& rack_blocks = rack_blocks_[rack->second];
+      if (!rack_blocks.empty()) {
+        return take(*rack_blocks.begin(), host, now, false);
+      }
+    }
+  }
+  // 3. no location
+  if (!unlocated_blocks_.empty()) {
+    return take(*unlocated_blocks_.begin(), host, now, false);
+  }
+  // 4. remote
+  int id = pick_stolen(host, may_wait);
+  if (id != -1) {
+    return take(id, host, now, false);
+  }
+  return wait(host);
+}
+
+bool BlockAssignmentPolicy::complete(const std::string& host, const std::string& filename, size_t offset, double now) {
+  auto it = block_ids_.find(std::make_pair(filename, offset));
+  if (it == block_ids_.end()) {
+    LOG(WARNING) << "Unknown block " << filename << "@" << offset << " completed by " << host;
+    return false;
+  }
+  BlockState& state = blocks_[it->second];
+  for (const auto& copy : state.copies) {
+    if (copy.first == host && now > copy.second) {
+      double rate = state.block.length / (now - copy.second);
+      auto old_rate = rates_.find(host);
+      rates_[host] = old_rate == rates_.end() ? rate : 0.7 * old_rate->second + 0.3 * rate;
+      break;
+    }
+  }
+  if (state.completed) {
+    return false;
+  }
+  state.completed = true;
+  in_progress_.erase(it->second);
+  num_completed_ += 1;
+  completed_bytes_ += state.block.length;
+  return true;
+}
+
+double BlockAssignmentPolicy::get_rate(const std::string& host) const {
+  auto it = rates_.find(host);
+  return it == rates_.end() ? 0 : it->second;
+}
+
+void BlockAssignmentPolicy::leave(const std::string& host) {
+  waiting_hosts_.erase(host);
+  finished_hosts_.insert(host);
+}
+
+BlockAssignmentPolicy::Assignment BlockAssignmentPolicy::take(int id, const std::string& host, double now,
+                                                              bool speculative) {
+  BlockState& state = blocks_[id];
+  if (speculative) {
+    num_speculative_ += 1;
+  } else {
+    unassigned_.erase(id);
+    unassigned_bytes_ -= state.block.length;
+    for (const auto& replica_host : state.block.hosts) {
+      host_blocks_[replica_host].erase(id);
+      host_bytes_[replica_host] -= state.block.length;
+    }
+    for (const auto& rack : state.block.racks) {
+      rack_blocks_[rack].erase(id);
+    }
+    unlocated_blocks_.erase(id);
+    in_progress_.insert(id);
+  }
+  state.copies.push_back(std::make_pair(host, now));
+  waiting_hosts_.erase(host);
+  finished_hosts_.erase(host);
+  return Assignment{state.block.filename, state.block.offset, speculative, false};
+}
+
+BlockAssignmentPolicy::Assignment BlockAssignmentPolicy::wait(const std::string& host) {
+  waiting_hosts_.insert(host);
+  return Assignment{"", 0, false, true};
+}
+
+bool BlockAssignmentPolicy::has_other_reader(const std::string& host) const {
+  for (const auto& other : hosts_) {
+    if (other != host && waiting_hosts_.count(other) == 0 && finished_hosts_.count(other) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool BlockAssignmentPolicy::is_tail(const std::string& host, double now) const {
+  auto it = rates_.find(host);
+  double mean_rate = get_mean_rate();
+  if (it == rates_.end() || it->second >= mean_rate || completed_bytes_ == 0 || now <= 0) {
+    return false;
+  }
+  // the time for the others to read the unassigned blocks, at the throughput measured so far
+  double block_length = static_cast<double>(total_bytes_) / blocks_.size();
+  double remaining = unassigned_bytes_ / (completed_bytes_ / now);
+  return block_length / it->second > remaining + block_length / mean_rate;
+}
+
+int BlockAssignmentPolicy::pick_stolen(const std::string& host, bool may_decline) const {
+  if (unassigned_.empty()) {
+    return -1;
+  }
+  if (!options_.rate_aware) {
+    return *unassigned_.begin();
+  }
+  // steal from the host expected to finish its local blocks the last
+  const std::string* owner = nullptr;
+  double owner_eta = -1;
+  for (const auto& kv : host_blocks_) {
+    if (kv.second.empty() || kv.first == host) {
+      continue;
+    }
+    double rate = expected_rate(kv.first);
+    double eta = rate > 0 ? host_bytes_.at(kv.first) / rate : host_bytes_.at(kv.first);
+    if (eta > owner_eta) {
+      owner = &kv.first;
+      owner_eta = eta;
+    }
+  }
+  if (owner == nullptr) {
+    return *unassigned_.begin();
+  }
+  // the owner keeps the blocks it reads first
+  int id = *host_blocks_.at(*owner).rbegin();
+  double rate = expected_rate(host);
+  if (may_decline && rate > 0 && expected_rate(*owner) > 0 && blocks_[id].block.length / rate >= owner_eta) {
+    // the owner would read the block sooner
+    return -1;
+  }
+  return id;
+}
+
+int BlockAssignmentPolicy::pick_speculative(const std::string& host, double now) const {
+  if (!options_.speculative || !unassigned_.empty()) {
+    return -1;
+  }
+  double rate = expected_rate(host);
+  if (rate <= 0) {
+    return -1;
+  }
+  int picked = -1;
+  double latest_finish = 0;
+  for (int id : in_progress_) {
+    const BlockState& state = blocks_[id];
+    if (state.copies.size() != 1 || state.copies[0].first == host) {
+      continue;
+    }
+    double owner_rate = expected_rate(state.copies[0].first);
+    double owner_finish = state.copies[0].second + state.block.length / owner_rate;
+    // only worth it if the copy would finish first
+    if (now + state.block.length / rate < owner_finish && owner_finish > latest_finish) {
+      picked = id;
+      latest_finish = owner_finish;
+    }
+  }
+  return picked;
+}
+
+double BlockAssignmentPolicy::expected_rate(const std::string& host) const {
+  auto it = rates_.find(host);
+  return it != rates_.end() ? it->second : get_mean_rate();
+}
+
+double BlockAssignmentPolicy::get_mean_rate() const {
+  if (rates_.empty()) {
+    return 0;
+  }
+  double sum = 0;
+  for (const auto& kv : rates_) {
+    sum += kv.second;
+  }
+  return sum / rates_.size();
+}
+
+}  // namespace csci5570
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * Decides which block of an input goes to which worker host, for HDFSBlockAssigner
+ *
+ * A host so slow that it would still read a block when the faster hosts are expected to have read all the
+ * others is told to retry later. Otherwise, a host asking for a block gets, in order of preference:
+ *   1. a block with a replica on the host,
+ *   2. a block with a replica on the rack of the host,
+ *   3. a block without location, e.g., a local file chunk,
+ *   4. a block stolen from the host whose remaining local blocks would take it the longest to read, unless
+ *      the asking host is so slow that the owner would read the block sooner,
+ *   5. if speculative, a second copy of the block in progress that is expected to finish the last.
+ * The read rate of each host is measured from the blocks it completes.
+ *
+ * A host is only told that there is no block left once all the blocks are assigned, and only told to retry
+ * while another host still reads, i.e., is neither retrying nor done, so that no block is left behind.
+ */
+class BlockAssignmentPolicy {
+ public:
+  struct Options {
+    bool rack_aware = true;
+    bool rate_aware = true;  // steal from the slowest hosts and keep slow hosts from becoming the tail
+    bool speculative = false;
+  };
+
+  struct Block {
+    std::string filename;
+    size_t offset;
+    size_t length;
+    std::vector<std::string> hosts;  // of the replicas
+    std::vector<std::string> racks;  // of the replicas, e.g., "/default-rack", may be empty
+  };
+
+  struct Assignment {
+    std::string filename;  // empty if there is no block to read now
+    size_t offset;
+    bool speculative;  // a second copy of a block in progress
+    bool retry;        // no block now, but some are left: ask again later
+  };
+
+  BlockAssignmentPolicy() : BlockAssignmentPolicy(Options()) {}
+  explicit BlockAssignmentPolicy(const Options& options) : options_(options) {}
+
+  void add_block(const Block& block);
+
+  /**
+   * Pick a block for <host> at time <now> in seconds
+   */
+  Assignment assign(const std::string& host, double now);
+
+  /**
+   * Record that <host> finished reading a block at time <now>
+   *
+   * @return  true if it is the first copy of the block completed
+   */
+  bool complete(const std::string& host, const std::string& filename, size_t offset, double now);
+
+  /**
+   * Record that <host> exited and asks for no more blocks, so that the others are not told to wait for it
+   */
+  void leave(const std::string& host);
+
+  size_t get_num_blocks() const { return blocks_.size(); }
+  size_t get_num_unassigned() const { return unassigned_.size(); }
+  size_t get_num_completed() const { return num_completed_; }
+  size_t get_num_speculative() const { return num_speculative_; }
+  bool is_done() const { return num_completed_ == blocks_.size(); }
+
+  /**
+   * The measured read rate of <host> in bytes per second, 0 if unknown
+   */
+  double get_rate(const std::string& host) const;
+  double get_mean_rate() const;
+
+ private:
+  struct BlockState {
+    Block block;
+    bool completed = false;
+    std::vector<std::pair<std::string, double>> copies;  // (host, start time) of the copies assigned
+  };
+
+  // remove a block from the unassigned ones and give it to host
+  Assignment take(int id, const std::string& host, double now, bool speculative);
+  // tell host to ask again later
+  Assignment wait(const std::string& host);
+  // whether a host other than <host> may still read blocks, i.e., is neither retrying nor done
+  bool has_other_reader(const std::string& host) const;
+  bool is_tail(const std::string& host, double now) const;
+  // -1 if <may_decline> and the owner of the block would read it sooner
+  int pick_stolen(const std::string& host, bool may_decline) const;
+  int pick_speculative(const std::string& host, double now) const;
+  // the expected read rate of host, the average of the known rates if unknown
+  double expected_rate(const std::string& host) const;
+
+  Options options_;
+  std::vector<BlockState> blocks_;
+  std::map<std::pair<std::string, size_t>, int> block_ids_;  // (filename, offset) -> id
+  std::set<int> unassigned_;
+  std::map<std::string, std::set<int>> host_blocks_;  // the unassigned blocks with a replica on a host
+  std::map<std::string, std::set<int>> rack_blocks_;
+  std::set<int> unlocated_blocks_;
+  std::map<std::string, size_t> host_bytes_;  // the bytes of host_blocks_
+  std::map<std::string, std::string> host_racks_;
+  std::map<std::string, double> rates_;
+  std::set<int> in_progress_;
+  std::set<std::string> hosts_;           // the hosts that asked for blocks
+  std::set<std::string> waiting_hosts_;   // told to retry and not given a block since
+  std::set<std::string> finished_hosts_;  // told that there is no block left, or exited
+  size_t total_bytes_ = 0;
+  size_t unassigned_bytes_ = 0;
+  size_t completed_bytes_ = 0;
+  size_t num_completed_ = 0;
+  size_t num_speculative_ = 0;
+};
+
+}  // namespace csci5570
@@ -0,0 +1,161 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "io/block_assignment_policy.hpp"
+
+#include <string>
+#include <vector>
+
+namespace csci5570 {
+namespace {
+
+class TestBlockAssignmentPolicy : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+BlockAssignmentPolicy::Block MakeBlock(const std::string& filename, size_t offset, std::vector<std::string> hosts,
+                                       std::vector<std::string> racks = {}) {
+  return BlockAssignmentPolicy::Block{filename, offset, 100, hosts, racks};
+}
+
+TEST_F(TestBlockAssignmentPolicy, Locality) {
+  BlockAssignmentPolicy policy;
+  policy.add_block(MakeBlock("a", 0, {"h1", "h2"}, {"/r1", "/r1"}));
+  policy.add_block(MakeBlock("a", 100, {"h3"}, {"/r2"}));
+  policy.add_block(MakeBlock("b", 0, {"h2"}, {"/r1"}));
+  policy.add_block(MakeBlock("c", 0, {}));
+  EXPECT_EQ(policy.get_num_blocks(), 4);
+
+  // local
+  auto assignment = policy.assign("h2", 0);
+  EXPECT_EQ(assignment.filename, "a");
+  EXPECT_EQ(assignment.offset, 0);
+  EXPECT_FALSE(assignment.speculative);
+  // rack-local, as h1 has no local block left
+  assignment = policy.assign("h1", 0);
+  EXPECT_EQ(assignment.filename, "b");
+  // no location, before stealing the block of h3
+  assignment = policy.assign("h1", 0);
+  EXPECT_EQ(assignment.filename, "c");
+  assignment = policy.assign("h1", 0);
+  EXPECT_EQ(assignment.filename, "a");
+  EXPECT_EQ(assignment.offset, 100);
+  EXPECT_EQ(policy.get_num_unassigned(), 0);
+  EXPECT_EQ(policy.assign("h3", 0).filename, "");
+
+  EXPECT_TRUE(policy.complete("h2", "a", 0, 1));
+  EXPECT_FALSE(policy.complete("h2", "a", 0, 2));  // twice
+  EXPECT_FALSE(policy.complete("h2", "d", 0, 2));  // unknown
+  EXPECT_FALSE(policy.is_done());
+  for (auto fn : {"b", "c"}) {
+    EXPECT_TRUE(policy.complete("h1", fn, 0, 1));
+  }
+  EXPECT_TRUE(policy.complete("h1", "a", 100, 1));
+  EXPECT_TRUE(policy.is_done());
+}
+
+TEST_F(TestBlockAssignmentPolicy, Rates) {
+  BlockAssignmentPolicy policy;
+  for (size_t i = 0; i < 4; ++i) {
+    policy.add_block(MakeBlock("fast", i * 100, {"fast"}));
+    policy.add_block(MakeBlock("slow", i * 100, {"slow"}));
+  }
+  policy.assign("fast", 0);
+  policy.assign("slow", 0);
+  policy.complete("fast", "fast", 0, 1);
+  policy.complete("slow", "slow", 0, 10);
+  EXPECT_DOUBLE_EQ(policy.get_rate("fast"), 100);
+  EXPECT_DOUBLE_EQ(policy.get_rate("slow"), 10);
+  EXPECT_DOUBLE_EQ(policy.get_rate("other"), 0);
+
+  // the fast host steals from the slow one, from its last blocks
+  for (size_t i = 1; i < 4; ++i) {
+    EXPECT_EQ(policy.assign("fast", 1).filename, "fast");
+  }
+  auto assignment = policy.assign("fast", 2);
+  EXPECT_EQ(assignment.filename, "slow");
+  EXPECT_EQ(assignment.offset, 300);
+
+  // the slow host would take longer than the owner to read a block of the fast one
+  BlockAssignmentPolicy other;
+  other.add_block(MakeBlock("fast", 0, {"fast"}));
+  other.add_block(MakeBlock("fast", 100, {"fast"}));
+  other.add_block(MakeBlock("slow", 0, {"slow"}));
+  other.assign("fast", 0);
+  other.assign("slow", 0);
+  other.complete("fast", "fast", 0, 1);
+  other.complete("slow", "slow", 0, 10);
+  auto wait = other.assign("slow", 10);
+  EXPECT_EQ(wait.filename, "");
+  EXPECT_TRUE(wait.retry);  // a block is left to the fast host
+  EXPECT_EQ(other.assign("fast", 10).offset, 100);
+  // all the blocks are assigned
+  EXPECT_FALSE(other.assign("slow", 10).retry);
+  other.complete("fast", "fast", 100, 11);
+  EXPECT_FALSE(other.assign("fast", 11).retry);
+  EXPECT_TRUE(other.is_done());
+}
+
+TEST_F(TestBlockAssignmentPolicy, TailHostLeftAlone) {
+  BlockAssignmentPolicy policy;
+  policy.add_block(MakeBlock("fast", 0, {"fast"}));
+  policy.add_block(MakeBlock("slow", 0, {"slow"}));
+  policy.add_block(MakeBlock("slow", 100, {"slow"}));
+  policy.assign("fast", 0);
+  policy.assign("slow", 0);
+  policy.complete("fast", "fast", 0, 1);
+  policy.complete("slow", "slow", 0, 10);
+  // the slow host is the tail while the fast one reads, it is not told that the input ended
+  auto assignment = policy.assign("slow", 10);
+  EXPECT_EQ(assignment.filename, "");
+  EXPECT_TRUE(assignment.retry);
+  EXPECT_EQ(policy.get_num_unassigned(), 1);
+
+  // the fast host leaves, the tail host is the only one left and reads the block itself
+  policy.leave("fast");
+  EXPECT_EQ(policy.get_num_unassigned(), 1);
+  assignment = policy.assign("slow", 10);
+  EXPECT_EQ(assignment.filename, "slow");
+  EXPECT_EQ(assignment.offset, 100);
+  policy.complete("slow", "slow", 100, 20);
+  EXPECT_TRUE(policy.is_done());
+}
+
+TEST_F(TestBlockAssignmentPolicy, Speculative) {
+  BlockAssignmentPolicy::Options options;
+  options.speculative = true;
+  BlockAssignmentPolicy policy(options);
+  for (size_t i = 0; i < 3; ++i) {
+    policy.add_block(MakeBlock("fast", i * 100, {"fast"}));
+  }
+  policy.add_block(MakeBlock("slow", 0, {"slow"}));
+  policy.add_block(MakeBlock("slow", 100, {"slow"}));
+  policy.assign("fast", 0);
+  policy.assign("slow", 0);
+  policy.complete("fast", "fast", 0, 1);
+  policy.complete("slow", "slow", 0, 10);
+  policy.assign("slow", 10);  // slow@100, expected to finish at 20
+  policy.assign("fast", 10);
+  policy.complete("fast", "fast", 100, 11);
+  policy.assign("fast", 11);
+  policy.complete("fast", "fast", 200, 12);
+  EXPECT_EQ(policy.get_num_unassigned(), 0);
+
+  // a second copy of the block of the slow host
+  auto assignment = policy.assign("fast", 12);
+  EXPECT_EQ(assignment.filename, "slow");
+  EXPECT_EQ(assignment.offset, 100);
+  EXPECT_TRUE(assignment.speculative);
+  EXPECT_EQ(policy.get_num_speculative(), 1);
+  EXPECT_EQ(policy.assign("fast", 12).filename, "");  // no third copy
+
+  // the first copy completed wins
+  EXPECT_TRUE(policy.complete("fast", "slow", 100, 13));
+  EXPECT_FALSE(policy.complete("slow", "slow", 100, 20));
+  EXPECT_TRUE(policy.is_done());
+}
+
+}  // namespace
+}  // namespace csci5570
@@ -0,0 +1,204 @@
+#include "io/compressed_file_splitter.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/utility/string_ref.hpp"
+#include "glog/logging.h"
+
+namespace csci5570 {
+
+namespace {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+CompressedFileSplitter::CompressedFileSplitter(std::unique_ptr<AbstractFileSplitter> splitter, int num_threads)
+    : splitter_(std::move(splitter)), num_threads_(num_threads) {
+  CHECK(splitter_);
+  CHECK_GT(num_threads_, 0);
+  // keep every thread busy while the caller parses a frame
+  window_ = 2 * num_threads_;
+}
+
+CompressedFileSplitter::~CompressedFileSplitter() {
+  stop();
+  if (compressed_bytes_ > 0) {
+    LOG(INFO) << "Decompressed " << compressed_bytes_ << " bytes of " << url_ << " into " << decompressed_bytes_
+              << " bytes, " << decompressed_bytes_ / 1e6 / std::max(decompress_seconds_, 1e-9)
+              << " MB/s per thread";
+  }
+}
+
+void CompressedFileSplitter::load(std::string url) {
+  url_ = url;
+  splitter_->load(url);
+}
+
+boost::string_ref CompressedFileSplitter::fetch_block(bool is_next) {
+  if (is_next) {
+    if (passthrough_) {
+      return splitter_->fetch_block(true);
+    }
+    // the frames following the current one
+    boost::string_ref data = wait_frame(&next_);
+    next_ += 1;
+    return data;
+  }
+
+  if (!passthrough_) {
+    // the caller is done with the current frame
+    offset_ += frames_[current_].data.size();
+    std::string().swap(frames_[current_].data);
+    size_t idx = current_ + 1;
+    boost::string_ref data = wait_frame(&idx);
+    for (size_t i = current_ + 1; i < idx; ++i) {
+      std::string().swap(frames_[i].data);  // empty frames
+    }
+    current_ = idx;
+    next_ = idx + 1;
+    if (!data.empty()) {
+      return data;
+    }
+    // the end of the compressed file
+    stop();
+  }
+
+  while (true) {
+    boost::string_ref block = splitter_->fetch_block(false);
+    if (block.empty() || splitter_->get_offset() != 0) {
+      return block;
+    }
+    Decompressor::Codec codec = Decompressor::detect(block);
+    if (codec == Decompressor::Codec::kNone) {
+      return block;
+    }
+    start(codec, block);
+    size_t idx = 0;
+    boost::string_ref data = wait_frame(&idx);
+    if (!data.empty()) {
+      current_ = idx;
+      next_ = idx + 1;
+      offset_ = 0;
+      return data;
+    }
+    // nothing in the file
+    stop();
+  }
+}
+
+size_t CompressedFileSplitter::get_offset() { return passthrough_ ? splitter_->get_offset() : offset_; }
+
+void CompressedFileSplitter::start(Decompressor::Codec codec, boost::string_ref head) {
+  CHECK(Decompressor::is_available(codec)) << "Built without " << Decompressor::get_name(codec) << " to read "
+                                           << url_;
+  codec_ = codec;
+  // the rest of the file, if the block does not cover it
+  boost::string_ref next = splitter_->fetch_block(true);
+  if (next.empty()) {
+    file_ = head;
+  } else {
+    compressed_.assign(head.data(), head.size());
+    for (; !next.empty(); next = splitter_->fetch_block(true)) {
+      compressed_.append(next.data(), next.size());
+    }
+    file_ = compressed_;
+  }
+  frame_pos_ = Decompressor::find_frames(codec_, file_);
+  CHECK(!frame_pos_.empty()) << "Corrupted " << Decompressor::get_name(codec_) << " file under " << url_;
+  if (frame_pos_.size() == 1 && num_threads_ > 1) {
+    LOG(INFO) << "A " << Decompressor::get_name(codec_) << " file under " << url_
+              << " is a single frame, decompressed by one thread, see Decompressor for the tools writing several";
+  }
+  compressed_bytes_ += file_.size();
+  file_start_ = std::chrono::steady_clock::now();
+  file_start_bytes_ = decompressed_bytes_;
+
+  frames_ = std::vector<Frame>(frame_pos_.size());
+  next_todo_ = 0;
+  max_wanted_ = 0;
+  stop_ = false;
+  passthrough_ = false;
+  int num_threads = std::min(static_cast<size_t>(num_threads_), frames_.size());
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this] { decompress(); });
+  }
+}
+
+void CompressedFileSplitter::stop() {
+  if (threads_.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  todo_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  double seconds = SecondsSince(file_start_);
+  LOG(INFO) << "Decompressed " << frames_.size() << " " << Decompressor::get_name(codec_) << " frames of " << url_
+            << " on " << num_threads_ << " threads in " << seconds << " s, "
+            << (decompressed_bytes_ - file_start_bytes_) / 1e6 / std::max(seconds, 1e-9) << " MB/s";
+  frames_.clear();
+  frame_pos_.clear();
+  std::string().swap(compressed_);
+  file_.clear();
+  passthrough_ = true;
+}
+
+void CompressedFileSplitter::decompress() {
+  while (true) {
+    size_t idx;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      todo_cv_.wait(lk, [this] {
+        return stop_ || next_todo_ >= frames_.size() || next_todo_ < max_wanted_ + window_;
+      });
+      if (stop_ || next_todo_ >= frames_.size()) {
+        return;
+      }
+      idx = next_todo_++;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::string data;
+    CHECK(Decompressor::decompress(codec_, file_.substr(frame_pos_[idx].first, frame_pos_[idx].second), &data))
+        << "Corrupted " << Decompressor::get_name(codec_) << " frame at " << frame_pos_[idx].first << " under "
+        << url_;
+    double seconds = SecondsSince(start);
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      decompressed_bytes_ += data.size();
+      decompress_seconds_ += seconds;
+      frames_[idx].data = std::move(data);
+      frames_[idx].done = true;
+    }
+    done_cv_.notify_all();
+  }
+}
+
+boost::string_ref CompressedFileSplitter::wait_frame(size_t* idx) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  for (; *idx < frames_.size(); *idx += 1) {
+    if (*idx > max_wanted_) {
+      max_wanted_ = *idx;
+      todo_cv_.notify_all();
+    }
+    done_cv_.wait(lk, [this, idx] { return frames_[*idx].done; });
+    if (!frames_[*idx].data.empty()) {
+      return frames_[*idx].data;
+    }
+  }
+  return "";
+}
+
+}  // namespace csci5570
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "boost/utility/string_ref.hpp"
+
+#include "io/abstract_file_splitter.hpp"
+#include "io/decompressor.hpp"
+
+namespace csci5570 {
+
+/**
+ * Decompresses the compressed files read by another splitter, see Decompressor
+ *
+ * A block at the start of a file with the magic number of a codec is completed up to the end of the file,
+ * which the master assigns as a single block if its name tells it is compressed. Its frames are then
+ * decompressed by <num_threads> threads, a few frames ahead of the caller, and handed out in order as
+ * blocks whose offsets are those in the decompressed file. Other blocks are passed through unchanged.
+ */
+class CompressedFileSplitter : public AbstractFileSplitter {
+ public:
+  CompressedFileSplitter(std::unique_ptr<AbstractFileSplitter> splitter, int num_threads);
+
+  ~CompressedFileSplitter() override;
+
+  void load(std::string url) override;
+
+  boost::string_ref fetch_block(bool is_next = false) override;
+
+  size_t get_offset() override;
+
+  // the compressed and decompressed bytes so far, and the time spent decompressing on all the threads
+  size_t get_compressed_bytes() const { return compressed_bytes_; }
+  size_t get_decompressed_bytes() const { return decompressed_bytes_; }
+  double get_decompress_seconds() const { return decompress_seconds_; }
+
+ private:
+  struct Frame {
+    std::string data;
+    bool done = false;
+  };
+
+  // start decompressing the file starting with <head>
+  void start(Decompressor::Codec codec, boost::string_ref head);
+  void stop();
+  void decompress();
+  // the next non-empty frame from <*idx> on, empty at the end of the file
+  boost::string_ref wait_frame(size_t* idx);
+
+  std::unique_ptr<AbstractFileSplitter> splitter_;
+  int num_threads_;
+  size_t window_;  // the number of frames decompressed ahead
+
+  // the compressed file being read
+  Decompressor::Codec codec_ = Decompressor::Codec::kNone;
+  std::string compressed_;  // a copy of the file if the first block did not cover it
+  boost::string_ref file_;  // the whole compressed file
+  std::vector<std::pair<size_t, size_t>> frame_pos_;  // the (offset, size) of the frames in file_
+  std::vector<Frame> frames_;
+  size_t current_ = 0;       // the frame handed out by the last fetch_block(false)
+  size_t next_ = 0;          // the frame to hand out by the next fetch_block(true)
+  size_t offset_ = 0;        // the offset of the current frame in the decompressed file
+  bool passthrough_ = true;  // whether the current block is from the inner splitter
+
+  // decompression
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable done_cv_;
+  std::condition_variable todo_cv_;
+  size_t next_todo_ = 0;   // the next frame to decompress
+  size_t max_wanted_ = 0;  // the last frame wanted by the caller
+  bool stop_ = false;
+
+  // statistics
+  size_t compressed_bytes_ = 0;
+  size_t decompressed_bytes_ = 0;
+  double decompress_seconds_ = 0;  // on the decompressing threads
+  std::chrono::steady_clock::time_point file_start_;  // of the current compressed file
+  size_t file_start_bytes_ = 0;
+  std::string url_;
+
+};  // class CompressedFileSplitter
+
+}  // namespace csci5570
@@ -0,0 +1,257 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "io/compressed_file_splitter.hpp"
+#include "io/decompressor.hpp"
+#include "io/line_input_format.hpp"
+#include "io/local_file_splitter.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef WITH_GZIP
+#include "zlib.h"
+#endif
+#ifdef WITH_ZSTD
+#include "zstd.h"
+#endif
+#ifdef WITH_LZ4
+#include "lz4frame.h"
+#endif
+
+namespace csci5570 {
+namespace {
+
+#ifdef WITH_GZIP
+// a BGZF member, i.e., a gzip member whose extra field tells its size
+std::string CompressBGZF(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  CHECK_EQ(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY), Z_OK);
+  std::string deflated(deflateBound(&stream, data.size()), '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&deflated[0]);
+  stream.avail_out = deflated.size();
+  CHECK_EQ(deflate(&stream, Z_FINISH), Z_STREAM_END);
+  deflated.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  auto le = [](uint32_t x, int bytes) {
+    std::string s;
+    for (int i = 0; i < bytes; ++i) {
+      s += static_cast<char>((x >> (8 * i)) & 0xff);
+    }
+    return s;
+  };
+  std::string member = std::string("\x1f\x8b\x08\x04", 4) + le(0, 4) + std::string("\x00\xff", 2) + le(6, 2) + "BC" +
+                       le(2, 2) + le(18 + deflated.size() + 8 - 1, 2);
+  member += deflated;
+  member += le(crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size()), 4) + le(data.size(), 4);
+  return member;
+}
+
+// a plain gzip member
+std::string CompressGzip(const std::string& data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  CHECK_EQ(deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY), Z_OK);
+  std::string out(deflateBound(&stream, data.size()) + 32, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  CHECK_EQ(deflate(&stream, Z_FINISH), Z_STREAM_END);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+#endif
+
+#ifdef WITH_ZSTD
+std::string CompressZstd(const std::string& data) {
+  std::string out(ZSTD_compressBound(data.size()), '\0');
+  size_t size = ZSTD_compress(&out[0], out.size(), data.data(), data.size(), 1);
+  CHECK(!ZSTD_isError(size));
+  out.resize(size);
+  return out;
+}
+#endif
+
+#ifdef WITH_LZ4
+std::string CompressLz4(const std::string& data) {
+  std::string out(LZ4F_compressFrameBound(data.size(), nullptr), '\0');
+  size_t size = LZ4F_compressFrame(&out[0], out.size(), data.data(), data.size(), nullptr);
+  CHECK(!LZ4F_isError(size));
+  out.resize(size);
+  return out;
+}
+#endif
+
+class TestCompressedFileSplitter : public testing::Test {
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/csci5570_compressed_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+    // lines of 0 to 40 characters
+    for (int i = 0; i < 2000; ++i) {
+      lines_.push_back(std::string(i % 41, 'a' + i % 26));
+      content_ += lines_.back() + "\n";
+    }
+    lines_.erase(lines_.begin());  // the first line is empty
+  }
+  void TearDown() {
+    std::string cmd = "rm -rf " + dir_;
+    system(cmd.c_str());
+  }
+
+  void WriteFile(const std::string& name, const std::string& content) {
+    FILE* file = fopen((dir_ + "/" + name).c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+  }
+
+  // compress the content in frames of <frame_size> bytes, cutting lines, with an empty frame in the middle
+  std::string Compress(const std::function<std::string(const std::string&)>& compress, size_t frame_size) {
+    std::string compressed;
+    for (size_t p = 0; p < content_.size(); p += frame_size) {
+      compressed += compress(content_.substr(p, frame_size));
+      if (p == 0) {
+        compressed += compress("");
+      }
+    }
+    return compressed;
+  }
+
+  std::vector<std::string> ReadLines(const std::string& url, size_t chunk_size) {
+    std::unique_ptr<AbstractFileSplitter> splitter(new LocalFileSplitter(1, 0, nullptr, "localhost", chunk_size));
+    LineInputFormat infmt(url, std::move(splitter));
+    std::vector<std::string> lines;
+    boost::string_ref record;
+    while (infmt.next(record)) {
+      lines.push_back(std::string(record.data(), record.size()));
+    }
+    return lines;
+  }
+
+  // read the decompressed blocks of a file and check their offsets
+  std::string ReadBlocks(const std::string& name, int num_threads, bool compressed) {
+    CompressedFileSplitter splitter(
+        std::unique_ptr<AbstractFileSplitter>(new LocalFileSplitter(1, 0, nullptr, "localhost", 1 << 20)),
+        num_threads);
+    splitter.load(dir_ + "/" + name);
+    std::string data;
+    for (boost::string_ref block = splitter.fetch_block(); !block.empty(); block = splitter.fetch_block()) {
+      EXPECT_EQ(splitter.get_offset(), data.size());
+      data.append(block.data(), block.size());
+    }
+    EXPECT_EQ(splitter.get_decompressed_bytes(), compressed ? data.size() : 0);
+    return data;
+  }
+
+  void TestCodec(const std::string& name, const std::string& compressed) {
+    WriteFile(name, compressed);
+    for (int num_threads : {1, 3}) {
+      EXPECT_EQ(ReadBlocks(name, num_threads, true), content_) << num_threads << " threads";
+    }
+    // the compressed file is read whole whatever the chunk size
+    EXPECT_EQ(ReadLines("file://" + dir_ + "/" + name, 64), lines_);
+  }
+
+  std::string dir_;
+  std::string content_;
+  std::vector<std::string> lines_;
+};
+
+TEST_F(TestCompressedFileSplitter, Detect) {
+  EXPECT_EQ(Decompressor::detect(std::string("\x1f\x8b\x08\x00", 4)), Decompressor::Codec::kGzip);
+  EXPECT_EQ(Decompressor::detect("\x28\xb5\x2f\xfd"), Decompressor::Codec::kZstd);
+  EXPECT_EQ(Decompressor::detect("\x04\x22\x4d\x18"), Decompressor::Codec::kLz4);
+  // a skippable frame, as pzstd writes before each frame, is followed by the frame telling the codec
+  std::string skippable("\x50\x2a\x4d\x18\x04\x00\x00\x00\x10\x00\x00\x00", 12);
+  EXPECT_EQ(Decompressor::detect(skippable + "\x28\xb5\x2f\xfd"), Decompressor::Codec::kZstd);
+  EXPECT_EQ(Decompressor::detect(skippable + skippable + "\x04\x22\x4d\x18"), Decompressor::Codec::kLz4);
+  EXPECT_EQ(Decompressor::detect(skippable + "1 1:1\n"), Decompressor::Codec::kNone);
+  EXPECT_EQ(Decompressor::detect("1 1:1\n"), Decompressor::Codec::kNone);
+  EXPECT_EQ(Decompressor::detect(""), Decompressor::Codec::kNone);
+  EXPECT_TRUE(Decompressor::is_compressed_name("/data/part-0.gz"));
+  EXPECT_TRUE(Decompressor::is_compressed_name("/data/part-0.zst"));
+  EXPECT_TRUE(Decompressor::is_compressed_name("/data/part-0.lz4"));
+  EXPECT_FALSE(Decompressor::is_compressed_name("/data/part-0"));
+}
+
+TEST_F(TestCompressedFileSplitter, PassThrough) {
+  WriteFile("data", content_);
+  EXPECT_EQ(ReadBlocks("data", 2, false), content_);
+  EXPECT_EQ(ReadLines("file://" + dir_ + "/data", 64), lines_);
+}
+
+#ifdef WITH_GZIP
+TEST_F(TestCompressedFileSplitter, Gzip) {
+  std::string bgzf = Compress(CompressBGZF, 1000);
+  EXPECT_EQ(Decompressor::find_frames(Decompressor::Codec::kGzip, bgzf).size(), content_.size() / 1000 + 2);
+  TestCodec("bgzf.gz", bgzf);
+  // plain gzip members cannot be located, they are decompressed at once
+  std::string gzip = Compress(CompressGzip, 1000);
+  EXPECT_EQ(Decompressor::find_frames(Decompressor::Codec::kGzip, gzip).size(), 1);
+  TestCodec("plain.gz", gzip);
+  std::string large(1 << 20, 'x'), out;
+  EXPECT_TRUE(Decompressor::decompress(Decompressor::Codec::kGzip, CompressGzip(large), &out));
+  EXPECT_EQ(out, large);
+}
+#endif
+
+#ifdef WITH_ZSTD
+TEST_F(TestCompressedFileSplitter, Zstd) {
+  std::string zstd = Compress(CompressZstd, 1000);
+  EXPECT_EQ(Decompressor::find_frames(Decompressor::Codec::kZstd, zstd).size(), content_.size() / 1000 + 2);
+  TestCodec("data.zst", zstd);
+  // pzstd writes a skippable frame with the size of each frame before it
+  std::string pzstd;
+  for (size_t i = 0; i < content_.size(); i += 1000) {
+    std::string frame = CompressZstd(content_.substr(i, 1000));
+    uint32_t size = frame.size();
+    pzstd += std::string("\x50\x2a\x4d\x18\x04\x00\x00\x00", 8) + std::string(reinterpret_cast<char*>(&size), 4);
+    pzstd += frame;
+  }
+  EXPECT_EQ(Decompressor::detect(pzstd), Decompressor::Codec::kZstd);
+  TestCodec("pzstd.zst", pzstd);
+  // a frame filling the output pieces exactly
+  std::string large(1 << 20, 'x'), out;
+  EXPECT_TRUE(Decompressor::decompress(Decompressor::Codec::kZstd, CompressZstd(large), &out));
+  EXPECT_EQ(out, large);
+}
+#endif
+
+#ifdef WITH_LZ4
+TEST_F(TestCompressedFileSplitter, Lz4) {
+  std::string lz4 = Compress(CompressLz4, 1000);
+  EXPECT_EQ(Decompressor::find_frames(Decompressor::Codec::kLz4, lz4).size(), content_.size() / 1000 + 2);
+  TestCodec("data.lz4", lz4);
+  std::string large(1 << 20, 'x'), out;
+  EXPECT_TRUE(Decompressor::decompress(Decompressor::Codec::kLz4, CompressLz4(large), &out));
+  EXPECT_EQ(out, large);
+  // truncated
+  EXPECT_TRUE(Decompressor::find_frames(Decompressor::Codec::kLz4, lz4.substr(0, lz4.size() - 3)).empty());
+}
+#endif
+
+#if defined(WITH_GZIP) && defined(WITH_ZSTD)
+TEST_F(TestCompressedFileSplitter, ReadDirectory) {
+  // plain and compressed files mixed
+  WriteFile("a", "1 1:1\n2 2:2\n");
+  WriteFile("b.gz", CompressBGZF("3 3:3\n4 4:4"));
+  WriteFile("c.zst", CompressZstd("5 5:5\n"));
+  std::vector<std::string> lines = ReadLines("file://" + dir_, 4);
+  EXPECT_EQ(lines, (std::vector<std::string>{"1 1:1", "2 2:2", "3 3:3", "4 4:4", "5 5:5"}));
+}
+#endif
+
+}  // namespace
+}  // namespace csci5570
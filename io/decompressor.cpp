@@ -0,0 +1,314 @@
+#include "io/decompressor.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/utility/string_ref.hpp"
+#include "glog/logging.h"
+
+#ifdef WITH_GZIP
+#include "zlib.h"
+#endif
+#ifdef WITH_ZSTD
+#include "zstd.h"
+#endif
+#ifdef WITH_LZ4
+#include "lz4frame.h"
+#endif
+
+namespace csci5570 {
+
+namespace {
+
+const uint32_t kZstdMagic = 0xFD2FB528;
+const uint32_t kLz4Magic = 0x184D2204;
+const uint32_t kSkippableMagic = 0x184D2A50;  // to 0x184D2A5F, the skippable frames of both zstd and lz4
+
+// the size of the pieces of output when the decompressed size is unknown
+const size_t kOutputPieceSize = 1 << 20;
+
+uint32_t ReadLE(const char* p, int bytes) {
+  uint32_t x = 0;
+  for (int i = bytes - 1; i >= 0; --i) {
+    x = (x << 8) | static_cast<unsigned char>(p[i]);
+  }
+  return x;
+}
+
+bool EndsWith(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * The size of the BGZF member at the start of <data>, 0 if it has no BGZF block size
+ */
+size_t BGZFMemberSize(boost::string_ref data) {
+  // ID1 ID2 CM FLG with FEXTRA, MTIME, XFL, OS, XLEN, then the subfields
+  if (data.size() < 18 || static_cast<unsigned char>(data[0]) != 0x1f || static_cast<unsigned char>(data[1]) != 0x8b ||
+      (data[3] & 4) == 0)
+    return 0;
+  size_t xlen = ReadLE(data.data() + 10, 2);
+  if (12 + xlen > data.size())
+    return 0;
+  for (size_t p = 12; p + 4 <= 12 + xlen;) {
+    size_t slen = ReadLE(data.data() + p + 2, 2);
+    if (data[p] == 'B' && data[p + 1] == 'C' && slen == 2 && p + 6 <= 12 + xlen) {
+      return ReadLE(data.data() + p + 4, 2) + 1;
+    }
+    p += 4 + slen;
+  }
+  return 0;
+}
+
+/**
+ * The size of the lz4 frame, or skippable frame, at the start of <data>, 0 if corrupted
+ */
+size_t Lz4FrameSize(boost::string_ref data) {
+  if (data.size() < 8)
+    return 0;
+  uint32_t magic = ReadLE(data.data(), 4);
+  if ((magic & 0xFFFFFFF0) == kSkippableMagic) {
+    size_t size = 8 + static_cast<size_t>(ReadLE(data.data() + 4, 4));
+    return size <= data.size() ? size : 0;
+  }
+  if (magic != kLz4Magic)
+    return 0;
+  unsigned char flg = data[4];
+  if ((flg >> 6) != 1)
+    return 0;
+  bool block_checksum = flg & 0x10;
+  bool content_size = flg & 0x08;
+  bool content_checksum = flg & 0x04;
+  bool dict_id = flg & 0x01;
+  // magic, FLG, BD, the optional fields and the header checksum
+  size_t p = 4 + 2 + (content_size ? 8 : 0) + (dict_id ? 4 : 0) + 1;
+  while (true) {
+    if (p + 4 > data.size())
+      return 0;
+    // the highest bit tells an uncompressed block
+    uint32_t block_size = ReadLE(data.data() + p, 4) & 0x7FFFFFFF;
+    p += 4;
+    if (block_size == 0)  // the end mark
+      break;
+    p += block_size + (block_checksum ? 4 : 0);
+  }
+  p += content_checksum ? 4 : 0;
+  return p <= data.size() ? p : 0;
+}
+
+#ifdef WITH_GZIP
+bool DecompressGzip(boost::string_ref frame, std::string* out) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, 15 + 16) != Z_OK)
+    return false;
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(frame.data()));
+  stream.avail_in = frame.size();
+  bool ok = true;
+  while (true) {
+    size_t size = out->size();
+    out->resize(size + kOutputPieceSize);
+    stream.next_out = reinterpret_cast<Bytef*>(&(*out)[size]);
+    stream.avail_out = kOutputPieceSize;
+    int rc = inflate(&stream, Z_NO_FLUSH);
+    out->resize(out->size() - stream.avail_out);
+    if (rc == Z_STREAM_END) {
+      if (stream.avail_in == 0)
+        break;
+      // the next member
+      inflateReset(&stream);
+    } else if (rc != Z_OK) {
+      ok = false;
+      break;
+    }
+  }
+  inflateEnd(&stream);
+  return ok;
+}
+#endif
+
+#ifdef WITH_ZSTD
+bool DecompressZstd(boost::string_ref frame, std::string* out) {
+  std::unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream*)> stream(ZSTD_createDStream(), ZSTD_freeDStream);
+  if (!stream || ZSTD_isError(ZSTD_initDStream(stream.get())))
+    return false;
+  // reserve the whole output if the frame header tells its size
+  unsigned long long content_size = ZSTD_getFrameContentSize(frame.data(), frame.size());
+  if (content_size != ZSTD_CONTENTSIZE_UNKNOWN && content_size != ZSTD_CONTENTSIZE_ERROR) {
+    out->reserve(out->size() + content_size);
+  }
+  ZSTD_inBuffer input{frame.data(), frame.size(), 0};
+  size_t rc = 0;
+  while (true) {
+    size_t size = out->size();
+    size_t piece = std::max(out->capacity() - size, kOutputPieceSize);
+    out->resize(size + piece);
+    ZSTD_outBuffer output{&(*out)[size], piece, 0};
+    rc = ZSTD_decompressStream(stream.get(), &output, &input);
+    out->resize(size + output.pos);
+    if (ZSTD_isError(rc))
+      return false;
+    // done once the input is consumed and the last frame is complete, or truncated
+    if (input.pos == input.size && (rc == 0 || output.pos < piece))
+      break;
+  }
+  // 0 once a frame is complete
+  return rc == 0;
+}
+#endif
+
+#ifdef WITH_LZ4
+bool DecompressLz4(boost::string_ref frame, std::string* out) {
+  LZ4F_dctx* dctx;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+    return false;
+  const char* in = frame.data();
+  const char* end = frame.data() + frame.size();
+  size_t rc = 0;
+  bool ok = true;
+  while (in < end || rc > 0) {
+    size_t size = out->size();
+    out->resize(size + kOutputPieceSize);
+    size_t out_size = kOutputPieceSize;
+    size_t in_size = end - in;
+    rc = LZ4F_decompress(dctx, &(*out)[size], &out_size, in, &in_size, nullptr);
+    out->resize(size + out_size);
+    in += in_size;
+    if (LZ4F_isError(rc) || (in_size == 0 && out_size == 0)) {
+      // an error, or a truncated frame
+      ok = false;
+      break;
+    }
+  }
+  LZ4F_freeDecompressionContext(dctx);
+  return ok;
+}
+#endif
+
+}  // namespace
+
+Decompressor::Codec Decompressor::detect(boost::string_ref head) {
+  if (head.size() >= 2 && static_cast<unsigned char>(head[0]) == 0x1f && static_cast<unsigned char>(head[1]) == 0x8b)
+    return Codec::kGzip;
+  // skippable frames, e.g., the headers of pzstd, are shared by zstd and lz4, the codec is that of the next frame
+  size_t p = 0;
+  while (head.size() >= p + 8 && (ReadLE(head.data() + p, 4) & 0xFFFFFFF0) == kSkippableMagic) {
+    p += 8 + static_cast<size_t>(ReadLE(head.data() + p + 4, 4));
+  }
+  if (head.size() < p + 4)
+    // nothing seen past the skippable frames, as written by pzstd, or a truncated file
+    return p > 0 && p > head.size() ? Codec::kZstd : Codec::kNone;
+  if (ReadLE(head.data() + p, 4) == kZstdMagic)
+    return Codec::kZstd;
+  if (ReadLE(head.data() + p, 4) == kLz4Magic)
+    return Codec::kLz4;
+  return Codec::kNone;
+}
+
+bool Decompressor::is_compressed_name(const std::string& filename) {
+  return EndsWith(filename, ".gz") || EndsWith(filename, ".zst") || EndsWith(filename, ".zstd") ||
+         EndsWith(filename, ".lz4");
+}
+
+bool Decompressor::is_available(Codec codec) {
+  switch (codec) {
+  case Codec::kNone:
+    return true;
+  case Codec::kGzip:
+#ifdef WITH_GZIP
+    return true;
+#else
+    return false;
+#endif
+  case Codec::kZstd:
+#ifdef WITH_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  case Codec::kLz4:
+#ifdef WITH_LZ4
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+const char* Decompressor::get_name(Codec codec) {
+  switch (codec) {
+  case Codec::kNone:
+    return "none";
+  case Codec::kGzip:
+    return "gzip";
+  case Codec::kZstd:
+    return "zstd";
+  case Codec::kLz4:
+    return "lz4";
+  }
+  return "unknown";
+}
+
+std::vector<std::pair<size_t, size_t>> Decompressor::find_frames(Codec codec, boost::string_ref data) {
+  std::vector<std::pair<size_t, size_t>> frames;
+  size_t p = 0;
+  while (p < data.size()) {
+    size_t size = 0;
+    if (codec == Codec::kGzip) {
+      // a gzip member does not tell its size unless it is a BGZF block, decompress the rest at once then
+      size = BGZFMemberSize(data.substr(p));
+      if (size == 0 || p + size > data.size())
+        size = data.size() - p;
+    } else if (codec == Codec::kZstd) {
+#ifdef WITH_ZSTD
+      size = ZSTD_findFrameCompressedSize(data.data() + p, data.size() - p);
+      if (ZSTD_isError(size))
+        size = 0;
+#else
+      size = data.size() - p;
+#endif
+    } else if (codec == Codec::kLz4) {
+      size = Lz4FrameSize(data.substr(p));
+    } else {
+      size = data.size() - p;
+    }
+    if (size == 0) {
+      LOG(ERROR) << "Corrupted " << get_name(codec) << " frame at " << p;
+      return {};
+    }
+    frames.push_back({p, size});
+    p += size;
+  }
+  return frames;
+}
+
+bool Decompressor::decompress(Codec codec, boost::string_ref frame, std::string* out) {
+  switch (codec) {
+  case Codec::kNone:
+    out->append(frame.data(), frame.size());
+    return true;
+#ifdef WITH_GZIP
+  case Codec::kGzip:
+    return DecompressGzip(frame, out);
+#endif
+#ifdef WITH_ZSTD
+  case Codec::kZstd:
+    return DecompressZstd(frame, out);
+#endif
+#ifdef WITH_LZ4
+  case Codec::kLz4:
+    return DecompressLz4(frame, out);
+#endif
+  default:
+    LOG(ERROR) << "Built without " << get_name(codec);
+    return false;
+  }
+}
+
+}  // namespace csci5570
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "boost/utility/string_ref.hpp"
+
+namespace csci5570 {
+
+/**
+ * Decompression of gzip, zstd and lz4 files made of independently compressed frames
+ *
+ * The frames are gzip members (located without decompression if they carry a BGZF block size, as bgzip
+ * writes), zstd frames and lz4 frames, so that they can be decompressed in parallel. A file is only split
+ * if it was written in several frames: gzip writes a single member, use bgzip; the zstd CLI writes a single
+ * frame, even with -T, use pzstd or the seekable format; lz4 writes a single frame. Skippable zstd and lz4
+ * frames, e.g., the headers of pzstd, are decompressed to nothing. A codec is available if its library is
+ * found at build time, i.e., with WITH_GZIP, WITH_ZSTD and WITH_LZ4.
+ */
+class Decompressor {
+ public:
+  enum class Codec { kNone, kGzip, kZstd, kLz4 };
+
+  /**
+   * The codec of the data starting with <head>, by its magic number
+   */
+  static Codec detect(boost::string_ref head);
+
+  /**
+   * Whether the file name has the extension of a compressed file, i.e., the file cannot be split in blocks
+   */
+  static bool is_compressed_name(const std::string& filename);
+
+  static bool is_available(Codec codec);
+  static const char* get_name(Codec codec);
+
+  /**
+   * Split compressed data into frames to decompress independently
+   *
+   * @return  the (offset, size) of the frames, a single frame if they cannot be located, empty if corrupted
+   */
+  static std::vector<std::pair<size_t, size_t>> find_frames(Codec codec, boost::string_ref data);
+
+  /**
+   * Decompress a frame, or consecutive frames, appending to <out>
+   *
+   * @return  false if the data is corrupted
+   */
+  static bool decompress(Codec codec, boost::string_ref frame, std::string* out);
+};
+
+}  // namespace csci5570
@@ -1,21 +1,23 @@
 #include "hdfs_assigner.hpp"
 
+#include <algorithm>
+#include <string>
+
 #include "glog/logging.h"
 
 #include "base/serialization.hpp"
 #include "base/zmq_helper.hpp"
+#include "io/decompressor.hpp"
 
 namespace csci5570 {
 
 const int HDFSBlockAssigner::kBlockRequest;
 const int HDFSBlockAssigner::kExit;
 
-bool HDFSBlockAssigner::BlkDesc::operator==(const BlkDesc& other) const {
-  return filename == other.filename && offset == other.offset && block_location == block_location;
-}
-
 HDFSBlockAssigner::HDFSBlockAssigner(std::string hdfs_namenode, int hdfs_namenode_port, zmq::context_t* context,
-                                     int master_port, int total_nodes) {
+                                     int master_port, int total_nodes, size_t local_chunk_size,
+                                     const BlockAssignmentPolicy::Options& options)
+    : local_chunk_size_(local_chunk_size), options_(options) {
   init_socket(master_port, context);
   init_hdfs(hdfs_namenode, hdfs_namenode_port);
   total_nodes_ = total_nodes;
@@ -57,6 +59,12 @@ void HDFSBlockAssigner::handle_exit() {
   stream.push_back_bytes(reinterpret_cast<char*>(msg.data()), msg.size());
   stream >> worker_name >> worker_id;
   finished_workers_.insert(worker_name);
+  // the host asks for no more blocks, the others should not wait for it
+  for (auto& task : policies_) {
+    for (auto& kv : task.second) {
+      kv.second.leave(worker_name);
+    }
+  }
 
   LOG(INFO) << "master => worker finished @" << worker_name << "-" << std::to_string(worker_id);
 
@@ -74,13 +82,31 @@ void HDFSBlockAssigner::handle_block_request(const std::string& cur_client) {
   BinStream stream;
   stream.push_back_bytes(reinterpret_cast<char*>(msg1.data()), msg1.size());
   stream >> url >> host >> num_threads >> id;
+  if (stream.size() > 0) {
+    // the block the worker finished
+    std::string done_file;
+    size_t done_offset;
+    stream >> done_file >> done_offset;
+    auto task = policies_.find(id);
+    if (task != policies_.end() && task->second.find(url) != task->second.end()) {
+      task->second[url].complete(host, done_file, done_offset, now());
+    }
+  }
 
   // reset num_worker_alive
   num_workers_alive_ += num_threads;
   LOG(INFO) << url << " " << host << " " << num_threads << " " << id << " " << load_type;
-  std::pair<std::string, size_t> ret = answer(host, url, id);
+  BlockAssignmentPolicy::Assignment ret = answer(host, url, id);
   stream.clear();
-  stream << ret.first << ret.second;
+  stream << ret.filename << ret.offset;
+  if (ret.filename.empty()) {
+    // whether the worker should ask again later rather than stop reading
+    stream << ret.retry;
+  } else if (is_local(url)) {
+    // local chunks have no block size to look up, a compressed file is read whole
+    stream << (Decompressor::is_compressed_name(ret.filename) ? LocalFileSplitter::get_file_size(ret.filename)
+                                                              : local_chunk_size_);
+  }
 
   zmq_send_common(master_socket_.get(), cur_client.data(), cur_client.length(), ZMQ_SNDMORE);
   zmq_send_common(master_socket_.get(), nullptr, 0, ZMQ_SNDMORE);
@@ -93,6 +119,7 @@ void HDFSBlockAssigner::init_socket(int master_port, zmq::context_t* zmq_context
 }
 
 void HDFSBlockAssigner::init_hdfs(const std::string& node, const int& port) {
+#ifdef WITH_HDFS
   int num_retries = 3;
   while (num_retries--) {
     struct hdfsBuilder* builder = hdfsNewBuilder();
@@ -107,109 +134,114 @@ void HDFSBlockAssigner::init_hdfs(const std::string& node, const int& port) {
     return;
   }
   LOG(ERROR) << "Failed to connect to HDFS " << node << ":" << port;
+#endif
 }
 
 /**
- * Build locality dictionary for files
+ * Collect the blocks of files and their locations from hdfs
  */
 void HDFSBlockAssigner::browse_hdfs(int id, const std::string& url) {
+#ifdef WITH_HDFS
   if (!fs_)
     return;
 
   // 1. List Url Directory
   int num_files;
-  int dummy;
   hdfsFileInfo* file_info = hdfsListDirectory(fs_, url.c_str(), &num_files);
 
   // 2. Collect file locality info for specific task <id> and input <url>
-  auto& files_locality = files_locality_multi_dict_[id][url];
+  auto& policy = policies_[id][url];
   for (int i = 0; i < num_files; ++i) {         // for every file in a directory
     if (file_info[i].mKind != kObjectKindFile)  // omit directories
       continue;
-    size_t k = 0;
-    while (k < file_info[i].mSize) {
+    int num_blocks;
+    BlockLocation* blk_loc = hdfsGetFileBlockLocations(fs_, file_info[i].mName, 0, file_info[i].mSize, &num_blocks);
+    // a compressed file cannot be split, it is a single block located at its first one
+    bool compressed = Decompressor::is_compressed_name(file_info[i].mName);
+    for (int k = 0; k < (compressed ? std::min(num_blocks, 1) : num_blocks); ++k) {
       // for every block in a file
-      auto blk_loc = hdfsGetFileBlockLocations(fs_, file_info[i].mName, k, 1, &dummy);
-      for (int j = 0; j < blk_loc->numOfNodes; ++j) {
-        // for every replication in a block
-        files_locality[blk_loc->hosts[j]].insert(
-            BlkDesc{std::string(file_info[i].mName) + '\0', k, std::string(blk_loc->hosts[j])});
-        // init finish_multi_dict_, 0 means no thread has been rejected by this (url, host)
-        (finish_multi_dict_[id][url].first)[blk_loc->hosts[j]] = 0;
+      BlockAssignmentPolicy::Block block{file_info[i].mName, static_cast<size_t>(blk_loc[k].offset),
+                                         static_cast<size_t>(compressed ? file_info[i].mSize : blk_loc[k].length),
+                                         {}, {}};
+      for (int j = 0; j < blk_loc[k].numOfNodes; ++j) {
+        // for every replication in a block, the rack is the directory of the topology path,
+        // e.g., /default-rack of /default-rack/10.0.0.1:50010
+        block.hosts.push_back(blk_loc[k].hosts[j]);
+        std::string topology = blk_loc[k].topologyPaths ? blk_loc[k].topologyPaths[j] : "";
+        block.racks.push_back(topology.substr(0, topology.rfind('/')));
       }
-      k += file_info[i].mBlockSize;
+      policy.add_block(block);
     }
+    if (blk_loc != NULL)
+      hdfsFreeFileBlockLocations(blk_loc, num_blocks);
   }
 
   // 3. Clear file info
   hdfsFreeFileInfo(file_info, num_files);
+#endif
 }
 
 /**
- * Assign blocks to workers per request
+ * Collect the chunks of local files, the chunks have no location so that any host can take them
  */
-std::pair<std::string, size_t> HDFSBlockAssigner::answer(const std::string& host, const std::string& url, int id) {
-  if (!fs_)
-    return {"", 0};
-
-  // 1. If id or url is not found, collect file locality information from hdfs
-  if (files_locality_multi_dict_.find(id) == files_locality_multi_dict_.end() ||
-      files_locality_multi_dict_[id].find(url) == files_locality_multi_dict_[id].end()) {
-    browse_hdfs(id, url);
-    // reset the url accessing times
-    finish_multi_dict_[id][url].second = 0;
+void HDFSBlockAssigner::browse_local(int id, const std::string& url) {
+  auto& policy = policies_[id][url];
+  for (const auto& fn : LocalFileSplitter::list_files(url.substr(std::string("file://").size()))) {
+    size_t size = LocalFileSplitter::get_file_size(fn);
+    // a compressed file cannot be split
+    size_t chunk_size = Decompressor::is_compressed_name(fn) ? size : local_chunk_size_;
+    for (size_t k = 0; k < size; k += chunk_size) {
+      policy.add_block(BlockAssignmentPolicy::Block{fn, k, std::min(chunk_size, size - k), {}, {}});
+    }
   }
+}
 
-  // selected_file, offset
-  std::pair<std::string, size_t> ret = {"", 0};
-
-  auto& all_files_locality = files_locality_multi_dict_[id][url];
-  /*
-   * when loading local host, selected_host equals host,
-   * when loading gloabl host, selected_host equals an unfinished host
-   */
-  std::string selected_host;
-
-  // if there is local file, allocate local file
-  if (all_files_locality[host].size()) {
-    selected_host = host;
-  } else {  // there is no local file, so need to check all hosts
-    bool is_finish = true;
-    for (auto& item : all_files_locality) {
-      if (item.second.size() != 0) {
-        is_finish = false;
-        selected_host = item.first;  // default allocate an unfinished host block
-        break;
-      }
-    }
+bool HDFSBlockAssigner::is_local(const std::string& url) { return url.compare(0, 7, "file://") == 0; }
 
-    if (is_finish) {
-      finish_multi_dict_[id][url].second += 1;
-      if (finish_multi_dict_[id][url].second == num_workers_alive_) {
-        // this means all workers's requests about this url are rejected
-        // blocks under this url are all allocated
-        files_locality_multi_dict_[id].erase(url);
-      }
-      return {"", 0};
+double HDFSBlockAssigner::now() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+}
+
+/**
+ * Assign blocks to workers per request
+ */
+BlockAssignmentPolicy::Assignment HDFSBlockAssigner::answer(const std::string& host, const std::string& url,
+                                                             int id) {
+  bool local = is_local(url);
+#ifdef WITH_HDFS
+  if (!local && !fs_)
+    return {"", 0, false, false};
+#else
+  if (!local)
+    return {"", 0, false, false};
+#endif
+
+  // 1. If id or url is not found, collect file locality information from hdfs or the local file system
+  if (policies_.find(id) == policies_.end() || policies_[id].find(url) == policies_[id].end()) {
+    policies_[id].emplace(url, BlockAssignmentPolicy(options_));
+    if (local) {
+      browse_local(id, url);
+    } else {
+      browse_hdfs(id, url);
     }
+    // reset the url accessing times
+    num_rejected_[id][url] = 0;
   }
 
-  // according selected_host to get the select file
-  auto selected_file = all_files_locality[selected_host].begin();
-  // select
-  ret = {selected_file->filename, selected_file->offset};
-
-  // caution: need to remove all replicas in different host
-  for (auto its = all_files_locality.begin(); its != all_files_locality.end(); its++) {
-    for (auto it = its->second.begin(); it != its->second.end(); it++) {
-      if (it->filename == ret.first && it->offset == ret.second) {
-        all_files_locality[its->first].erase(it);
-        break;
-      }
+  // 2. Pick a block
+  auto& policy = policies_[id][url];
+  BlockAssignmentPolicy::Assignment assignment = policy.assign(host, now());
+  if (assignment.filename.empty() && !assignment.retry) {
+    num_rejected_[id][url] += 1;
+    if (num_rejected_[id][url] == static_cast<size_t>(num_workers_alive_)) {
+      // this means all workers's requests about this url are rejected
+      // blocks under this url are all allocated
+      LOG(INFO) << "All the " << policy.get_num_blocks() << " blocks of " << url << " are assigned, "
+                << policy.get_num_speculative() << " speculatively";
+      policies_[id].erase(url);
     }
   }
-
-  return ret;
+  return assignment;
 }
 
 }  // namespace csci5570
@@ -1,17 +1,30 @@
 #pragma once
 
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
-#include <unordered_set>
 #include <utility>
 
+#ifdef WITH_HDFS
 #include "hdfs/hdfs.h"
+#endif
 #include "zmq.hpp"
 
+#include "io/block_assignment_policy.hpp"
+#include "io/local_file_splitter.hpp"
+
 namespace csci5570 {
 
+/**
+ * Assigns the blocks of the files under a url to the workers asking for them, see BlockAssignmentPolicy
+ *
+ * The blocks are HDFS blocks for HDFS urls, and chunks of <local_chunk_size> bytes for file:// urls, which
+ * do not need HDFS. A compressed file, told by its name, is a single block. A block request may carry the
+ * block the worker finished, to measure its read rate. An answer without a block says whether the worker should
+ * ask again later, e.g., while it would be the tail, or stop reading.
+ */
 class HDFSBlockAssigner {
  public:
   // 301 is a constant for IO load
@@ -19,14 +32,9 @@ class HDFSBlockAssigner {
   static const int kBlockRequest = 301;
   static const int kExit = 300;
 
-  struct BlkDesc {
-    std::string filename;
-    size_t offset;
-    std::string block_location;
-    bool operator==(const BlkDesc& other) const;
-  };
-
-  HDFSBlockAssigner(std::string hdfsNameNode, int hdfsNameNodePort, zmq::context_t* context, int master_port, int total_nodes);
+  HDFSBlockAssigner(std::string hdfsNameNode, int hdfsNameNodePort, zmq::context_t* context, int master_port, int total_nodes,
+                    size_t local_chunk_size = LocalFileSplitter::kDefaultChunkSize,
+                    const BlockAssignmentPolicy::Options& options = BlockAssignmentPolicy::Options());
   ~HDFSBlockAssigner() = default;
 
   void Serve();
@@ -38,35 +46,32 @@ class HDFSBlockAssigner {
   void init_socket(int master_port, zmq::context_t* zmq_context);
   void init_hdfs(const std::string& node, const int& port);
   void browse_hdfs(int id, const std::string& url);
-  std::pair<std::string, size_t> answer(const std::string& host, const std::string& url, int id);
+  void browse_local(int id, const std::string& url);
+  static bool is_local(const std::string& url);
+  BlockAssignmentPolicy::Assignment answer(const std::string& host, const std::string& url, int id);
+  double now() const;
 
  private:
   bool running_ = true;
   std::unique_ptr<zmq::socket_t> master_socket_;
 
+#ifdef WITH_HDFS
   hdfsFS fs_ = NULL;
+#endif
+  size_t local_chunk_size_;
   std::set<std::string> finished_workers_;
   int num_workers_alive_ = 0;
   int total_nodes_;
   std::map<std::string, int> finish_dict;
+  BlockAssignmentPolicy::Options options_;
+  std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
 
-  // {task_id: {{url: {host:[{filename,offset,block_location}, {filename,offset,block_location}...]}},....}},...
-  std::map<size_t, std::map<std::string, std::map<std::string, std::unordered_set<BlkDesc>>>>
-      files_locality_multi_dict_;
+  // {task_id: {url: the blocks of the url}}
+  std::map<size_t, std::map<std::string, BlockAssignmentPolicy>> policies_;
 
-  // finish_multi_dict_ describes each available thread has request the url, and response null
+  // the number of requests answered with no block left per task_id and url, not counting the ones told to retry
   // if none thread can get anything from an url, this means this url has dispensed all block, this url can be removed
-  // {task_id:{{url: {{host: count},count_num},...}},...
-  std::map<size_t, std::map<std::string, std::pair<std::map<std::string, size_t>, size_t>>> finish_multi_dict_;
+  std::map<size_t, std::map<std::string, size_t>> num_rejected_;
 };
 
 }  // namespace csci5570
-
-namespace std {
-
-template <>
-struct hash<csci5570::HDFSBlockAssigner::BlkDesc> {
-  size_t operator()(const csci5570::HDFSBlockAssigner::BlkDesc& t) const { return hash<string>()(t.filename); }
-};
-
-}  // namespace std
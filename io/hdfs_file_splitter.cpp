@@ -8,75 +8,105 @@
 
 namespace csci5570 {
 
+namespace {
+
+// the size of the reads for the data following a block, which usually ends in the first few bytes
+const size_t kNextReadSize = 64 << 10;
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+const int HDFSFileSplitter::kDefaultReadAhead;
+
 HDFSFileSplitter::HDFSFileSplitter(int num_threads, int id, Coordinator* coordinator, std::string hostname,
-                                   std::string hdfs_namenode, int hdfs_namenode_port) {
-  data_ = nullptr;
+                                   std::string hdfs_namenode, int hdfs_namenode_port, int read_ahead) {
   num_threads_ = num_threads;
   id_ = id;
   coordinator_ = coordinator;
   hostname_ = hostname;
   hdfs_namenode_ = hdfs_namenode;
   hdfs_namenode_port_ = hdfs_namenode_port;
+  read_ahead_ = read_ahead;
+  CHECK_GT(read_ahead_, 0);
 }
 
 HDFSFileSplitter::~HDFSFileSplitter() {
-  if (data_)
-    delete[] data_;
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+    }
+    free_cv_.notify_all();
+    thread_.join();
+  }
+  if (next_file_ != NULL) {
+    hdfsCloseFile(fs_, next_file_);
+  }
+  if (num_blocks_ > 0) {
+    LOG(INFO) << "Read " << num_blocks_ << " blocks of " << url_ << ", " << num_bytes_ << " bytes in "
+              << read_seconds_ << " s, waited " << io_wait_seconds_ << " s for I/O, parsed for " << parse_seconds_
+              << " s";
+  }
 }
 
 boost::string_ref HDFSFileSplitter::fetch_block(bool is_next) {
-  int nbytes = 0;
-
   if (is_next) {
-    nbytes = hdfsRead(fs_, file_, data_, hdfs_block_size);
-    if (nbytes == 0)
-      return "";
-    if (nbytes == -1) {
-      LOG(ERROR) << "read next block error!";
-    }
-  } else {
-    // ask master for a new block
-    BinStream question;
-    question << url_ << hostname_ << num_threads_ << id_;
-    // 301 is constant for kBlockRequest
-    BinStream answer = coordinator_->ask_master(question, 301);
-    std::string fn;
-    answer >> fn;
-    answer >> offset_;
-    if (fn.empty()) {
-      // no more files
-      return "";
-    }
+    return read_next();
+  }
 
-    if (file_ != NULL) {
-      int rc = hdfsCloseFile(fs_, file_);
-      CHECK(rc == 0) << "close file fails";
-      // Notice that "file" will be deleted inside hdfsCloseFile
-      file_ = NULL;
+  auto start = std::chrono::steady_clock::now();
+  if (num_blocks_ > 0) {
+    parse_seconds_ += std::chrono::duration<double>(start - last_fetch_).count();
+  }
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (current_.data) {
+      // the caller is done with the current block
+      free_data_.push_back(std::move(current_.data));
+      free_cv_.notify_one();
     }
-
-    // read block
-    nbytes = read_block(fn);
+    ready_cv_.wait(lk, [this] { return !ready_.empty(); });
+    current_ = std::move(ready_.front());
+    if (!current_.filename.empty()) {
+      // keep the end of the input for the next calls
+      ready_.pop_front();
+    }
+  }
+  io_wait_seconds_ += SecondsSince(start);
+  last_fetch_ = std::chrono::steady_clock::now();
+  if (current_.filename.empty()) {
+    // no more files
+    return "";
   }
-  return boost::string_ref(data_, nbytes);
+
+  num_blocks_ += 1;
+  num_bytes_ += current_.size;
+  next_offset_ = current_.offset + current_.size;
+  return boost::string_ref(current_.data.get(), current_.size);
 }
 
-void HDFSFileSplitter::init_blocksize(hdfsFS fs, const std::string& url) {
+size_t HDFSFileSplitter::get_block_size(hdfsFS fs, const std::string& url) {
   int num_files;
   hdfsFileInfo* file_info = hdfsListDirectory(fs, url.c_str(), &num_files);
+  size_t block_size = 0;
   for (int i = 0; i < num_files; ++i) {
     if (file_info[i].mKind == kObjectKindFile) {
-      hdfs_block_size = file_info[i].mBlockSize;
-      hdfsFreeFileInfo(file_info, num_files);
-      return;
+      block_size = file_info[i].mBlockSize;
+      break;
     }
-    continue;
   }
-  LOG(ERROR) << "Block size init error. (File NOT exist or EMPTY directory)";
+  if (file_info != NULL) {
+    hdfsFreeFileInfo(file_info, num_files);
+  }
+  return block_size;
 }
 
 void HDFSFileSplitter::load(std::string url) {
-  // init url, fs_, hdfs_block_size
+  CHECK(!thread_.joinable()) << "The splitter is already loading " << url_;
+  // init url, fs_, block_size_
   url_ = url;
   // init fs_
   struct hdfsBuilder* builder = hdfsNewBuilder();
@@ -84,30 +114,125 @@ void HDFSFileSplitter::load(std::string url) {
   hdfsBuilderSetNameNodePort(builder, hdfs_namenode_port_);
   fs_ = hdfsBuilderConnect(builder);
   hdfsFreeBuilder(builder);
-  //	std::mutex gCallOnceMutex;
-  //	std::lock_guard<std::mutex> guard(gCallOnceMutex);
-  init_blocksize(fs_, url_);
-  data_ = new char[hdfs_block_size];
+  block_size_ = get_block_size(fs_, url_);
+  if (block_size_ == 0) {
+    LOG(ERROR) << "Block size init error. (File NOT exist or EMPTY directory)";
+  }
+  // one buffer for the caller and <read_ahead_> for the blocks read ahead
+  for (int i = 0; i <= read_ahead_; ++i) {
+    free_data_.emplace_back(new char[block_size_]);
+  }
+  next_data_.resize(kNextReadSize);
+  thread_ = std::thread([this] { prefetch(); });
 }
 
-size_t HDFSFileSplitter::get_offset() { return offset_; }
+size_t HDFSFileSplitter::get_offset() { return current_.offset; }
+
+void HDFSFileSplitter::prefetch() {
+  // the last block read, reported to the master with the next request
+  std::string last_file;
+  size_t last_offset = 0;
+  while (true) {
+    Block block;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      free_cv_.wait(lk, [this] { return !free_data_.empty() || stop_; });
+      if (stop_) {
+        return;
+      }
+      block.data = std::move(free_data_.back());
+      free_data_.pop_back();
+    }
+
+    // ask master for a new block, again later while it tells to retry
+    while (true) {
+      BinStream question;
+      question << url_ << hostname_ << num_threads_ << id_;
+      if (!last_file.empty()) {
+        question << last_file << last_offset;
+        // reported once
+        last_file.clear();
+      }
+      // 301 is constant for kBlockRequest
+      BinStream answer = coordinator_->ask_master(question, 301);
+      answer >> block.filename >> block.offset;
+      bool retry = false;
+      if (block.filename.empty()) {
+        answer >> retry;
+      }
+      if (!retry) {
+        break;
+      }
+      std::unique_lock<std::mutex> lk(mutex_);
+      if (free_cv_.wait_for(lk, retry_interval(), [this] { return stop_; })) {
+        return;
+      }
+    }
+    bool end = block.filename.empty();
+    if (!end) {
+      // read block
+      auto start = std::chrono::steady_clock::now();
+      block.size = read_block(block.filename, block.offset, block.data.get());
+      read_seconds_ += SecondsSince(start);
+      last_file = block.filename;
+      last_offset = block.offset;
+    }
+
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      ready_.push_back(std::move(block));
+    }
+    ready_cv_.notify_one();
+    if (end) {
+      return;
+    }
+  }
+}
 
-int HDFSFileSplitter::read_block(const std::string& fn) {
-  file_ = hdfsOpenFile(fs_, fn.c_str(), O_RDONLY, 0, 0, 0);
-  CHECK(file_ != NULL) << "HDFS file open fails";
-  hdfsSeek(fs_, file_, offset_);
+size_t HDFSFileSplitter::read_block(const std::string& fn, size_t offset, char* data) {
+  hdfsFile file = hdfsOpenFile(fs_, fn.c_str(), O_RDONLY, 0, 0, 0);
+  CHECK(file != NULL) << "HDFS file open fails";
+  hdfsSeek(fs_, file, offset);
   size_t start = 0;
-  size_t nbytes = 0;
-  while (start < hdfs_block_size) {
+  while (start < block_size_) {
     // only 128KB per hdfsRead
-    nbytes = hdfsRead(fs_, file_, data_ + start, hdfs_block_size);
-    start += nbytes;
-    if (nbytes == 0)
+    tSize nbytes = hdfsRead(fs_, file, data + start, block_size_ - start);
+    if (nbytes <= 0) {
+      if (nbytes == -1) {
+        LOG(ERROR) << "read block error!";
+      }
       break;
+    }
+    start += nbytes;
   }
+  int rc = hdfsCloseFile(fs_, file);
+  CHECK(rc == 0) << "close file fails";
   return start;
 }
 
-size_t HDFSFileSplitter::hdfs_block_size = 0;
+boost::string_ref HDFSFileSplitter::read_next() {
+  if (current_.filename.empty()) {
+    return "";
+  }
+  if (next_file_name_ != current_.filename) {
+    if (next_file_ != NULL) {
+      int rc = hdfsCloseFile(fs_, next_file_);
+      CHECK(rc == 0) << "close file fails";
+    }
+    next_file_ = hdfsOpenFile(fs_, current_.filename.c_str(), O_RDONLY, 0, 0, 0);
+    CHECK(next_file_ != NULL) << "HDFS file open fails";
+    next_file_name_ = current_.filename;
+  }
+  hdfsSeek(fs_, next_file_, next_offset_);
+  tSize nbytes = hdfsRead(fs_, next_file_, next_data_.data(), next_data_.size());
+  if (nbytes <= 0) {
+    if (nbytes == -1) {
+      LOG(ERROR) << "read next block error!";
+    }
+    return "";
+  }
+  next_offset_ += nbytes;
+  return boost::string_ref(next_data_.data(), nbytes);
+}
 
 }  // namespace csci5570
@@ -1,50 +1,104 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "boost/utility/string_ref.hpp"
 #include "glog/logging.h"
 #include "hdfs/hdfs.h"
 
+#include "io/abstract_file_splitter.hpp"
 #include "io/coordinator.hpp"
 
 namespace csci5570 {
 
-class HDFSFileSplitter {
+/**
+ * Reads the HDFS blocks assigned by the master
+ *
+ * A background thread asks for the next blocks and reads up to <read_ahead> of them while the caller parses
+ * the current one, so that I/O and parsing overlap. The data following a block, i.e., the end of its last
+ * line, is read on demand in small pieces.
+ */
+class HDFSFileSplitter : public AbstractFileSplitter {
  public:
+  static const int kDefaultReadAhead = 1;  // i.e., double buffering
+
   HDFSFileSplitter(int num_threads, int id, Coordinator* coordinator, std::string hostname, std::string hdfs_namenode,
-                   int hdfs_namenode_port);
+                   int hdfs_namenode_port, int read_ahead = kDefaultReadAhead);
 
-  virtual ~HDFSFileSplitter();
+  ~HDFSFileSplitter() override;
 
-  boost::string_ref fetch_block(bool is_next = false);
+  boost::string_ref fetch_block(bool is_next = false) override;
 
-  static void init_blocksize(hdfsFS fs, const std::string& url);
+  void load(std::string url) override;
 
-  void load(std::string url);
+  size_t get_offset() override;
 
-  size_t get_offset();
+  // the time the caller waited for blocks to be read, and spent between two blocks, e.g., parsing
+  double get_io_wait_seconds() const { return io_wait_seconds_; }
+  double get_parse_seconds() const { return parse_seconds_; }
 
  private:
-  int read_block(const std::string& fn);
+  struct Block {
+    std::string filename;  // empty at the end of the input
+    size_t offset = 0;
+    size_t size = 0;
+    std::unique_ptr<char[]> data;
+  };
+
+  // the block size of the first file under url, 0 if there is none
+  static size_t get_block_size(hdfsFS fs, const std::string& url);
+
+  // the workloads of the prefetching thread
+  void prefetch();
+  size_t read_block(const std::string& fn, size_t offset, char* data);
+  boost::string_ref read_next();
 
   Coordinator* coordinator_;
   int num_threads_;
   int id_;
-  size_t offset_ = 0;
-
-  // using heap to store data
-  char* data_;
-  hdfsFile file_ = NULL;
+  int read_ahead_;
   hdfsFS fs_;
 
+  // the block being parsed
+  Block current_;
+  bool started_ = false;
+
+  // the data following the current block
+  hdfsFile next_file_ = NULL;
+  std::string next_file_name_;
+  size_t next_offset_ = 0;
+  std::vector<char> next_data_;
+
+  // prefetching
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::condition_variable free_cv_;
+  std::deque<Block> ready_;                         // the blocks read, in order
+  std::vector<std::unique_ptr<char[]>> free_data_;  // the buffers to read into
+  bool stop_ = false;
+
+  // statistics
+  double io_wait_seconds_ = 0;
+  double parse_seconds_ = 0;
+  double read_seconds_ = 0;  // on the prefetching thread
+  size_t num_blocks_ = 0;
+  size_t num_bytes_ = 0;
+  std::chrono::steady_clock::time_point last_fetch_;
+
   // url may be a directory, so that cur_file is different from url
   std::string url_;
   std::string hostname_;
   std::string hdfs_namenode_;
   int hdfs_namenode_port_;
-
-  static size_t hdfs_block_size;
+  size_t block_size_ = 0;  // set by load before the prefetching thread starts
 
 };  // class HDFSFileSplitter
 
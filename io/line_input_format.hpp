@@ -1,12 +1,21 @@
 #pragma once
 
+#include <cstring>
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 #include "boost/utility/string_ref.hpp"
 #include "glog/logging.h"
 
+#include "io/abstract_file_splitter.hpp"
+#include "io/compressed_file_splitter.hpp"
 #include "io/coordinator.hpp"
+#include "io/local_file_splitter.hpp"
+#ifdef WITH_HDFS
 #include "io/hdfs_file_splitter.hpp"
-#include "io/hdfs_assigner.hpp"
+#endif
 
 namespace csci5570 {
 
@@ -16,11 +25,24 @@ class LineInputFormat {
                   std::string hdfs_namenode, int hdfs_namenode_port) {
     num_threads_ = num_threads;
     id_ = id;
-    splitter_ = new HDFSFileSplitter(num_threads, id, coordinator, hostname, hdfs_namenode, hdfs_namenode_port);
+    coordinator_ = coordinator;
+    hostname_ = hostname;
+    hdfs_namenode_ = hdfs_namenode;
+    hdfs_namenode_port_ = hdfs_namenode_port;
     // set_up url
     set_splitter(url);
   }
 
+  /// read the url with the given splitter, e.g., a LocalFileSplitter without coordinator
+  LineInputFormat(const std::string url, std::unique_ptr<AbstractFileSplitter> splitter)
+      : coordinator_(nullptr), num_threads_(1), id_(0), hdfs_namenode_port_(0) {
+    splitter_ = decompressed(std::move(splitter));
+    url_ = url;
+    size_t prefix = url_.find("://");
+    CHECK(prefix != std::string::npos) << ("Cannot analyze protocol from " + url_).c_str();
+    splitter_->load(url_.substr(prefix + 3));
+  }
+
   virtual ~LineInputFormat() {}
 
   /// function for creating different splitters for different urls
@@ -30,119 +52,159 @@ class LineInputFormat {
       return;
     url_ = url;
 
-    int prefix = url_.find("://");
+    size_t prefix = url_.find("://");
     CHECK(prefix != std::string::npos) << ("Cannot analyze protocol from " + url_).c_str();
-    // parse the url for hadoop
+    std::string protocol = url_.substr(0, prefix);
+    if (protocol == "file") {
+      splitter_ = decompressed(std::unique_ptr<AbstractFileSplitter>(
+          new LocalFileSplitter(num_threads_, id_, coordinator_, hostname_)));
+    } else {
+#ifdef WITH_HDFS
+      CHECK(protocol == "hdfs") << ("Unknown protocol " + protocol).c_str();
+      splitter_ = decompressed(std::unique_ptr<AbstractFileSplitter>(
+          new HDFSFileSplitter(num_threads_, id_, coordinator_, hostname_, hdfs_namenode_, hdfs_namenode_port_)));
+#else
+      CHECK(false) << ("Unsupported protocol " + protocol + " without HDFS").c_str();
+#endif
+    }
+    // parse the url for the splitter
     splitter_->load(url_.substr(prefix + 3));
+    clear_buffer();
   }
 
   void set_num_threads(int num_threads) { num_threads_ = num_threads; }
 
   void set_worker_info(int id) { id_ = id; }
 
+  /**
+   * Read the next line, valid until the next call
+   */
   bool next(boost::string_ref& ref) {
-    if (buffer_.size() == 0) {
-      bool success = fetch_new_block();
-      if (success == false)
+    while (pos_ == boost::string_ref::npos || !next_in_block(ref)) {
+      if (!fetch_new_block())
         return false;
     }
-    // last charater in block
-    if (r == buffer_.size() - 1) {
-      // fetch next block
-      buffer_ = splitter_->fetch_block(true);
-      if (buffer_.empty()) {
-        // end of a file
-        bool success = fetch_new_block();
-        if (success == false)
-          return false;
-      } else {
-        // directly process the remaing
-        last_part_ = "";
-        handle_next_block();
-        ref = last_part_;
-        return true;
+    return true;
+  }
+
+  /**
+   * Read up to <max_lines> lines of the current block, valid until the next call
+   *
+   * @return  the number of lines read, 0 at the end of the input
+   */
+  size_t next_batch(std::vector<boost::string_ref>* lines, size_t max_lines) {
+    lines->clear();
+    boost::string_ref ref;
+    while (true) {
+      while (lines->size() < max_lines && pos_ != boost::string_ref::npos && next_in_block(ref)) {
+        lines->push_back(ref);
       }
-    }
-    if (splitter_->get_offset() == 0 && r == 0) {
-      // begin of a file
-      l = 0;
-      if (buffer_[0] == '\n')
-        // for the case file starting with '\n'
-        l = 1;
-      r = find_next(buffer_, l, '\n');
-    } else {
-      // what if not found
-      l = find_next(buffer_, r, '\n') + 1;
-      r = find_next(buffer_, l, '\n');
-    }
-    // if the right end does not exist in current block
-    if (r == boost::string_ref::npos) {
-      auto last = buffer_.substr(l);
-      last_part_ = std::string(last.data(), last.size());
-      // fetch next subBlock
-      buffer_ = splitter_->fetch_block(true);
-      handle_next_block();
-      ref = last_part_;
-      return true;
-    } else {
-      ref = buffer_.substr(l, r - l);
-      return true;
+      // stop at the end of a block, whose data may be released by the next one
+      if (!lines->empty() || max_lines == 0)
+        return lines->size();
+      if (!fetch_new_block())
+        return 0;
     }
   }
 
  private:
-  // helper function to locate the buffer
-  size_t find_next(boost::string_ref sref, size_t l, char c) {
-    size_t r = l;
-    while (r != sref.size() && sref[r] != c)
-      r++;
-    if (r == sref.size())
+  // decompress the compressed files read by <splitter>, sharing the cores among the reading threads
+  std::unique_ptr<AbstractFileSplitter> decompressed(std::unique_ptr<AbstractFileSplitter> splitter) const {
+    int num_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / std::max(num_threads_, 1));
+    return std::unique_ptr<AbstractFileSplitter>(new CompressedFileSplitter(std::move(splitter), num_threads));
+  }
+
+  // helper function to locate the buffer, memchr is vectorized in glibc
+  static size_t find_next(boost::string_ref sref, size_t l, char c) {
+    if (l >= sref.size())
       return boost::string_ref::npos;
-    return r;
+    const char* p = static_cast<const char*>(memchr(sref.data() + l, c, sref.size() - l));
+    return p == nullptr ? boost::string_ref::npos : p - sref.data();
+  }
+
+  /*
+   * Read the next line owned by the current block, i.e., whose preceding '\n' is in the block, or the first
+   * line of a file. Return false once the block is done.
+   */
+  bool next_in_block(boost::string_ref& ref) {
+    if (pos_ < buffer_.size()) {
+      size_t r = find_next(buffer_, pos_, '\n');
+      if (r != boost::string_ref::npos) {
+        ref = buffer_.substr(pos_, r - pos_);
+        pos_ = r + 1;
+        return true;
+      }
+      // the last line crosses the end of the block
+      last_part_.assign(buffer_.data() + pos_, buffer_.size() - pos_);
+      pos_ = boost::string_ref::npos;
+      read_next_part();
+      ref = last_part_;
+      return true;
+    }
+    if (pos_ == buffer_.size()) {
+      // a line starting right after the block, unless at the end of the file
+      last_part_.clear();
+      pos_ = boost::string_ref::npos;
+      if (read_next_part()) {
+        ref = last_part_;
+        return true;
+      }
+    }
+    return false;
   }
 
-  void handle_next_block() {
+  // append the data following the block up to the first '\n' to last_part_, return false at the end of the file
+  bool read_next_part() {
+    bool has_data = false;
     while (true) {
-      if (buffer_.empty())
-        return;
-
-      r = find_next(buffer_, 0, '\n');
-      if (r == boost::string_ref::npos) {
-        // fetch next subBlock
-        last_part_ += std::string(buffer_.data(), buffer_.size());
-        buffer_ = splitter_->fetch_block(true);
-        continue;
-      } else {
-        last_part_ += std::string(buffer_.substr(0, r).data(), r);
-        clear_buffer();
-        return;
+      boost::string_ref next = splitter_->fetch_block(true);
+      if (next.empty())
+        return has_data;
+      has_data = true;
+      size_t r = find_next(next, 0, '\n');
+      if (r != boost::string_ref::npos) {
+        last_part_.append(next.data(), r);
+        return true;
       }
+      last_part_.append(next.data(), next.size());
     }
   }
 
   bool fetch_new_block() {
     // fetch a new block
     buffer_ = splitter_->fetch_block(false);
-    if (buffer_.empty())
+    if (buffer_.empty()) {
       //  no more files, exit
+      clear_buffer();
       return false;
-    l = r = 0;
+    }
+    if (splitter_->get_offset() == 0) {
+      // begin of a file, for the case file starting with '\n'
+      pos_ = buffer_[0] == '\n' ? 1 : 0;
+    } else {
+      // the first line belongs to the previous block
+      size_t r = find_next(buffer_, 0, '\n');
+      pos_ = r == boost::string_ref::npos ? r : r + 1;
+    }
     return true;
   }
 
   void clear_buffer() {
     buffer_.clear();
-    l = r = 0;
+    pos_ = boost::string_ref::npos;
   }
 
-  HDFSFileSplitter* splitter_;
+  std::unique_ptr<AbstractFileSplitter> splitter_;
+  Coordinator* coordinator_;
   int num_threads_;
   int id_;
-  int l = 0;
-  int r = 0;
+  std::string hostname_;
+  std::string hdfs_namenode_;
+  int hdfs_namenode_port_;
   std::string url_;
-  std::string last_part_;
+  std::string last_part_;  // the line crossing the end of a block, reused
   boost::string_ref buffer_;
+  size_t pos_ = boost::string_ref::npos;  // the start of the next line in buffer_, npos if the block is done
 
 };  // class LineInputFormat
 
@@ -0,0 +1,172 @@
+#include "io/local_file_splitter.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "boost/utility/string_ref.hpp"
+#include "glog/logging.h"
+
+#include "base/serialization.hpp"
+#include "io/decompressor.hpp"
+
+namespace csci5570 {
+
+const size_t LocalFileSplitter::kDefaultChunkSize;
+
+LocalFileSplitter::LocalFileSplitter(int num_threads, int id, Coordinator* coordinator, std::string hostname,
+                                     size_t chunk_size)
+    : coordinator_(coordinator), num_threads_(num_threads), id_(id), hostname_(hostname), chunk_size_(chunk_size) {
+  CHECK_GT(chunk_size_, 0);
+}
+
+LocalFileSplitter::~LocalFileSplitter() { unmap_file(); }
+
+void LocalFileSplitter::load(std::string url) {
+  url_ = url;
+  if (coordinator_ == nullptr) {
+    files_ = list_files(url_);
+    file_idx_ = 0;
+    next_offset_ = 0;
+  }
+}
+
+boost::string_ref LocalFileSplitter::fetch_block(bool is_next) {
+  if (is_next) {
+    // the data following the current one, up to one more chunk
+    size_t begin = end_;
+    end_ = std::min(end_ + chunk_length_, file_size_);
+    return boost::string_ref(data_ + begin, end_ - begin);
+  }
+
+  std::string fn;
+  if (!next_chunk(&fn, &offset_, &chunk_length_)) {
+    // no more files
+    return "";
+  }
+  if (fn != file_name_) {
+    map_file(fn);
+  }
+  if (offset_ >= file_size_) {
+    LOG(ERROR) << "Chunk at " << offset_ << " out of file " << fn << " of size " << file_size_;
+    return "";
+  }
+  end_ = std::min(offset_ + chunk_length_, file_size_);
+  return boost::string_ref(data_ + offset_, end_ - offset_);
+}
+
+size_t LocalFileSplitter::get_offset() { return offset_; }
+
+std::vector<std::string> LocalFileSplitter::list_files(const std::string& path) {
+  std::vector<std::string> files;
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    LOG(ERROR) << "Cannot find " << path;
+    return files;
+  }
+  if (S_ISREG(st.st_mode)) {
+    if (st.st_size > 0) {
+      files.push_back(path);
+    }
+    return files;
+  }
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    LOG(ERROR) << "Cannot list " << path;
+    return files;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    std::string fn = path + "/" + entry->d_name;
+    // omit directories
+    if (stat(fn.c_str(), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+      files.push_back(fn);
+    }
+  }
+  closedir(dir);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+size_t LocalFileSplitter::get_file_size(const std::string& fn) {
+  struct stat st;
+  return stat(fn.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+bool LocalFileSplitter::next_chunk(std::string* fn, size_t* offset, size_t* length) {
+  if (coordinator_ != nullptr) {
+    // ask master for a new chunk, with the url scheme to tell it from HDFS blocks
+    // report the chunk finished, once
+    bool report = !file_name_.empty();
+    while (true) {
+      BinStream question;
+      question << ("file://" + url_) << hostname_ << num_threads_ << id_;
+      if (report) {
+        question << file_name_ << offset_;
+        report = false;
+      }
+      // 301 is constant for kBlockRequest
+      BinStream answer = coordinator_->ask_master(question, 301);
+      answer >> *fn >> *offset;
+      if (!fn->empty()) {
+        answer >> *length;
+        return true;
+      }
+      bool retry;
+      answer >> retry;
+      if (!retry) {
+        return false;
+      }
+      std::this_thread::sleep_for(retry_interval());
+    }
+  }
+
+  while (file_idx_ < files_.size()) {
+    size_t size = get_file_size(files_[file_idx_]);
+    if (next_offset_ < size) {
+      *fn = files_[file_idx_];
+      *offset = next_offset_;
+      // a compressed file cannot be split
+      *length = Decompressor::is_compressed_name(*fn) ? size : chunk_size_;
+      next_offset_ += *length;
+      return true;
+    }
+    file_idx_ += 1;
+    next_offset_ = 0;
+  }
+  return false;
+}
+
+void LocalFileSplitter::map_file(const std::string& fn) {
+  unmap_file();
+  int fd = open(fn.c_str(), O_RDONLY);
+  CHECK(fd != -1) << "Local file open fails: " << fn;
+  struct stat st;
+  CHECK(fstat(fd, &st) == 0) << "Local file stat fails: " << fn;
+  file_size_ = st.st_size;
+  if (file_size_ > 0) {
+    void* addr = mmap(nullptr, file_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    CHECK(addr != MAP_FAILED) << "Local file mmap fails: " << fn;
+    madvise(addr, file_size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(addr);
+  }
+  close(fd);
+  file_name_ = fn;
+}
+
+void LocalFileSplitter::unmap_file() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), file_size_);
+    data_ = nullptr;
+  }
+  file_name_.clear();
+  file_size_ = 0;
+}
+
+}  // namespace csci5570
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "boost/utility/string_ref.hpp"
+#include "glog/logging.h"
+
+#include "io/abstract_file_splitter.hpp"
+#include "io/coordinator.hpp"
+
+namespace csci5570 {
+
+/**
+ * Reads local files (file:// urls) in chunks of fixed size, mapped in memory
+ *
+ * With a coordinator, the chunks are assigned by the master through the same block requests as HDFS blocks,
+ * so that the readers of all the workers share them. Without one, e.g., for single-node runs and tests, the
+ * splitter reads all the chunks of the url by itself. A compressed file, told by its name, is a single chunk.
+ */
+class LocalFileSplitter : public AbstractFileSplitter {
+ public:
+  static const size_t kDefaultChunkSize = 64 << 20;
+
+  LocalFileSplitter(int num_threads, int id, Coordinator* coordinator, std::string hostname,
+                    size_t chunk_size = kDefaultChunkSize);
+
+  ~LocalFileSplitter() override;
+
+  void load(std::string url) override;
+
+  boost::string_ref fetch_block(bool is_next = false) override;
+
+  size_t get_offset() override;
+
+  /**
+   * The non-empty regular files under <path> sorted by name, or <path> itself if it is a file
+   */
+  static std::vector<std::string> list_files(const std::string& path);
+
+  /**
+   * The size of a file, 0 if it cannot be read
+   */
+  static size_t get_file_size(const std::string& fn);
+
+ private:
+  // get the next chunk to read, from the master if any
+  bool next_chunk(std::string* fn, size_t* offset, size_t* length);
+  void map_file(const std::string& fn);
+  void unmap_file();
+
+  Coordinator* coordinator_;
+  int num_threads_;
+  int id_;
+  std::string hostname_;
+  size_t chunk_size_;
+  std::string url_;
+
+  // without a coordinator, the files of the url and the next chunk to read
+  std::vector<std::string> files_;
+  size_t file_idx_ = 0;
+  size_t next_offset_ = 0;
+
+  // the mapped file
+  std::string file_name_;
+  const char* data_ = nullptr;
+  size_t file_size_ = 0;
+
+  size_t offset_ = 0;        // the offset of the current chunk
+  size_t end_ = 0;           // the end of the data fetched so far
+  size_t chunk_length_ = 0;  // the length of the current chunk
+
+};  // class LocalFileSplitter
+
+}  // namespace csci5570
@@ -0,0 +1,142 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "io/line_input_format.hpp"
+#include "io/local_file_splitter.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace csci5570 {
+namespace {
+
+class TestLocalFileSplitter : public testing::Test {
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/csci5570_local_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+  }
+  void TearDown() {
+    std::string cmd = "rm -rf " + dir_;
+    system(cmd.c_str());
+  }
+
+  void WriteFile(const std::string& name, const std::string& content) {
+    FILE* file = fopen((dir_ + "/" + name).c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    fwrite(content.data(), 1, content.size(), file);
+    fclose(file);
+  }
+
+  std::vector<std::string> ReadLines(const std::string& url, size_t chunk_size) {
+    std::unique_ptr<AbstractFileSplitter> splitter(new LocalFileSplitter(1, 0, nullptr, "localhost", chunk_size));
+    LineInputFormat infmt(url, std::move(splitter));
+    std::vector<std::string> lines;
+    boost::string_ref record;
+    while (infmt.next(record)) {
+      lines.push_back(std::string(record.data(), record.size()));
+    }
+    return lines;
+  }
+
+  std::string dir_;
+};
+
+TEST_F(TestLocalFileSplitter, ListFiles) {
+  WriteFile("b", "2\n");
+  WriteFile("a", "1\n");
+  WriteFile("empty", "");
+  std::vector<std::string> files = LocalFileSplitter::list_files(dir_);
+  EXPECT_EQ(files, (std::vector<std::string>{dir_ + "/a", dir_ + "/b"}));
+  EXPECT_EQ(LocalFileSplitter::list_files(dir_ + "/a"), std::vector<std::string>{dir_ + "/a"});
+  EXPECT_TRUE(LocalFileSplitter::list_files(dir_ + "/missing").empty());
+}
+
+TEST_F(TestLocalFileSplitter, FetchBlock) {
+  WriteFile("a", "0123456789");
+  WriteFile("b", "abcd");
+  LocalFileSplitter splitter(1, 0, nullptr, "localhost", 4);
+  splitter.load(dir_);
+
+  EXPECT_EQ(splitter.fetch_block(), "0123");
+  EXPECT_EQ(splitter.get_offset(), 0);
+  EXPECT_EQ(splitter.fetch_block(true), "4567");
+  EXPECT_EQ(splitter.fetch_block(true), "89");
+  EXPECT_EQ(splitter.fetch_block(true), "");
+  EXPECT_EQ(splitter.fetch_block(), "4567");
+  EXPECT_EQ(splitter.get_offset(), 4);
+  EXPECT_EQ(splitter.fetch_block(), "89");
+  EXPECT_EQ(splitter.fetch_block(), "abcd");
+  EXPECT_EQ(splitter.get_offset(), 0);
+  EXPECT_EQ(splitter.fetch_block(), "");
+}
+
+TEST_F(TestLocalFileSplitter, ReadLines) {
+  // lines of 0 to 6 characters
+  std::vector<std::string> expected;
+  std::string content;
+  for (int i = 0; i < 50; ++i) {
+    expected.push_back(std::string(i % 7, 'a' + i % 26));
+    content += expected.back() + "\n";
+  }
+  WriteFile("data", content);
+  // every line is read once whatever the chunk boundaries
+  for (size_t chunk_size = 8; chunk_size <= 24; ++chunk_size) {
+    std::vector<std::string> lines = ReadLines("file://" + dir_ + "/data", chunk_size);
+    EXPECT_EQ(lines, std::vector<std::string>(expected.begin() + (expected[0].empty() ? 1 : 0), expected.end()))
+        << "chunk size " << chunk_size;
+  }
+}
+
+TEST_F(TestLocalFileSplitter, ReadBatches) {
+  std::string content;
+  for (int i = 0; i < 50; ++i) {
+    content += std::string(i % 7, 'a' + i % 26) + "\n";
+  }
+  WriteFile("data", content);
+  std::string url = "file://" + dir_ + "/data";
+  for (size_t chunk_size : {8, 13, 1000}) {
+    std::vector<std::string> expected = ReadLines(url, chunk_size);
+    for (size_t max_lines : {1, 3, 100}) {
+      std::unique_ptr<AbstractFileSplitter> splitter(new LocalFileSplitter(1, 0, nullptr, "localhost", chunk_size));
+      LineInputFormat infmt(url, std::move(splitter));
+      std::vector<std::string> lines;
+      std::vector<boost::string_ref> batch;
+      while (infmt.next_batch(&batch, max_lines) > 0) {
+        EXPECT_LE(batch.size(), max_lines);
+        for (auto line : batch) {
+          lines.push_back(std::string(line.data(), line.size()));
+        }
+      }
+      EXPECT_EQ(lines, expected) << "chunk size " << chunk_size << ", max lines " << max_lines;
+    }
+  }
+}
+
+TEST_F(TestLocalFileSplitter, LongLines) {
+  // lines spanning several chunks
+  std::vector<std::string> expected;
+  std::string content;
+  for (int i = 0; i < 20; ++i) {
+    expected.push_back(std::string(10 + i * 3, 'a' + i));
+    content += expected.back() + "\n";
+  }
+  WriteFile("data", content);
+  for (size_t chunk_size : {4, 8, 16}) {
+    EXPECT_EQ(ReadLines("file://" + dir_ + "/data", chunk_size), expected) << "chunk size " << chunk_size;
+  }
+}
+
+TEST_F(TestLocalFileSplitter, ReadDirectory) {
+  WriteFile("a", "1 1:1\n2 2:2\n3 3:3");  // no newline at the end
+  WriteFile("b", "4 4:4\n");
+  std::vector<std::string> lines = ReadLines("file://" + dir_, 8);
+  EXPECT_EQ(lines, (std::vector<std::string>{"1 1:1", "2 2:2", "3 3:3", "4 4:4"}));
+}
+
+}  // namespace
+}  // namespace csci5570
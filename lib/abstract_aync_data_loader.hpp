@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <string>
@@ -7,6 +11,8 @@
 #include <vector>
 
 #include "boost/tokenizer.hpp"
+#include "boost/utility/string_ref.hpp"
+#include "glog/logging.h"
 
 #include "base/magic.hpp"
 #include "io/line_input_format.hpp"
@@ -18,7 +24,18 @@ namespace lib {
 class AsyncReadBuffer {
  public:
   using BatchT = std::vector<std::string>;
-  ~AsyncReadBuffer() {}
+  // read the next record into <record>, return false at the end of the input
+  using NextRecord = std::function<bool(boost::string_ref& record)>;
+
+  ~AsyncReadBuffer() {
+    if (!init_) {return;}
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+    }
+    load_cv_.notify_all();
+    thread_.join();
+  }
 
   /*
    * Initializes the input format and reader threads
@@ -29,32 +46,100 @@ class AsyncReadBuffer {
    * @param task_id     identifier to this running task
    * @param num_threads the number of worker threads we are using
    * @param batch_size  the size of each batch
-   * @param batch_num   the max number of records in the buffer
+   * @param batch_num   the max number of batches in the buffer
+   * @param coordinator, hostname, hdfs_namenode, hdfs_namenode_port   as in LineInputFormat
    */
-  void init(const std::string& url, int task_id, int num_threads, int batch_size, int batch_num) {
+  void init(const std::string& url, int task_id, int num_threads, int batch_size, int batch_num,
+            Coordinator* coordinator, const std::string& hostname, const std::string& hdfs_namenode,
+            int hdfs_namenode_port) {
     // 1. initialize input format
+    infmt_.reset(new LineInputFormat(url, num_threads, task_id, coordinator, hostname, hdfs_namenode,
+                                     hdfs_namenode_port));
     // 2. spawn spreads to asynchronously load data
+    LineInputFormat* infmt = infmt_.get();
+    init([infmt](boost::string_ref& record) { return infmt->next(record); }, batch_size, batch_num);
+  }
+
+  /*
+   * Starts the reader thread on any source of records
+   */
+  void init(NextRecord next_record, int batch_size, int batch_num) {
+    CHECK(!init_) << "The buffer is already initialized";
+    CHECK_GT(batch_size, 0);
+    CHECK_GT(batch_num, 0);
+    next_record_ = next_record;
+    batch_size_ = batch_size;
+    batch_num_ = batch_num;
+    buffer_.resize(batch_num);
+    init_ = true;
+    thread_ = std::thread([this] { main(); });
   }
 
+  /*
+   * Blocks until a batch is buffered, returns false once all batches are read
+   */
   bool get_batch(BatchT* batch) {
     // store batch_size_ records in <batch> and return true if success
+    std::unique_lock<std::mutex> lk(mutex_);
+    get_cv_.wait(lk, [this] { return batch_count_ > 0 || eof_; });
+    if (batch_count_ == 0) {
+      return false;
+    }
+    *batch = std::move(buffer_[start_]);
+    buffer_[start_].clear();
+    start_ = (start_ + 1) % batch_num_;
+    batch_count_ -= 1;
+    lk.unlock();
+    load_cv_.notify_one();
+    return true;
   }
 
   int ask() {
     // return the number of batches buffered
+    std::lock_guard<std::mutex> lk(mutex_);
+    return batch_count_;
   }
 
   inline bool end_of_file() const {
     // return true if the end of the file is reached
+    return eof_;
   }
 
  protected:
   virtual void main() {
     // the workloads of the thread reading samples asynchronously
+    boost::string_ref record;
+    bool more = true;
+    while (more) {
+      // read and copy a batch out of the input blocks without holding the lock
+      BatchT batch;
+      batch.reserve(batch_size_);
+      while (batch.size() < static_cast<size_t>(batch_size_) && (more = next_record_(record))) {
+        batch.emplace_back(record.data(), record.size());
+      }
+
+      std::unique_lock<std::mutex> lk(mutex_);
+      // wait for a free slot: the consumers hold back the reader
+      load_cv_.wait(lk, [this] { return batch_count_ < batch_num_ || stop_; });
+      if (stop_) {
+        break;
+      }
+      if (!batch.empty()) {
+        buffer_[end_] = std::move(batch);
+        end_ = (end_ + 1) % batch_num_;
+        batch_count_ += 1;
+      }
+      if (!more) {
+        eof_ = true;
+      }
+      lk.unlock();
+      get_cv_.notify_all();
+    }
   }
 
   // input
   std::unique_ptr<LineInputFormat> infmt_;
+  NextRecord next_record_;
   std::atomic<bool> eof_{false};
 
   // buffer
@@ -71,26 +156,47 @@ class AsyncReadBuffer {
   std::condition_variable load_cv_;
   std::condition_variable get_cv_;
   bool init_ = false;
+  bool stop_ = false;
 };
 
 template <typename Sample>
 class AbstractAsyncDataLoader {
  public:
-  AbstractAsyncDataLoader(int batch_size, int num_features, AsyncReadBuffer* buffer)
-      : batch_size_(batch_size), n_features_(num_features), buffer_(buffer) {}
+  using Parse = std::function<Sample(boost::string_ref, int)>;  // e.g. Parser::parse_libsvm
+
+  AbstractAsyncDataLoader(int batch_size, int num_features, AsyncReadBuffer* buffer, Parse parse)
+      : buffer_(buffer), parse_(parse), batch_size_(batch_size), n_features_(num_features) {}
+  virtual ~AbstractAsyncDataLoader() {}
 
   virtual const std::vector<Sample>& get_data() {
     // parse data in buffer
     // return a batch of samples
+    batch_data_.clear();
+    index_set_.clear();
+    AsyncReadBuffer::BatchT batch;
+    if (!buffer_->get_batch(&batch)) {
+      return batch_data_;
+    }
+    // parsed here, on the consumer, so that the reader only moves bytes
+    batch_data_.reserve(batch.size());
+    for (const auto& line : batch) {
+      batch_data_.push_back(parse_(boost::string_ref(line), n_features_));
+      for (const auto& feature : batch_data_.back().x_) {
+        index_set_.insert(feature.first);
+      }
+    }
+    return batch_data_;
   }
   std::vector<Key> get_keys() {
     // return the keys of features of the current batch
+    return std::vector<Key>(index_set_.begin(), index_set_.end());
   }
 
-  inline bool is_empty() {}
+  inline bool is_empty() { return buffer_->end_of_file() && buffer_->ask() == 0; }
 
  protected:
   AsyncReadBuffer* buffer_;
+  Parse parse_;
   int batch_size_;                  // batch size
   int n_features_;                  // number of features in the dataset
   std::vector<Sample> batch_data_;  // a batch of data samples
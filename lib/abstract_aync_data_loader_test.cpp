@@ -0,0 +1,115 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "lib/abstract_aync_data_loader.hpp"
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace csci5570 {
+namespace lib {
+namespace {
+
+class TestAsyncDataLoader : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+// serves the lines in turn
+AsyncReadBuffer::NextRecord MakeSource(const std::vector<std::string>* lines) {
+  auto pos = std::make_shared<size_t>(0);
+  return [lines, pos](boost::string_ref& record) {
+    if (*pos == lines->size()) {
+      return false;
+    }
+    record = (*lines)[(*pos)++];
+    return true;
+  };
+}
+
+struct FakeSample {
+  std::vector<std::pair<int, int>> x_;
+  int y_;
+};
+
+// "<label> <index> <index> ..."
+FakeSample ParseFake(boost::string_ref line, int) {
+  FakeSample sample;
+  std::stringstream ss(line.to_string());
+  ss >> sample.y_;
+  int index;
+  while (ss >> index) {
+    sample.x_.push_back({index, 1});
+  }
+  return sample;
+}
+
+TEST_F(TestAsyncDataLoader, GetBatches) {
+  std::vector<std::string> lines;
+  for (int i = 0; i < 10; ++i) {
+    lines.push_back(std::to_string(i));
+  }
+  AsyncReadBuffer buffer;
+  buffer.init(MakeSource(&lines), 4, 2);
+
+  AsyncReadBuffer::BatchT batch;
+  std::vector<std::string> read;
+  std::vector<size_t> sizes;
+  while (buffer.get_batch(&batch)) {
+    sizes.push_back(batch.size());
+    read.insert(read.end(), batch.begin(), batch.end());
+  }
+  EXPECT_EQ(sizes, (std::vector<size_t>{4, 4, 2}));
+  EXPECT_EQ(read, lines);
+  EXPECT_TRUE(buffer.end_of_file());
+  EXPECT_EQ(buffer.ask(), 0);
+  EXPECT_FALSE(buffer.get_batch(&batch));
+}
+
+TEST_F(TestAsyncDataLoader, BoundedBuffer) {
+  std::vector<std::string> lines(100, "line");
+  AsyncReadBuffer buffer;
+  buffer.init(MakeSource(&lines), 1, 3);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(buffer.ask(), 3);  // the reader waits for a free slot
+  EXPECT_FALSE(buffer.end_of_file());
+  // destroyed while the reader waits
+}
+
+TEST_F(TestAsyncDataLoader, EmptyInput) {
+  std::vector<std::string> lines;
+  AsyncReadBuffer buffer;
+  buffer.init(MakeSource(&lines), 4, 2);
+  AsyncReadBuffer::BatchT batch;
+  EXPECT_FALSE(buffer.get_batch(&batch));
+  EXPECT_TRUE(buffer.end_of_file());
+}
+
+TEST_F(TestAsyncDataLoader, ParseOnConsume) {
+  std::vector<std::string> lines{"1 3 5", "0 5 7", "1 2"};
+  AsyncReadBuffer buffer;
+  buffer.init(MakeSource(&lines), 2, 2);
+  AbstractAsyncDataLoader<FakeSample> loader(2, 10, &buffer, ParseFake);
+
+  const auto& first = loader.get_data();
+  ASSERT_EQ(first.size(), 2);
+  EXPECT_EQ(first[0].y_, 1);
+  EXPECT_EQ(first[1].x_.size(), 2);
+  EXPECT_EQ(loader.get_keys(), (std::vector<Key>{3, 5, 7}));
+
+  const auto& second = loader.get_data();
+  ASSERT_EQ(second.size(), 1);
+  EXPECT_EQ(loader.get_keys(), (std::vector<Key>{2}));
+
+  EXPECT_TRUE(loader.get_data().empty());
+  EXPECT_TRUE(loader.is_empty());
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace csci5570
@@ -13,7 +13,6 @@
 #include "base/serialization.hpp"
 #include "io/coordinator.hpp"
 #include "io/hdfs_assigner.hpp"
-#include "io/hdfs_file_splitter.hpp"
 #include "io/line_input_format.hpp"
 
 namespace csci5570 {
@@ -0,0 +1,386 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "base/magic.hpp"
+#include "lib/csr_dataset.hpp"
+
+namespace csci5570 {
+namespace lib {
+
+/**
+ * The header of a binary CSR cache file.
+ *
+ * A cache file holds a parsed CSRDataset: [header][blocks][indptr][labels][indices][values], each
+ * section starting at an 8-byte aligned offset so that the file can be mapped and used in place.
+ * The rows are cut into blocks of block_rows rows, each with its ranges and a checksum, so that a
+ * worker can map and check only the blocks assigned to it.
+ */
+struct CSRCacheHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t block_rows;  // the number of rows per block, the last block may have fewer
+  uint64_t num_rows;
+  uint64_t nnz;
+  uint64_t num_blocks;
+  uint64_t blocks_offset;   // CSRCacheBlock[num_blocks]
+  uint64_t indptr_offset;   // uint64_t[num_rows + 1], global offsets into indices and values
+  uint64_t labels_offset;   // CSRDataset::Label[num_rows]
+  uint64_t indices_offset;  // Key[nnz]
+  uint64_t values_offset;   // CSRDataset::Value[nnz]
+};
+
+struct CSRCacheBlock {
+  uint64_t first_row;
+  uint64_t num_rows;
+  uint64_t first_nnz;
+  uint64_t nnz;
+  uint64_t checksum;  // FNV-1a of the indptr, labels, indices and values of the block
+};
+
+/**
+ * The rows of some consecutive blocks of a cache file, the arrays point into the mapped file
+ *
+ * It is read like a CSRDataset, in mini-batches over an optionally shuffled row order.
+ */
+class MappedCSRDataset {
+ public:
+  using Row = CSRRow;
+  using Batch = CSRBatch<MappedCSRDataset>;
+
+  size_t size() const { return num_rows_; }
+  bool empty() const { return num_rows_ == 0; }
+  size_t nnz() const { return num_rows_ == 0 ? 0 : indptr_[num_rows_] - indptr_[0]; }
+  // the index of the first row in the whole dataset
+  size_t first_row() const { return first_row_; }
+
+  CSRDataset::Row row(size_t i) const {
+    DCHECK_LT(i, num_rows_);
+    size_t begin = indptr_[i] - indptr_[0];
+    return CSRDataset::Row{indices_ + begin, values_ + begin, indptr_[i + 1] - indptr_[i], labels_[i]};
+  }
+
+  /**
+   * Permute the row order seen by the batches, the mapped rows are not moved
+   */
+  template <typename URNG>
+  void shuffle(URNG&& gen) {
+    order_.shuffle(num_rows_, gen);
+  }
+
+  /**
+   * Return the <i>-th batch of <batch_size> rows in the current order, the last one may be smaller
+   */
+  Batch batch(size_t i, size_t batch_size) const {
+    size_t begin = std::min(i * batch_size, num_rows_);
+    return Batch(this, begin, std::min(begin + batch_size, num_rows_));
+  }
+  size_t num_batches(size_t batch_size) const { return (num_rows_ + batch_size - 1) / batch_size; }
+  // the row at <position> of the current order
+  size_t row_id(size_t position) const { return order_.row_id(position); }
+
+ private:
+  friend class CSRCache;
+
+  size_t first_row_ = 0;
+  size_t num_rows_ = 0;
+  const uint64_t* indptr_ = nullptr;
+  const CSRDataset::Label* labels_ = nullptr;
+  const Key* indices_ = nullptr;
+  const CSRDataset::Value* values_ = nullptr;
+  std::vector<std::shared_ptr<void>> mappings_;  // unmapped when the last copy is gone
+  CSRRowOrder order_;
+};
+
+class CSRCache {
+ public:
+  static const uint32_t kFormatVersion = 1;
+  static const uint32_t kDefaultBlockRows = 1 << 16;
+
+  /**
+   * Write a dataset to <path> atomically, i.e., to a temporary file renamed when complete
+   *
+   * @return  the number of bytes written, 0 on failure
+   */
+  static size_t Write(const std::string& path, const CSRDataset& dataset, uint32_t block_rows = kDefaultBlockRows) {
+    CHECK_GT(block_rows, 0);
+    static_assert(sizeof(size_t) == sizeof(uint64_t), "indptr is written as is");
+    const auto& indptr = dataset.indptr();
+    CSRCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, Magic(), sizeof(header.magic));
+    header.format_version = kFormatVersion;
+    header.block_rows = block_rows;
+    header.num_rows = dataset.size();
+    header.nnz = dataset.nnz();
+    header.num_blocks = (dataset.size() + block_rows - 1) / block_rows;
+    header.blocks_offset = Align(sizeof(header));
+    header.indptr_offset = Align(header.blocks_offset + header.num_blocks * sizeof(CSRCacheBlock));
+    header.labels_offset = Align(header.indptr_offset + indptr.size() * sizeof(uint64_t));
+    header.indices_offset = Align(header.labels_offset + header.num_rows * sizeof(CSRDataset::Label));
+    header.values_offset = Align(header.indices_offset + header.nnz * sizeof(Key));
+    uint64_t file_size = header.values_offset + header.nnz * sizeof(CSRDataset::Value);
+
+    std::vector<CSRCacheBlock> blocks(header.num_blocks);
+    for (size_t b = 0; b < blocks.size(); ++b) {
+      CSRCacheBlock& block = blocks[b];
+      block.first_row = b * block_rows;
+      block.num_rows = std::min<uint64_t>(block_rows, header.num_rows - block.first_row);
+      block.first_nnz = indptr[block.first_row];
+      block.nnz = indptr[block.first_row + block.num_rows] - block.first_nnz;
+      block.checksum = Checksum(indptr.data() + block.first_row, dataset.labels().data() + block.first_row,
+                                dataset.indices().data() + block.first_nnz,
+                                dataset.values().data() + block.first_nnz, block.num_rows, block.nnz);
+    }
+
+    std::string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (file == nullptr) {
+      LOG(ERROR) << "Cannot open cache file " << tmp_path;
+      return 0;
+    }
+    bool ok = WriteAt(file, 0, &header, sizeof(header)) &&
+              WriteAt(file, header.blocks_offset, blocks.data(), blocks.size() * sizeof(CSRCacheBlock)) &&
+              WriteAt(file, header.indptr_offset, indptr.data(), indptr.size() * sizeof(uint64_t)) &&
+              WriteAt(file, header.labels_offset, dataset.labels().data(),
+                      header.num_rows * sizeof(CSRDataset::Label)) &&
+              WriteAt(file, header.indices_offset, dataset.indices().data(), header.nnz * sizeof(Key)) &&
+              WriteAt(file, header.values_offset, dataset.values().data(),
+                      header.nnz * sizeof(CSRDataset::Value));
+    // the data must be on disk before the rename makes the file visible
+    ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+      LOG(ERROR) << "Failed to write cache file " << path;
+      unlink(tmp_path.c_str());
+      return 0;
+    }
+    if (!SyncDir(path)) {
+      LOG(ERROR) << "Failed to sync the directory of cache file " << path;
+      return 0;
+    }
+    return file_size;
+  }
+
+  /**
+   * Read and check the header and the block table of a cache file
+   *
+   * @return  false if the file does not exist or is not a valid cache file
+   */
+  static bool ReadHeader(const std::string& path, CSRCacheHeader* header, std::vector<CSRCacheBlock>* blocks) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    bool ok = ReadHeader(fd, path, header, blocks);
+    close(fd);
+    return ok;
+  }
+
+  /**
+   * Map the blocks of part <part> out of <num_parts>, e.g., of one worker among the workers sharing the
+   * file, the pages are shared with the other processes mapping the file
+   *
+   * @param verify  check the checksums of the blocks mapped, reading them all
+   * @return        false if the file does not exist, is not a valid cache file, or is corrupted
+   */
+  static bool Map(const std::string& path, size_t part, size_t num_parts, MappedCSRDataset* dataset,
+                  bool verify = true) {
+    CHECK_LT(part, num_parts);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    CSRCacheHeader header;
+    std::vector<CSRCacheBlock> blocks;
+    bool ok = ReadHeader(fd, path, &header, &blocks);
+    if (ok) {
+      size_t first_block = header.num_blocks * part / num_parts;
+      size_t last_block = header.num_blocks * (part + 1) / num_parts;
+      ok = MapBlocks(fd, path, header, blocks, first_block, last_block, verify, dataset);
+    }
+    close(fd);
+    return ok;
+  }
+
+  /**
+   * Map the whole file
+   */
+  static bool Map(const std::string& path, MappedCSRDataset* dataset, bool verify = true) {
+    return Map(path, 0, 1, dataset, verify);
+  }
+
+  /**
+   * FNV-1a over the arrays of a block
+   */
+  static uint64_t Checksum(const uint64_t* indptr, const CSRDataset::Label* labels, const Key* indices,
+                           const CSRDataset::Value* values, size_t num_rows, size_t nnz) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = Fnv1a(hash, indptr, (num_rows + 1) * sizeof(uint64_t));
+    hash = Fnv1a(hash, labels, num_rows * sizeof(CSRDataset::Label));
+    hash = Fnv1a(hash, indices, nnz * sizeof(Key));
+    hash = Fnv1a(hash, values, nnz * sizeof(CSRDataset::Value));
+    return hash;
+  }
+
+ private:
+  static const char* Magic() { return "CSCICSR1"; }
+
+  static uint64_t Align(uint64_t offset) { return (offset + 7) / 8 * 8; }
+
+  // Makes a rename into the directory of <path> durable
+  static bool SyncDir(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd == -1) {
+      return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+  }
+
+  static uint64_t Fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+      hash = (hash ^ p[i]) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  static bool WriteAt(FILE* file, uint64_t offset, const void* data, size_t size) {
+    if (fseeko(file, offset, SEEK_SET) != 0) {
+      return false;
+    }
+    return size == 0 || fwrite(data, 1, size, file) == size;
+  }
+
+  static bool ReadAt(int fd, uint64_t offset, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+      ssize_t n = pread(fd, p, size, offset);
+      if (n <= 0) {
+        return false;
+      }
+      p += n;
+      offset += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  static bool ReadHeader(int fd, const std::string& path, CSRCacheHeader* header, std::vector<CSRCacheBlock>* blocks) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !ReadAt(fd, 0, header, sizeof(*header)) ||
+        std::memcmp(header->magic, Magic(), sizeof(header->magic)) != 0 ||
+        header->format_version != kFormatVersion || header->block_rows == 0 ||
+        header->num_blocks != (header->num_rows + header->block_rows - 1) / header->block_rows ||
+        header->blocks_offset + header->num_blocks * sizeof(CSRCacheBlock) > static_cast<uint64_t>(st.st_size) ||
+        header->indptr_offset + (header->num_rows + 1) * sizeof(uint64_t) > static_cast<uint64_t>(st.st_size) ||
+        header->labels_offset + header->num_rows * sizeof(CSRDataset::Label) > static_cast<uint64_t>(st.st_size) ||
+        header->indices_offset + header->nnz * sizeof(Key) > static_cast<uint64_t>(st.st_size) ||
+        header->values_offset + header->nnz * sizeof(CSRDataset::Value) > static_cast<uint64_t>(st.st_size)) {
+      LOG(ERROR) << "Invalid cache file " << path;
+      return false;
+    }
+    blocks->resize(header->num_blocks);
+    if (!ReadAt(fd, header->blocks_offset, blocks->data(), blocks->size() * sizeof(CSRCacheBlock))) {
+      LOG(ERROR) << "Invalid cache file " << path;
+      return false;
+    }
+    return true;
+  }
+
+  // Map [offset, offset + size) of the file, rounded to pages, and return where the range starts
+  static const char* MapRange(int fd, uint64_t offset, size_t size, std::vector<std::shared_ptr<void>>* mappings) {
+    static const uint64_t kPageSize = sysconf(_SC_PAGESIZE);
+    uint64_t page_offset = offset / kPageSize * kPageSize;
+    size_t length = size + (offset - page_offset);
+    if (length == 0) {
+      return nullptr;
+    }
+    void* addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, page_offset);
+    if (addr == MAP_FAILED) {
+      return nullptr;
+    }
+    mappings->push_back(std::shared_ptr<void>(addr, [length](void* p) { munmap(p, length); }));
+    return static_cast<const char*>(addr) + (offset - page_offset);
+  }
+
+  static bool MapBlocks(int fd, const std::string& path, const CSRCacheHeader& header,
+                        const std::vector<CSRCacheBlock>& blocks, size_t first_block, size_t last_block, bool verify,
+                        MappedCSRDataset* dataset) {
+    MappedCSRDataset mapped;
+    if (first_block == last_block) {
+      *dataset = mapped;
+      return true;
+    }
+    // the blocks must be contiguous
+    for (size_t b = first_block; b < last_block; ++b) {
+      const CSRCacheBlock& block = blocks[b];
+      if (block.first_row != b * header.block_rows || block.first_row + block.num_rows > header.num_rows ||
+          (b > first_block && block.first_nnz != blocks[b - 1].first_nnz + blocks[b - 1].nnz) ||
+          block.first_nnz + block.nnz > header.nnz) {
+        LOG(ERROR) << "Invalid block " << b << " in cache file " << path;
+        return false;
+      }
+    }
+    uint64_t first_row = blocks[first_block].first_row;
+    uint64_t num_rows = blocks[last_block - 1].first_row + blocks[last_block - 1].num_rows - first_row;
+    uint64_t first_nnz = blocks[first_block].first_nnz;
+    uint64_t nnz = blocks[last_block - 1].first_nnz + blocks[last_block - 1].nnz - first_nnz;
+
+    mapped.first_row_ = first_row;
+    mapped.num_rows_ = num_rows;
+    mapped.indptr_ = reinterpret_cast<const uint64_t*>(MapRange(
+        fd, header.indptr_offset + first_row * sizeof(uint64_t), (num_rows + 1) * sizeof(uint64_t), &mapped.mappings_));
+    mapped.labels_ = reinterpret_cast<const CSRDataset::Label*>(MapRange(
+        fd, header.labels_offset + first_row * sizeof(CSRDataset::Label), num_rows * sizeof(CSRDataset::Label),
+        &mapped.mappings_));
+    mapped.indices_ = reinterpret_cast<const Key*>(MapRange(
+        fd, header.indices_offset + first_nnz * sizeof(Key), nnz * sizeof(Key), &mapped.mappings_));
+    mapped.values_ = reinterpret_cast<const CSRDataset::Value*>(MapRange(
+        fd, header.values_offset + first_nnz * sizeof(CSRDataset::Value), nnz * sizeof(CSRDataset::Value),
+        &mapped.mappings_));
+    if (mapped.indptr_ == nullptr || mapped.labels_ == nullptr ||
+        (nnz > 0 && (mapped.indices_ == nullptr || mapped.values_ == nullptr))) {
+      LOG(ERROR) << "Cannot map cache file " << path;
+      return false;
+    }
+    if (mapped.indptr_[0] != first_nnz || mapped.indptr_[num_rows] != first_nnz + nnz) {
+      LOG(ERROR) << "Invalid indptr in cache file " << path;
+      return false;
+    }
+    if (verify) {
+      for (size_t b = first_block; b < last_block; ++b) {
+        const CSRCacheBlock& block = blocks[b];
+        size_t row = block.first_row - first_row;
+        size_t pos = block.first_nnz - first_nnz;
+        if (Checksum(mapped.indptr_ + row, mapped.labels_ + row, mapped.indices_ + pos, mapped.values_ + pos,
+                     block.num_rows, block.nnz) != block.checksum) {
+          LOG(ERROR) << "Corrupted block " << b << " in cache file " << path;
+          return false;
+        }
+      }
+    }
+    *dataset = mapped;
+    return true;
+  }
+};
+
+}  // namespace lib
+}  // namespace csci5570
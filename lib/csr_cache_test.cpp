@@ -0,0 +1,173 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "lib/csr_cache.hpp"
+#include "lib/csr_dataset.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace csci5570 {
+namespace lib {
+namespace {
+
+class TestCSRCache : public testing::Test {
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/csci5570_csr_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+    // row i has i % 4 features
+    for (int i = 0; i < 10; ++i) {
+      std::vector<std::pair<Key, double>> x;
+      for (int j = 0; j < i % 4; ++j) {
+        x.push_back({static_cast<Key>(i * 10 + j), i + j * .5});
+      }
+      dataset_.push_back(x, i % 2 ? 1 : -1);
+    }
+  }
+  void TearDown() {
+    std::string cmd = "rm -rf " + dir_;
+    system(cmd.c_str());
+  }
+
+  void ExpectRowsEqual(const MappedCSRDataset& mapped, size_t first_row, size_t num_rows) {
+    ASSERT_EQ(mapped.size(), num_rows);
+    EXPECT_EQ(mapped.first_row(), first_row);
+    size_t nnz = 0;
+    for (size_t i = 0; i < num_rows; ++i) {
+      auto expected = dataset_.row(first_row + i);
+      auto row = mapped.row(i);
+      ASSERT_EQ(row.nnz, expected.nnz);
+      EXPECT_DOUBLE_EQ(row.label, expected.label);
+      for (size_t j = 0; j < row.nnz; ++j) {
+        EXPECT_EQ(row.indices[j], expected.indices[j]);
+        EXPECT_DOUBLE_EQ(row.values[j], expected.values[j]);
+      }
+      nnz += row.nnz;
+    }
+    EXPECT_EQ(mapped.nnz(), nnz);
+  }
+
+  std::string dir_;
+  CSRDataset dataset_;
+};
+
+TEST_F(TestCSRCache, WriteAndMap) {
+  std::string path = dir_ + "/data.csr";
+  EXPECT_GT(CSRCache::Write(path, dataset_, 3), 0);
+  EXPECT_NE(access((path + ".tmp").c_str(), F_OK), 0);
+
+  CSRCacheHeader header;
+  std::vector<CSRCacheBlock> blocks;
+  ASSERT_TRUE(CSRCache::ReadHeader(path, &header, &blocks));
+  EXPECT_EQ(header.num_rows, 10);
+  EXPECT_EQ(header.nnz, dataset_.nnz());
+  ASSERT_EQ(blocks.size(), 4);
+  EXPECT_EQ(blocks[3].first_row, 9);
+  EXPECT_EQ(blocks[3].num_rows, 1);
+
+  MappedCSRDataset mapped;
+  ASSERT_TRUE(CSRCache::Map(path, &mapped));
+  ExpectRowsEqual(mapped, 0, 10);
+}
+
+TEST_F(TestCSRCache, MapParts) {
+  std::string path = dir_ + "/data.csr";
+  ASSERT_GT(CSRCache::Write(path, dataset_, 3), 0);
+  // 4 blocks among 3 parts: [0, 1), [1, 2), [2, 4)
+  MappedCSRDataset parts[3];
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(CSRCache::Map(path, i, 3, &parts[i]));
+  }
+  ExpectRowsEqual(parts[0], 0, 3);
+  ExpectRowsEqual(parts[1], 3, 3);
+  ExpectRowsEqual(parts[2], 6, 4);
+
+  // more parts than blocks
+  MappedCSRDataset empty;
+  ASSERT_TRUE(CSRCache::Map(path, 0, 5, &empty));
+  EXPECT_TRUE(empty.empty());
+
+  // the mapping outlives the copies
+  MappedCSRDataset copy = parts[2];
+  parts[2] = MappedCSRDataset();
+  ExpectRowsEqual(copy, 6, 4);
+}
+
+TEST_F(TestCSRCache, Batches) {
+  std::string path = dir_ + "/data.csr";
+  ASSERT_GT(CSRCache::Write(path, dataset_, 3), 0);
+  MappedCSRDataset mapped;
+  ASSERT_TRUE(CSRCache::Map(path, 2, 3, &mapped));  // rows [6, 10)
+  ASSERT_EQ(mapped.num_batches(3), 2);
+  EXPECT_EQ(mapped.batch(1, 3).size(), 1);
+  EXPECT_EQ(mapped.batch(1, 3).row(0).indices, mapped.row(3).indices);
+
+  // the batches of a shuffled dataset cover the same rows as the in-memory one shuffled alike
+  CSRDataset part = dataset_.slice(6, 10);
+  std::mt19937 gen(0), part_gen(0);
+  mapped.shuffle(gen);
+  part.shuffle(part_gen);
+  auto batch = mapped.batch(0, 4);
+  auto part_batch = part.batch(0, 4);
+  ASSERT_EQ(batch.size(), 4);
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_DOUBLE_EQ(batch.row(i).label, part_batch.row(i).label);
+    ASSERT_EQ(batch.row(i).nnz, part_batch.row(i).nnz);
+    for (size_t j = 0; j < batch.row(i).nnz; ++j) {
+      EXPECT_EQ(batch.row(i).indices[j], part_batch.row(i).indices[j]);
+    }
+  }
+}
+
+TEST_F(TestCSRCache, Corrupted) {
+  std::string path = dir_ + "/data.csr";
+  ASSERT_GT(CSRCache::Write(path, dataset_, 3), 0);
+  CSRCacheHeader header;
+  std::vector<CSRCacheBlock> blocks;
+  ASSERT_TRUE(CSRCache::ReadHeader(path, &header, &blocks));
+
+  // flip a byte of a value in the last block
+  FILE* file = fopen(path.c_str(), "r+b");
+  ASSERT_NE(file, nullptr);
+  long offset = header.values_offset + blocks[3].first_nnz * sizeof(double);
+  ASSERT_EQ(fseek(file, offset, SEEK_SET), 0);
+  int byte = fgetc(file);
+  ASSERT_EQ(fseek(file, offset, SEEK_SET), 0);
+  fputc(byte ^ 0xff, file);
+  fclose(file);
+
+  MappedCSRDataset mapped;
+  EXPECT_FALSE(CSRCache::Map(path, &mapped));
+  EXPECT_TRUE(CSRCache::Map(path, 0, 2, &mapped));  // the first blocks are intact
+  EXPECT_FALSE(CSRCache::Map(path, 1, 2, &mapped));
+  EXPECT_TRUE(CSRCache::Map(path, 1, 2, &mapped, false));
+}
+
+TEST_F(TestCSRCache, Invalid) {
+  MappedCSRDataset mapped;
+  EXPECT_FALSE(CSRCache::Map(dir_ + "/missing.csr", &mapped));
+
+  std::string path = dir_ + "/text.csr";
+  FILE* file = fopen(path.c_str(), "w");
+  ASSERT_NE(file, nullptr);
+  fputs("1 1:0.5 4:2\n", file);
+  fclose(file);
+  EXPECT_FALSE(CSRCache::Map(path, &mapped));
+
+  // an empty dataset has no block
+  path = dir_ + "/empty.csr";
+  ASSERT_GT(CSRCache::Write(path, CSRDataset()), 0);
+  ASSERT_TRUE(CSRCache::Map(path, &mapped));
+  EXPECT_TRUE(mapped.empty());
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace csci5570
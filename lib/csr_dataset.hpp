@@ -0,0 +1,186 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "base/magic.hpp"
+
+namespace csci5570 {
+namespace lib {
+
+/**
+ * A view of one row of a sparse dataset
+ */
+struct CSRRow {
+  const Key* indices;
+  const double* values;
+  size_t nnz;
+  double label;
+};
+
+/**
+ * A view of the rows [begin, end) of a dataset, e.g., CSRDataset, in its current row order
+ */
+template <typename Dataset>
+class CSRBatch {
+ public:
+  CSRBatch(const Dataset* dataset, size_t begin, size_t end) : dataset_(dataset), begin_(begin), end_(end) {}
+
+  size_t size() const { return end_ - begin_; }
+  CSRRow row(size_t i) const { return dataset_->row(dataset_->row_id(begin_ + i)); }
+
+ private:
+  const Dataset* dataset_;
+  size_t begin_;
+  size_t end_;
+};
+
+/**
+ * The row order of a dataset seen by its batches, the natural order until shuffled
+ */
+class CSRRowOrder {
+ public:
+  size_t row_id(size_t position) const { return order_.empty() ? position : order_[position]; }
+
+  template <typename URNG>
+  void shuffle(size_t num_rows, URNG&& gen) {
+    if (order_.size() != num_rows) {
+      order_.resize(num_rows);
+      std::iota(order_.begin(), order_.end(), 0);
+    }
+    std::shuffle(order_.begin(), order_.end(), gen);
+  }
+
+  void clear() { order_.clear(); }
+
+ private:
+  std::vector<size_t> order_;  // the row order after shuffle(), empty for the natural order
+};
+
+/**
+ * A sparse dataset in compressed sparse row (CSR) format
+ *
+ * The features of all the rows are kept in two contiguous arrays, indices and values, and row i spans
+ * [indptr[i], indptr[i + 1]) of them. Rows are appended with push_back, e.g., by DataLoader in place
+ * of std::vector<SVMSample>, and read through lightweight views, in mini-batches over an optionally
+ * shuffled row order.
+ */
+class CSRDataset {
+ public:
+  using Value = double;
+  using Label = double;
+  using Row = CSRRow;
+  using Batch = CSRBatch<CSRDataset>;
+
+  CSRDataset() : indptr_(1, 0) {}
+
+  size_t size() const { return labels_.size(); }
+  bool empty() const { return labels_.empty(); }
+  size_t nnz() const { return indices_.size(); }
+
+  void reserve(size_t num_rows, size_t nnz) {
+    indptr_.reserve(num_rows + 1);
+    labels_.reserve(num_rows);
+    indices_.reserve(nnz);
+    values_.reserve(nnz);
+  }
+
+  /**
+   * Append a row of (index, value) pairs
+   */
+  template <typename Features>
+  void push_back(const Features& x, Label y) {
+    for (const auto& feature : x) {
+      indices_.push_back(feature.first);
+      values_.push_back(feature.second);
+    }
+    indptr_.push_back(indices_.size());
+    labels_.push_back(y);
+    order_.clear();
+  }
+  /**
+   * Append a sample with x_ and y_, e.g., SVMSample
+   */
+  template <typename Sample>
+  void push_back(const Sample& sample) {
+    push_back(sample.x_, sample.y_);
+  }
+
+  /**
+   * Append all the rows of <other>
+   */
+  void append(const CSRDataset& other) {
+    size_t offset = indices_.size();
+    indices_.insert(indices_.end(), other.indices_.begin(), other.indices_.end());
+    values_.insert(values_.end(), other.values_.begin(), other.values_.end());
+    labels_.insert(labels_.end(), other.labels_.begin(), other.labels_.end());
+    for (size_t i = 1; i < other.indptr_.size(); ++i) {
+      indptr_.push_back(other.indptr_[i] + offset);
+    }
+    order_.clear();
+  }
+
+  /**
+   * Copy the rows [begin, end), e.g., the shard of a worker, into a new dataset
+   */
+  CSRDataset slice(size_t begin, size_t end) const {
+    CHECK_LE(begin, end);
+    CHECK_LE(end, size());
+    CSRDataset part;
+    size_t first = indptr_[begin];
+    part.indices_.assign(indices_.begin() + first, indices_.begin() + indptr_[end]);
+    part.values_.assign(values_.begin() + first, values_.begin() + indptr_[end]);
+    part.labels_.assign(labels_.begin() + begin, labels_.begin() + end);
+    part.indptr_.reserve(end - begin + 1);
+    for (size_t i = begin + 1; i <= end; ++i) {
+      part.indptr_.push_back(indptr_[i] - first);
+    }
+    return part;
+  }
+
+  Row row(size_t i) const {
+    DCHECK_LT(i, size());
+    size_t begin = indptr_[i];
+    return Row{indices_.data() + begin, values_.data() + begin, indptr_[i + 1] - begin, labels_[i]};
+  }
+
+  /**
+   * Permute the row order seen by the batches, the rows themselves are not moved
+   */
+  template <typename URNG>
+  void shuffle(URNG&& gen) {
+    order_.shuffle(size(), gen);
+  }
+
+  /**
+   * Return the <i>-th batch of <batch_size> rows in the current order, the last one may be smaller
+   */
+  Batch batch(size_t i, size_t batch_size) const {
+    size_t begin = std::min(i * batch_size, size());
+    return Batch(this, begin, std::min(begin + batch_size, size()));
+  }
+  size_t num_batches(size_t batch_size) const { return (size() + batch_size - 1) / batch_size; }
+  // the row at <position> of the current order
+  size_t row_id(size_t position) const { return order_.row_id(position); }
+
+  // the raw arrays
+  const std::vector<size_t>& indptr() const { return indptr_; }
+  const std::vector<Key>& indices() const { return indices_; }
+  const std::vector<Value>& values() const { return values_; }
+  const std::vector<Label>& labels() const { return labels_; }
+
+ private:
+
+  std::vector<size_t> indptr_;  // size() + 1 offsets into indices_ and values_
+  std::vector<Key> indices_;
+  std::vector<Value> values_;
+  std::vector<Label> labels_;
+  CSRRowOrder order_;
+};
+
+}  // namespace lib
+}  // namespace csci5570
@@ -0,0 +1,125 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "lib/csr_dataset.hpp"
+#include "lib/parser.hpp"
+#include "lib/svm_loader.hpp"
+#include "lib/svm_sample.hpp"
+
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace csci5570 {
+namespace lib {
+namespace {
+
+class TestCSRDataset : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+TEST_F(TestCSRDataset, PushBack) {
+  CSRDataset dataset;
+  EXPECT_TRUE(dataset.empty());
+  SVMSample sample;
+  sample.x_ = {{1, .5}, {4, 2}};
+  sample.y_ = 1;
+  dataset.push_back(sample);
+  dataset.push_back(std::vector<std::pair<Key, double>>(), -1);  // no feature
+  dataset.push_back(std::vector<std::pair<Key, double>>{{7, 3}}, -1);
+
+  ASSERT_EQ(dataset.size(), 3);
+  EXPECT_EQ(dataset.nnz(), 3);
+  EXPECT_EQ(dataset.indptr(), (std::vector<size_t>{0, 2, 2, 3}));
+  auto row = dataset.row(0);
+  ASSERT_EQ(row.nnz, 2);
+  EXPECT_EQ(row.indices[1], 4);
+  EXPECT_DOUBLE_EQ(row.values[0], .5);
+  EXPECT_DOUBLE_EQ(row.label, 1);
+  EXPECT_EQ(dataset.row(1).nnz, 0);
+  EXPECT_EQ(dataset.row(2).indices[0], 7);
+}
+
+TEST_F(TestCSRDataset, Append) {
+  CSRDataset a, b;
+  a.push_back(std::vector<std::pair<Key, double>>{{1, 1}}, 1);
+  b.push_back(std::vector<std::pair<Key, double>>{{2, 2}, {3, 3}}, -1);
+  b.push_back(std::vector<std::pair<Key, double>>{{4, 4}}, 1);
+  a.append(b);
+  ASSERT_EQ(a.size(), 3);
+  EXPECT_EQ(a.indptr(), (std::vector<size_t>{0, 1, 3, 4}));
+  EXPECT_EQ(a.row(2).indices[0], 4);
+  EXPECT_DOUBLE_EQ(a.row(1).label, -1);
+}
+
+TEST_F(TestCSRDataset, Slice) {
+  CSRDataset dataset;
+  for (Key i = 0; i < 5; ++i) {
+    // row i has i features
+    std::vector<std::pair<Key, double>> x;
+    for (Key j = 0; j < i; ++j) {
+      x.push_back({i * 10 + j, 1});
+    }
+    dataset.push_back(x, i);
+  }
+  CSRDataset part = dataset.slice(2, 4);
+  ASSERT_EQ(part.size(), 2);
+  EXPECT_EQ(part.indptr(), (std::vector<size_t>{0, 2, 5}));
+  EXPECT_EQ(part.row(1).indices[2], 32);
+  EXPECT_DOUBLE_EQ(part.row(0).label, 2);
+  EXPECT_TRUE(dataset.slice(3, 3).empty());
+  EXPECT_EQ(dataset.slice(0, 5).indices(), dataset.indices());
+}
+
+TEST_F(TestCSRDataset, Batches) {
+  CSRDataset dataset;
+  for (int i = 0; i < 10; ++i) {
+    dataset.push_back(std::vector<std::pair<Key, double>>{{static_cast<Key>(i), 1}}, i);
+  }
+  EXPECT_EQ(dataset.num_batches(4), 3);
+  auto last = dataset.batch(2, 4);
+  ASSERT_EQ(last.size(), 2);
+  EXPECT_EQ(last.row(0).indices[0], 8);
+  EXPECT_EQ(dataset.batch(3, 4).size(), 0);
+
+  dataset.shuffle(std::mt19937(0));
+  std::set<Key> seen;
+  std::vector<Key> order;
+  for (size_t b = 0; b < dataset.num_batches(4); ++b) {
+    auto batch = dataset.batch(b, 4);
+    for (size_t i = 0; i < batch.size(); ++i) {
+      auto row = batch.row(i);
+      EXPECT_DOUBLE_EQ(row.label, row.indices[0]);  // the rows are intact
+      seen.insert(row.indices[0]);
+      order.push_back(row.indices[0]);
+    }
+  }
+  EXPECT_EQ(seen.size(), 10);  // a permutation
+  EXPECT_NE(order, (std::vector<Key>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+  EXPECT_EQ(dataset.row(3).indices[0], 3);  // the rows did not move
+}
+
+TEST_F(TestCSRDataset, ParseParallel) {
+  std::vector<std::vector<std::string>> files{{"1 1:1 2:2", "-1 3:3"}, {}, {"1 4:4.5"}};
+  Parser<SVMSample, CSRDataset> parser;
+  CSRDataset dataset;
+  DataLoader<SVMSample, CSRDataset>::parse_parallel(
+      files.size(),
+      [&](int i, const std::function<void(boost::string_ref)>& on_record) {
+        for (const auto& line : files[i]) {
+          on_record(line);
+        }
+      },
+      parser, 10, &dataset);
+  ASSERT_EQ(dataset.size(), 3);
+  EXPECT_EQ(dataset.indptr(), (std::vector<size_t>{0, 2, 3, 4}));
+  EXPECT_DOUBLE_EQ(dataset.row(2).values[0], 4.5);
+  EXPECT_DOUBLE_EQ(dataset.row(1).label, -1);
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace csci5570
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+
+namespace csci5570 {
+namespace lib {
+
+/**
+ * A fixed-size vector of parameters stored under one key, e.g., a factor of matrix factorization
+ *
+ * It is trivial, so that storages and messages carry it as raw bytes like a scalar Val, and adds elementwise as
+ * the storages accumulate updates. As a scalar, Embedding() is zero while a default-initialized one is not.
+ */
+template <size_t N, typename T = float>
+struct Embedding {
+  static const size_t kDim = N;
+
+  T& operator[](size_t i) { return data[i]; }
+  const T& operator[](size_t i) const { return data[i]; }
+
+  Embedding& operator+=(const Embedding& other) {
+    for (size_t i = 0; i < N; ++i) {
+      data[i] += other.data[i];
+    }
+    return *this;
+  }
+
+  Embedding operator+(const Embedding& other) const {
+    Embedding sum = *this;
+    sum += other;
+    return sum;
+  }
+
+  bool operator==(const Embedding& other) const {
+    for (size_t i = 0; i < N; ++i) {
+      if (data[i] != other.data[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  T data[N];
+};
+
+template <size_t N, typename T>
+const size_t Embedding<N, T>::kDim;
+
+}  // namespace lib
+}  // namespace csci5570
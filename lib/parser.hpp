@@ -1,8 +1,18 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <type_traits>
+
 #include "boost/algorithm/string/finder.hpp"
 #include "boost/algorithm/string/split.hpp"
 #include "boost/utility/string_ref.hpp"
 #include "boost/algorithm/string/classification.hpp"
+#include "glog/logging.h"
+#include "lib/rating.hpp"
 #include "lib/svm_sample.hpp"
 
 namespace csci5570 {
@@ -17,49 +27,165 @@ class Parser {
    * @param line    a line read from the input file
    */
   static Sample parse_libsvm(boost::string_ref line, int n_features) {
-    // check the LibSVM format and complete the parsing
-    // hints: you may use boost::tokenizer, std::strtok_r, std::stringstream or any method you like
-    // so far we tried all the tree and found std::strtok_r is fastest :)
-    Sample sample = SVMSample();
-
-    using V = std::vector<boost::string_ref>;
-    using S = boost::string_ref;
-
-    S label;
-
-    size_t p;
-    // get label
-    p = line.find_first_of(" ");
-    label = line.substr(0, p);
-    sample.y_ = std::stoi(label.to_string());
-
+    Sample sample;
+    parse_libsvm(line, n_features, &sample);
+    return sample;
+  }
 
-    line.remove_prefix(p+1);
+  /**
+   * Parse a LibSVM line "<label> <index>:<value> <index>:<value> ..." in place into <sample>,
+   * reusing the capacity of its features. Nothing is allocated once the features fit.
+   */
+  static void parse_libsvm(boost::string_ref line, int n_features, Sample* sample) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    sample->x_.clear();
+    size_t num_features = std::count(p, end, ':');
+    if (sample->x_.capacity() < num_features) {
+      sample->x_.reserve(num_features);
+    }
 
-    while(true){
-      p = line.find_first_of(" ");
-      if (p == S::npos) {
+    p = skip_spaces(p, end);
+    double label;
+    p = parse_double(p, end, &label);
+    CHECK(p != nullptr) << "Bad label in line: " << line;
+    // a class label, e.g., of SVMSample, is not silently truncated
+    CHECK(!std::is_integral<decltype(sample->y_)>::value || label == std::trunc(label))
+        << "Non-integral label in line: " << line;
+    sample->y_ = label;
+    while (true) {
+      p = skip_spaces(p, end);
+      if (p == end) {
         break;
       }
-      S data = line.substr(0, p);
-      size_t p1;
-
-      p1 = data.find_first_of(";");
-      auto index = std::stoi(data.substr(0,p1).to_string());
-      data.remove_prefix(p1+1);
-      auto value = std::stoi(data.to_string());
-      line.remove_prefix(p+1);
-      sample.x_.push_back(std::make_pair(index,value));
+      uint64_t index = 0;
+      const char* digits = p;
+      while (p != end && is_digit(*p)) {
+        index = index * 10 + (*p - '0');
+        // checked per digit, so the accumulation cannot overflow either
+        CHECK_LE(index, static_cast<uint64_t>(std::numeric_limits<int>::max())) << "Feature index out of range in line: " << line;
+        ++p;
+      }
+      CHECK(p != digits && p != end && (*p == ':' || *p == ';')) << "Bad feature in line: " << line;
+      double value;
+      p = parse_double(p + 1, end, &value);
+      CHECK(p != nullptr) << "Bad value in line: " << line;
+      sample->x_.emplace_back(index, value);
     }
-    return sample;
   }
 
   static Sample parse_mnist(boost::string_ref line, int n_features) {
     // check the MNIST format and complete the parsing
   }
 
+  /**
+   * Parse a rating line "<user> <item> <rating>", the fields being separated by spaces, tabs, commas or "::",
+   * e.g., MovieLens ratings. Trailing fields, e.g., a timestamp, are ignored.
+   */
+  static void parse_rating(boost::string_ref line, Rating* rating) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    uint32_t* ids[] = {&rating->user, &rating->item};
+    for (uint32_t* id : ids) {
+      p = skip_separators(p, end);
+      const char* digits = p;
+      uint64_t value = 0;
+      while (p != end && is_digit(*p)) {
+        value = value * 10 + (*p - '0');
+        ++p;
+      }
+      CHECK(p != digits && value <= UINT32_MAX) << "Bad id in line: " << line;
+      *id = value;
+    }
+    double value;
+    p = parse_double(skip_separators(p, end), end, &value);
+    CHECK(p != nullptr) << "Bad rating in line: " << line;
+    rating->value = value;
+  }
+
   // You may implement other parsing logic
 
+  /**
+   * Parse a decimal floating point number at the beginning of [p, end), e.g., -1, 0.25, 1e-3
+   *
+   * @return    the end of the number, or nullptr if there is no number
+   */
+  static const char* parse_double(const char* p, const char* end, double* value) {
+    const char* begin = p;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+')) {
+      negative = *p == '-';
+      ++p;
+    }
+    uint64_t mantissa = 0;
+    int num_digits = 0;  // significant digits in the mantissa
+    int exponent = 0;
+    bool any_digit = false;
+    for (; p != end && is_digit(*p); ++p, any_digit = true) {
+      if (num_digits < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        num_digits += mantissa != 0;
+      } else {
+        exponent += 1;
+      }
+    }
+    if (p != end && *p == '.') {
+      for (++p; p != end && is_digit(*p); ++p, any_digit = true) {
+        if (num_digits < 19) {
+          mantissa = mantissa * 10 + (*p - '0');
+          num_digits += mantissa != 0;
+          exponent -= 1;
+        }
+      }
+    }
+    if (!any_digit) {
+      return nullptr;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+      const char* q = p + 1;
+      bool negative_exp = false;
+      if (q != end && (*q == '-' || *q == '+')) {
+        negative_exp = *q == '-';
+        ++q;
+      }
+      if (q != end && is_digit(*q)) {
+        int exp = 0;
+        for (; q != end && is_digit(*q); ++q) {
+          exp = std::min(exp * 10 + (*q - '0'), 100000);
+        }
+        exponent += negative_exp ? -exp : exp;
+        p = q;
+      }
+    }
+    // exact when both the mantissa and the power of 10 are exact doubles
+    static const double kPow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (mantissa < (1ull << 53) && exponent >= -22 && exponent <= 22) {
+      double v = static_cast<double>(mantissa);
+      v = exponent < 0 ? v / kPow10[-exponent] : v * kPow10[exponent];
+      *value = negative ? -v : v;
+      return p;
+    }
+    // rare: fall back to strtod on a null-terminated copy of the whole number, however long
+    std::string number(begin, p);
+    *value = std::strtod(number.c_str(), nullptr);
+    return p;
+  }
+
+ private:
+  static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+  static const char* skip_spaces(const char* p, const char* end) {
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+      ++p;
+    }
+    return p;
+  }
+  static const char* skip_separators(const char* p, const char* end) {
+    while (p != end && (*p == ' ' || *p == '\t' || *p == ',' || *p == ':')) {
+      ++p;
+    }
+    return p;
+  }
 };  // class Parser
 
 }  // namespace lib
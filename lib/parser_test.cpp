@@ -0,0 +1,100 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "lib/parser.hpp"
+#include "lib/svm_sample.hpp"
+
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace csci5570 {
+namespace lib {
+namespace {
+
+class TestParser : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+using SVMParser = Parser<SVMSample, std::vector<SVMSample>>;
+
+TEST_F(TestParser, ParseLibsvm) {
+  SVMSample sample = SVMParser::parse_libsvm("-1 3:0.5 10:2 123:-1.25e-2", 200);
+  EXPECT_EQ(sample.y_, -1);
+  ASSERT_EQ(sample.x_.size(), 3);
+  EXPECT_EQ(sample.x_[0].first, 3);
+  EXPECT_DOUBLE_EQ(sample.x_[0].second, 0.5);
+  EXPECT_EQ(sample.x_[1].first, 10);
+  EXPECT_DOUBLE_EQ(sample.x_[1].second, 2);
+  EXPECT_EQ(sample.x_[2].first, 123);
+  EXPECT_DOUBLE_EQ(sample.x_[2].second, -0.0125);
+}
+
+TEST_F(TestParser, Spaces) {
+  SVMSample sample = SVMParser::parse_libsvm("  +1\t1:1  2:3 \r", 10);
+  EXPECT_EQ(sample.y_, 1);
+  ASSERT_EQ(sample.x_.size(), 2);
+  EXPECT_EQ(sample.x_[1].first, 2);
+  EXPECT_DOUBLE_EQ(sample.x_[1].second, 3);
+
+  sample = SVMParser::parse_libsvm("0", 10);
+  EXPECT_EQ(sample.y_, 0);
+  EXPECT_TRUE(sample.x_.empty());
+}
+
+TEST_F(TestParser, LargestIndex) {
+  SVMSample sample = SVMParser::parse_libsvm("1 0002147483647:1", 10);
+  ASSERT_EQ(sample.x_.size(), 1);
+  EXPECT_EQ(sample.x_[0].first, std::numeric_limits<int>::max());
+}
+
+TEST_F(TestParser, ReuseSample) {
+  SVMSample sample;
+  SVMParser::parse_libsvm("1 1:1 2:1 3:1", 10, &sample);
+  auto* data = sample.x_.data();
+  SVMParser::parse_libsvm("0 4:1 5:1", 10, &sample);
+  EXPECT_EQ(sample.x_.data(), data);  // no allocation
+  ASSERT_EQ(sample.x_.size(), 2);
+  EXPECT_EQ(sample.x_[0].first, 4);
+}
+
+TEST_F(TestParser, ParseRating) {
+  Rating rating;
+  SVMParser::parse_rating("196\t242\t3\t881250949", &rating);
+  EXPECT_EQ(rating.user, 196);
+  EXPECT_EQ(rating.item, 242);
+  EXPECT_FLOAT_EQ(rating.value, 3);
+  SVMParser::parse_rating("1::1193::4.5::978300760", &rating);
+  EXPECT_EQ(rating.user, 1);
+  EXPECT_EQ(rating.item, 1193);
+  EXPECT_FLOAT_EQ(rating.value, 4.5);
+  SVMParser::parse_rating("7,8,-0.5", &rating);
+  EXPECT_EQ(rating.item, 8);
+  EXPECT_FLOAT_EQ(rating.value, -0.5);
+}
+
+TEST_F(TestParser, ParseDouble) {
+  for (const std::string s : {"0", "-0.5", "3.14159", "1e10", "2.5E-3", "123456789012345678901234", "0.000001",
+                              "1.7976931348623157e308", "4.9e-324", "0.1234567890123456789", "12.", ".5"}) {
+    double value;
+    const char* end = SVMParser::parse_double(s.data(), s.data() + s.size(), &value);
+    EXPECT_EQ(end, s.data() + s.size()) << s;
+    EXPECT_EQ(value, std::strtod(s.c_str(), nullptr)) << s;
+  }
+  // longer than the fast path, the exponent is past the 64th character
+  std::string long_number = "0." + std::string(80, '1') + "e-5";
+  double long_value;
+  EXPECT_EQ(SVMParser::parse_double(long_number.data(), long_number.data() + long_number.size(), &long_value),
+            long_number.data() + long_number.size());
+  EXPECT_EQ(long_value, std::strtod(long_number.c_str(), nullptr));
+  std::string bad = "-x";
+  double value;
+  EXPECT_EQ(SVMParser::parse_double(bad.data(), bad.data() + bad.size(), &value), nullptr);
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace csci5570
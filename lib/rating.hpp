@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace csci5570 {
+namespace lib {
+
+/**
+ * A rating of an item by a user, a sample of matrix factorization
+ */
+struct Rating {
+  uint32_t user = 0;
+  uint32_t item = 0;
+  float value = 0;
+};
+
+}  // namespace lib
+}  // namespace csci5570
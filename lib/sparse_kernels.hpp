@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace csci5570 {
+namespace lib {
+
+/**
+ * Kernels of the sparse models, e.g., LogisticRegression and SVM, over rows of CSR data
+ *
+ * A row is given by the columns of its features, i.e., their positions in a dense array of parameters, and their
+ * values. With AVX2 and FMA (-mavx2 -mfma, see WITH_AVX2), the dot products gather 4 parameters at a time and
+ * the sigmoid evaluates 4 exponentials at a time with FastExp, a polynomial approximation with a relative error
+ * below 1e-8, plenty for gradients.
+ */
+
+namespace detail {
+
+// exp(x) = 2^n * exp(r) with x = n * ln2 + r, |r| <= ln2 / 2
+const double kLog2e = 1.4426950408889634;
+const double kLn2Hi = 0.693145751953125;
+const double kLn2Lo = 1.42860682030941723212e-6;
+const double kExpLimit = 708;  // keeps 2^n a normal double
+// Taylor coefficients of exp(r) from r^7 down to r^0
+const double kExpPoly[] = {1.0 / 5040, 1.0 / 720, 1.0 / 120, 1.0 / 24, 1.0 / 6, 0.5, 1.0, 1.0};
+
+}  // namespace detail
+
+inline double FastExp(double x) {
+  x = x < -detail::kExpLimit ? -detail::kExpLimit : (x > detail::kExpLimit ? detail::kExpLimit : x);
+  double n = static_cast<double>(static_cast<int64_t>(x * detail::kLog2e + (x >= 0 ? 0.5 : -0.5)));
+  double r = x - n * detail::kLn2Hi - n * detail::kLn2Lo;
+  double p = detail::kExpPoly[0];
+  for (int i = 1; i < 8; ++i) {
+    p = p * r + detail::kExpPoly[i];
+  }
+  uint64_t bits = static_cast<uint64_t>(static_cast<int64_t>(n) + 1023) << 52;
+  double scale;
+  memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+/**
+ * out[i] = 1 / (1 + exp(-z[i])) for i in [0, n), <out> may be <z>
+ */
+inline void Sigmoid(const double* z, size_t n, double* out) {
+  size_t i = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+  const __m256d limit = _mm256_set1_pd(detail::kExpLimit);
+  const __m256d one = _mm256_set1_pd(1.0);
+  for (; i + 4 <= n; i += 4) {
+    // exp(-z)
+    __m256d x = _mm256_sub_pd(_mm256_setzero_pd(), _mm256_loadu_pd(z + i));
+    x = _mm256_max_pd(_mm256_min_pd(x, limit), _mm256_sub_pd(_mm256_setzero_pd(), limit));
+    __m256d k = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(detail::kLog2e)),
+                                _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(k, _mm256_set1_pd(detail::kLn2Hi), x);
+    r = _mm256_fnmadd_pd(k, _mm256_set1_pd(detail::kLn2Lo), r);
+    __m256d p = _mm256_set1_pd(detail::kExpPoly[0]);
+    for (int j = 1; j < 8; ++j) {
+      p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(detail::kExpPoly[j]));
+    }
+    __m256i e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(k));
+    e = _mm256_slli_epi64(_mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52);
+    __m256d ex = _mm256_mul_pd(p, _mm256_castsi256_pd(e));
+    _mm256_storeu_pd(out + i, _mm256_div_pd(one, _mm256_add_pd(one, ex)));
+  }
+  // the remainder as the vectors
+  for (; i < n; ++i) {
+    out[i] = 1 / (1 + FastExp(-z[i]));
+  }
+#else
+  // the scalar polynomial is no faster than libm
+  for (; i < n; ++i) {
+    out[i] = 1 / (1 + std::exp(-z[i]));
+  }
+#endif
+}
+
+/**
+ * sum_k values[k] * w[cols[k]], for any type of parameters
+ */
+template <typename W>
+double SparseDot(const uint32_t* cols, const double* values, size_t nnz, const W* w) {
+  double z = 0;
+  for (size_t k = 0; k < nnz; ++k) {
+    z += values[k] * w[cols[k]];
+  }
+  return z;
+}
+
+/**
+ * sum_k values[k] * w[cols[k]] over double parameters, gathered 4 at a time with AVX2
+ */
+inline double SparseDot(const uint32_t* cols, const double* values, size_t nnz, const double* w) {
+  size_t k = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+  __m256d acc0 = _mm256_setzero_pd();
+  __m256d acc1 = _mm256_setzero_pd();
+  for (; k + 8 <= nnz; k += 8) {
+    __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cols + k));
+    __m128i c1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cols + k + 4));
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k), _mm256_i32gather_pd(w, c0, 8), acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k + 4), _mm256_i32gather_pd(w, c1, 8), acc1);
+  }
+  if (k + 4 <= nnz) {
+    __m128i c0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cols + k));
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(values + k), _mm256_i32gather_pd(w, c0, 8), acc0);
+    k += 4;
+  }
+  __m256d acc = _mm256_add_pd(acc0, acc1);
+  __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  double z = _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#else
+  // independent sums to overlap the loads
+  double z0 = 0, z1 = 0;
+  for (; k + 2 <= nnz; k += 2) {
+    z0 += values[k] * w[cols[k]];
+    z1 += values[k + 1] * w[cols[k + 1]];
+  }
+  double z = z0 + z1;
+#endif
+  for (; k < nnz; ++k) {
+    z += values[k] * w[cols[k]];
+  }
+  return z;
+}
+
+/**
+ * y[cols[k]] += a * values[k], the columns of a row being distinct
+ *
+ * AVX2 has no scatter, the updates are scalar.
+ */
+template <typename Y>
+void SparseAxpy(double a, const uint32_t* cols, const double* values, size_t nnz, Y* y) {
+  for (size_t k = 0; k < nnz; ++k) {
+    y[cols[k]] += a * values[k];
+  }
+}
+
+}  // namespace lib
+}  // namespace csci5570
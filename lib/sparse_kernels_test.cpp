@@ -0,0 +1,86 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "lib/sparse_kernels.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace csci5570 {
+namespace lib {
+namespace {
+
+class TestSparseKernels : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+TEST_F(TestSparseKernels, FastExp) {
+  for (double x = -700; x <= 700; x += 0.37) {
+    EXPECT_NEAR(FastExp(x) / std::exp(x), 1, 1e-8) << x;
+  }
+  EXPECT_EQ(FastExp(0), 1);
+  // clamped instead of overflowing
+  EXPECT_TRUE(std::isfinite(FastExp(1000)));
+  EXPECT_GE(FastExp(-1000), 0);
+}
+
+TEST_F(TestSparseKernels, Sigmoid) {
+  // the lengths cover the vectorized loop and its tail
+  for (size_t n : {0, 1, 3, 4, 7, 17}) {
+    std::vector<double> z(n), out(n);
+    for (size_t i = 0; i < n; ++i) {
+      z[i] = (static_cast<double>(i) - 8) * 1.7;
+    }
+    Sigmoid(z.data(), n, out.data());
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_NEAR(out[i], 1 / (1 + std::exp(-z[i])), 1e-9) << z[i];
+    }
+    Sigmoid(z.data(), n, z.data());  // in place
+    EXPECT_EQ(z, out);
+  }
+  std::vector<double> extreme{-1e6, -800, 800, 1e6};
+  Sigmoid(extreme.data(), extreme.size(), extreme.data());
+  EXPECT_NEAR(extreme[0], 0, 1e-300);
+  EXPECT_NEAR(extreme[1], 0, 1e-300);
+  EXPECT_EQ(extreme[2], 1);
+  EXPECT_EQ(extreme[3], 1);
+}
+
+TEST_F(TestSparseKernels, DotAndAxpy) {
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<double> dist(-1, 1);
+  std::vector<double> w(1000);
+  for (auto& x : w) {
+    x = dist(gen);
+  }
+  std::vector<float> wf(w.begin(), w.end());
+  for (size_t nnz : {0, 1, 3, 4, 5, 8, 9, 13, 64}) {
+    std::vector<uint32_t> cols;
+    std::vector<double> values;
+    for (size_t k = 0; k < nnz; ++k) {
+      cols.push_back(k * 71 % w.size());  // distinct
+      values.push_back(dist(gen));
+    }
+    double expected = 0;
+    for (size_t k = 0; k < nnz; ++k) {
+      expected += values[k] * w[cols[k]];
+    }
+    EXPECT_NEAR(SparseDot(cols.data(), values.data(), nnz, w.data()), expected, 1e-12) << nnz;
+    EXPECT_NEAR(SparseDot(cols.data(), values.data(), nnz, wf.data()), expected, 1e-5) << nnz;
+
+    std::vector<double> y(w);
+    SparseAxpy(0.5, cols.data(), values.data(), nnz, y.data());
+    for (size_t k = 0; k < nnz; ++k) {
+      EXPECT_DOUBLE_EQ(y[cols[k]], w[cols[k]] + 0.5 * values[k]);
+      y[cols[k]] = w[cols[k]];
+    }
+    EXPECT_EQ(y, w);
+  }
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace csci5570
@@ -5,16 +5,18 @@
 #ifndef CSCI5570_SVM_LOADER_HPP
 #define CSCI5570_SVM_LOADER_HPP
 
+#include <functional>
 #include <thread>
 #include <vector>
 #include "base/serialization.hpp"
 #include "boost/utility/string_ref.hpp"
 #include "io/coordinator.hpp"
 #include "io/hdfs_assigner.hpp"
-#include "io/hdfs_file_splitter.hpp"
 #include "io/line_input_format.hpp"
 #include "lib/abstract_data_loader.hpp"
+#include "lib/csr_dataset.hpp"
 #include "lib/labeled_sample.hpp"
+#include "lib/rating.hpp"
 
 #include "glog/logging.h"
 #include "lib/parser.hpp"
@@ -25,9 +27,13 @@ namespace csci5570 {
         template<typename Sample, typename DataStore>
         class DataLoader : public AbstractDataLoader<Sample, DataStore> {
         public:
+            /**
+             * Load the samples of the url on the local node with <num_threads> reader/parser threads
+             */
             template <typename Parse>  // e.g. std::function<Sample(boost::string_ref, int)>
             static void load(std::string url, std::string hdfs_namenode, std::string master_host, std::string worker_host,
-                             int hdfs_namenode_port, int master_port, int n_features, Parse parse, DataStore* datastore, uint32_t id, int total_nodes) {
+                             int hdfs_namenode_port, int master_port, int n_features, Parse parse, DataStore* datastore, uint32_t id, int total_nodes,
+                             int num_threads = 1) {
               // 1. Connect to the data source, e.g. HDFS, via the modules in io
               // 2. Extract and parse lines
               // 3. Put samples into datastore
@@ -56,38 +62,75 @@ namespace csci5570 {
                 });
               }
 
-              std::thread worker_thread([url, hdfs_namenode_port, hdfs_namenode, &coordinator, worker_host, parse, &datastore,n_features, id] {
-                  int num_threads = 1;
-                  int second_id = 1;
-
-                  LOG(INFO) << "Line input start to prepare";
-                  LineInputFormat infmt(url, num_threads, second_id, &coordinator, worker_host, hdfs_namenode,
-                                        hdfs_namenode_port);
-                  LOG(INFO) << "Line input is well prepared";
-
-                  boost::string_ref record;
-                  bool success = true;
-                  int count = 0;
-                  while (true) {
-                    success = infmt.next(record);
-                    if (success == false)
-                      break;
-                    // LOG(INFO) << record.to_string();
-                    Sample s = parse.parse_libsvm(record, n_features);
-                    datastore->push_back(s);
-                    ++count;
-                    //if (count > 10000)
-                    //  break;
-                  }
-                  // Notify master that the worker wants to exit
-                  BinStream finish_signal;
-                  finish_signal << worker_host << second_id;
-                  coordinator.notify_master(finish_signal, 300);
-              });
+              // Each reader asks the master for blocks through its own splitter, all under the same task id
+              // so that they share the blocks of the file
+              int task_id = 1;
+              parse_parallel(num_threads,
+                  [&](int i, const std::function<void(boost::string_ref)>& on_record) {
+                    LineInputFormat infmt(url, num_threads, task_id, &coordinator, worker_host, hdfs_namenode,
+                                          hdfs_namenode_port);
+                    boost::string_ref record;
+                    while (infmt.next(record)) {
+                      on_record(record);
+                    }
+                  },
+                  parse, n_features, datastore);
+              // Notify master that the worker wants to exit, once all the readers are done
+              BinStream finish_signal;
+              finish_signal << worker_host << task_id;
+              coordinator.notify_master(finish_signal, 300);
               if(worker_host == master_host)
                 master_thread.join();
+            }
 
-              worker_thread.join();
+            /**
+             * Run <num_threads> readers in parallel, each parsing its records into its own DataStore, and append
+             * them to <datastore> in the order of the readers
+             *
+             * @param read    read(i, on_record) runs the i-th reader, calling on_record for each of its records
+             */
+            template <typename Read, typename Parse>
+            static void parse_parallel(int num_threads, Read read, Parse parse, int n_features, DataStore* datastore) {
+              CHECK_GT(num_threads, 0);
+              std::vector<DataStore> parts(num_threads);
+              std::vector<std::thread> threads;
+              for (int i = 0; i < num_threads; ++i) {
+                threads.push_back(std::thread([i, &read, &parse, n_features, &parts] {
+                    DataStore& part = parts[i];
+                    Sample sample;  // reused by all the records
+                    read(i, [&](boost::string_ref record) {
+                      parse_record(parse, record, n_features, &sample);
+                      part.push_back(sample);
+                    });
+                }));
+              }
+              for (auto& thread : threads) {
+                thread.join();
+              }
+              for (auto& part : parts) {
+                LOG(INFO) << "Reader parsed " << part.size() << " samples";
+                append(datastore, &part);
+              }
+            }
+
+        private:
+            template <typename Parse, typename S>
+            static void parse_record(Parse& parse, boost::string_ref record, int n_features, S* sample) {
+              parse.parse_libsvm(record, n_features, sample);
+            }
+            template <typename Parse>
+            static void parse_record(Parse& parse, boost::string_ref record, int, Rating* rating) {
+              parse.parse_rating(record, rating);
+            }
+
+            template <typename Store>
+            static void append(Store* datastore, Store* part) {
+              for (auto& sample : *part) {
+                datastore->push_back(std::move(sample));
+              }
+            }
+            static void append(CSRDataset* datastore, CSRDataset* part) {
+              datastore->append(*part);
             }
         };  // Class DataLoader
     }  // namespace lib
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace csci5570 {
+namespace lib {
+
+/**
+ * A fixed group of threads of a worker splitting loops over its local data, e.g., the rows of a mini-batch
+ *
+ * The threads are kept between calls, so that a loop costs two synchronizations rather than thread creations.
+ * The caller takes part in each loop as the last thread. Not thread-safe: one worker thread drives the pool.
+ */
+class ThreadPool {
+ public:
+  /**
+   * @param num_threads  the number of threads running a loop, including the caller
+   */
+  explicit ThreadPool(int num_threads) : num_threads_(num_threads) {
+    CHECK_GT(num_threads_, 0);
+    for (int i = 0; i + 1 < num_threads_; ++i) {
+      threads_.push_back(std::thread([this, i] { Main(i); }));
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  int GetNumThreads() const { return num_threads_; }
+
+  /**
+   * Run f(tid, begin, end) for balanced contiguous ranges of [0, n) on all the threads, tid in
+   * [0, GetNumThreads()), and wait for all of them
+   */
+  void ParallelFor(size_t n, const std::function<void(int, size_t, size_t)>& f) {
+    if (num_threads_ == 1) {
+      f(0, 0, n);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      task_ = &f;
+      n_ = n;
+      num_running_ = num_threads_ - 1;
+      round_ += 1;
+    }
+    start_cv_.notify_all();
+    Run(num_threads_ - 1);
+    std::unique_lock<std::mutex> lk(mu_);
+    done_cv_.wait(lk, [this] { return num_running_ == 0; });
+    task_ = nullptr;
+  }
+
+ private:
+  void Main(int tid) {
+    size_t round = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lk(mu_);
+        start_cv_.wait(lk, [this, round] { return stop_ || round_ != round; });
+        if (stop_) {
+          return;
+        }
+        round = round_;
+      }
+      Run(tid);
+      {
+        std::lock_guard<std::mutex> lk(mu_);
+        num_running_ -= 1;
+      }
+      done_cv_.notify_one();
+    }
+  }
+
+  void Run(int tid) {
+    size_t begin = n_ * tid / num_threads_;
+    size_t end = n_ * (tid + 1) / num_threads_;
+    (*task_)(tid, begin, end);
+  }
+
+  const int num_threads_;
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(int, size_t, size_t)>* task_ = nullptr;
+  size_t n_ = 0;
+  size_t round_ = 0;  // the number of loops started
+  int num_running_ = 0;
+  bool stop_ = false;
+};
+
+}  // namespace lib
+}  // namespace csci5570
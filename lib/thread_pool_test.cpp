@@ -0,0 +1,54 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "lib/thread_pool.hpp"
+
+#include <atomic>
+#include <vector>
+
+namespace csci5570 {
+namespace lib {
+namespace {
+
+class TestThreadPool : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+TEST_F(TestThreadPool, ParallelFor) {
+  for (int num_threads : {1, 2, 4}) {
+    ThreadPool pool(num_threads);
+    EXPECT_EQ(pool.GetNumThreads(), num_threads);
+    // every index is visited once, in contiguous ranges, over repeated loops
+    for (size_t n : {0, 1, 3, 100, 1001}) {
+      std::vector<int> visits(n, 0);
+      std::vector<int> tids(num_threads, 0);
+      pool.ParallelFor(n, [&](int tid, size_t begin, size_t end) {
+        tids[tid] += 1;
+        for (size_t i = begin; i < end; ++i) {
+          visits[i] += 1;
+        }
+      });
+      EXPECT_EQ(visits, std::vector<int>(n, 1)) << num_threads << " threads, n " << n;
+      EXPECT_EQ(tids, std::vector<int>(num_threads, 1));
+    }
+  }
+}
+
+TEST_F(TestThreadPool, Sum) {
+  ThreadPool pool(3);
+  std::vector<long> partial(3, 0);
+  for (int round = 0; round < 100; ++round) {
+    pool.ParallelFor(10000, [&](int tid, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        partial[tid] += i;
+      }
+    });
+  }
+  EXPECT_EQ(partial[0] + partial[1] + partial[2], 100L * 10000 * 9999 / 2);
+}
+
+}  // namespace
+}  // namespace lib
+}  // namespace csci5570
@@ -3,6 +3,8 @@
 #include <cinttypes>
 #include "base/message.hpp"
 #include "base/threadsafe_queue.hpp"
+#include "server/abstract_storage.hpp"
+#include "server/util/progress_tracker.hpp"
 
 namespace csci5570 {
 
@@ -12,7 +14,31 @@ class AbstractModel {
   virtual void Add(Message& msg) = 0;
   virtual void Get(Message& msg) = 0;
   virtual int GetProgress(int tid) = 0;
+  /**
+   * Register the worker threads in msg.data[0]. The optional msg.data[1] holds failed worker threads
+   * to drop, so that their progress no longer holds back the others
+   */
   virtual void ResetWorker(Message& msg) = 0;
+  /**
+   * Return the number of requests currently held back by the consistency control
+   */
+  virtual int GetPendingDepth() { return 0; }
+  /**
+   * Return the largest number of requests ever held back at once
+   */
+  virtual int GetMaxPendingDepth() { return 0; }
+  /**
+   * Return the progress of the slowest worker, -1 if the model does not track it
+   */
+  virtual int GetMinClock() { return -1; }
+  /**
+   * Return the storage of the model, nullptr if the model does not expose it
+   */
+  virtual AbstractStorage* GetStorage() { return nullptr; }
+  /**
+   * Return the progresses of the workers, nullptr if the model does not track them
+   */
+  virtual ProgressTracker* GetProgressTracker() { return nullptr; }
   virtual ~AbstractModel() {}
 };
 
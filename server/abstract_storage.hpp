@@ -4,6 +4,12 @@
 
 #include "glog/logging.h"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace csci5570 {
 
 /*
@@ -11,6 +17,8 @@ namespace csci5570 {
  */
 class AbstractStorage {
  public:
+  using DumpFn = std::function<void(third_party::SArray<Key>*, third_party::SArray<char>*)>;
+
   void Add(Message& msg) {
     CHECK(msg.data.size() == 2);
     auto typed_keys = third_party::SArray<Key>(msg.data[0]);
@@ -19,26 +27,128 @@ class AbstractStorage {
   Message Get(Message& msg) {
     CHECK(msg.data.size() == 1);
     auto typed_keys = third_party::SArray<Key>(msg.data[0]);
-    Message reply;
-    reply.meta.recver = msg.meta.sender;
-    reply.meta.sender = msg.meta.recver;
-    reply.meta.flag = msg.meta.flag;
-    reply.meta.model_id = msg.meta.model_id;
+    Message reply = CreateReply(msg);
     third_party::SArray<Key> reply_keys(typed_keys);
     third_party::SArray<char> reply_vals = SubGet(reply_keys);
     reply.AddData<Key>(reply_keys);
     reply.AddData<char>(reply_vals);
     return reply;
   }
+
+  /**
+   * Apply a batch of Add messages as one update, so that each key is written once
+   * no matter how many messages carry it
+   */
+  void AddBatch(const std::vector<Message>& msgs) {
+    if (msgs.empty()) {return;}
+    std::vector<third_party::SArray<Key>> typed_keys;
+    std::vector<third_party::SArray<char>> vals;
+    typed_keys.reserve(msgs.size());
+    vals.reserve(msgs.size());
+    for (const auto& msg : msgs) {
+      CHECK(msg.data.size() == 2);
+      typed_keys.push_back(third_party::SArray<Key>(msg.data[0]));
+      vals.push_back(msg.data[1]);
+    }
+    SubAddBatch(typed_keys, vals);
+  }
+
+  /**
+   * Serve a batch of Get messages from a single read over the union of the requested keys
+   *
+   * @return the replies in the order of msgs
+   */
+  std::vector<Message> GetBatch(const std::vector<Message>& msgs) {
+    std::vector<Message> replies;
+    if (msgs.empty()) {return replies;}
+    std::vector<Key> all_keys;
+    for (const auto& msg : msgs) {
+      CHECK(msg.data.size() == 1);
+      auto typed_keys = third_party::SArray<Key>(msg.data[0]);
+      all_keys.insert(all_keys.end(), typed_keys.begin(), typed_keys.end());
+    }
+    std::sort(all_keys.begin(), all_keys.end());
+    all_keys.erase(std::unique(all_keys.begin(), all_keys.end()), all_keys.end());
+    const third_party::SArray<Key> union_keys(all_keys);
+    third_party::SArray<char> union_vals = SubGet(union_keys);
+    size_t val_size = union_keys.empty() ? 0 : union_vals.size() / union_keys.size();
+
+    replies.reserve(msgs.size());
+    for (const auto& msg : msgs) {
+      auto typed_keys = third_party::SArray<Key>(msg.data[0]);
+      third_party::SArray<char> reply_vals(typed_keys.size() * val_size);
+      // keys of a request are usually sorted, so the lookup resumes where the previous key was found
+      const Key* pos = union_keys.begin();
+      for (size_t i = 0; i < typed_keys.size(); ++i) {
+        if (i > 0 && typed_keys[i] < typed_keys[i - 1]) {
+          pos = union_keys.begin();
+        }
+        pos = std::lower_bound(pos, union_keys.end(), typed_keys[i]);
+        std::memcpy(reply_vals.data() + i * val_size, union_vals.data() + (pos - union_keys.begin()) * val_size,
+                    val_size);
+      }
+      Message reply = CreateReply(msg);
+      reply.AddData<Key>(typed_keys);
+      reply.AddData<char>(reply_vals);
+      replies.push_back(std::move(reply));
+    }
+    return replies;
+  }
   
   // Add the typed_keys and typed_vals to kvstore
   virtual void SubAdd(const third_party::SArray<Key>& typed_keys, 
       const third_party::SArray<char>& vals) = 0;
 
+  // Add several groups of typed_keys and vals to kvstore, subclasses may merge them by key
+  virtual void SubAddBatch(const std::vector<third_party::SArray<Key>>& typed_keys,
+      const std::vector<third_party::SArray<char>>& vals) {
+    CHECK_EQ(typed_keys.size(), vals.size());
+    for (size_t i = 0; i < typed_keys.size(); ++i) {
+      SubAdd(typed_keys[i], vals[i]);
+    }
+  }
+
   // Retrieve the vals according to the typed_keys
   virtual third_party::SArray<char> SubGet(const third_party::SArray<Key>& typed_keys) = 0;
 
+  // Copy the content out sorted by key, later updates do not change the arrays
+  virtual void Dump(third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) = 0;
+
+  // Like Dump, but the copy is made by the returned function, which may run on another thread while the storage
+  // keeps being updated and fills the arrays with the content at the time of this call. By default it dumps now
+  virtual DumpFn DumpLater() {
+    std::shared_ptr<third_party::SArray<Key>> keys(new third_party::SArray<Key>());
+    std::shared_ptr<third_party::SArray<char>> vals(new third_party::SArray<char>());
+    Dump(keys.get(), vals.get());
+    return [keys, vals](third_party::SArray<Key>* typed_keys, third_party::SArray<char>* typed_vals) {
+      *typed_keys = *keys;
+      *typed_vals = *vals;
+    };
+  }
+
+  // Like Dump, but only the entries written since the last Dump or DumpDirty
+  virtual void DumpDirty(third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) = 0;
+
+  // Replace the content with the typed_keys (sorted) and vals
+  virtual void Restore(const third_party::SArray<Key>& typed_keys, const third_party::SArray<char>& vals) = 0;
+
+  // Called by the model at clock boundaries
   virtual void FinishIter() = 0;
+
+  // The number of threads that may serve Gets concurrently with the server thread, 0 if SubGet is not thread-safe
+  virtual int GetNumReaders() const { return 0; }
+
+  virtual ~AbstractStorage() {}
+
+ private:
+  Message CreateReply(const Message& msg) {
+    Message reply;
+    reply.meta.recver = msg.meta.sender;
+    reply.meta.sender = msg.meta.recver;
+    reply.meta.flag = msg.meta.flag;
+    reply.meta.model_id = msg.meta.model_id;
+    return reply;
+  }
 };
 
 }  // namespace csci5570
@@ -8,11 +8,16 @@ ASPModel::ASPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage
   model_id_ = model_id;
   storage_ = std::move(storage_ptr);
   reply_queue_ = reply_queue;
+  if (storage_->GetNumReaders() > 0) {
+    reader_pool_.reset(new ReaderPool(storage_.get(), reply_queue_, storage_->GetNumReaders()));
+  }
 }
 
 void ASPModel::Clock(Message& msg) {
   if (msg.meta.model_id != model_id_) {return;}
   progress_tracker_.AdvanceAndGetChangedMinClock(msg.meta.sender);
+  // there is no global clock boundary, publish the updates on every clock
+  storage_->FinishIter();
 }
 
 void ASPModel::Add(Message& msg) {
@@ -22,19 +27,49 @@ void ASPModel::Add(Message& msg) {
 
 void ASPModel::Get(Message& msg) {
   if (msg.meta.model_id != model_id_) {return;}
-  Message reply_msg = storage_->Get(msg);
-  reply_queue_->Push(reply_msg);
+  ServeGet(msg);
+}
+
+void ASPModel::ServeGet(Message& msg) {
+  if (reader_pool_) {
+    reader_pool_->Serve(std::move(msg));
+  } else {
+    Message reply_msg = storage_->Get(msg);
+    reply_queue_->Push(std::move(reply_msg));
+  }
 }
 
 int ASPModel::GetProgress(int tid) {
   return progress_tracker_.GetProgress(tid);
 }
 
+int ASPModel::GetMinClock() {
+  return progress_tracker_.GetMinClock();
+}
+
+AbstractStorage* ASPModel::GetStorage() {
+  return storage_.get();
+}
+
+ProgressTracker* ASPModel::GetProgressTracker() {
+  return &progress_tracker_;
+}
+
+void ASPModel::RemoveWorkers(const third_party::SArray<uint32_t>& tids) {
+  // nothing waits for the progress of others
+  for (uint32_t tid : tids) {
+    progress_tracker_.RemoveThread(tid);
+  }
+}
+
 void ASPModel::ResetWorker(Message& msg) {
   std::vector<uint32_t> tids;
   auto msg_data = third_party::SArray<uint32_t>(msg.data[0]);
   for (uint32_t tid : msg_data) {tids.push_back(tid);}
   progress_tracker_.Init(tids);
+  if (msg.data.size() > 1) {
+    RemoveWorkers(third_party::SArray<uint32_t>(msg.data[1]));
+  }
   Message response;
   response.meta.sender = msg.meta.recver;
   response.meta.recver = msg.meta.sender;
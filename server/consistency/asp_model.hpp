@@ -8,6 +8,7 @@
 #include "server/abstract_storage.hpp"
 #include "server/util/pending_buffer.hpp"
 #include "server/util/progress_tracker.hpp"
+#include "server/util/reader_pool.hpp"
 
 namespace csci5570 {
 
@@ -24,13 +25,22 @@ class ASPModel : public AbstractModel {
   virtual void Get(Message& msg) override;
   virtual int GetProgress(int tid) override;
   virtual void ResetWorker(Message& msg) override;
+  virtual int GetMinClock() override;
+  virtual AbstractStorage* GetStorage() override;
+  virtual ProgressTracker* GetProgressTracker() override;
 
  private:
+  // Drop failed workers and release the requests held back by them
+  void RemoveWorkers(const third_party::SArray<uint32_t>& tids);
+  // Answer a Get request, on the reader threads if the storage supports concurrent reads
+  void ServeGet(Message& msg);
+
   uint32_t model_id_;
 
   ThreadsafeQueue<Message>* reply_queue_;     // not owned, the queue where reply messages are put
   std::unique_ptr<AbstractStorage> storage_;  // actual storage
   ProgressTracker progress_tracker_;          // the progresses of all worker threads interacting with the model
+  std::unique_ptr<ReaderPool> reader_pool_;   // destroyed before storage_
 };
 
 }  // namespace csci5570
@@ -1,6 +1,8 @@
 #include "server/consistency/bsp_model.hpp"
 #include "glog/logging.h"
 
+#include <algorithm>
+
 namespace csci5570 {
 
 BSPModel::BSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr,
@@ -8,6 +10,9 @@ BSPModel::BSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage
   model_id_ = model_id;
   storage_ = std::move(storage_ptr);
   reply_queue_ = reply_queue;
+  if (storage_->GetNumReaders() > 0) {
+    reader_pool_.reset(new ReaderPool(storage_.get(), reply_queue_, storage_->GetNumReaders()));
+  }
 }
 
 void BSPModel::Clock(Message& msg) {
@@ -16,24 +21,45 @@ void BSPModel::Clock(Message& msg) {
   if (min_clock <= -1) {
     return;
   }
-  // do update first
-  for (auto& m : add_buffer_) {
-    storage_->Add(m);
-  }
+  FinishClock();
+}
+
+void BSPModel::FinishClock() {
+  // do update first, buffered updates are merged by key and applied at once
+  storage_->AddBatch(add_buffer_);
   add_buffer_.clear();
-  // get message for next iter
-  for (auto& m : get_buffer_) {
-    storage_->Get(m);
+  storage_->FinishIter();
+  // get message for next iter, served from one read of the requested keys
+  for (auto& reply_msg : storage_->GetBatch(get_buffer_)) {
+    reply_queue_->Push(std::move(reply_msg));
   }
   get_buffer_.clear();
 }
 
+void BSPModel::RemoveWorkers(const third_party::SArray<uint32_t>& tids) {
+  int old_min_clock = progress_tracker_.GetMinClock();
+  for (uint32_t tid : tids) {
+    progress_tracker_.RemoveThread(tid);
+  }
+  // nobody waits for the replies to the removed workers
+  get_buffer_.erase(std::remove_if(get_buffer_.begin(), get_buffer_.end(),
+                                   [this](const Message& m) {
+                                     return !progress_tracker_.CheckThreadValid(m.meta.sender);
+                                   }),
+                    get_buffer_.end());
+  if (progress_tracker_.GetMinClock() != old_min_clock) {
+    LOG(INFO) << "model " << model_id_ << " removed " << tids.size() << " workers, min clock " << old_min_clock
+              << " -> " << progress_tracker_.GetMinClock();
+    FinishClock();
+  }
+}
+
 void BSPModel::Add(Message& msg) {
   if (msg.meta.model_id != model_id_) {return;}
   // NOTICE: can only push Add-Message in current iter, will ignore other messages
   // Updating will be executed in BSPModel::Clock() when all worker advance one step
   if (progress_tracker_.GetProgress(msg.meta.sender) == progress_tracker_.GetMinClock()) {
-    add_buffer_.push_back(msg);
+    add_buffer_.push_back(std::move(msg));
   }
 }
 
@@ -42,10 +68,18 @@ void BSPModel::Get(Message& msg) {
   uint32_t tid = msg.meta.sender;
   // can only read after all updated
   if (progress_tracker_.GetProgress(tid) > progress_tracker_.GetMinClock()) {
-    get_buffer_.push_back(msg);
+    get_buffer_.push_back(std::move(msg));
+  } else {
+    ServeGet(msg);
+  }
+}
+
+void BSPModel::ServeGet(Message& msg) {
+  if (reader_pool_) {
+    reader_pool_->Serve(std::move(msg));
   } else {
     Message reply_msg = storage_->Get(msg);
-    reply_queue_->Push(reply_msg);
+    reply_queue_->Push(std::move(reply_msg));
   }
 }
 
@@ -61,11 +95,26 @@ int BSPModel::GetAddPendingSize() {
   return add_buffer_.size();
 }
 
+int BSPModel::GetMinClock() {
+  return progress_tracker_.GetMinClock();
+}
+
+AbstractStorage* BSPModel::GetStorage() {
+  return storage_.get();
+}
+
+ProgressTracker* BSPModel::GetProgressTracker() {
+  return &progress_tracker_;
+}
+
 void BSPModel::ResetWorker(Message& msg) {
   std::vector<uint32_t> tids;
   auto msg_data = third_party::SArray<uint32_t>(msg.data[0]);
   for (uint32_t tid : msg_data) {tids.push_back(tid);}
   progress_tracker_.Init(tids);
+  if (msg.data.size() > 1) {
+    RemoveWorkers(third_party::SArray<uint32_t>(msg.data[1]));
+  }
   Message response;
   response.meta.sender = msg.meta.recver;
   response.meta.recver = msg.meta.sender;
@@ -5,6 +5,7 @@
 #include "server/abstract_storage.hpp"
 #include "server/util/pending_buffer.hpp"
 #include "server/util/progress_tracker.hpp"
+#include "server/util/reader_pool.hpp"
 
 #include <map>
 #include <vector>
@@ -24,11 +25,21 @@ class BSPModel : public AbstractModel {
   virtual void Get(Message& msg) override;
   virtual int GetProgress(int tid) override;
   virtual void ResetWorker(Message& msg) override;
+  virtual int GetMinClock() override;
+  virtual AbstractStorage* GetStorage() override;
+  virtual ProgressTracker* GetProgressTracker() override;
 
   int GetGetPendingSize();
   int GetAddPendingSize();
 
  private:
+  // Apply the buffered updates and serve the buffered Gets once all workers finished the clock
+  void FinishClock();
+  // Drop failed workers and release the requests held back by them
+  void RemoveWorkers(const third_party::SArray<uint32_t>& tids);
+  // Answer a Get request, on the reader threads if the storage supports concurrent reads
+  void ServeGet(Message& msg);
+
   uint32_t model_id_;
 
   ThreadsafeQueue<Message>* reply_queue_;
@@ -36,6 +47,7 @@ class BSPModel : public AbstractModel {
   ProgressTracker progress_tracker_;
   std::vector<Message> get_buffer_;  // buffer of get requests
   std::vector<Message> add_buffer_;  // buffer of add requests
+  std::unique_ptr<ReaderPool> reader_pool_;  // destroyed before storage_
 };
 
 }  // namespace csci5570
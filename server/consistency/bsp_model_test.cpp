@@ -129,5 +129,115 @@ TEST_F(TestBSPModel, CheckGetAndAdd) {
   EXPECT_EQ(rep_vals2[0], 100);
 }
 
+TEST_F(TestBSPModel, CheckBufferedGet) {
+  ThreadsafeQueue<Message> reply_queue;
+  int model_id = 0;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new BSPModel(model_id, std::move(storage), &reply_queue));
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reset_reply_msg;
+  reply_queue.WaitAndPop(&reset_reply_msg);
+
+  // both workers push updates to overlapping keys in iteration 0
+  for (int tid : {2, 3}) {
+    Message m;
+    m.meta.flag = Flag::kAdd;
+    m.meta.model_id = 0;
+    m.meta.sender = tid;
+    m.meta.recver = 0;
+    third_party::SArray<Key> keys({1, 2});
+    third_party::SArray<int> vals({tid, 10 * tid});
+    m.AddData(keys);
+    m.AddData(vals);
+    model->Add(m);
+  }
+
+  // worker 2 finishes the iteration and asks for the parameters of the next one
+  Message clock2;
+  clock2.meta.flag = Flag::kClock;
+  clock2.meta.model_id = 0;
+  clock2.meta.sender = 2;
+  clock2.meta.recver = 0;
+  model->Clock(clock2);
+
+  Message get2;
+  get2.meta.flag = Flag::kGet;
+  get2.meta.model_id = 0;
+  get2.meta.sender = 2;
+  get2.meta.recver = 0;
+  third_party::SArray<Key> get_keys({2});
+  get2.AddData(get_keys);
+  model->Get(get2);
+  EXPECT_EQ(reply_queue.Size(), 0);
+  EXPECT_EQ(dynamic_cast<BSPModel*>(model.get())->GetGetPendingSize(), 1);
+
+  // the buffered Get is answered once all updates of iteration 0 are applied
+  Message clock3;
+  clock3.meta.flag = Flag::kClock;
+  clock3.meta.model_id = 0;
+  clock3.meta.sender = 3;
+  clock3.meta.recver = 0;
+  model->Clock(clock3);
+  EXPECT_EQ(dynamic_cast<BSPModel*>(model.get())->GetGetPendingSize(), 0);
+
+  Message check_msg;
+  ASSERT_EQ(reply_queue.Size(), 1);
+  reply_queue.WaitAndPop(&check_msg);
+  EXPECT_EQ(check_msg.meta.recver, 2);
+  EXPECT_EQ(check_msg.meta.flag, Flag::kGet);
+  auto rep_keys = third_party::SArray<Key>(check_msg.data[0]);
+  auto rep_vals = third_party::SArray<int>(check_msg.data[1]);
+  ASSERT_EQ(rep_vals.size(), 1);
+  EXPECT_EQ(rep_keys[0], 2);
+  EXPECT_EQ(rep_vals[0], 50);
+}
+
+TEST_F(TestBSPModel, CheckRemoveWorkers) {
+  ThreadsafeQueue<Message> reply_queue;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new BSPModel(0, std::move(storage), &reply_queue));
+  Message reset_msg;
+  reset_msg.AddData(third_party::SArray<uint32_t>({2, 3}));
+  model->ResetWorker(reset_msg);
+  Message reply;
+  reply_queue.WaitAndPop(&reply);
+
+  // worker 3 finishes iteration 0 and waits for worker 2, which fails
+  Message add_msg;
+  add_msg.meta.flag = Flag::kAdd;
+  add_msg.meta.model_id = 0;
+  add_msg.meta.sender = 3;
+  add_msg.AddData(third_party::SArray<Key>({1}));
+  add_msg.AddData(third_party::SArray<int>({5}));
+  model->Add(add_msg);
+  Message clock_msg;
+  clock_msg.meta.flag = Flag::kClock;
+  clock_msg.meta.model_id = 0;
+  clock_msg.meta.sender = 3;
+  model->Clock(clock_msg);
+  Message get_msg;
+  get_msg.meta.flag = Flag::kGet;
+  get_msg.meta.model_id = 0;
+  get_msg.meta.sender = 3;
+  get_msg.AddData(third_party::SArray<Key>({1}));
+  model->Get(get_msg);
+  EXPECT_EQ(reply_queue.Size(), 0);
+
+  Message remove_msg;
+  remove_msg.AddData(third_party::SArray<uint32_t>());
+  remove_msg.AddData(third_party::SArray<uint32_t>({2}));
+  model->ResetWorker(remove_msg);
+  EXPECT_EQ(model->GetMinClock(), 1);
+  ASSERT_EQ(reply_queue.Size(), 2);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(reply.meta.flag, Flag::kGet);
+  EXPECT_EQ(third_party::SArray<int>(reply.data[1])[0], 5);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(reply.meta.flag, Flag::kResetWorkerInModel);
+}
+
 }  // namespace
 }  // namespace csci5570
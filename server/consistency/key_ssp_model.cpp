@@ -0,0 +1,210 @@
+#include "server/consistency/key_ssp_model.hpp"
+#include "glog/logging.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace csci5570 {
+
+KeySSPModel::KeySSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr, int staleness,
+                         ThreadsafeQueue<Message>* reply_queue, uint32_t key_range_size) {
+  CHECK_GT(key_range_size, 0);
+  model_id_ = model_id;
+  storage_ = std::move(storage_ptr);
+  staleness_ = staleness;
+  key_range_size_ = key_range_size;
+  reply_queue_ = reply_queue;
+  if (storage_->GetNumReaders() > 0) {
+    reader_pool_.reset(new ReaderPool(storage_.get(), reply_queue_, storage_->GetNumReaders()));
+  }
+}
+
+void KeySSPModel::Clock(Message& msg) {
+  if (msg.meta.model_id != model_id_) {return;}
+  int tid = msg.meta.sender;
+  // a late clock of a removed worker, it is no longer tracked
+  if (!progress_tracker_.CheckThreadValid(tid)) {return;}
+  int progress = progress_tracker_.GetProgress(tid);
+  progress_tracker_.AdvanceAndGetChangedMinClock(tid);
+  clocks_.erase(std::make_pair(progress, tid));
+  clocks_.insert(std::make_pair(progress + 1, tid));
+  first_clock_.erase(tid);
+  // Gets are released by single workers rather than by the min clock, publish on every clock
+  storage_->FinishIter();
+  auto it = waiting_on_.find(tid);
+  if (it == waiting_on_.end()) {
+    return;
+  }
+  std::vector<Message> pending_msgs;
+  pending_msgs.swap(it->second);
+  waiting_on_.erase(it);
+  pending_depth_ -= pending_msgs.size();
+  // the requests may still wait for another writer
+  for (Message& m : pending_msgs) {
+    Get(m);
+  }
+}
+
+void KeySSPModel::Add(Message& msg) {
+  if (msg.meta.model_id != model_id_) {return;}
+  int tid = msg.meta.sender;
+  // the updates of a removed worker are kept, but it writes no range anyone should wait for
+  if (!progress_tracker_.CheckThreadValid(tid)) {
+    storage_->Add(msg);
+    return;
+  }
+  auto typed_keys = third_party::SArray<Key>(msg.data[0]);
+  auto& ranges = writer_ranges_[tid];
+  bool has_last_range = false;
+  uint32_t last_range = 0;
+  for (Key key : typed_keys) {
+    uint32_t range = key / key_range_size_;
+    if (has_last_range && range == last_range) {continue;}
+    has_last_range = true;
+    last_range = range;
+    ranges.insert(range);
+  }
+  storage_->Add(msg);
+}
+
+void KeySSPModel::Get(Message& msg) {
+  if (msg.meta.model_id != model_id_) {return;}
+  int tid = msg.meta.sender;
+  int worker_progress = progress_tracker_.GetProgress(tid);
+  // fast path, no worker at all is too stale
+  if (worker_progress - progress_tracker_.GetMinClock() <= staleness_) {
+    ServeGet(msg);
+    return;
+  }
+  int stale_writer = FindStaleWriter(third_party::SArray<Key>(msg.data[0]), tid, worker_progress);
+  if (stale_writer == -1) {
+    ServeGet(msg);
+  } else {
+    // wait for the stale writer
+    waiting_on_[stale_writer].push_back(std::move(msg));
+    pending_depth_ += 1;
+    max_pending_depth_ = std::max(max_pending_depth_, pending_depth_);
+  }
+}
+
+int KeySSPModel::FindStaleWriter(const third_party::SArray<Key>& keys, int reader, int progress) {
+  std::vector<uint32_t> ranges;
+  for (Key key : keys) {
+    uint32_t range = key / key_range_size_;
+    if (ranges.empty() || range != ranges.back()) {
+      ranges.push_back(range);
+    }
+  }
+  // only the workers more than <staleness> clocks behind, the most stale first
+  for (auto it = clocks_.begin(); it != clocks_.end() && progress - it->first > staleness_; ++it) {
+    int writer = it->second;
+    if (writer == reader) {continue;}
+    if (first_clock_.count(writer) > 0) {return writer;}
+    auto writer_it = writer_ranges_.find(writer);
+    if (writer_it == writer_ranges_.end()) {continue;}
+    for (uint32_t range : ranges) {
+      if (writer_it->second.count(range) > 0) {return writer;}
+    }
+  }
+  return -1;
+}
+
+void KeySSPModel::IndexClocks() {
+  clocks_.clear();
+  for (const auto& kv : progress_tracker_.GetProgresses()) {
+    clocks_.insert(std::make_pair(kv.second, static_cast<int>(kv.first)));
+  }
+}
+
+void KeySSPModel::ServeGet(Message& msg) {
+  if (reader_pool_) {
+    reader_pool_->Serve(std::move(msg));
+  } else {
+    Message reply_msg = storage_->Get(msg);
+    reply_queue_->Push(std::move(reply_msg));
+  }
+}
+
+int KeySSPModel::GetProgress(int tid) {
+  return progress_tracker_.GetProgress(tid);
+}
+
+int KeySSPModel::GetPendingSize(int tid) {
+  auto it = waiting_on_.find(tid);
+  if (it == waiting_on_.end()) {return 0;}
+  return it->second.size();
+}
+
+int KeySSPModel::GetPendingDepth() {
+  return pending_depth_;
+}
+
+int KeySSPModel::GetMaxPendingDepth() {
+  return max_pending_depth_;
+}
+
+int KeySSPModel::GetMinClock() {
+  return progress_tracker_.GetMinClock();
+}
+
+AbstractStorage* KeySSPModel::GetStorage() {
+  return storage_.get();
+}
+
+ProgressTracker* KeySSPModel::GetProgressTracker() {
+  return &progress_tracker_;
+}
+
+void KeySSPModel::RemoveWorkers(const third_party::SArray<uint32_t>& tids) {
+  std::vector<Message> released;
+  for (uint32_t tid : tids) {
+    progress_tracker_.RemoveThread(tid);
+    writer_ranges_.erase(tid);
+    first_clock_.erase(tid);
+    // a removed writer no longer counts as stale, see FindStaleWriter
+    auto it = waiting_on_.find(tid);
+    if (it != waiting_on_.end()) {
+      pending_depth_ -= it->second.size();
+      std::move(it->second.begin(), it->second.end(), std::back_inserter(released));
+      waiting_on_.erase(it);
+    }
+  }
+  // nobody waits for the replies to the removed workers
+  for (auto& kv : waiting_on_) {
+    auto& msgs = kv.second;
+    auto end = std::remove_if(msgs.begin(), msgs.end(), [this](const Message& m) {
+      return !progress_tracker_.CheckThreadValid(m.meta.sender);
+    });
+    pending_depth_ -= msgs.end() - end;
+    msgs.erase(end, msgs.end());
+  }
+  IndexClocks();
+  for (Message& m : released) {
+    if (progress_tracker_.CheckThreadValid(m.meta.sender)) {
+      Get(m);
+    }
+  }
+}
+
+void KeySSPModel::ResetWorker(Message& msg) {
+  std::vector<uint32_t> tids;
+  auto msg_data = third_party::SArray<uint32_t>(msg.data[0]);
+  for (uint32_t tid : msg_data) {tids.push_back(tid);}
+  progress_tracker_.Init(tids);
+  // the ranges of the workers are learned again from their first clock
+  for (uint32_t tid : tids) {
+    writer_ranges_.erase(tid);
+    first_clock_.insert(tid);
+  }
+  IndexClocks();
+  if (msg.data.size() > 1) {
+    RemoveWorkers(third_party::SArray<uint32_t>(msg.data[1]));
+  }
+  Message response;
+  response.meta.sender = msg.meta.recver;
+  response.meta.recver = msg.meta.sender;
+  response.meta.flag = Flag::kResetWorkerInModel;
+  reply_queue_->Push(response);
+}
+
+}  // namespace csci5570
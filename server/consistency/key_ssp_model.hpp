@@ -0,0 +1,82 @@
+#pragma once
+
+#include "server/abstract_model.hpp"
+
+#include "base/message.hpp"
+#include "base/threadsafe_queue.hpp"
+#include "server/abstract_storage.hpp"
+#include "server/util/progress_tracker.hpp"
+#include "server/util/reader_pool.hpp"
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * A wrapper for model with per-key Stale Synchronous Parallel consistency
+ *
+ * Keys are grouped into ranges of key_range_size consecutive keys, and each worker remembers the
+ * ranges it has updated. A range is up to date up to the min progress of its writers, so a Get
+ * only waits if one of the requested ranges has a writer more than <staleness> clocks behind the
+ * reader. Slow workers updating disjoint keys do not block each other.
+ * Until its first clock, a worker counts as a writer of every range, as its updates are not known yet;
+ * afterwards it is assumed to keep updating the ranges of its Adds so far.
+ */
+class KeySSPModel : public AbstractModel {
+ public:
+  explicit KeySSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr, int staleness,
+                       ThreadsafeQueue<Message>* reply_queue, uint32_t key_range_size = kDefaultKeyRangeSize);
+
+  virtual void Clock(Message& msg) override;
+  virtual void Add(Message& msg) override;
+  virtual void Get(Message& msg) override;
+  virtual int GetProgress(int tid) override;
+  virtual void ResetWorker(Message& msg) override;
+  virtual int GetMinClock() override;
+  virtual AbstractStorage* GetStorage() override;
+  virtual ProgressTracker* GetProgressTracker() override;
+  virtual int GetPendingDepth() override;
+  virtual int GetMaxPendingDepth() override;
+
+  /**
+   * Return the number of requests waiting for a worker thread to advance
+   *
+   * @param tid   worker thread id
+   */
+  int GetPendingSize(int tid);
+
+  static const uint32_t kDefaultKeyRangeSize = 64;
+
+ private:
+  /**
+   * Return the writer that is too stale for a reader at the given progress, -1 if all requested keys are fresh
+   */
+  int FindStaleWriter(const third_party::SArray<Key>& keys, int reader, int progress);
+  // Index the workers by their progress, after a reset or a removal
+  void IndexClocks();
+  // Drop failed workers and release the requests held back by them
+  void RemoveWorkers(const third_party::SArray<uint32_t>& tids);
+  // Answer a Get request, on the reader threads if the storage supports concurrent reads
+  void ServeGet(Message& msg);
+
+  uint32_t model_id_;
+  int staleness_;
+  uint32_t key_range_size_;
+
+  ThreadsafeQueue<Message>* reply_queue_;
+  std::unique_ptr<AbstractStorage> storage_;
+  ProgressTracker progress_tracker_;
+  std::unordered_map<int, std::unordered_set<uint32_t>> writer_ranges_;  // {writer tid: key ranges it updated}
+  std::unordered_set<int> first_clock_;     // the workers yet to finish their first clock, writers of every range
+  std::set<std::pair<int, int>> clocks_;    // {(progress, tid)} of the workers, the most stale first
+  std::unordered_map<int, std::vector<Message>> waiting_on_;  // {writer tid: Gets waiting for it}
+  int pending_depth_ = 0;
+  int max_pending_depth_ = 0;
+  std::unique_ptr<ReaderPool> reader_pool_;  // destroyed before storage_
+};
+
+}  // namespace csci5570
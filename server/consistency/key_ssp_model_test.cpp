@@ -0,0 +1,239 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "base/threadsafe_queue.hpp"
+#include "server/consistency/key_ssp_model.hpp"
+#include "server/map_storage.hpp"
+
+namespace csci5570 {
+namespace {
+
+class TestKeySSPModel : public testing::Test {
+ public:
+  TestKeySSPModel() {}
+  ~TestKeySSPModel() {}
+
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+
+  Message MakeMsg(Flag flag, int sender, const std::vector<Key>& keys) {
+    Message m;
+    m.meta.flag = flag;
+    m.meta.model_id = 0;
+    m.meta.sender = sender;
+    m.meta.recver = 0;
+    if (flag == Flag::kAdd || flag == Flag::kGet) {
+      m.AddData(third_party::SArray<Key>(keys));
+    }
+    if (flag == Flag::kAdd) {
+      m.AddData(third_party::SArray<int>(keys.size(), 1));
+    }
+    return m;
+  }
+};
+
+TEST_F(TestKeySSPModel, CheckConstructor) {
+  ThreadsafeQueue<Message> reply_queue;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new KeySSPModel(0, std::move(storage), 1, &reply_queue));
+}
+
+TEST_F(TestKeySSPModel, DisjointKeysDoNotBlock) {
+  ThreadsafeQueue<Message> reply_queue;
+  int staleness = 1;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new KeySSPModel(0, std::move(storage), staleness, &reply_queue, 10));
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reset_reply_msg;
+  reply_queue.WaitAndPop(&reset_reply_msg);
+
+  // worker 2 owns keys [0, 10), worker 3 owns keys [100, 110)
+  Message add2 = MakeMsg(Flag::kAdd, 2, {1, 2});
+  model->Add(add2);
+  Message add3 = MakeMsg(Flag::kAdd, 3, {100});
+  model->Add(add3);
+  Message first_clock3 = MakeMsg(Flag::kClock, 3, {});
+  model->Clock(first_clock3);
+
+  // worker 2 runs 3 clocks ahead of worker 3
+  for (int i = 0; i < 4; ++i) {
+    Message clock = MakeMsg(Flag::kClock, 2, {});
+    model->Clock(clock);
+  }
+  EXPECT_EQ(model->GetProgress(2), 4);
+  EXPECT_EQ(model->GetProgress(3), 1);
+
+  // its own keys are fresh
+  Message get_own = MakeMsg(Flag::kGet, 2, {1, 5});
+  model->Get(get_own);
+  EXPECT_EQ(reply_queue.Size(), 1);
+  Message reply;
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(third_party::SArray<int>(reply.data[1])[0], 1);
+
+  // keys never written by anyone are fresh
+  Message get_unknown = MakeMsg(Flag::kGet, 2, {50});
+  model->Get(get_unknown);
+  EXPECT_EQ(reply_queue.Size(), 1);
+  reply_queue.WaitAndPop(&reply);
+
+  // keys written by the slow worker wait for it
+  Message get_slow = MakeMsg(Flag::kGet, 2, {1, 105});
+  model->Get(get_slow);
+  EXPECT_EQ(reply_queue.Size(), 0);
+  EXPECT_EQ(dynamic_cast<KeySSPModel*>(model.get())->GetPendingSize(3), 1);
+  EXPECT_EQ(model->GetPendingDepth(), 1);
+
+  Message clock3 = MakeMsg(Flag::kClock, 3, {});
+  model->Clock(clock3);  // [4, 2]
+  EXPECT_EQ(reply_queue.Size(), 0);
+  model->Clock(clock3);  // [4, 3]
+  ASSERT_EQ(reply_queue.Size(), 1);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(reply.meta.recver, 2);
+  auto rep_keys = third_party::SArray<Key>(reply.data[0]);
+  auto rep_vals = third_party::SArray<int>(reply.data[1]);
+  ASSERT_EQ(rep_vals.size(), 2);
+  EXPECT_EQ(rep_keys[1], 105);
+  EXPECT_EQ(rep_vals[0], 1);
+  EXPECT_EQ(model->GetPendingDepth(), 0);
+  EXPECT_EQ(model->GetMaxPendingDepth(), 1);
+}
+
+TEST_F(TestKeySSPModel, WriterOfEveryRangeUntilFirstClock) {
+  ThreadsafeQueue<Message> reply_queue;
+  int staleness = 0;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new KeySSPModel(0, std::move(storage), staleness, &reply_queue, 10));
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3, 4});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reset_reply_msg;
+  reply_queue.WaitAndPop(&reset_reply_msg);
+
+  // worker 3 has sent no Add yet, it may still update any key
+  Message clock2 = MakeMsg(Flag::kClock, 2, {});
+  model->Clock(clock2);
+  Message add4 = MakeMsg(Flag::kAdd, 4, {50});
+  model->Add(add4);
+  Message clock4 = MakeMsg(Flag::kClock, 4, {});
+  model->Clock(clock4);
+  Message get = MakeMsg(Flag::kGet, 2, {1});
+  model->Get(get);
+  EXPECT_EQ(reply_queue.Size(), 0);
+  EXPECT_EQ(dynamic_cast<KeySSPModel*>(model.get())->GetPendingSize(3), 1);
+
+  // once clocked, it only writes the ranges of its Adds
+  Message add3 = MakeMsg(Flag::kAdd, 3, {100});
+  model->Add(add3);
+  Message clock3 = MakeMsg(Flag::kClock, 3, {});
+  model->Clock(clock3);
+  ASSERT_EQ(reply_queue.Size(), 1);
+  Message reply;
+  reply_queue.WaitAndPop(&reply);
+  model->Clock(clock2);
+  model->Clock(clock4);
+  Message get_fresh = MakeMsg(Flag::kGet, 2, {1, 50});
+  model->Get(get_fresh);
+  EXPECT_EQ(reply_queue.Size(), 1);
+  reply_queue.WaitAndPop(&reply);
+  Message get_stale = MakeMsg(Flag::kGet, 2, {105});
+  model->Get(get_stale);
+  EXPECT_EQ(reply_queue.Size(), 0);
+  EXPECT_EQ(dynamic_cast<KeySSPModel*>(model.get())->GetPendingSize(3), 1);
+
+  // a removed writer no longer holds back the reads
+  Message remove_msg;
+  remove_msg.AddData(third_party::SArray<uint32_t>());
+  remove_msg.AddData(third_party::SArray<uint32_t>({3}));
+  model->ResetWorker(remove_msg);
+  ASSERT_EQ(reply_queue.Size(), 2);
+}
+
+TEST_F(TestKeySSPModel, LateMessagesOfRemovedWorker) {
+  ThreadsafeQueue<Message> reply_queue;
+  int staleness = 0;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new KeySSPModel(0, std::move(storage), staleness, &reply_queue, 10));
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3, 4});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reply;
+  reply_queue.WaitAndPop(&reply);
+  Message add4 = MakeMsg(Flag::kAdd, 4, {50});
+  model->Add(add4);
+  Message clock4 = MakeMsg(Flag::kClock, 4, {});
+  model->Clock(clock4);
+  Message remove_msg;
+  remove_msg.AddData(third_party::SArray<uint32_t>());
+  remove_msg.AddData(third_party::SArray<uint32_t>({3}));
+  model->ResetWorker(remove_msg);
+  reply_queue.WaitAndPop(&reply);
+
+  // worker 3 was alive but too slow, its messages still arrive
+  Message add3 = MakeMsg(Flag::kAdd, 3, {100});
+  model->Add(add3);
+  Message clock3 = MakeMsg(Flag::kClock, 3, {});
+  model->Clock(clock3);
+  EXPECT_EQ(model->GetProgress(3), -1);
+
+  // worker 4 keeps the min clock behind, worker 3 holds back no Get of the others
+  Message clock2 = MakeMsg(Flag::kClock, 2, {});
+  model->Clock(clock2);
+  model->Clock(clock2);
+  Message get = MakeMsg(Flag::kGet, 2, {100});
+  model->Get(get);
+  ASSERT_EQ(reply_queue.Size(), 1);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(third_party::SArray<int>(reply.data[1])[0], 1);
+  EXPECT_EQ(dynamic_cast<KeySSPModel*>(model.get())->GetPendingSize(3), 0);
+}
+
+TEST_F(TestKeySSPModel, WaitForSeveralWriters) {
+  ThreadsafeQueue<Message> reply_queue;
+  int staleness = 0;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new KeySSPModel(0, std::move(storage), staleness, &reply_queue, 1));
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3, 4});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reset_reply_msg;
+  reply_queue.WaitAndPop(&reset_reply_msg);
+
+  Message add3 = MakeMsg(Flag::kAdd, 3, {7});
+  model->Add(add3);
+  Message add4 = MakeMsg(Flag::kAdd, 4, {8});
+  model->Add(add4);
+  Message clock2 = MakeMsg(Flag::kClock, 2, {});
+  model->Clock(clock2);
+
+  Message get = MakeMsg(Flag::kGet, 2, {7, 8});
+  model->Get(get);
+  EXPECT_EQ(reply_queue.Size(), 0);
+
+  // released by worker 3, then parked again on worker 4
+  Message clock3 = MakeMsg(Flag::kClock, 3, {});
+  model->Clock(clock3);
+  EXPECT_EQ(reply_queue.Size(), 0);
+  EXPECT_EQ(dynamic_cast<KeySSPModel*>(model.get())->GetPendingSize(4), 1);
+
+  Message clock4 = MakeMsg(Flag::kClock, 4, {});
+  model->Clock(clock4);
+  ASSERT_EQ(reply_queue.Size(), 1);
+  Message reply;
+  reply_queue.WaitAndPop(&reply);
+  auto rep_vals = third_party::SArray<int>(reply.data[1]);
+  ASSERT_EQ(rep_vals.size(), 2);
+  EXPECT_EQ(rep_vals[0], 1);
+  EXPECT_EQ(rep_vals[1], 1);
+}
+
+}  // namespace
+}  // namespace csci5570
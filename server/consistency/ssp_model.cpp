@@ -4,31 +4,77 @@
 namespace csci5570 {
 
 SSPModel::SSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr, int staleness,
-                   ThreadsafeQueue<Message>* reply_queue) {
+                   ThreadsafeQueue<Message>* reply_queue)
+    : buffer_(staleness + 2) {
   model_id_ = model_id;
   storage_ = std::move(storage_ptr);
   staleness_ = staleness;
   reply_queue_ = reply_queue;
+  if (storage_->GetNumReaders() > 0) {
+    reader_pool_.reset(new ReaderPool(storage_.get(), reply_queue_, storage_->GetNumReaders()));
+  }
+}
+
+SSPModel::SSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr, int min_staleness,
+                   int max_staleness, ThreadsafeQueue<Message>* reply_queue)
+    : SSPModel(model_id, std::move(storage_ptr), max_staleness, reply_queue) {
+  staleness_controller_.reset(new StalenessController(min_staleness, max_staleness));
+  staleness_ = staleness_controller_->GetStaleness();
 }
 
 void SSPModel::Clock(Message& msg) {
   if (msg.meta.model_id != model_id_) {return;}
+  if (staleness_controller_) {
+    staleness_controller_->OnClock(msg.meta.sender, std::chrono::steady_clock::now());
+  }
   int min_clock = progress_tracker_.AdvanceAndGetChangedMinClock(msg.meta.sender);
   if (min_clock <= -1) {
     return;
   }
-  // handle pending messages
-  std::vector<Message> pending_msgs = buffer_.Pop(min_clock);
-  for (Message m : pending_msgs) {
+  storage_->FinishIter();
+  // handle pending messages, which are moved out of the buffer and served in place
+  HandlePending(min_clock);
+  if (staleness_controller_) {
+    int old_staleness = staleness_;
+    staleness_ = staleness_controller_->OnMinClock(min_clock, std::chrono::steady_clock::now());
+    // a wider bound releases the requests parked at the next clocks
+    for (int clock = min_clock + 1; clock <= min_clock + static_cast<int>(staleness_) - old_staleness; ++clock) {
+      HandlePending(clock);
+    }
+  }
+}
+
+void SSPModel::HandlePending(int clock) {
+  std::vector<Message> pending_msgs = buffer_.Pop(clock);
+  for (Message& m : pending_msgs) {
     if (m.meta.flag == Flag::kAdd) {
       Add(m);
     }
-    if (m.meta.flag == Flag::kGet) {
+    // nobody waits for the reply to a removed worker
+    if (m.meta.flag == Flag::kGet && progress_tracker_.CheckThreadValid(m.meta.sender)) {
       Get(m);
     }
   }
 }
 
+void SSPModel::RemoveWorkers(const third_party::SArray<uint32_t>& tids) {
+  int old_min_clock = progress_tracker_.GetMinClock();
+  for (uint32_t tid : tids) {
+    progress_tracker_.RemoveThread(tid);
+  }
+  int min_clock = progress_tracker_.GetMinClock();
+  if (min_clock == old_min_clock) {
+    return;
+  }
+  LOG(INFO) << "model " << model_id_ << " removed " << tids.size() << " workers, min clock " << old_min_clock
+            << " -> " << min_clock;
+  storage_->FinishIter();
+  // the min clock may jump by several clocks, release all of them
+  for (int clock = old_min_clock + 1; clock <= min_clock; ++clock) {
+    HandlePending(clock);
+  }
+}
+
 void SSPModel::Add(Message& msg) {
   if (msg.meta.model_id != model_id_) {return;}
   storage_->Add(msg);
@@ -41,11 +87,25 @@ void SSPModel::Get(Message& msg) {
   if (worker_progress - min_clock > staleness_) {
     // wait for other workers
     int barrier_clock = worker_progress - staleness_;
-    buffer_.Push(barrier_clock, msg);
+    if (staleness_controller_) {
+      staleness_controller_->OnPark(msg.meta.sender, std::chrono::steady_clock::now());
+    }
+    buffer_.Push(barrier_clock, std::move(msg));
   } else {
     // response immediately
+    if (staleness_controller_) {
+      staleness_controller_->OnRelease(msg.meta.sender, std::chrono::steady_clock::now());
+    }
+    ServeGet(msg);
+  }
+}
+
+void SSPModel::ServeGet(Message& msg) {
+  if (reader_pool_) {
+    reader_pool_->Serve(std::move(msg));
+  } else {
     Message reply_msg = storage_->Get(msg);
-    reply_queue_->Push(reply_msg);
+    reply_queue_->Push(std::move(reply_msg));
   }
 }
 
@@ -57,11 +117,46 @@ int SSPModel::GetPendingSize(int progress) {
   return buffer_.Size(progress);
 }
 
+int SSPModel::GetStaleness() {
+  return staleness_;
+}
+
+std::vector<StalenessDecision> SSPModel::GetStalenessDecisions() {
+  if (!staleness_controller_) {
+    return {};
+  }
+  const auto& decisions = staleness_controller_->GetDecisions();
+  return std::vector<StalenessDecision>(decisions.begin(), decisions.end());
+}
+
+int SSPModel::GetPendingDepth() {
+  return buffer_.TotalSize();
+}
+
+int SSPModel::GetMaxPendingDepth() {
+  return buffer_.MaxTotalSize();
+}
+
+int SSPModel::GetMinClock() {
+  return progress_tracker_.GetMinClock();
+}
+
+AbstractStorage* SSPModel::GetStorage() {
+  return storage_.get();
+}
+
+ProgressTracker* SSPModel::GetProgressTracker() {
+  return &progress_tracker_;
+}
+
 void SSPModel::ResetWorker(Message& msg) {
   std::vector<uint32_t> tids;
   auto msg_data = third_party::SArray<uint32_t>(msg.data[0]);
   for (uint32_t tid : msg_data) {tids.push_back(tid);}
   progress_tracker_.Init(tids);
+  if (msg.data.size() > 1) {
+    RemoveWorkers(third_party::SArray<uint32_t>(msg.data[1]));
+  }
   Message response;
   response.meta.sender = msg.meta.recver;
   response.meta.recver = msg.meta.sender;
@@ -5,6 +5,8 @@
 #include "server/abstract_storage.hpp"
 #include "server/util/pending_buffer.hpp"
 #include "server/util/progress_tracker.hpp"
+#include "server/util/reader_pool.hpp"
+#include "server/util/staleness_controller.hpp"
 
 #include <map>
 #include <vector>
@@ -18,12 +20,22 @@ class SSPModel : public AbstractModel {
  public:
   explicit SSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr, int staleness,
                     ThreadsafeQueue<Message>* reply_queue);
+  /**
+   * Create a model whose staleness adapts to the observed stragglers within [min_staleness, max_staleness]
+   */
+  explicit SSPModel(uint32_t model_id, std::unique_ptr<AbstractStorage>&& storage_ptr, int min_staleness,
+                    int max_staleness, ThreadsafeQueue<Message>* reply_queue);
 
   virtual void Clock(Message& msg) override;
   virtual void Add(Message& msg) override;
   virtual void Get(Message& msg) override;
   virtual int GetProgress(int tid) override;
   virtual void ResetWorker(Message& msg) override;
+  virtual int GetMinClock() override;
+  virtual AbstractStorage* GetStorage() override;
+  virtual ProgressTracker* GetProgressTracker() override;
+  virtual int GetPendingDepth() override;
+  virtual int GetMaxPendingDepth() override;
 
   /**
    * Return the number of requests waiting at the specific progress
@@ -32,7 +44,24 @@ class SSPModel : public AbstractModel {
    */
   int GetPendingSize(int progress);
 
+  /**
+   * Return the current staleness bound
+   */
+  int GetStaleness();
+
+  /**
+   * Return the decisions of the adaptive staleness, empty if the staleness is fixed
+   */
+  std::vector<StalenessDecision> GetStalenessDecisions();
+
  private:
+  // Re-dispatch the requests waiting at the clock
+  void HandlePending(int clock);
+  // Drop failed workers and release the requests held back by them
+  void RemoveWorkers(const third_party::SArray<uint32_t>& tids);
+  // Answer a Get request, on the reader threads if the storage supports concurrent reads
+  void ServeGet(Message& msg);
+
   uint32_t model_id_;
   uint32_t staleness_;
 
@@ -40,6 +69,8 @@ class SSPModel : public AbstractModel {
   std::unique_ptr<AbstractStorage> storage_;
   ProgressTracker progress_tracker_;
   PendingBuffer buffer_;
+  std::unique_ptr<StalenessController> staleness_controller_;  // only set in adaptive mode
+  std::unique_ptr<ReaderPool> reader_pool_;  // destroyed before storage_
 };
 
 }  // namespace csci5570
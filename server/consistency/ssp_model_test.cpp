@@ -247,6 +247,121 @@ TEST_F(TestSSPModel, CheckStaleness) {
   m7.AddData(m7_keys);
   model->Get(m7);
   EXPECT_EQ(dynamic_cast<SSPModel*>(model.get())->GetPendingSize(1), 0);
+  EXPECT_EQ(model->GetPendingDepth(), 0);
+  EXPECT_EQ(model->GetMaxPendingDepth(), 1);
+}
+
+TEST_F(TestSSPModel, CheckAdaptiveStaleness) {
+  ThreadsafeQueue<Message> reply_queue;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<SSPModel> model(new SSPModel(0, std::move(storage), 1, 3, &reply_queue));
+  EXPECT_EQ(model->GetStaleness(), 1);
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reset_reply_msg;
+  reply_queue.WaitAndPop(&reset_reply_msg);
+
+  Message clock2;
+  clock2.meta.flag = Flag::kClock;
+  clock2.meta.model_id = 0;
+  clock2.meta.sender = 2;
+  clock2.meta.recver = 0;
+  Message clock3 = clock2;
+  clock3.meta.sender = 3;
+
+  // bounded by the current staleness
+  model->Clock(clock2);
+  model->Clock(clock2);
+  Message get;
+  get.meta.flag = Flag::kGet;
+  get.meta.model_id = 0;
+  get.meta.sender = 2;
+  get.meta.recver = 0;
+  third_party::SArray<Key> get_keys({0});
+  get.AddData(get_keys);
+  model->Get(get);
+  EXPECT_EQ(model->GetPendingSize(1), 1);
+  model->Clock(clock3);
+  EXPECT_EQ(model->GetPendingSize(1), 0);
+  EXPECT_EQ(reply_queue.Size(), 1);
+
+  // every decision is recorded
+  for (int i = 0; i < 2 * StalenessController::kDefaultWindow; ++i) {
+    model->Clock(clock2);
+    model->Clock(clock3);
+  }
+  auto decisions = model->GetStalenessDecisions();
+  EXPECT_EQ(decisions.size(), 2);
+  for (const auto& decision : decisions) {
+    EXPECT_GE(decision.new_staleness, 1);
+    EXPECT_LE(decision.new_staleness, 3);
+  }
+}
+
+TEST_F(TestSSPModel, CheckRemoveWorkers) {
+  ThreadsafeQueue<Message> reply_queue;
+  int staleness = 1;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<int>());
+  std::unique_ptr<AbstractModel> model(new SSPModel(0, std::move(storage), staleness, &reply_queue));
+  Message reset_msg;
+  reset_msg.AddData(third_party::SArray<uint32_t>({2, 3, 4}));
+  model->ResetWorker(reset_msg);
+  Message reply;
+  reply_queue.WaitAndPop(&reply);
+
+  auto make_msg = [](Flag flag, int sender) {
+    Message m;
+    m.meta.flag = flag;
+    m.meta.model_id = 0;
+    m.meta.sender = sender;
+    m.meta.recver = 0;
+    if (flag == Flag::kGet) {
+      m.AddData(third_party::SArray<Key>({1}));
+    }
+    return m;
+  };
+  // worker 2 fails at clock 0, workers 3 and 4 run ahead and wait
+  for (int i = 0; i < 4; ++i) {
+    Message clock_msg = make_msg(Flag::kClock, 3);
+    model->Clock(clock_msg);
+  }
+  for (int i = 0; i < 2; ++i) {
+    Message clock_msg = make_msg(Flag::kClock, 4);
+    model->Clock(clock_msg);
+  }
+  for (int tid : {3, 4, 2}) {
+    Message get_msg = make_msg(Flag::kGet, tid);
+    model->Get(get_msg);
+  }
+  EXPECT_EQ(reply_queue.Size(), 1);  // the Get of worker 2
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(model->GetPendingDepth(), 2);
+
+  // dropping worker 2 moves the min clock to 2 and releases worker 4 only
+  Message remove_msg;
+  remove_msg.meta.sender = 999;
+  remove_msg.meta.recver = 0;
+  remove_msg.AddData(third_party::SArray<uint32_t>());
+  remove_msg.AddData(third_party::SArray<uint32_t>({2}));
+  model->ResetWorker(remove_msg);
+  EXPECT_EQ(model->GetMinClock(), 2);
+  EXPECT_EQ(model->GetProgress(2), -1);
+  ASSERT_EQ(reply_queue.Size(), 2);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(reply.meta.recver, 4);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(reply.meta.flag, Flag::kResetWorkerInModel);
+  EXPECT_EQ(reply.meta.recver, 999);
+
+  // worker 3 is released once worker 4 catches up
+  Message clock_msg = make_msg(Flag::kClock, 4);
+  model->Clock(clock_msg);
+  ASSERT_EQ(reply_queue.Size(), 1);
+  reply_queue.WaitAndPop(&reply);
+  EXPECT_EQ(reply.meta.recver, 3);
+  EXPECT_EQ(model->GetPendingDepth(), 0);
 }
 
 }  // namespace
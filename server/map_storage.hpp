@@ -5,10 +5,22 @@
 
 #include "glog/logging.h"
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
+#include <utility>
+#include <vector>
 
 namespace csci5570 {
 
+/**
+ * Stores the entries in a map split into chunks of consecutive keys.
+ *
+ * The chunks are copied on write while a dump taken by DumpLater is pending, so that taking the dump only copies
+ * the chunk pointers on the server thread and the entries are copied out later by the checkpoint writer.
+ */
 template <typename Val>
 class MapStorage : public AbstractStorage {
  public:
@@ -18,31 +30,213 @@ class MapStorage : public AbstractStorage {
       const third_party::SArray<char>& vals) override {
     auto typed_vals = third_party::SArray<Val>(vals);
     CHECK_EQ(typed_keys.size(), typed_vals.size());
+    RefreshPendingDumps();
     for (uint32_t i = 0; i < typed_keys.size(); i++) {
-        if (storage_.find(typed_keys[i]) == storage_.end()) {
-          storage_[typed_keys[i]] = typed_vals[i];
-        } else {
-          storage_[typed_keys[i]] += typed_vals[i];
-        }
+        auto& entry = MutableEntry(typed_keys[i]);
+        entry.val += typed_vals[i];
+        MarkDirty(typed_keys[i], &entry);
+    }
+  }
+
+  virtual void SubAddBatch(const std::vector<third_party::SArray<Key>>& typed_keys,
+      const std::vector<third_party::SArray<char>>& vals) override {
+    CHECK_EQ(typed_keys.size(), vals.size());
+    // merge all updates into one sorted update
+    std::vector<std::pair<Key, Val>> updates;
+    for (size_t i = 0; i < typed_keys.size(); i++) {
+      auto typed_vals = third_party::SArray<Val>(vals[i]);
+      CHECK_EQ(typed_keys[i].size(), typed_vals.size());
+      for (uint32_t j = 0; j < typed_keys[i].size(); j++) {
+        updates.emplace_back(typed_keys[i][j], typed_vals[j]);
+      }
+    }
+    std::stable_sort(updates.begin(), updates.end(),
+                     [](const std::pair<Key, Val>& a, const std::pair<Key, Val>& b) { return a.first < b.first; });
+    // apply it in key order, each insertion is hinted by the position of the previous key in its chunk
+    RefreshPendingDumps();
+    Chunk* chunk = nullptr;
+    Key chunk_id = 0;
+    typename std::map<Key, Entry>::iterator hint;
+    for (size_t i = 0; i < updates.size();) {
+      Key k = updates[i].first;
+      Val sum = updates[i].second;
+      for (++i; i < updates.size() && updates[i].first == k; ++i) {
+        sum += updates[i].second;
+      }
+      if (chunk == nullptr || ChunkId(k) != chunk_id) {
+        chunk_id = ChunkId(k);
+        chunk = MutableChunk(chunk_id);
+        hint = chunk->entries.begin();
+      }
+      auto it = chunk->entries.insert(hint, std::make_pair(k, Entry()));
+      it->second.val += sum;
+      MarkDirty(k, &it->second);
+      hint = std::next(it);
     }
   }
 
   virtual third_party::SArray<char> SubGet(const third_party::SArray<Key>& typed_keys) override {
     third_party::SArray<Val> reply_vals(typed_keys.size());
+    RefreshPendingDumps();
     for (uint32_t i = 0; i < typed_keys.size(); i++) {
-        auto k = typed_keys[i];
-        if (storage_.find(k) == storage_.end()) {
-          storage_[k] = 0;
-        }
-        reply_vals[i] = storage_[k];
+        const Entry* entry = FindEntry(typed_keys[i]);
+        // a missing key is created like with std::map::operator[]
+        reply_vals[i] = entry != nullptr ? entry->val : MutableEntry(typed_keys[i]).val;
     }
     return third_party::SArray<char>(reply_vals);
   }
 
+  virtual void Dump(third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) override {
+    DumpLater()(typed_keys, vals);
+  }
+
+  virtual DumpFn DumpLater() override {
+    std::shared_ptr<PendingDump> dump(new PendingDump());
+    dump->chunks.reserve(chunks_.size());
+    for (const auto& kv : chunks_) {
+      dump->chunks.push_back(kv.second);
+    }
+    dump->done = std::make_shared<std::atomic<bool>>(false);
+    // the chunks of this generation and before are shared with the dump until it is done
+    pending_dumps_.emplace_back(gen_, dump->done);
+    max_pending_gen_ = gen_++;
+    NextEpoch();
+    return [dump](third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) {
+      size_t size = 0;
+      for (const auto& chunk : dump->chunks) {
+        size += chunk->entries.size();
+      }
+      third_party::SArray<Key> keys(size);
+      third_party::SArray<Val> typed_vals(size);
+      size_t i = 0;
+      for (const auto& chunk : dump->chunks) {
+        for (const auto& kv : chunk->entries) {
+          keys[i] = kv.first;
+          typed_vals[i] = kv.second.val;
+          i++;
+        }
+      }
+      *typed_keys = keys;
+      *vals = third_party::SArray<char>(typed_vals);
+      dump->Release();
+    };
+  }
+
+  virtual void DumpDirty(third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) override {
+    std::sort(dirty_keys_.begin(), dirty_keys_.end());
+    third_party::SArray<Key> keys(dirty_keys_.size());
+    third_party::SArray<Val> typed_vals(dirty_keys_.size());
+    for (size_t i = 0; i < dirty_keys_.size(); i++) {
+      keys[i] = dirty_keys_[i];
+      typed_vals[i] = FindEntry(dirty_keys_[i])->val;
+    }
+    *typed_keys = keys;
+    *vals = third_party::SArray<char>(typed_vals);
+    NextEpoch();
+  }
+
+  virtual void Restore(const third_party::SArray<Key>& typed_keys, const third_party::SArray<char>& vals) override {
+    auto typed_vals = third_party::SArray<Val>(vals);
+    CHECK_EQ(typed_keys.size(), typed_vals.size());
+    // new chunks, those of the pending dumps are left to them
+    chunks_.clear();
+    for (uint32_t i = 0; i < typed_keys.size(); i++) {
+      auto& chunk = chunks_[ChunkId(typed_keys[i])];
+      if (!chunk) {
+        chunk = std::make_shared<Chunk>();
+        chunk->gen = gen_;
+      }
+      auto it = chunk->entries.emplace_hint(chunk->entries.end(), typed_keys[i], Entry());
+      it->second.val = typed_vals[i];
+    }
+    NextEpoch();
+  }
+
   virtual void FinishIter() override {}
 
  private:
-  std::map<Key, Val> storage_;
+  // An entry is dirty if it was written in the current epoch, a Dump or DumpDirty starts a new epoch
+  struct Entry {
+    Val val = Val();
+    uint32_t epoch = 0;
+  };
+  struct Chunk {
+    uint64_t gen = 0;  // the generation it was created or copied in
+    std::map<Key, Entry> entries;
+  };
+
+  // The chunks captured by DumpLater, released when the dump is copied out or dropped
+  struct PendingDump {
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    std::shared_ptr<std::atomic<bool>> done;
+
+    void Release() {
+      chunks.clear();
+      // the reads of the chunks happen before the server thread writes them again
+      done->store(true, std::memory_order_release);
+    }
+    ~PendingDump() { Release(); }
+  };
+
+  static Key ChunkId(Key key) { return key >> kChunkBits; }
+
+  const Entry* FindEntry(Key key) const {
+    auto chunk = chunks_.find(ChunkId(key));
+    if (chunk == chunks_.end()) {
+      return nullptr;
+    }
+    auto it = chunk->second->entries.find(key);
+    return it == chunk->second->entries.end() ? nullptr : &it->second;
+  }
+
+  Entry& MutableEntry(Key key) { return MutableChunk(ChunkId(key))->entries[key]; }
+
+  // Return the chunk to write, a copy of it if a pending dump shares it
+  Chunk* MutableChunk(Key chunk_id) {
+    auto& chunk = chunks_[chunk_id];
+    if (!chunk) {
+      chunk = std::make_shared<Chunk>();
+    } else if (chunk->gen <= max_pending_gen_) {
+      chunk = std::make_shared<Chunk>(*chunk);
+    } else {
+      return chunk.get();
+    }
+    chunk->gen = gen_;
+    return chunk.get();
+  }
+
+  // Forget the dumps that are done, from the oldest one
+  void RefreshPendingDumps() {
+    while (!pending_dumps_.empty() && pending_dumps_.front().second->load(std::memory_order_acquire)) {
+      pending_dumps_.pop_front();
+    }
+    // the dumps are usually done in order, a later one done first only makes some chunks copied once more
+    max_pending_gen_ = pending_dumps_.empty() ? 0 : pending_dumps_.back().first;
+  }
+
+  void MarkDirty(Key key, Entry* entry) {
+    if (entry->epoch != epoch_) {
+      entry->epoch = epoch_;
+      dirty_keys_.push_back(key);
+    }
+  }
+
+  void NextEpoch() {
+    dirty_keys_.clear();
+    if (++epoch_ == 0) {  // 0 is the epoch of the entries never written
+      epoch_ = 1;
+    }
+  }
+
+  static const int kChunkBits = 10;  // 1024 consecutive keys per chunk
+
+  std::map<Key, std::shared_ptr<Chunk>> chunks_;
+  uint32_t epoch_ = 1;
+  std::vector<Key> dirty_keys_;  // the keys written in the current epoch, each once
+  // copy on write: a chunk created or copied in generation g is shared with the pending dumps of generation >= g
+  uint64_t gen_ = 1;
+  uint64_t max_pending_gen_ = 0;
+  std::deque<std::pair<uint64_t, std::shared_ptr<std::atomic<bool>>>> pending_dumps_;  // {generation, done}
 };
 
 }  // namespace csci5570
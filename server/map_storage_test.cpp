@@ -1,6 +1,7 @@
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 
+#include "lib/embedding.hpp"
 #include "server/map_storage.hpp"
 
 namespace csci5570 {
@@ -74,5 +75,85 @@ TEST_F(TestMapStorage, SubAddSubGet) {
   }
 }
 
+TEST_F(TestMapStorage, AddBatchGetBatch) {
+  MapStorage<int> s;
+
+  std::vector<Message> adds(3);
+  third_party::SArray<Key> keys0({3, 5, 8});
+  third_party::SArray<int> vals0({1, 2, 3});
+  third_party::SArray<Key> keys1({5, 9});
+  third_party::SArray<int> vals1({10, 20});
+  third_party::SArray<Key> keys2({1, 3, 9});
+  third_party::SArray<int> vals2({100, 200, 300});
+  adds[0].AddData(keys0);
+  adds[0].AddData(vals0);
+  adds[1].AddData(keys1);
+  adds[1].AddData(vals1);
+  adds[2].AddData(keys2);
+  adds[2].AddData(vals2);
+  s.AddBatch(adds);
+  s.AddBatch(adds);
+
+  std::vector<Message> gets(2);
+  third_party::SArray<Key> get_keys0({1, 3, 4});
+  third_party::SArray<Key> get_keys1({3, 5, 8, 9});
+  gets[0].meta.sender = 2;
+  gets[0].meta.recver = 0;
+  gets[0].AddData(get_keys0);
+  gets[1].meta.sender = 3;
+  gets[1].meta.recver = 0;
+  gets[1].AddData(get_keys1);
+  std::vector<Message> reps = s.GetBatch(gets);
+
+  ASSERT_EQ(reps.size(), 2);
+  EXPECT_EQ(reps[0].meta.recver, 2);
+  EXPECT_EQ(reps[1].meta.recver, 3);
+  ASSERT_EQ(reps[0].data.size(), 2);
+  auto rep_vals0 = third_party::SArray<int>(reps[0].data[1]);
+  ASSERT_EQ(rep_vals0.size(), 3);
+  EXPECT_EQ(rep_vals0[0], 200);
+  EXPECT_EQ(rep_vals0[1], 402);
+  EXPECT_EQ(rep_vals0[2], 0);
+  auto rep_keys1 = third_party::SArray<Key>(reps[1].data[0]);
+  auto rep_vals1 = third_party::SArray<int>(reps[1].data[1]);
+  ASSERT_EQ(rep_vals1.size(), 4);
+  EXPECT_EQ(rep_keys1[3], 9);
+  EXPECT_EQ(rep_vals1[0], 402);
+  EXPECT_EQ(rep_vals1[1], 24);
+  EXPECT_EQ(rep_vals1[2], 6);
+  EXPECT_EQ(rep_vals1[3], 640);
+}
+
+TEST_F(TestMapStorage, AddBatchGetBatchVector) {
+  using Val = lib::Embedding<4>;
+  MapStorage<Val> s;
+
+  third_party::SArray<Key> keys({2, 7});
+  third_party::SArray<Val> vals(2);
+  for (int j = 0; j < 4; ++j) {
+    vals[0][j] = j;
+    vals[1][j] = -j;
+  }
+  std::vector<Message> adds(2);
+  for (auto& add : adds) {
+    add.AddData(keys);
+    add.AddData(vals);
+  }
+  s.AddBatch(adds);
+
+  std::vector<Message> gets(1);
+  third_party::SArray<Key> get_keys({2, 5, 7});
+  gets[0].AddData(get_keys);
+  std::vector<Message> reps = s.GetBatch(gets);
+  ASSERT_EQ(reps.size(), 1);
+  auto rep_vals = third_party::SArray<Val>(reps[0].data[1]);
+  ASSERT_EQ(rep_vals.size(), 3);
+  for (int j = 0; j < 4; ++j) {
+    EXPECT_EQ(rep_vals[0][j], 2 * j);
+    EXPECT_EQ(rep_vals[1][j], 0);
+    EXPECT_EQ(rep_vals[2][j], -2 * j);
+  }
+}
+
 }  // namespace
 }  // namespace csci5570
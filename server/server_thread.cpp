@@ -8,6 +8,28 @@ void ServerThread::RegisterModel(uint32_t model_id, std::unique_ptr<AbstractMode
     models_[model_id] = std::move(model);
 }
 
+void ServerThread::RegisterCheckpointer(uint32_t model_id, std::unique_ptr<Checkpointer>&& checkpointer) {
+    checkpointers_[model_id] = std::move(checkpointer);
+}
+
+void ServerThread::RegisterReplicator(uint32_t model_id, std::unique_ptr<Replicator>&& replicator) {
+    replicators_[model_id] = std::move(replicator);
+}
+
+Replicator* ServerThread::GetReplicator(uint32_t model_id) {
+    auto it = replicators_.find(model_id);
+    return it == replicators_.end() ? nullptr : it->second.get();
+}
+
+void ServerThread::RegisterBackup(uint32_t model_id, uint32_t primary_id, std::unique_ptr<Backup>&& backup) {
+    backups_[{model_id, primary_id}] = std::move(backup);
+}
+
+Backup* ServerThread::GetBackup(uint32_t model_id, uint32_t primary_id) {
+    auto it = backups_.find({model_id, primary_id});
+    return it == backups_.end() ? nullptr : it->second.get();
+}
+
 AbstractModel* ServerThread::GetModel(uint32_t model_id) {
     auto it = models_.find(model_id);
     if (it != models_.end()) {
@@ -27,30 +49,120 @@ void ServerThread::Main() {
         work_queue_.WaitAndPop(&msg);
         // LOG(INFO) << "Server " << id_ << " received " << msg.DebugString();
         if (msg.meta.flag == Flag::kExit) {
+            for (auto& model : models_) {
+                LOG(INFO) << "server " << GetId() << " model " << model.first
+                          << " pending depth: " << model.second->GetPendingDepth()
+                          << ", max pending depth: " << model.second->GetMaxPendingDepth();
+            }
+            for (auto& replicator : replicators_) {
+                LOG(INFO) << "server " << GetId() << " model " << replicator.first
+                          << " replication lag: " << replicator.second->GetLag()
+                          << ", max replication lag: " << replicator.second->GetMaxLag()
+                          << ", shipped bytes: " << replicator.second->GetShippedBytes();
+            }
             LOG(INFO) << "server thread exit";
             break;
         }
-        if (msg.meta.flag == Flag::kClock) {
-            uint32_t model_id = msg.meta.model_id;
-            auto* model = GetModel(model_id);
-            model->Clock(msg);
+        if (msg.meta.flag == Flag::kReplicate) {
+            auto* backup = GetBackup(msg.meta.model_id, msg.meta.sender);
+            if (backup != nullptr) {  // may have been promoted
+                backup->OnReplicate(msg);
+            }
+        } else if (msg.meta.flag == Flag::kReplicateAck) {
+            auto* replicator = GetReplicator(msg.meta.model_id);
+            CHECK(replicator != nullptr);
+            replicator->OnAck(msg.meta.sender, third_party::SArray<int>(msg.data[0])[0]);
+            Replay(msg.meta.model_id);
+        } else if (msg.meta.flag == Flag::kFailover) {
+            Failover(msg);
+        } else {
+            Handle(msg);
         }
-        if (msg.meta.flag == Flag::kAdd) {
-            uint32_t model_id = msg.meta.model_id;
-            auto* model = GetModel(model_id);
-            model->Add(msg);
+    }
+}
+
+void ServerThread::Handle(Message& msg) {
+    uint32_t model_id = msg.meta.model_id;
+    auto* replicator = GetReplicator(model_id);
+    if (replicator != nullptr) {
+        auto& deferred = deferred_[model_id];
+        if (!deferred.empty() || replicator->IsLagging()) {
+            deferred.push_back(std::move(msg));
+            return;
         }
-        if (msg.meta.flag == Flag::kGet) {
-            uint32_t model_id = msg.meta.model_id;
-            auto* model = GetModel(model_id);
-            model->Get(msg);
+    }
+    Dispatch(msg);
+}
+
+void ServerThread::Dispatch(Message& msg) {
+    if (msg.meta.flag == Flag::kClock) {
+        uint32_t model_id = msg.meta.model_id;
+        auto* model = GetModel(model_id);
+        model->Clock(msg);
+        auto it = checkpointers_.find(model_id);
+        if (it != checkpointers_.end()) {
+            it->second->MaybeCheckpoint(model->GetMinClock(), model->GetStorage(), model->GetProgressTracker());
+        }
+        auto* replicator = GetReplicator(model_id);
+        if (replicator != nullptr) {
+            replicator->OnMinClock(model->GetMinClock());
         }
-        if (msg.meta.flag == Flag::kResetWorkerInModel) {
-            auto* model = GetModel(msg.meta.model_id);
-            model->ResetWorker(msg);
+    }
+    if (msg.meta.flag == Flag::kAdd) {
+        uint32_t model_id = msg.meta.model_id;
+        auto* model = GetModel(model_id);
+        auto* replicator = GetReplicator(model_id);
+        if (replicator != nullptr) {
+            replicator->OnAdd(msg);  // before the model may take the message
         }
+        model->Add(msg);
+    }
+    if (msg.meta.flag == Flag::kGet) {
+        uint32_t model_id = msg.meta.model_id;
+        auto* model = GetModel(model_id);
+        model->Get(msg);
+    }
+    if (msg.meta.flag == Flag::kResetWorkerInModel) {
+        auto* model = GetModel(msg.meta.model_id);
+        model->ResetWorker(msg);
     }
 }
 
-}  // namespace csci5570
+void ServerThread::Replay(uint32_t model_id) {
+    auto* replicator = GetReplicator(model_id);
+    auto& deferred = deferred_[model_id];
+    while (!deferred.empty() && (replicator == nullptr || !replicator->IsLagging())) {
+        Message msg = std::move(deferred.front());
+        deferred.pop_front();
+        Dispatch(msg);
+    }
+}
 
+void ServerThread::Failover(Message& msg) {
+    uint32_t model_id = msg.meta.model_id;
+    CHECK_EQ(msg.data.size(), 2);
+    auto* replicator = GetReplicator(model_id);
+    for (uint32_t primary_id : third_party::SArray<uint32_t>(msg.data[1])) {
+        auto it = backups_.find({model_id, primary_id});
+        CHECK(it != backups_.end()) << "server " << GetId() << " holds no backup of server " << primary_id;
+        auto* storage = GetModel(model_id)->GetStorage();
+        CHECK(storage != nullptr);
+        third_party::SArray<Key> keys;
+        third_party::SArray<char> vals;
+        it->second->GetStorage()->Dump(&keys, &vals);
+        storage->SubAdd(keys, vals);
+        storage->FinishIter();
+        LOG(WARNING) << "server " << GetId() << " takes over " << keys.size() << " keys of model " << model_id
+                     << " from server " << primary_id << " at clock " << it->second->GetClock();
+        backups_.erase(it);
+    }
+    for (uint32_t failed_id : third_party::SArray<uint32_t>(msg.data[0])) {
+        if (replicator != nullptr) {
+            replicator->RemoveBackup(failed_id);
+        }
+        backups_.erase({model_id, failed_id});  // the backups of the failed primaries not promoted here
+    }
+    Replay(model_id);
+}
+
+}  // namespace csci5570
@@ -3,7 +3,11 @@
 #include "base/actor_model.hpp"
 #include "base/threadsafe_queue.hpp"
 #include "server/abstract_model.hpp"
+#include "server/util/checkpointer.hpp"
+#include "server/util/replicator.hpp"
 
+#include <deque>
+#include <map>
 #include <thread>
 #include <unordered_map>
 
@@ -16,13 +20,33 @@ class ServerThread : public Actor {
   // for model maintenance
   void RegisterModel(uint32_t model_id, std::unique_ptr<AbstractModel>&& model);
   AbstractModel* GetModel(uint32_t model_id);
+  // checkpoint the shard of a registered model at clock boundaries
+  void RegisterCheckpointer(uint32_t model_id, std::unique_ptr<Checkpointer>&& checkpointer);
+  // replicate the shard of a registered model to its backups at clock boundaries
+  void RegisterReplicator(uint32_t model_id, std::unique_ptr<Replicator>&& replicator);
+  Replicator* GetReplicator(uint32_t model_id);
+  // hold the backup of the shard of a model on server <primary_id>
+  void RegisterBackup(uint32_t model_id, uint32_t primary_id, std::unique_ptr<Backup>&& backup);
+  Backup* GetBackup(uint32_t model_id, uint32_t primary_id);
 
   uint32_t GetServerId();
 
  protected:
   virtual void Main() override;                                  // where the actor polls events and reacts
 
+  // apply a message of a model, or defer it while the backups of the model lag behind
+  void Handle(Message& msg);
+  void Dispatch(Message& msg);
+  // apply the deferred messages of a model until its backups lag behind again
+  void Replay(uint32_t model_id);
+  // data[0]: the failed servers, data[1]: the primaries whose backups on this server are promoted
+  void Failover(Message& msg);
+
   std::unordered_map<uint32_t, std::unique_ptr<AbstractModel>> models_;
+  std::unordered_map<uint32_t, std::unique_ptr<Checkpointer>> checkpointers_;
+  std::unordered_map<uint32_t, std::unique_ptr<Replicator>> replicators_;
+  std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<Backup>> backups_;  // {(model id, primary id): backup}
+  std::unordered_map<uint32_t, std::deque<Message>> deferred_;
 };
 
 }  // namespace csci5570
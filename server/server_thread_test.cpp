@@ -3,6 +3,8 @@
 
 #include "base/magic.hpp"
 #include "server/abstract_model.hpp"
+#include "server/consistency/asp_model.hpp"
+#include "server/map_storage.hpp"
 #include "server/server_thread.hpp"
 
 namespace csci5570 {
@@ -25,6 +27,7 @@ class FakeModel : public AbstractModel {
   virtual void Get(Message&) override { get_count_ += 1; }
   virtual int GetProgress(int tid) override { return -1; }
   virtual void ResetWorker(Message& msg) override {}
+  virtual int GetMinClock() override { return clock_count_; }
 
   int clock_count_ = 0;
   int add_count_ = 0;
@@ -113,5 +116,146 @@ TEST_F(TestServerThread, Get) {
   EXPECT_EQ(p->get_count_, 3);
 }
 
+Message MakeAdd(uint32_t model_id) {
+  Message msg;
+  msg.meta.flag = Flag::kAdd;
+  msg.meta.model_id = model_id;
+  msg.AddData(third_party::SArray<Key>({1}));
+  msg.AddData(third_party::SArray<double>({.1}));
+  return msg;
+}
+
+TEST_F(TestServerThread, Replicate) {
+  ThreadsafeQueue<Message> send_queue;
+  ServerThread server_thread(0);
+  std::unique_ptr<AbstractModel> model(new FakeModel());
+  const uint32_t model_id = 0;
+  server_thread.RegisterModel(model_id, std::move(model));
+  server_thread.RegisterReplicator(model_id, std::unique_ptr<Replicator>(
+      new Replicator(model_id, 0, {1000}, &send_queue, 1)));
+  auto* p = static_cast<FakeModel*>(server_thread.GetModel(model_id));
+  server_thread.Start();
+
+  auto* work_queue = server_thread.GetWorkQueue();
+  Message clock_msg;
+  clock_msg.meta.flag = Flag::kClock;
+  clock_msg.meta.model_id = model_id;
+  Message get_msg;
+  get_msg.meta.flag = Flag::kGet;
+  get_msg.meta.model_id = model_id;
+  work_queue->Push(MakeAdd(model_id));
+  work_queue->Push(clock_msg);
+  work_queue->Push(clock_msg);
+  // the backup lags 2 clocks behind, hold back the model
+  work_queue->Push(MakeAdd(model_id));
+  work_queue->Push(get_msg);
+
+  Message exit_msg;
+  exit_msg.meta.flag = Flag::kExit;
+  work_queue->Push(exit_msg);
+  server_thread.Stop();
+
+  EXPECT_EQ(p->clock_count_, 2);
+  EXPECT_EQ(p->add_count_, 1);
+  EXPECT_EQ(p->get_count_, 0);
+  ASSERT_EQ(send_queue.Size(), 2);
+  Message batch;
+  send_queue.WaitAndPop(&batch);
+  EXPECT_EQ(batch.meta.flag, Flag::kReplicate);
+  EXPECT_EQ(batch.meta.recver, 1000);
+  EXPECT_EQ(batch.data.size(), 3);
+  send_queue.WaitAndPop(&batch);
+  EXPECT_EQ(batch.data.size(), 1);  // nothing added in the second clock
+  EXPECT_EQ(server_thread.GetReplicator(model_id)->GetLag(), 2);
+}
+
+TEST_F(TestServerThread, ReplayAfterAck) {
+  ThreadsafeQueue<Message> send_queue;
+  ServerThread server_thread(0);
+  std::unique_ptr<AbstractModel> model(new FakeModel());
+  const uint32_t model_id = 0;
+  server_thread.RegisterModel(model_id, std::move(model));
+  server_thread.RegisterReplicator(model_id, std::unique_ptr<Replicator>(
+      new Replicator(model_id, 0, {1000, 2000}, &send_queue, 1)));
+  auto* p = static_cast<FakeModel*>(server_thread.GetModel(model_id));
+  server_thread.Start();
+
+  auto* work_queue = server_thread.GetWorkQueue();
+  Message clock_msg;
+  clock_msg.meta.flag = Flag::kClock;
+  clock_msg.meta.model_id = model_id;
+  work_queue->Push(clock_msg);
+  work_queue->Push(clock_msg);
+  work_queue->Push(MakeAdd(model_id));  // deferred
+  work_queue->Push(clock_msg);          // deferred
+  Message ack;
+  ack.meta.flag = Flag::kReplicateAck;
+  ack.meta.model_id = model_id;
+  ack.meta.sender = 1000;
+  ack.AddData(third_party::SArray<int>({2}));
+  work_queue->Push(ack);  // 2000 still lags behind
+  Message failover;
+  failover.meta.flag = Flag::kFailover;
+  failover.meta.model_id = model_id;
+  failover.AddData(third_party::SArray<uint32_t>({2000}));
+  failover.AddData(third_party::SArray<uint32_t>());
+  work_queue->Push(failover);
+
+  Message exit_msg;
+  exit_msg.meta.flag = Flag::kExit;
+  work_queue->Push(exit_msg);
+  server_thread.Stop();
+
+  EXPECT_EQ(p->add_count_, 1);
+  EXPECT_EQ(p->clock_count_, 3);
+  EXPECT_EQ(server_thread.GetReplicator(model_id)->GetLag(), 1);
+}
+
+TEST_F(TestServerThread, Promote) {
+  ThreadsafeQueue<Message> reply_queue;
+  ServerThread server_thread(1000);
+  const uint32_t model_id = 0;
+  std::unique_ptr<AbstractStorage> storage(new MapStorage<double>());
+  server_thread.RegisterModel(model_id, std::unique_ptr<AbstractModel>(
+      new ASPModel(model_id, std::move(storage), &reply_queue)));
+  server_thread.RegisterBackup(model_id, 0, std::unique_ptr<Backup>(
+      new Backup(std::unique_ptr<AbstractStorage>(new MapStorage<double>()), &reply_queue)));
+  server_thread.Start();
+
+  auto* work_queue = server_thread.GetWorkQueue();
+  Message batch;
+  batch.meta.flag = Flag::kReplicate;
+  batch.meta.model_id = model_id;
+  batch.meta.sender = 0;
+  batch.meta.recver = 1000;
+  batch.AddData(third_party::SArray<int>({1}));
+  batch.AddData(third_party::SArray<Key>({3, 5}));
+  batch.AddData(third_party::SArray<double>({.3, .5}));
+  work_queue->Push(batch);
+  Message failover;
+  failover.meta.flag = Flag::kFailover;
+  failover.meta.model_id = model_id;
+  failover.AddData(third_party::SArray<uint32_t>({0}));
+  failover.AddData(third_party::SArray<uint32_t>({0}));
+  work_queue->Push(failover);
+
+  Message exit_msg;
+  exit_msg.meta.flag = Flag::kExit;
+  work_queue->Push(exit_msg);
+  server_thread.Stop();
+
+  EXPECT_EQ(server_thread.GetBackup(model_id, 0), nullptr);
+  auto vals = third_party::SArray<double>(
+      server_thread.GetModel(model_id)->GetStorage()->SubGet(third_party::SArray<Key>({3, 5})));
+  ASSERT_EQ(vals.size(), 2);
+  EXPECT_DOUBLE_EQ(vals[0], .3);
+  EXPECT_DOUBLE_EQ(vals[1], .5);
+  ASSERT_EQ(reply_queue.Size(), 1);
+  Message ack;
+  reply_queue.WaitAndPop(&ack);
+  EXPECT_EQ(ack.meta.flag, Flag::kReplicateAck);
+  EXPECT_EQ(ack.meta.recver, 0);
+}
+
 }  // namespace
 }  // namespace csci5570
@@ -0,0 +1,267 @@
+#pragma once
+
+#include "base/message.hpp"
+#include "server/abstract_storage.hpp"
+#include "server/util/reader_pool.hpp"
+
+#include "glog/logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * A versioned storage that serves reads from an immutable snapshot of the model.
+ *
+ * Adds are accumulated in a write buffer owned by the server thread. FinishIter() is called at
+ * clock boundaries and publishes a new snapshot that merges the previous one with the buffer.
+ * Readers grab the current snapshot through an atomic shared_ptr and never block the writer;
+ * an old version is released when its last reader drops it (RCU style).
+ *
+ * A snapshot is split into chunks of consecutive keys, as MapStorage, and a new snapshot only copies the chunks
+ * with buffered updates and shares the others with the previous one. The entries written since the last dump
+ * are tracked by a bitmap over the positions of each chunk.
+ */
+template <typename Val>
+class SnapshotStorage : public AbstractStorage {
+ public:
+  /**
+   * @param num_readers   the number of threads serving Gets from the snapshot
+   */
+  explicit SnapshotStorage(int num_readers = ReaderPool::kDefaultNumThreads)
+      : num_readers_(num_readers), snapshot_(new Snapshot()) {}
+
+  virtual void SubAdd(const third_party::SArray<Key>& typed_keys,
+      const third_party::SArray<char>& vals) override {
+    auto typed_vals = third_party::SArray<Val>(vals);
+    CHECK_EQ(typed_keys.size(), typed_vals.size());
+    auto hint = write_buffer_.begin();
+    for (uint32_t i = 0; i < typed_keys.size(); i++) {
+      auto it = write_buffer_.insert(hint, std::make_pair(typed_keys[i], Val()));
+      it->second += typed_vals[i];
+      hint = std::next(it);
+    }
+  }
+
+  // Thread-safe, can run concurrently with SubAdd and FinishIter
+  virtual third_party::SArray<char> SubGet(const third_party::SArray<Key>& typed_keys) override {
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+    const std::vector<Key>& chunk_ids = snapshot->chunk_ids;
+    third_party::SArray<Val> reply_vals(typed_keys.size());
+    auto chunk_pos = chunk_ids.begin();
+    for (uint32_t i = 0; i < typed_keys.size(); i++) {
+      if (i > 0 && typed_keys[i] < typed_keys[i - 1]) {
+        chunk_pos = chunk_ids.begin();
+      }
+      chunk_pos = std::lower_bound(chunk_pos, chunk_ids.end(), ChunkId(typed_keys[i]));
+      reply_vals[i] = Val();
+      if (chunk_pos != chunk_ids.end() && *chunk_pos == ChunkId(typed_keys[i])) {
+        const Chunk& chunk = *snapshot->chunks[chunk_pos - chunk_ids.begin()];
+        auto pos = std::lower_bound(chunk.keys.begin(), chunk.keys.end(), typed_keys[i]);
+        if (pos != chunk.keys.end() && *pos == typed_keys[i]) {
+          reply_vals[i] = chunk.vals[pos - chunk.keys.begin()];
+        }
+      }
+    }
+    return third_party::SArray<char>(reply_vals);
+  }
+
+  virtual void Dump(third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) override {
+    DumpLater()(typed_keys, vals);
+  }
+
+  // The published snapshot is immutable, the entries are copied out of it later without blocking the writer
+  virtual DumpFn DumpLater() override {
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+    for (auto& kv : dirty_bits_) {
+      std::fill(kv.second.begin(), kv.second.end(), 0);
+    }
+    return [snapshot](third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) {
+      third_party::SArray<Key> keys(snapshot->num_keys);
+      third_party::SArray<Val> typed_vals(snapshot->num_keys);
+      size_t i = 0;
+      for (const auto& chunk : snapshot->chunks) {
+        std::copy(chunk->keys.begin(), chunk->keys.end(), keys.begin() + i);
+        std::copy(chunk->vals.begin(), chunk->vals.end(), typed_vals.begin() + i);
+        i += chunk->keys.size();
+      }
+      *typed_keys = keys;
+      *vals = third_party::SArray<char>(typed_vals);
+    };
+  }
+
+  virtual void DumpDirty(third_party::SArray<Key>* typed_keys, third_party::SArray<char>* vals) override {
+    std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+    size_t num_dirty = 0;
+    for (const auto& kv : dirty_bits_) {
+      for (uint64_t word : kv.second) {
+        num_dirty += __builtin_popcountll(word);
+      }
+    }
+    third_party::SArray<Key> keys(num_dirty);
+    third_party::SArray<Val> typed_vals(num_dirty);
+    size_t j = 0;
+    // the dirty chunks are published, in the order of the snapshot
+    auto chunk_pos = snapshot->chunk_ids.begin();
+    for (auto& kv : dirty_bits_) {
+      chunk_pos = std::lower_bound(chunk_pos, snapshot->chunk_ids.end(), kv.first);
+      const Chunk& chunk = *snapshot->chunks[chunk_pos - snapshot->chunk_ids.begin()];
+      for (size_t w = 0; w < kv.second.size(); w++) {
+        for (uint64_t word = kv.second[w]; word != 0; word &= word - 1) {
+          size_t pos = w * 64 + __builtin_ctzll(word);
+          keys[j] = chunk.keys[pos];
+          typed_vals[j] = chunk.vals[pos];
+          j++;
+        }
+      }
+    }
+    dirty_bits_.clear();
+    *typed_keys = keys;
+    *vals = third_party::SArray<char>(typed_vals);
+  }
+
+  virtual void Restore(const third_party::SArray<Key>& typed_keys, const third_party::SArray<char>& vals) override {
+    auto typed_vals = third_party::SArray<Val>(vals);
+    CHECK_EQ(typed_keys.size(), typed_vals.size());
+    std::shared_ptr<const Snapshot> old_snapshot = std::atomic_load(&snapshot_);
+    std::shared_ptr<Snapshot> new_snapshot(new Snapshot());
+    new_snapshot->version = old_snapshot->version + 1;
+    new_snapshot->num_keys = typed_keys.size();
+    for (size_t i = 0; i < typed_keys.size();) {
+      Key id = ChunkId(typed_keys[i]);
+      std::shared_ptr<Chunk> chunk(new Chunk());
+      for (; i < typed_keys.size() && ChunkId(typed_keys[i]) == id; i++) {
+        chunk->keys.push_back(typed_keys[i]);
+        chunk->vals.push_back(typed_vals[i]);
+      }
+      new_snapshot->chunk_ids.push_back(id);
+      new_snapshot->chunks.push_back(std::move(chunk));
+    }
+    dirty_bits_.clear();
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(new_snapshot)));
+    write_buffer_.clear();
+  }
+
+  // Publish the buffered updates as a new snapshot, copying only the chunks they touch
+  virtual void FinishIter() override {
+    if (write_buffer_.empty()) {return;}
+    std::shared_ptr<const Snapshot> old_snapshot = std::atomic_load(&snapshot_);
+    std::shared_ptr<Snapshot> new_snapshot(new Snapshot());
+    new_snapshot->version = old_snapshot->version + 1;
+    new_snapshot->num_keys = old_snapshot->num_keys;
+    const std::vector<Key>& old_ids = old_snapshot->chunk_ids;
+    Chunk empty;
+    size_t c = 0;
+    typename Buffer::const_iterator it = write_buffer_.begin();
+    while (it != write_buffer_.end()) {
+      Key id = ChunkId(it->first);
+      // the chunks without updates are shared
+      for (; c < old_ids.size() && old_ids[c] < id; c++) {
+        new_snapshot->chunk_ids.push_back(old_ids[c]);
+        new_snapshot->chunks.push_back(old_snapshot->chunks[c]);
+      }
+      const Chunk& old_chunk = c < old_ids.size() && old_ids[c] == id ? *old_snapshot->chunks[c++] : empty;
+      std::shared_ptr<Chunk> chunk(new Chunk());
+      it = Merge(old_chunk, it, &dirty_bits_[id], chunk.get());
+      new_snapshot->num_keys += chunk->keys.size() - old_chunk.keys.size();
+      new_snapshot->chunk_ids.push_back(id);
+      new_snapshot->chunks.push_back(std::move(chunk));
+    }
+    for (; c < old_ids.size(); c++) {
+      new_snapshot->chunk_ids.push_back(old_ids[c]);
+      new_snapshot->chunks.push_back(old_snapshot->chunks[c]);
+    }
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(new_snapshot)));
+    write_buffer_.clear();
+  }
+
+  virtual int GetNumReaders() const override { return num_readers_; }
+
+  /**
+   * Return the version of the published snapshot, i.e., the number of publications with updates
+   */
+  int GetVersion() const { return std::atomic_load(&snapshot_)->version; }
+
+ private:
+  struct Chunk {
+    std::vector<Key> keys;  // sorted
+    std::vector<Val> vals;
+  };
+
+  struct Snapshot {
+    std::vector<Key> chunk_ids;  // sorted
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    size_t num_keys = 0;
+    int version = 0;
+  };
+
+  using Buffer = std::map<Key, Val>;
+
+  static Key ChunkId(Key key) { return key >> kChunkBits; }
+  static size_t NumWords(size_t num_bits) { return (num_bits + 63) / 64; }
+  static bool IsDirty(const std::vector<uint64_t>& bits, size_t pos) {
+    return pos / 64 < bits.size() && ((bits[pos / 64] >> (pos % 64)) & 1);
+  }
+  static void SetDirty(std::vector<uint64_t>* bits, size_t pos) { (*bits)[pos / 64] |= uint64_t(1) << (pos % 64); }
+
+  /**
+   * Merge <old_chunk> with the buffered updates of its chunk from <it> into <chunk>, and move the dirty <bits> of
+   * the chunk to the new positions
+   *
+   * @return  the first buffered update of the next chunks
+   */
+  typename Buffer::const_iterator Merge(const Chunk& old_chunk, typename Buffer::const_iterator it,
+                                        std::vector<uint64_t>* bits, Chunk* chunk) const {
+    Key id = ChunkId(it->first);
+    auto end = it;
+    while (end != write_buffer_.end() && ChunkId(end->first) == id) {
+      ++end;
+    }
+    size_t size = old_chunk.keys.size() + std::distance(it, end);
+    chunk->keys.reserve(size);
+    chunk->vals.reserve(size);
+    std::vector<uint64_t> new_bits(NumWords(size), 0);
+    // both sides are sorted by key, merge them in one pass
+    size_t i = 0;
+    while (i < old_chunk.keys.size() || it != end) {
+      if (it == end || (i < old_chunk.keys.size() && old_chunk.keys[i] < it->first)) {
+        if (IsDirty(*bits, i)) {
+          SetDirty(&new_bits, chunk->keys.size());
+        }
+        chunk->keys.push_back(old_chunk.keys[i]);
+        chunk->vals.push_back(old_chunk.vals[i]);
+        i++;
+      } else if (i == old_chunk.keys.size() || it->first < old_chunk.keys[i]) {
+        SetDirty(&new_bits, chunk->keys.size());
+        chunk->keys.push_back(it->first);
+        chunk->vals.push_back(it->second);
+        ++it;
+      } else {
+        SetDirty(&new_bits, chunk->keys.size());
+        chunk->keys.push_back(it->first);
+        chunk->vals.push_back(old_chunk.vals[i]);
+        chunk->vals.back() += it->second;
+        i++;
+        ++it;
+      }
+    }
+    new_bits.resize(NumWords(chunk->keys.size()));
+    bits->swap(new_bits);
+    return end;
+  }
+
+  static const int kChunkBits = 10;  // 1024 consecutive keys per chunk
+
+  int num_readers_;
+  std::shared_ptr<const Snapshot> snapshot_;  // only accessed through std::atomic_load/std::atomic_store
+  Buffer write_buffer_;                       // updates since the last publication, server thread only
+  // the dirty positions in each chunk with entries written since the last dump, server thread only
+  std::map<Key, std::vector<uint64_t>> dirty_bits_;
+};
+
+}  // namespace csci5570
@@ -0,0 +1,213 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "base/threadsafe_queue.hpp"
+#include "lib/embedding.hpp"
+#include "server/consistency/ssp_model.hpp"
+#include "server/snapshot_storage.hpp"
+
+#include <thread>
+
+namespace csci5570 {
+namespace {
+
+class TestSnapshotStorage : public testing::Test {
+ public:
+  TestSnapshotStorage() {}
+  ~TestSnapshotStorage() {}
+
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+TEST_F(TestSnapshotStorage, PublishOnFinishIter) {
+  SnapshotStorage<int> s;
+  EXPECT_EQ(s.GetNumReaders(), 2);
+
+  third_party::SArray<Key> s_keys({13, 15});
+  third_party::SArray<int> s_vals({1, 3});
+  s.SubAdd(s_keys, third_party::SArray<char>(s_vals));
+
+  // updates are invisible until they are published
+  third_party::SArray<Key> get_keys({13, 14, 15});
+  auto ret = third_party::SArray<int>(s.SubGet(get_keys));
+  ASSERT_EQ(ret.size(), 3);
+  EXPECT_EQ(ret[0], 0);
+  EXPECT_EQ(ret[2], 0);
+  EXPECT_EQ(s.GetVersion(), 0);
+
+  s.FinishIter();
+  EXPECT_EQ(s.GetVersion(), 1);
+  ret = third_party::SArray<int>(s.SubGet(get_keys));
+  EXPECT_EQ(ret[0], 1);
+  EXPECT_EQ(ret[1], 0);
+  EXPECT_EQ(ret[2], 3);
+
+  // merge new keys and updates to existing keys
+  third_party::SArray<Key> s_keys2({12, 14, 15});
+  third_party::SArray<int> s_vals2({2, 4, 6});
+  s.SubAdd(s_keys2, third_party::SArray<char>(s_vals2));
+  s.SubAdd(s_keys2, third_party::SArray<char>(s_vals2));
+  s.FinishIter();
+  s.FinishIter();  // nothing to publish
+  EXPECT_EQ(s.GetVersion(), 2);
+  third_party::SArray<Key> get_keys2({12, 13, 14, 15, 16});
+  ret = third_party::SArray<int>(s.SubGet(get_keys2));
+  ASSERT_EQ(ret.size(), 5);
+  EXPECT_EQ(ret[0], 4);
+  EXPECT_EQ(ret[1], 1);
+  EXPECT_EQ(ret[2], 8);
+  EXPECT_EQ(ret[3], 15);
+  EXPECT_EQ(ret[4], 0);
+}
+
+TEST_F(TestSnapshotStorage, Chunks) {
+  SnapshotStorage<int> s(3);
+  EXPECT_EQ(s.GetNumReaders(), 3);
+  // the keys of three chunks
+  third_party::SArray<Key> keys({5, 6, 2000, 5000});
+  third_party::SArray<int> vals({1, 2, 3, 4});
+  s.SubAdd(keys, third_party::SArray<char>(vals));
+  s.FinishIter();
+  auto dump = s.DumpLater();
+
+  // only the chunk of 2000 and a new one are updated, the dump sees the snapshot at the time it was taken
+  third_party::SArray<Key> keys2({1999, 2000, 9000});
+  third_party::SArray<int> vals2({10, 10, 10});
+  s.SubAdd(keys2, third_party::SArray<char>(vals2));
+  s.FinishIter();
+  third_party::SArray<Key> get_keys({5, 6, 1999, 2000, 5000, 9000, 9001});
+  auto ret = third_party::SArray<int>(s.SubGet(get_keys));
+  EXPECT_EQ(std::vector<int>(ret.begin(), ret.end()), (std::vector<int>{1, 2, 10, 13, 4, 10, 0}));
+
+  third_party::SArray<Key> dump_keys;
+  third_party::SArray<char> dump_vals;
+  dump(&dump_keys, &dump_vals);
+  auto typed_dump_vals = third_party::SArray<int>(dump_vals);
+  EXPECT_EQ(std::vector<Key>(dump_keys.begin(), dump_keys.end()), (std::vector<Key>{5, 6, 2000, 5000}));
+  EXPECT_EQ(std::vector<int>(typed_dump_vals.begin(), typed_dump_vals.end()), (std::vector<int>{1, 2, 3, 4}));
+
+  s.DumpDirty(&dump_keys, &dump_vals);
+  typed_dump_vals = third_party::SArray<int>(dump_vals);
+  EXPECT_EQ(std::vector<Key>(dump_keys.begin(), dump_keys.end()), (std::vector<Key>{1999, 2000, 9000}));
+  EXPECT_EQ(std::vector<int>(typed_dump_vals.begin(), typed_dump_vals.end()), (std::vector<int>{10, 13, 10}));
+
+  // a full dump of the restored content
+  SnapshotStorage<int> restored;
+  s.Dump(&dump_keys, &dump_vals);
+  restored.Restore(dump_keys, dump_vals);
+  ret = third_party::SArray<int>(restored.SubGet(get_keys));
+  EXPECT_EQ(std::vector<int>(ret.begin(), ret.end()), (std::vector<int>{1, 2, 10, 13, 4, 10, 0}));
+}
+
+TEST_F(TestSnapshotStorage, VectorValues) {
+  using Val = lib::Embedding<3, double>;
+  SnapshotStorage<Val> s;
+  third_party::SArray<Key> s_keys({4, 9});
+  third_party::SArray<Val> s_vals(2);
+  for (int j = 0; j < 3; ++j) {
+    s_vals[0][j] = j + 1;
+    s_vals[1][j] = 0.5;
+  }
+  s.SubAdd(s_keys, third_party::SArray<char>(s_vals));
+  s.FinishIter();
+  s.SubAdd(s_keys.segment(1, 2), third_party::SArray<char>(s_vals.segment(1, 2)));
+  s.FinishIter();
+
+  third_party::SArray<Key> get_keys({4, 6, 9});
+  auto ret = third_party::SArray<Val>(s.SubGet(get_keys));
+  ASSERT_EQ(ret.size(), 3);
+  EXPECT_EQ(ret[0], s_vals[0]);
+  EXPECT_EQ(ret[1], Val());
+  for (int j = 0; j < 3; ++j) {
+    EXPECT_DOUBLE_EQ(ret[2][j], 1);
+  }
+}
+
+TEST_F(TestSnapshotStorage, ConcurrentReaders) {
+  SnapshotStorage<int> s;
+  const int num_keys = 100;
+  const int num_iters = 200;
+  third_party::SArray<Key> keys(num_keys);
+  third_party::SArray<int> ones(num_keys, 1);
+  for (int i = 0; i < num_keys; ++i) {
+    keys[i] = i;
+  }
+
+  // every published version holds the same value for all keys
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.push_back(std::thread([&s, &keys, num_iters] {
+      int last = 0;
+      while (last < num_iters) {
+        auto ret = third_party::SArray<int>(s.SubGet(keys));
+        for (int v : ret) {
+          ASSERT_EQ(v, ret[0]);
+        }
+        ASSERT_GE(ret[0], last);
+        last = ret[0];
+      }
+    }));
+  }
+  for (int iter = 0; iter < num_iters; ++iter) {
+    s.SubAdd(keys, third_party::SArray<char>(ones));
+    s.FinishIter();
+  }
+  for (auto& reader : readers) {
+    reader.join();
+  }
+}
+
+TEST_F(TestSnapshotStorage, SSPModelReaders) {
+  ThreadsafeQueue<Message> reply_queue;
+  int staleness = 0;
+  std::unique_ptr<AbstractStorage> storage(new SnapshotStorage<int>());
+  std::unique_ptr<AbstractModel> model(new SSPModel(0, std::move(storage), staleness, &reply_queue));
+  Message reset_msg;
+  third_party::SArray<uint32_t> tids({2, 3});
+  reset_msg.AddData(tids);
+  model->ResetWorker(reset_msg);
+  Message reset_reply_msg;
+  reply_queue.WaitAndPop(&reset_reply_msg);
+
+  for (int tid : {2, 3}) {
+    Message m;
+    m.meta.flag = Flag::kAdd;
+    m.meta.model_id = 0;
+    m.meta.sender = tid;
+    m.meta.recver = 0;
+    third_party::SArray<Key> keys({7});
+    third_party::SArray<int> vals({tid});
+    m.AddData(keys);
+    m.AddData(vals);
+    model->Add(m);
+
+    Message clock;
+    clock.meta.flag = Flag::kClock;
+    clock.meta.model_id = 0;
+    clock.meta.sender = tid;
+    clock.meta.recver = 0;
+    model->Clock(clock);
+  }
+
+  // the Get is answered by a reader thread from the snapshot published at clock 1
+  Message get;
+  get.meta.flag = Flag::kGet;
+  get.meta.model_id = 0;
+  get.meta.sender = 2;
+  get.meta.recver = 0;
+  third_party::SArray<Key> get_keys({7});
+  get.AddData(get_keys);
+  model->Get(get);
+
+  Message check_msg;
+  reply_queue.WaitAndPop(&check_msg);
+  EXPECT_EQ(check_msg.meta.recver, 2);
+  auto rep_vals = third_party::SArray<int>(check_msg.data[1]);
+  ASSERT_EQ(rep_vals.size(), 1);
+  EXPECT_EQ(rep_vals[0], 5);
+}
+
+}  // namespace
+}  // namespace csci5570
@@ -0,0 +1,226 @@
+#include "server/util/checkpoint.hpp"
+
+#include "glog/logging.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace csci5570 {
+
+const uint32_t CheckpointFile::kFormatVersion;
+const uint32_t CheckpointFile::kFull;
+const uint32_t CheckpointFile::kDelta;
+
+namespace {
+
+const char kMagic[8] = {'C', 'S', 'C', 'I', 'C', 'K', 'P', 'T'};
+
+uint64_t Align(uint64_t offset) { return (offset + 7) / 8 * 8; }
+
+bool WriteAt(FILE* file, uint64_t offset, const void* data, size_t size) {
+  if (fseeko(file, offset, SEEK_SET) != 0) {
+    return false;
+  }
+  return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+// Makes a rename into the directory of <path> durable
+bool SyncDir(const std::string& path) {
+  size_t slash = path.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+  int fd = open(dir.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+// Keeps a file mapped as long as an array points into it
+class MappedFile {
+ public:
+  MappedFile(void* addr, size_t size) : addr_(addr), size_(size) {}
+  ~MappedFile() { munmap(addr_, size_); }
+  char* data() const { return static_cast<char*>(addr_); }
+
+ private:
+  void* addr_;
+  size_t size_;
+};
+
+}  // namespace
+
+size_t CheckpointFile::Write(const std::string& path, uint32_t kind, uint32_t seq, uint32_t model_id,
+                             uint32_t server_id, int clock, uint32_t val_size, const std::vector<uint32_t>& server_ids,
+                             const third_party::SArray<Key>& keys, const third_party::SArray<char>& vals,
+                             const std::vector<std::pair<uint32_t, int>>& worker_clocks) {
+  CHECK_EQ(keys.size() * val_size, vals.size());
+  std::vector<int32_t> clocks;  // tid, clock, tid, clock...
+  for (const auto& clock : worker_clocks) {
+    clocks.push_back(clock.first);
+    clocks.push_back(clock.second);
+  }
+  CheckpointHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.format_version = kFormatVersion;
+  header.kind = kind;
+  header.seq = seq;
+  header.model_id = model_id;
+  header.server_id = server_id;
+  header.clock = clock;
+  header.val_size = val_size;
+  header.num_servers = server_ids.size();
+  header.num_workers = worker_clocks.size();
+  header.num_keys = keys.size();
+  header.servers_offset = Align(sizeof(header));
+  header.workers_offset = Align(header.servers_offset + server_ids.size() * sizeof(uint32_t));
+  header.keys_offset = Align(header.workers_offset + clocks.size() * sizeof(int32_t));
+  header.vals_offset = Align(header.keys_offset + keys.size() * sizeof(Key));
+  uint64_t file_size = header.vals_offset + vals.size();
+
+  std::string tmp_path = path + ".tmp";
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (file == nullptr) {
+    LOG(ERROR) << "Cannot open checkpoint file " << tmp_path;
+    return 0;
+  }
+  bool ok = WriteAt(file, 0, &header, sizeof(header)) &&
+            WriteAt(file, header.servers_offset, server_ids.data(), server_ids.size() * sizeof(uint32_t)) &&
+            WriteAt(file, header.workers_offset, clocks.data(), clocks.size() * sizeof(int32_t)) &&
+            WriteAt(file, header.keys_offset, keys.data(), keys.size() * sizeof(Key)) &&
+            WriteAt(file, header.vals_offset, vals.data(), vals.size());
+  // the data must be on disk before the rename makes the file visible
+  ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  ok = (fclose(file) == 0) && ok;
+  if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Failed to write checkpoint file " << path;
+    unlink(tmp_path.c_str());
+    return 0;
+  }
+  if (!SyncDir(path)) {
+    LOG(ERROR) << "Failed to sync the directory of checkpoint file " << path;
+    return 0;
+  }
+  return file_size;
+}
+
+bool CheckpointFile::Read(const std::string& path, CheckpointData* data) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader)) {
+    close(fd);
+    LOG(ERROR) << "Invalid checkpoint file " << path;
+    return false;
+  }
+  size_t file_size = st.st_size;
+  void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "Cannot map checkpoint file " << path;
+    return false;
+  }
+  std::shared_ptr<MappedFile> mapped(new MappedFile(addr, file_size));
+
+  CheckpointHeader& header = data->header;
+  std::memcpy(&header, mapped->data(), sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.format_version != kFormatVersion ||
+      header.servers_offset + header.num_servers * sizeof(uint32_t) > file_size ||
+      header.workers_offset + header.num_workers * 2 * sizeof(int32_t) > file_size ||
+      header.keys_offset + header.num_keys * sizeof(Key) > file_size ||
+      header.vals_offset + header.num_keys * header.val_size > file_size) {
+    LOG(ERROR) << "Invalid checkpoint file " << path;
+    return false;
+  }
+  const uint32_t* servers = reinterpret_cast<const uint32_t*>(mapped->data() + header.servers_offset);
+  data->server_ids.assign(servers, servers + header.num_servers);
+  const int32_t* clocks = reinterpret_cast<const int32_t*>(mapped->data() + header.workers_offset);
+  data->worker_clocks.clear();
+  for (uint32_t i = 0; i < header.num_workers; ++i) {
+    data->worker_clocks.emplace_back(clocks[2 * i], clocks[2 * i + 1]);
+  }
+  // the arrays share the mapping, it is unmapped when both are released
+  data->keys.reset(reinterpret_cast<Key*>(mapped->data() + header.keys_offset), header.num_keys,
+                   [mapped](Key*) {});
+  data->vals.reset(mapped->data() + header.vals_offset, header.num_keys * header.val_size, [mapped](char*) {});
+  return true;
+}
+
+std::string CheckpointFile::GetPath(const std::string& dir, uint32_t model_id, uint32_t server_id) {
+  return dir + "/model_" + std::to_string(model_id) + "_server_" + std::to_string(server_id) + ".ckpt";
+}
+
+std::string CheckpointFile::GetDeltaPath(const std::string& dir, uint32_t model_id, uint32_t server_id,
+                                         uint32_t seq) {
+  return GetPath(dir, model_id, server_id) + "." + std::to_string(seq);
+}
+
+std::vector<uint32_t> CheckpointFile::ListDeltas(const std::string& dir, uint32_t model_id, uint32_t server_id) {
+  std::vector<uint32_t> seqs;
+  // <prefix><seq>, where prefix is the file name of the full checkpoint followed by '.'
+  std::string path = GetPath(dir, model_id, server_id);
+  std::string prefix = path.substr(dir.size() + 1) + ".";
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr) {
+    return seqs;
+  }
+  while (struct dirent* entry = readdir(d)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, prefix.size(), prefix) != 0 || name.size() == prefix.size()) {
+      continue;
+    }
+    char* end;
+    unsigned long seq = std::strtoul(name.c_str() + prefix.size(), &end, 10);
+    if (*end == '\0') {  // skips the temporary files
+      seqs.push_back(seq);
+    }
+  }
+  closedir(d);
+  std::sort(seqs.begin(), seqs.end());
+  return seqs;
+}
+
+void CheckpointFile::Merge(const third_party::SArray<Key>& keys, const third_party::SArray<char>& vals,
+                           const third_party::SArray<Key>& newer_keys, const third_party::SArray<char>& newer_vals,
+                           uint32_t val_size, third_party::SArray<Key>* merged_keys,
+                           third_party::SArray<char>* merged_vals) {
+  CHECK_EQ(keys.size() * val_size, vals.size());
+  CHECK_EQ(newer_keys.size() * val_size, newer_vals.size());
+  third_party::SArray<Key> out_keys(keys.size() + newer_keys.size());
+  third_party::SArray<char> out_vals(out_keys.size() * val_size);
+  size_t i = 0, j = 0, n = 0;
+  while (i < keys.size() || j < newer_keys.size()) {
+    if (j == newer_keys.size() || (i < keys.size() && keys[i] < newer_keys[j])) {
+      out_keys[n] = keys[i];
+      std::memcpy(out_vals.data() + n * val_size, vals.data() + i * val_size, val_size);
+      i++;
+    } else {
+      if (i < keys.size() && keys[i] == newer_keys[j]) {
+        i++;
+      }
+      out_keys[n] = newer_keys[j];
+      std::memcpy(out_vals.data() + n * val_size, newer_vals.data() + j * val_size, val_size);
+      j++;
+    }
+    n++;
+  }
+  out_keys.resize(n);
+  out_vals.resize(n * val_size);
+  *merged_keys = out_keys;
+  *merged_vals = out_vals;
+}
+
+}  // namespace csci5570
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "base/magic.hpp"
+#include "base/third_party/sarray.h"
+
+#include <cinttypes>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * The header of a checkpoint file.
+ *
+ * A checkpoint file holds the shard of one model on one server thread:
+ * [header][server thread ids][worker clocks][keys][vals], each section starting at an 8-byte aligned offset so
+ * that the file can be mapped and used in place. Keys are sorted. The worker clocks are the {tid, clock} of the
+ * worker threads when the shard was dumped, the model resumes from them on restore.
+ *
+ * A full checkpoint holds the whole shard, a delta checkpoint only the entries written since the
+ * previous checkpoint. Deltas are numbered by a sequence number increasing over the life of the
+ * shard, and the shard is the full checkpoint overwritten by the deltas numbered after it in order.
+ */
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t kind;           // CheckpointFile::kFull or CheckpointFile::kDelta
+  uint32_t model_id;
+  uint32_t server_id;      // the server thread owning the shard
+  int32_t clock;           // the min clock when the shard was dumped
+  uint32_t val_size;       // sizeof(Val)
+  uint32_t num_servers;    // partition layout: the server thread ids of the model
+  uint32_t seq;            // delta: its sequence number, full: the last delta merged into it
+  uint32_t num_workers;    // the number of worker clocks
+  uint64_t num_keys;
+  uint64_t servers_offset;
+  uint64_t workers_offset;
+  uint64_t keys_offset;
+  uint64_t vals_offset;
+};
+
+/**
+ * A shard read from a checkpoint file, the arrays point into the mapped file
+ */
+struct CheckpointData {
+  CheckpointHeader header;
+  std::vector<uint32_t> server_ids;
+  std::vector<std::pair<uint32_t, int>> worker_clocks;
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+};
+
+class CheckpointFile {
+ public:
+  static const uint32_t kFormatVersion = 2;
+  static const uint32_t kFull = 0;
+  static const uint32_t kDelta = 1;
+
+  /**
+   * Write a shard to <path> atomically, i.e., to a temporary file renamed when complete
+   *
+   * @return  the number of bytes written, 0 on failure
+   */
+  static size_t Write(const std::string& path, uint32_t kind, uint32_t seq, uint32_t model_id, uint32_t server_id,
+                      int clock, uint32_t val_size, const std::vector<uint32_t>& server_ids,
+                      const third_party::SArray<Key>& keys, const third_party::SArray<char>& vals,
+                      const std::vector<std::pair<uint32_t, int>>& worker_clocks = {});
+
+  /**
+   * Map a checkpoint file and check its header
+   *
+   * @return  false if the file does not exist or is not a valid checkpoint
+   */
+  static bool Read(const std::string& path, CheckpointData* data);
+
+  /**
+   * Return the path of the checkpoint of a shard under a directory
+   */
+  static std::string GetPath(const std::string& dir, uint32_t model_id, uint32_t server_id);
+
+  /**
+   * Return the path of the delta checkpoint <seq> of a shard under a directory
+   */
+  static std::string GetDeltaPath(const std::string& dir, uint32_t model_id, uint32_t server_id, uint32_t seq);
+
+  /**
+   * Return the sequence numbers of the delta checkpoints of a shard under a directory in increasing order
+   */
+  static std::vector<uint32_t> ListDeltas(const std::string& dir, uint32_t model_id, uint32_t server_id);
+
+  /**
+   * Merge two sorted shards, the values of <newer_keys> replace those of the same keys in <keys>
+   */
+  static void Merge(const third_party::SArray<Key>& keys, const third_party::SArray<char>& vals,
+                    const third_party::SArray<Key>& newer_keys, const third_party::SArray<char>& newer_vals,
+                    uint32_t val_size, third_party::SArray<Key>* merged_keys, third_party::SArray<char>* merged_vals);
+};
+
+}  // namespace csci5570
@@ -0,0 +1,361 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "server/map_storage.hpp"
+#include "server/snapshot_storage.hpp"
+#include "server/util/checkpoint.hpp"
+#include "server/util/checkpointer.hpp"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace csci5570 {
+namespace {
+
+class TestCheckpoint : public testing::Test {
+ public:
+  TestCheckpoint() {}
+  ~TestCheckpoint() {}
+
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/csci5570_ckpt_XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    dir_ = dir;
+  }
+  void TearDown() {
+    std::string cmd = "rm -rf " + dir_;
+    system(cmd.c_str());
+  }
+
+  void AddToStorage(AbstractStorage* storage, const std::vector<Key>& keys, const std::vector<float>& vals) {
+    storage->SubAdd(third_party::SArray<Key>(keys), third_party::SArray<char>(third_party::SArray<float>(vals)));
+  }
+
+  std::string dir_;
+};
+
+TEST_F(TestCheckpoint, WriteAndRead) {
+  third_party::SArray<Key> keys({1, 4, 9});
+  third_party::SArray<double> vals({0.5, 1.5, 2.5});
+  std::string path = CheckpointFile::GetPath(dir_, 3, 7);
+  size_t bytes = CheckpointFile::Write(path, CheckpointFile::kFull, 0, 3, 7, 12, sizeof(double), {6, 7},
+                                       keys, third_party::SArray<char>(vals));
+  EXPECT_GT(bytes, sizeof(CheckpointHeader));
+
+  CheckpointData data;
+  ASSERT_TRUE(CheckpointFile::Read(path, &data));
+  EXPECT_EQ(data.header.model_id, 3);
+  EXPECT_EQ(data.header.server_id, 7);
+  EXPECT_EQ(data.header.clock, 12);
+  EXPECT_EQ(data.server_ids, std::vector<uint32_t>({6, 7}));
+  ASSERT_EQ(data.keys.size(), 3);
+  auto read_vals = third_party::SArray<double>(data.vals);
+  ASSERT_EQ(read_vals.size(), 3);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(data.keys[i], keys[i]);
+    EXPECT_EQ(read_vals[i], vals[i]);
+  }
+
+  EXPECT_FALSE(CheckpointFile::Read(CheckpointFile::GetPath(dir_, 3, 8), &data));
+}
+
+TEST_F(TestCheckpoint, DumpAndRestore) {
+  MapStorage<float> storage;
+  AddToStorage(&storage, {9, 2, 5}, {0.9, 0.2, 0.5});
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  storage.Dump(&keys, &vals);
+  ASSERT_EQ(keys.size(), 3);
+  EXPECT_EQ(keys[0], 2);
+  EXPECT_EQ(keys[2], 9);
+
+  // later updates do not change the dump
+  AddToStorage(&storage, {2}, {1.0});
+  EXPECT_FLOAT_EQ(third_party::SArray<float>(vals)[0], 0.2);
+
+  MapStorage<float> restored;
+  AddToStorage(&restored, {100}, {1.0});
+  restored.Restore(keys, vals);
+  auto ret = third_party::SArray<float>(restored.SubGet(third_party::SArray<Key>({2, 5, 9, 100})));
+  EXPECT_FLOAT_EQ(ret[0], 0.2);
+  EXPECT_FLOAT_EQ(ret[1], 0.5);
+  EXPECT_FLOAT_EQ(ret[2], 0.9);
+  EXPECT_FLOAT_EQ(ret[3], 0);
+}
+
+TEST_F(TestCheckpoint, DumpLater) {
+  MapStorage<float> storage;
+  // keys in several chunks
+  AddToStorage(&storage, {1, 2000, 5000}, {0.1, 0.2, 0.5});
+  auto dump = storage.DumpLater();
+
+  // the chunks written after the dump are copied, the dump sees the content when it was taken
+  AddToStorage(&storage, {1, 3000}, {1.0, 0.3});
+  storage.SubAddBatch({third_party::SArray<Key>({2000})},
+                      {third_party::SArray<char>(third_party::SArray<float>({1.0}))});
+  storage.SubGet(third_party::SArray<Key>({5001}));
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  dump(&keys, &vals);
+  ASSERT_EQ(keys.size(), 3);
+  auto typed_vals = third_party::SArray<float>(vals);
+  EXPECT_EQ(keys[0], 1);
+  EXPECT_FLOAT_EQ(typed_vals[0], 0.1);
+  EXPECT_EQ(keys[1], 2000);
+  EXPECT_FLOAT_EQ(typed_vals[1], 0.2);
+  EXPECT_EQ(keys[2], 5000);
+  EXPECT_FLOAT_EQ(typed_vals[2], 0.5);
+
+  auto ret = third_party::SArray<float>(storage.SubGet(third_party::SArray<Key>({1, 2000, 3000, 5000})));
+  EXPECT_FLOAT_EQ(ret[0], 1.1);
+  EXPECT_FLOAT_EQ(ret[1], 1.2);
+  EXPECT_FLOAT_EQ(ret[2], 0.3);
+  EXPECT_FLOAT_EQ(ret[3], 0.5);
+  // the dump starts a new epoch of dirty entries, the key created by the read is not one
+  storage.DumpDirty(&keys, &vals);
+  EXPECT_EQ(std::vector<Key>(keys.begin(), keys.end()), (std::vector<Key>{1, 2000, 3000}));
+}
+
+TEST_F(TestCheckpoint, DumpLaterConcurrent) {
+  MapStorage<float> storage;
+  std::vector<Key> all_keys(100000);
+  for (size_t i = 0; i < all_keys.size(); ++i) {
+    all_keys[i] = i * 7;
+  }
+  AddToStorage(&storage, all_keys, std::vector<float>(all_keys.size(), 1.0));
+  auto dump = storage.DumpLater();
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  std::thread writer([&] { dump(&keys, &vals); });
+  // the server thread keeps updating while the dump is copied out
+  for (int round = 0; round < 3; ++round) {
+    AddToStorage(&storage, all_keys, std::vector<float>(all_keys.size(), 1.0));
+  }
+  writer.join();
+  ASSERT_EQ(keys.size(), all_keys.size());
+  auto typed_vals = third_party::SArray<float>(vals);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(keys[i], all_keys[i]);
+    ASSERT_FLOAT_EQ(typed_vals[i], 1.0);
+  }
+  auto ret = third_party::SArray<float>(storage.SubGet(third_party::SArray<Key>({0, 7 * 99999})));
+  EXPECT_FLOAT_EQ(ret[0], 4.0);
+  EXPECT_FLOAT_EQ(ret[1], 4.0);
+}
+
+TEST_F(TestCheckpoint, WorkerClocks) {
+  std::vector<uint32_t> server_ids({0});
+  MapStorage<float> storage;
+  ProgressTracker tracker;
+  tracker.Init({2, 7});
+  {
+    Checkpointer checkpointer(dir_, 0, 0, server_ids, sizeof(float), 1);
+    AddToStorage(&storage, {3}, {0.3});
+    tracker.AdvanceAndGetChangedMinClock(7);
+    tracker.AdvanceAndGetChangedMinClock(7);
+    checkpointer.MaybeCheckpoint(tracker.AdvanceAndGetChangedMinClock(2), &storage, &tracker);  // full, [1,2]
+    tracker.AdvanceAndGetChangedMinClock(2);
+    tracker.AdvanceAndGetChangedMinClock(7);
+    checkpointer.MaybeCheckpoint(tracker.GetMinClock(), &storage, &tracker);  // delta, [2,3]
+  }
+
+  CheckpointData data;
+  ASSERT_TRUE(CheckpointFile::Read(CheckpointFile::GetPath(dir_, 0, 0), &data));
+  EXPECT_EQ(data.worker_clocks, (std::vector<std::pair<uint32_t, int>>{{2, 1}, {7, 2}}));
+
+  // the workers resume from the clocks of the last delta, a new one from its min clock
+  MapStorage<float> restored;
+  ProgressTracker restored_tracker;
+  EXPECT_EQ(Checkpointer::Restore(dir_, 0, 0, server_ids, sizeof(float), &restored, &restored_tracker), 2);
+  restored_tracker.Init({2, 7, 9});
+  EXPECT_EQ(restored_tracker.GetProgresses(), (std::vector<std::pair<uint32_t, int>>{{2, 2}, {7, 3}, {9, 2}}));
+  EXPECT_EQ(restored_tracker.GetMinClock(), 2);
+}
+
+TEST_F(TestCheckpoint, Checkpointer) {
+  std::vector<uint32_t> server_ids({0, 1});
+  MapStorage<float> storage;
+  {
+    Checkpointer checkpointer(dir_, 0, 1, server_ids, sizeof(float), 2);
+    AddToStorage(&storage, {3, 4}, {0.3, 0.4});
+    checkpointer.MaybeCheckpoint(1, &storage);  // not at the interval
+    checkpointer.MaybeCheckpoint(2, &storage);
+    AddToStorage(&storage, {3}, {1.0});
+    checkpointer.MaybeCheckpoint(2, &storage);  // already checkpointed
+    checkpointer.MaybeCheckpoint(3, &storage);
+  }  // waits for the writes
+
+  MapStorage<float> restored;
+  EXPECT_EQ(Checkpointer::Restore(dir_, 0, 0, server_ids, sizeof(float), &restored), -1);
+  EXPECT_EQ(Checkpointer::Restore(dir_, 0, 1, server_ids, sizeof(float), &restored), 2);
+  auto ret = third_party::SArray<float>(restored.SubGet(third_party::SArray<Key>({3, 4})));
+  EXPECT_FLOAT_EQ(ret[0], 0.3);
+  EXPECT_FLOAT_EQ(ret[1], 0.4);
+}
+
+TEST_F(TestCheckpoint, SnapshotStorage) {
+  std::vector<uint32_t> server_ids({0});
+  SnapshotStorage<float> storage;
+  AddToStorage(&storage, {3, 4}, {0.3, 0.4});
+  storage.FinishIter();
+  AddToStorage(&storage, {5}, {0.5});  // not published yet
+  {
+    Checkpointer checkpointer(dir_, 1, 0, server_ids, sizeof(float), 1);
+    checkpointer.MaybeCheckpoint(1, &storage);
+  }
+  SnapshotStorage<float> restored;
+  EXPECT_EQ(Checkpointer::Restore(dir_, 1, 0, server_ids, sizeof(float), &restored), 1);
+  auto ret = third_party::SArray<float>(restored.SubGet(third_party::SArray<Key>({3, 4, 5})));
+  EXPECT_FLOAT_EQ(ret[0], 0.3);
+  EXPECT_FLOAT_EQ(ret[1], 0.4);
+  EXPECT_FLOAT_EQ(ret[2], 0);
+}
+
+TEST_F(TestCheckpoint, DumpDirty) {
+  MapStorage<float> storage;
+  AddToStorage(&storage, {9, 2, 5}, {0.9, 0.2, 0.5});
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  storage.Dump(&keys, &vals);
+  storage.SubGet(third_party::SArray<Key>({1}));  // reads do not make a key dirty
+  AddToStorage(&storage, {7, 2}, {0.7, 1.0});
+  AddToStorage(&storage, {2}, {1.0});
+  storage.DumpDirty(&keys, &vals);
+  ASSERT_EQ(keys.size(), 2);
+  EXPECT_EQ(keys[0], 2);
+  EXPECT_EQ(keys[1], 7);
+  EXPECT_FLOAT_EQ(third_party::SArray<float>(vals)[0], 2.2);
+  EXPECT_FLOAT_EQ(third_party::SArray<float>(vals)[1], 0.7);
+  storage.DumpDirty(&keys, &vals);
+  EXPECT_EQ(keys.size(), 0);
+}
+
+TEST_F(TestCheckpoint, SnapshotDumpDirty) {
+  SnapshotStorage<float> storage;
+  std::vector<Key> keys(200);
+  for (int i = 0; i < 200; ++i) {
+    keys[i] = 2 * i;
+  }
+  AddToStorage(&storage, keys, std::vector<float>(200, 1.0));
+  storage.FinishIter();
+  third_party::SArray<Key> dump_keys;
+  third_party::SArray<char> dump_vals;
+  storage.Dump(&dump_keys, &dump_vals);
+  // the new keys shift the positions of the dirty ones
+  AddToStorage(&storage, {1, 3, 300, 398}, {0.1, 0.3, 1.0, 1.0});
+  storage.FinishIter();
+  AddToStorage(&storage, {399}, {0.5});  // not published yet
+  storage.DumpDirty(&dump_keys, &dump_vals);
+  ASSERT_EQ(dump_keys.size(), 4);
+  EXPECT_EQ(dump_keys[0], 1);
+  EXPECT_EQ(dump_keys[1], 3);
+  EXPECT_EQ(dump_keys[2], 300);
+  EXPECT_EQ(dump_keys[3], 398);
+  EXPECT_FLOAT_EQ(third_party::SArray<float>(dump_vals)[2], 2.0);
+  storage.FinishIter();
+  storage.DumpDirty(&dump_keys, &dump_vals);
+  ASSERT_EQ(dump_keys.size(), 1);
+  EXPECT_EQ(dump_keys[0], 399);
+}
+
+TEST_F(TestCheckpoint, Merge) {
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  third_party::SArray<int> old_vals({1, 3, 5});
+  third_party::SArray<int> new_vals({0, 30, 60});
+  CheckpointFile::Merge(third_party::SArray<Key>({1, 3, 5}), third_party::SArray<char>(old_vals),
+                        third_party::SArray<Key>({0, 3, 6}), third_party::SArray<char>(new_vals), sizeof(int), &keys,
+                        &vals);
+  auto typed_vals = third_party::SArray<int>(vals);
+  EXPECT_EQ(std::vector<Key>(keys.begin(), keys.end()), std::vector<Key>({0, 1, 3, 5, 6}));
+  EXPECT_EQ(std::vector<int>(typed_vals.begin(), typed_vals.end()), std::vector<int>({0, 1, 30, 5, 60}));
+}
+
+TEST_F(TestCheckpoint, RestoreDeltas) {
+  std::vector<uint32_t> server_ids({0});
+  MapStorage<float> storage;
+  {
+    Checkpointer checkpointer(dir_, 0, 0, server_ids, sizeof(float), 1, 10);
+    AddToStorage(&storage, {1, 2, 3}, {0.1, 0.2, 0.3});
+    checkpointer.MaybeCheckpoint(1, &storage);  // full
+    AddToStorage(&storage, {2, 4}, {1.0, 0.4});
+    checkpointer.MaybeCheckpoint(2, &storage);  // delta
+    AddToStorage(&storage, {4, 5}, {1.0, 0.5});
+    checkpointer.MaybeCheckpoint(3, &storage);  // delta
+  }
+  EXPECT_EQ(CheckpointFile::ListDeltas(dir_, 0, 0), std::vector<uint32_t>({1, 2}));
+  CheckpointData data;
+  ASSERT_TRUE(CheckpointFile::Read(CheckpointFile::GetDeltaPath(dir_, 0, 0, 2), &data));
+  EXPECT_EQ(data.header.kind, CheckpointFile::kDelta);
+  EXPECT_EQ(data.keys.size(), 2);
+
+  MapStorage<float> restored;
+  EXPECT_EQ(Checkpointer::Restore(dir_, 0, 0, server_ids, sizeof(float), &restored), 3);
+  auto ret = third_party::SArray<float>(restored.SubGet(third_party::SArray<Key>({1, 2, 3, 4, 5})));
+  std::vector<float> expected({0.1, 1.2, 0.3, 1.4, 0.5});
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_FLOAT_EQ(ret[i], expected[i]);
+  }
+
+  // a new run starts with a full checkpoint and removes the deltas
+  {
+    Checkpointer checkpointer(dir_, 0, 0, server_ids, sizeof(float), 1, 10);
+    checkpointer.MaybeCheckpoint(4, &restored);
+  }
+  EXPECT_TRUE(CheckpointFile::ListDeltas(dir_, 0, 0).empty());
+  ASSERT_TRUE(CheckpointFile::Read(CheckpointFile::GetPath(dir_, 0, 0), &data));
+  EXPECT_EQ(data.header.seq, 3);
+  EXPECT_EQ(data.keys.size(), 5);
+}
+
+TEST_F(TestCheckpoint, Compact) {
+  std::vector<uint32_t> server_ids({0});
+  SnapshotStorage<float> storage;
+  {
+    Checkpointer checkpointer(dir_, 0, 0, server_ids, sizeof(float), 1, 2);
+    for (int clock = 1; clock <= 4; ++clock) {
+      AddToStorage(&storage, {Key(clock)}, {float(clock)});
+      storage.FinishIter();
+      checkpointer.MaybeCheckpoint(clock, &storage);
+    }
+  }
+  // full at 1, deltas at 2 and 3 are compacted, delta at 4 is left
+  EXPECT_EQ(CheckpointFile::ListDeltas(dir_, 0, 0), std::vector<uint32_t>({3}));
+  CheckpointData data;
+  ASSERT_TRUE(CheckpointFile::Read(CheckpointFile::GetPath(dir_, 0, 0), &data));
+  EXPECT_EQ(data.header.clock, 3);
+  EXPECT_EQ(data.header.seq, 2);
+  EXPECT_EQ(data.keys.size(), 3);
+
+  SnapshotStorage<float> restored;
+  EXPECT_EQ(Checkpointer::Restore(dir_, 0, 0, server_ids, sizeof(float), &restored), 4);
+  auto ret = third_party::SArray<float>(restored.SubGet(third_party::SArray<Key>({1, 2, 3, 4})));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_FLOAT_EQ(ret[i], i + 1);
+  }
+}
+
+TEST_F(TestCheckpoint, IgnoreMergedDeltas) {
+  // deltas left by a compaction that stopped before removing them are already in the full checkpoint
+  std::vector<uint32_t> server_ids({0});
+  auto write = [&](uint32_t kind, uint32_t seq, int clock, float val) {
+    std::string path = kind == CheckpointFile::kFull ? CheckpointFile::GetPath(dir_, 0, 0)
+                                                     : CheckpointFile::GetDeltaPath(dir_, 0, 0, seq);
+    CheckpointFile::Write(path, kind, seq, 0, 0, clock, sizeof(float), server_ids, third_party::SArray<Key>({1}),
+                          third_party::SArray<char>(third_party::SArray<float>({val})));
+  };
+  write(CheckpointFile::kFull, 2, 2, 2.0);
+  write(CheckpointFile::kDelta, 1, 1, 1.0);
+  write(CheckpointFile::kDelta, 2, 2, 2.0);
+  write(CheckpointFile::kDelta, 3, 3, 3.0);
+  MapStorage<float> restored;
+  EXPECT_EQ(Checkpointer::Restore(dir_, 0, 0, server_ids, sizeof(float), &restored), 3);
+  EXPECT_FLOAT_EQ(third_party::SArray<float>(restored.SubGet(third_party::SArray<Key>({1})))[0], 3.0);
+}
+
+}  // namespace
+}  // namespace csci5570
@@ -0,0 +1,241 @@
+#include "server/util/checkpointer.hpp"
+
+#include "glog/logging.h"
+#include "lib/thread_pool.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace csci5570 {
+
+const int Checkpointer::kDefaultCompactEvery;
+
+namespace {
+
+void CheckShard(const std::string& path, const CheckpointData& data, uint32_t model_id, uint32_t server_id,
+                const std::vector<uint32_t>& server_ids, uint32_t val_size) {
+  CHECK(data.header.model_id == model_id && data.header.server_id == server_id) << "Checkpoint " << path
+                                                                                  << " belongs to another shard";
+  CHECK(data.server_ids == server_ids) << "Checkpoint " << path << " was written with another partition layout";
+  CHECK_EQ(data.header.val_size, val_size) << "Checkpoint " << path << " was written with another value type";
+}
+
+}  // namespace
+
+Checkpointer::Checkpointer(const std::string& dir, uint32_t model_id, uint32_t server_id,
+                           const std::vector<uint32_t>& server_ids, uint32_t val_size, int interval, int compact_every)
+    : dir_(dir), model_id_(model_id), server_id_(server_id), server_ids_(server_ids), val_size_(val_size),
+      interval_(interval), compact_every_(compact_every), next_seq_(0) {
+  CHECK_GT(interval, 0);
+  CHECK_GT(compact_every, 0);
+  // continue the sequence numbers of the files already there, so that they are never reused
+  CheckpointData data;
+  if (CheckpointFile::Read(CheckpointFile::GetPath(dir_, model_id_, server_id_), &data)) {
+    next_seq_ = data.header.seq + 1;
+  }
+  std::vector<uint32_t> seqs = CheckpointFile::ListDeltas(dir_, model_id_, server_id_);
+  if (!seqs.empty()) {
+    next_seq_ = std::max(next_seq_, seqs.back() + 1);
+  }
+  writer_thread_ = std::thread([this] { Main(); });
+}
+
+Checkpointer::~Checkpointer() {
+  Job exit_job;
+  exit_job.exit = true;
+  jobs_.Push(exit_job);
+  writer_thread_.join();
+}
+
+void Checkpointer::MaybeCheckpoint(int min_clock, AbstractStorage* storage, const ProgressTracker* tracker) {
+  if (storage == nullptr || min_clock <= last_clock_ || min_clock % interval_ != 0) {
+    return;
+  }
+  last_clock_ = min_clock;
+  Job job;
+  job.clock = min_clock;
+  job.seq = next_seq_++;
+  if (tracker != nullptr) {
+    job.worker_clocks = tracker->GetProgresses();
+  }
+  if (need_full_.exchange(false)) {
+    job.kind = CheckpointFile::kFull;
+    job.dump = storage->DumpLater();
+  } else {
+    job.kind = CheckpointFile::kDelta;
+    storage->DumpDirty(&job.keys, &job.vals);
+  }
+  jobs_.Push(std::move(job));
+}
+
+bool Checkpointer::Load(const std::string& dir, uint32_t model_id, uint32_t server_id,
+                        const std::vector<uint32_t>& server_ids, uint32_t val_size, CheckpointHeader* header,
+                        std::vector<std::pair<uint32_t, int>>* worker_clocks, third_party::SArray<Key>* keys,
+                        third_party::SArray<char>* vals) {
+  std::vector<std::string> paths;
+  std::vector<CheckpointData> data(1);
+  paths.push_back(CheckpointFile::GetPath(dir, model_id, server_id));
+  if (!CheckpointFile::Read(paths[0], &data[0])) {
+    return false;
+  }
+  CheckShard(paths[0], data[0], model_id, server_id, server_ids, val_size);
+  // the deltas not merged into the full checkpoint yet
+  for (uint32_t seq : CheckpointFile::ListDeltas(dir, model_id, server_id)) {
+    if (seq <= data[0].header.seq) {
+      continue;
+    }
+    paths.push_back(CheckpointFile::GetDeltaPath(dir, model_id, server_id, seq));
+    data.emplace_back();
+  }
+
+  // read the files in parallel on a bounded pool, each reader copies its files out of the mapping
+  size_t n = paths.size();
+  int num_threads = std::max(1, static_cast<int>(std::min<size_t>(n, std::thread::hardware_concurrency())));
+  lib::ThreadPool pool(num_threads);
+  std::vector<third_party::SArray<Key>> all_keys(n);
+  std::vector<third_party::SArray<char>> all_vals(n);
+  std::vector<char> ok(n, true);
+  pool.ParallelFor(n, [&](int, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i > 0 && !CheckpointFile::Read(paths[i], &data[i])) {
+        ok[i] = false;
+        continue;
+      }
+      all_keys[i].CopyFrom(data[i].keys);
+      all_vals[i].CopyFrom(data[i].vals);
+    }
+  });
+  // a delta is only valid on top of all the previous ones
+  for (size_t i = 1; i < n; ++i) {
+    if (!ok[i]) {
+      LOG(ERROR) << "Cannot read checkpoint " << paths[i] << ", ignore it and the deltas after it";
+      n = i;
+      break;
+    }
+    CheckShard(paths[i], data[i], model_id, server_id, server_ids, val_size);
+  }
+
+  // merge pairs of neighbours in parallel until a single shard is left, the newer values win
+  for (size_t step = 1; step < n; step *= 2) {
+    size_t num_pairs = (n - step + 2 * step - 1) / (2 * step);
+    pool.ParallelFor(num_pairs, [&, step](int, size_t begin, size_t end) {
+      for (size_t pair = begin; pair < end; ++pair) {
+        size_t i = pair * 2 * step;
+        CheckpointFile::Merge(all_keys[i], all_vals[i], all_keys[i + step], all_vals[i + step], val_size,
+                              &all_keys[i], &all_vals[i]);
+      }
+    });
+  }
+  *header = data[n - 1].header;
+  *worker_clocks = data[n - 1].worker_clocks;
+  *keys = all_keys[0];
+  *vals = all_vals[0];
+  VLOG(1) << "Loaded checkpoint " << paths[0] << " with " << n - 1 << " deltas";
+  return true;
+}
+
+int Checkpointer::Restore(const std::string& dir, uint32_t model_id, uint32_t server_id,
+                          const std::vector<uint32_t>& server_ids, uint32_t val_size, AbstractStorage* storage,
+                          ProgressTracker* tracker) {
+  CheckpointHeader header;
+  std::vector<std::pair<uint32_t, int>> worker_clocks;
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  auto start = std::chrono::steady_clock::now();
+  if (!Load(dir, model_id, server_id, server_ids, val_size, &header, &worker_clocks, &keys, &vals)) {
+    return -1;
+  }
+  storage->Restore(keys, vals);
+  if (tracker != nullptr) {
+    // the workers unknown to the checkpoint start from its min clock
+    tracker->SetStartClocks(worker_clocks, header.clock);
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  LOG(INFO) << "Restored " << keys.size() << " keys of model " << model_id << " on server " << server_id
+            << " at clock " << header.clock << " in " << seconds << "s";
+  return header.clock;
+}
+
+int Checkpointer::GetLastWrittenClock() {
+  std::lock_guard<std::mutex> lk(mu_);
+  return last_written_clock_;
+}
+
+void Checkpointer::Main() {
+  bool broken = false;  // a write failed, the deltas are useless until the next full checkpoint
+  while (true) {
+    Job job;
+    jobs_.WaitAndPop(&job);
+    if (job.exit) {
+      break;
+    }
+    if (job.kind == CheckpointFile::kDelta && broken) {
+      continue;
+    }
+    broken = false;
+    auto start = std::chrono::steady_clock::now();
+    if (job.dump) {
+      job.dump(&job.keys, &job.vals);
+      job.dump = nullptr;
+    }
+    std::string path = job.kind == CheckpointFile::kFull
+                           ? CheckpointFile::GetPath(dir_, model_id_, server_id_)
+                           : CheckpointFile::GetDeltaPath(dir_, model_id_, server_id_, job.seq);
+    size_t bytes = CheckpointFile::Write(path, job.kind, job.seq, model_id_, server_id_, job.clock, val_size_,
+                                         server_ids_, job.keys, job.vals, job.worker_clocks);
+    if (bytes == 0) {
+      broken = true;
+      need_full_ = true;
+      continue;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    VLOG(1) << "Checkpointed model " << model_id_ << " on server " << server_id_ << " at clock " << job.clock << ": "
+            << job.keys.size() << " keys (" << (job.kind == CheckpointFile::kFull ? "full" : "delta") << "), "
+            << bytes << " bytes in " << seconds << "s";
+    if (job.kind == CheckpointFile::kFull) {
+      num_deltas_ = 0;
+      RemoveDeltas(job.seq);
+    } else if (++num_deltas_ >= compact_every_) {
+      Compact();
+    }
+    std::lock_guard<std::mutex> lk(mu_);
+    last_written_clock_ = job.clock;
+  }
+}
+
+void Checkpointer::Compact() {
+  auto start = std::chrono::steady_clock::now();
+  CheckpointHeader header;
+  std::vector<std::pair<uint32_t, int>> worker_clocks;
+  third_party::SArray<Key> keys;
+  third_party::SArray<char> vals;
+  if (!Load(dir_, model_id_, server_id_, server_ids_, val_size_, &header, &worker_clocks, &keys, &vals)) {
+    return;
+  }
+  // the new full checkpoint replaces the old one before the deltas are removed, replaying the
+  // deltas again on top of it gives the same shard
+  size_t bytes = CheckpointFile::Write(CheckpointFile::GetPath(dir_, model_id_, server_id_), CheckpointFile::kFull,
+                                       header.seq, model_id_, server_id_, header.clock, val_size_, server_ids_, keys,
+                                       vals, worker_clocks);
+  if (bytes == 0) {
+    return;
+  }
+  RemoveDeltas(header.seq);
+  num_deltas_ = 0;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  VLOG(1) << "Compacted checkpoint of model " << model_id_ << " on server " << server_id_ << " at clock "
+          << header.clock << ": " << bytes << " bytes in " << seconds << "s";
+}
+
+void Checkpointer::RemoveDeltas(uint32_t seq) {
+  for (uint32_t delta_seq : CheckpointFile::ListDeltas(dir_, model_id_, server_id_)) {
+    if (delta_seq <= seq) {
+      unlink(CheckpointFile::GetDeltaPath(dir_, model_id_, server_id_, delta_seq).c_str());
+    }
+  }
+}
+
+}  // namespace csci5570
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "base/magic.hpp"
+#include "base/threadsafe_queue.hpp"
+#include "base/third_party/sarray.h"
+#include "server/abstract_storage.hpp"
+#include "server/util/checkpoint.hpp"
+#include "server/util/progress_tracker.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * Periodically checkpoints the shard of a model held by a server thread.
+ *
+ * At every <interval>-th min clock the storage is dumped into immutable arrays, and a background
+ * thread writes them to disk while training goes on. A full dump is only taken on the server thread
+ * (DumpLater), the background thread copies it out. The clocks of the workers are saved along with
+ * the shard, so that the model resumes from them.
+ *
+ * The first checkpoint is a full one, the following ones are deltas holding the entries written
+ * since the previous checkpoint. Every <compact_every> deltas the background thread compacts them
+ * into a new full checkpoint and removes them.
+ */
+class Checkpointer {
+ public:
+  /**
+   * @param dir         the directory of the checkpoint files
+   * @param model_id    the model id
+   * @param server_id   the server thread holding the shard
+   * @param server_ids  the partition layout, i.e., the server threads of the model
+   * @param val_size    sizeof(Val) of the model
+   * @param interval    the number of clocks between checkpoints
+   * @param compact_every the number of deltas merged into the full checkpoint at once
+   */
+  Checkpointer(const std::string& dir, uint32_t model_id, uint32_t server_id, const std::vector<uint32_t>& server_ids,
+               uint32_t val_size, int interval, int compact_every = kDefaultCompactEvery);
+  /**
+   * Finish the pending writes
+   */
+  ~Checkpointer();
+
+  /**
+   * Called by the server thread after a clock, checkpoint the storage if the min clock reaches the interval
+   *
+   * @param tracker the progresses of the workers saved with the shard, if not nullptr
+   */
+  void MaybeCheckpoint(int min_clock, AbstractStorage* storage, const ProgressTracker* tracker = nullptr);
+
+  /**
+   * Restore the shard from its full checkpoint and the deltas after it, which are read in parallel
+   *
+   * @param tracker the tracker whose workers start from the restored clocks, if not nullptr
+   * @return  the clock of the restored checkpoint, -1 if there is no checkpoint
+   */
+  static int Restore(const std::string& dir, uint32_t model_id, uint32_t server_id,
+                     const std::vector<uint32_t>& server_ids, uint32_t val_size, AbstractStorage* storage,
+                     ProgressTracker* tracker = nullptr);
+
+  /**
+   * Return the clock of the last checkpoint written to disk, -1 if none
+   */
+  int GetLastWrittenClock();
+
+  static const int kDefaultCompactEvery = 8;
+
+ private:
+  struct Job {
+    int clock = -1;
+    uint32_t kind = 0;
+    uint32_t seq = 0;
+    third_party::SArray<Key> keys;
+    third_party::SArray<char> vals;
+    AbstractStorage::DumpFn dump;  // fills keys and vals on the writer thread, if set
+    std::vector<std::pair<uint32_t, int>> worker_clocks;
+    bool exit = false;
+  };
+
+  /**
+   * Read the full checkpoint of a shard and merge the deltas after it
+   *
+   * @return  false if there is no full checkpoint
+   */
+  static bool Load(const std::string& dir, uint32_t model_id, uint32_t server_id,
+                   const std::vector<uint32_t>& server_ids, uint32_t val_size, CheckpointHeader* header,
+                   std::vector<std::pair<uint32_t, int>>* worker_clocks, third_party::SArray<Key>* keys,
+                   third_party::SArray<char>* vals);
+
+  void Main();
+  // Merge the full checkpoint and the deltas into a new full checkpoint, and remove the deltas
+  void Compact();
+  // Remove the deltas up to <seq>
+  void RemoveDeltas(uint32_t seq);
+
+  std::string dir_;
+  uint32_t model_id_;
+  uint32_t server_id_;
+  std::vector<uint32_t> server_ids_;
+  uint32_t val_size_;
+  int interval_;
+  int compact_every_;
+  int last_clock_ = -1;  // the last checkpointed clock, server thread only
+  uint32_t next_seq_;    // server thread only
+  // set when the next checkpoint must be a full one, i.e., at first and after a failed write
+  std::atomic<bool> need_full_{true};
+  int num_deltas_ = 0;   // the deltas written since the last full checkpoint, writer thread only
+
+  std::mutex mu_;
+  int last_written_clock_ = -1;
+
+  ThreadsafeQueue<Job> jobs_;
+  std::thread writer_thread_;
+};
+
+}  // namespace csci5570
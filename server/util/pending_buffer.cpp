@@ -1,28 +1,87 @@
 #include "server/util/pending_buffer.hpp"
 
+#include "glog/logging.h"
+
+#include <algorithm>
+
 namespace csci5570 {
 
+PendingBuffer::PendingBuffer(int num_slots) : slots_(num_slots > 0 ? num_slots : 1) {}
+
 std::vector<Message> PendingBuffer::Pop(const int clock) {
-  auto it = buffer_.find(clock);
   std::vector<Message> msgs;
-  if (it != buffer_.end()) {
-    msgs = it->second;
-    buffer_.erase(it);
+  Slot& slot = slots_[SlotIndex(clock)];
+  if (slot.clock == clock && !slot.msgs.empty()) {
+    msgs.swap(slot.msgs);
+    total_size_ -= msgs.size();
   }
   return msgs;
 }
 
-void PendingBuffer::Push(const int clock, Message& msg) {
-  if (buffer_.find(clock) == buffer_.end()) {
-    buffer_[clock] = std::vector<Message>();
+void PendingBuffer::Push(const int clock, Message&& msg) {
+  Slot* slot = &slots_[SlotIndex(clock)];
+  if (slot->clock != clock && !slot->msgs.empty()) {
+    // the slot is taken by another clock, the window is wider than the ring
+    Grow(clock);
+    slot = &slots_[SlotIndex(clock)];
   }
-  buffer_[clock].push_back(msg);
+  slot->clock = clock;
+  slot->msgs.push_back(std::move(msg));
+  total_size_ += 1;
+  max_total_size_ = std::max(max_total_size_, total_size_);
+}
+
+void PendingBuffer::Push(const int clock, const Message& msg) {
+  Push(clock, Message(msg));
 }
 
 int PendingBuffer::Size(const int progress) {
-  auto it = buffer_.find(progress);
-  if (it == buffer_.end()) {return 0;}
-  return buffer_[progress].size();
+  const Slot& slot = slots_[SlotIndex(progress)];
+  if (slot.clock != progress) {return 0;}
+  return slot.msgs.size();
+}
+
+int PendingBuffer::TotalSize() const {
+  return total_size_;
+}
+
+int PendingBuffer::MaxTotalSize() const {
+  return max_total_size_;
+}
+
+size_t PendingBuffer::SlotIndex(const int clock) const {
+  int num_slots = slots_.size();
+  return ((clock % num_slots) + num_slots) % num_slots;
+}
+
+void PendingBuffer::Grow(const int clock) {
+  std::vector<Slot> old_slots;
+  old_slots.swap(slots_);
+  size_t num_slots = old_slots.size();
+  bool collision = true;
+  while (collision) {
+    num_slots *= 2;
+    slots_.assign(num_slots, Slot());
+    collision = false;
+    std::vector<bool> taken(num_slots, false);
+    taken[SlotIndex(clock)] = true;
+    for (const auto& slot : old_slots) {
+      if (slot.msgs.empty()) {continue;}
+      size_t index = SlotIndex(slot.clock);
+      if (taken[index]) {
+        collision = true;
+        break;
+      }
+      taken[index] = true;
+    }
+  }
+  for (auto& slot : old_slots) {
+    if (slot.msgs.empty()) {continue;}
+    Slot& new_slot = slots_[SlotIndex(slot.clock)];
+    new_slot.clock = slot.clock;
+    new_slot.msgs.swap(slot.msgs);
+  }
+  VLOG(1) << "PendingBuffer grows to " << num_slots << " slots for clock " << clock;
 }
 
 }  // namespace csci5570
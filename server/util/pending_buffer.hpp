@@ -2,12 +2,24 @@
 
 #include "base/message.hpp"
 
-#include <unordered_map>
+#include <vector>
 
 namespace csci5570 {
 
+/**
+ * Requests held back by the consistency control, indexed by the clock at which they can be served.
+ *
+ * Pending clocks are bounded by the staleness window, so the buffer is a ring of clock slots
+ * (slot = clock % num_slots) that only grows if a clock falls outside the window.
+ * Messages are moved in and out, so a request is never copied while it waits.
+ */
 class PendingBuffer {
   public:
+  /**
+   * @param num_slots   the initial number of clock slots, e.g., staleness + 2
+   */
+  explicit PendingBuffer(int num_slots = 2);
+  virtual ~PendingBuffer() {}
   /**
    * Return the pending requests at the specific progress clock
    */
@@ -15,14 +27,33 @@ class PendingBuffer {
   /**
    * Add the pending requests at the specific progress clock
    */
-  virtual void Push(const int clock, Message& message);
+  virtual void Push(const int clock, Message&& message);
+  virtual void Push(const int clock, const Message& message);
   /**
    * Return the number of pending requests at the specific progress
    */
   virtual int Size(const int progress);
+  /**
+   * Return the number of pending requests over all clocks
+   */
+  int TotalSize() const;
+  /**
+   * Return the largest number of pending requests ever held at once
+   */
+  int MaxTotalSize() const;
 
   private:
-  std::map<int, std::vector<Message>> buffer_;
+  struct Slot {
+    int clock = 0;
+    std::vector<Message> msgs;
+  };
+
+  size_t SlotIndex(const int clock) const;
+  void Grow(const int clock);
+
+  std::vector<Slot> slots_;
+  int total_size_ = 0;
+  int max_total_size_ = 0;
 };
 
 }  // namespace csci5570
@@ -57,5 +57,59 @@ TEST_F(TestPendingBuffer, PushAndPop) {
   EXPECT_EQ(messages_1.size(), 1);
 }
 
+TEST_F(TestPendingBuffer, RingWrapAround) {
+  PendingBuffer pending_buffer(2);
+  Message m;
+  m.meta.flag = Flag::kGet;
+  third_party::SArray<int> keys({0});
+  m.AddData(keys);
+
+  // slots are reused once the clocks are popped
+  for (int clock = 0; clock < 10; ++clock) {
+    pending_buffer.Push(clock, m);
+    pending_buffer.Push(clock + 1, m);
+    EXPECT_EQ(pending_buffer.Size(clock), 1);
+    EXPECT_EQ(pending_buffer.Pop(clock).size(), 1);
+    EXPECT_EQ(pending_buffer.Size(clock), 0);
+    EXPECT_EQ(pending_buffer.Pop(clock + 1).size(), 1);
+  }
+  EXPECT_EQ(pending_buffer.TotalSize(), 0);
+  EXPECT_EQ(pending_buffer.MaxTotalSize(), 2);
+}
+
+TEST_F(TestPendingBuffer, GrowBeyondWindow) {
+  PendingBuffer pending_buffer(2);
+  Message m;
+  m.meta.flag = Flag::kGet;
+  for (int clock = 3; clock < 10; ++clock) {
+    pending_buffer.Push(clock, m);
+  }
+  pending_buffer.Push(5, m);
+  EXPECT_EQ(pending_buffer.TotalSize(), 8);
+  for (int clock = 3; clock < 10; ++clock) {
+    EXPECT_EQ(pending_buffer.Size(clock), clock == 5 ? 2 : 1);
+  }
+  for (int clock = 3; clock < 10; ++clock) {
+    EXPECT_EQ(pending_buffer.Pop(clock).size(), clock == 5 ? 2 : 1);
+  }
+  EXPECT_EQ(pending_buffer.TotalSize(), 0);
+  EXPECT_EQ(pending_buffer.MaxTotalSize(), 8);
+}
+
+TEST_F(TestPendingBuffer, PushByMove) {
+  PendingBuffer pending_buffer;
+  Message m;
+  m.meta.flag = Flag::kGet;
+  third_party::SArray<int> keys({0, 1, 2});
+  m.AddData(keys);
+  const char* payload = m.data[0].data();
+
+  pending_buffer.Push(1, std::move(m));
+  std::vector<Message> msgs = pending_buffer.Pop(1);
+  ASSERT_EQ(msgs.size(), 1);
+  ASSERT_EQ(msgs[0].data.size(), 1);
+  EXPECT_EQ(msgs[0].data[0].data(), payload);
+}
+
 }  // namespace
 }  // namespace csci5570
@@ -8,22 +8,73 @@ void ProgressTracker::Init(const std::vector<uint32_t>& tids) {
   // should this method clear all progresses ?
 //  progresses_.clear();
   for (auto tid : tids) {
-    progresses_[tid] = 0;
+    auto it = start_clocks_.find(tid);
+    progresses_[tid] = it == start_clocks_.end() ? default_start_clock_ : it->second;
   }
+  // rebuild the clock histogram, the only O(n) operation of the tracker
   min_clock_ = 0;
+  if (!progresses_.empty()) {
+    min_clock_ = std::min_element(progresses_.begin(), progresses_.end(),
+                                  [](const std::pair<const int, int>& a, const std::pair<const int, int>& b) {
+                                    return a.second < b.second;
+                                  })->second;
+  }
+  clock_counts_.clear();
+  for (const auto& entry : progresses_) {
+    size_t offset = entry.second - min_clock_;
+    if (offset >= clock_counts_.size()) {
+      clock_counts_.resize(offset + 1, 0);
+    }
+    clock_counts_[offset] += 1;
+  }
+}
+
+void ProgressTracker::SetStartClocks(const std::vector<std::pair<uint32_t, int>>& clocks, int default_clock) {
+  start_clocks_.clear();
+  for (const auto& clock : clocks) {
+    start_clocks_[clock.first] = clock.second;
+  }
+  default_start_clock_ = default_clock;
 }
 
 int ProgressTracker::AdvanceAndGetChangedMinClock(int tid) {
-  if (!CheckThreadValid(tid)) {
+  auto it = progresses_.find(tid);
+  if (it == progresses_.end()) {
+    return -1;
+  }
+  size_t offset = it->second - min_clock_;
+  it->second += 1;
+  clock_counts_[offset] -= 1;
+  if (offset + 1 == clock_counts_.size()) {
+    clock_counts_.push_back(0);
+  }
+  clock_counts_[offset + 1] += 1;
+  // the window slides by exactly one clock when the last thread leaves the min clock
+  if (offset == 0 && clock_counts_.front() == 0) {
+    clock_counts_.pop_front();
+    min_clock_ += 1;
+    return min_clock_;
+  }
+  return -1;
+}
+
+int ProgressTracker::RemoveThread(int tid) {
+  auto it = progresses_.find(tid);
+  if (it == progresses_.end()) {
     return -1;
   }
-  int changed_min_clock = -1;
-  if (IsUniqueMin(tid)) {
+  clock_counts_[it->second - min_clock_] -= 1;
+  progresses_.erase(it);
+  if (progresses_.empty()) {
+    clock_counts_.clear();
+    return -1;
+  }
+  int old_min_clock = min_clock_;
+  while (clock_counts_.front() == 0) {
+    clock_counts_.pop_front();
     min_clock_ += 1;
-    changed_min_clock = min_clock_;
   }
-  progresses_[tid] += 1;
-  return changed_min_clock;
+  return min_clock_ == old_min_clock ? -1 : min_clock_;
 }
 
 int ProgressTracker::GetNumThreads() const {
@@ -31,10 +82,17 @@ int ProgressTracker::GetNumThreads() const {
 }
 
 int ProgressTracker::GetProgress(int tid) const {
-  if (!CheckThreadValid(tid)) {
+  auto it = progresses_.find(tid);
+  if (it == progresses_.end()) {
     return -1;
   }
-  return progresses_.find(tid)->second;
+  return it->second;
+}
+
+std::vector<std::pair<uint32_t, int>> ProgressTracker::GetProgresses() const {
+  std::vector<std::pair<uint32_t, int>> progresses(progresses_.begin(), progresses_.end());
+  std::sort(progresses.begin(), progresses.end());
+  return progresses;
 }
 
 int ProgressTracker::GetMinClock() const {
@@ -46,9 +104,7 @@ bool ProgressTracker::IsUniqueMin(int tid) const {
   if (progress == -1 || progress > min_clock_) {
     return false;
   }
-  return std::count_if(progresses_.begin(), progresses_.end(), [this](const std::pair<int, int> entry) {
-    return entry.second == min_clock_;
-  }) == 1;
+  return clock_counts_.front() == 1;
 }
 
 bool ProgressTracker::CheckThreadValid(int tid) const {
@@ -1,13 +1,35 @@
 #pragma once
 
-#include <map>
+#include <cinttypes>
+#include <deque>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace csci5570 {
 
+/**
+ * Tracks the clock of every worker thread of a model.
+ *
+ * Besides the per-thread progress, the tracker keeps the number of threads sitting at each clock
+ * in the window [min_clock_, max progress], so advancing a thread and querying the slowest progress
+ * are both O(1) regardless of the number of workers.
+ */
 class ProgressTracker {
  public:
+  /**
+   * Register worker threads, each starting at its start clock
+   *
+   * @param tids worker thread ids
+   */
   void Init(const std::vector<uint32_t>& tids);
+  /**
+   * Set the clocks the worker threads start from in later Init calls, e.g., those restored from a checkpoint
+   *
+   * @param clocks        {tid: clock} of the threads known to the checkpoint
+   * @param default_clock the clock of the other threads
+   */
+  void SetStartClocks(const std::vector<std::pair<uint32_t, int>>& clocks, int default_clock);
   /**
    * Advance the progress of a worker thread
    * Return -1 if min_clock_ does not change,
@@ -16,12 +38,24 @@ class ProgressTracker {
    * @param tid worker thread id
    */
   int AdvanceAndGetChangedMinClock(int tid);
+  /**
+   * Remove a worker thread, e.g., a failed one, from the trace
+   * Return -1 if min_clock_ does not change,
+   * return min_clock_ otherwise, which may have advanced by several clocks.
+   *
+   * @param tid worker thread id
+   */
+  int RemoveThread(int tid);
   /**
    * Get the progress of a worker thread
    *
    * @param tid worker thread id
    */
   int GetProgress(int tid) const;
+  /**
+   * Get the progresses of all the worker threads as {tid: progress} sorted by tid
+   */
+  std::vector<std::pair<uint32_t, int>> GetProgresses() const;
   /**
    * Get the progress of the slowest worker
    */
@@ -44,8 +78,11 @@ class ProgressTracker {
   bool CheckThreadValid(int tid) const;
 
  private:
-  std::map<int, int> progresses_;  // {tid: progress}
-  int min_clock_;                  // the slowest progress
+  std::unordered_map<int, int> progresses_;  // {tid: progress}
+  std::deque<int> clock_counts_;             // clock_counts_[i]: number of threads at clock min_clock_ + i
+  int min_clock_ = 0;                        // the slowest progress
+  std::unordered_map<int, int> start_clocks_;  // {tid: clock} the threads start from, default_start_clock_ if absent
+  int default_start_clock_ = 0;
 };
 
 }  // namespace csci5570
@@ -46,5 +46,86 @@ TEST_F(TestProgressTracker, Advance) {
   EXPECT_EQ(tracker.GetProgress(7), 3);
 }
 
+TEST_F(TestProgressTracker, IsUniqueMin) {
+  ProgressTracker tracker;
+  tracker.Init({2, 7, 9});
+  EXPECT_FALSE(tracker.IsUniqueMin(2));
+  EXPECT_FALSE(tracker.IsUniqueMin(3));
+  tracker.AdvanceAndGetChangedMinClock(2);  // [1,0,0]
+  EXPECT_FALSE(tracker.IsUniqueMin(2));
+  EXPECT_FALSE(tracker.IsUniqueMin(7));
+  tracker.AdvanceAndGetChangedMinClock(7);  // [1,1,0]
+  EXPECT_TRUE(tracker.IsUniqueMin(9));
+  EXPECT_FALSE(tracker.IsUniqueMin(2));
+}
+
+TEST_F(TestProgressTracker, ManyWorkers) {
+  const int num_threads = 1000;
+  std::vector<uint32_t> tids;
+  for (int i = 0; i < num_threads; ++i) {
+    tids.push_back(i);
+  }
+  ProgressTracker tracker;
+  tracker.Init(tids);
+  for (int iter = 0; iter < 5; ++iter) {
+    // the min clock changes only when the last thread of the slowest clock advances
+    for (int i = num_threads - 1; i > 0; --i) {
+      EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(i), -1);
+    }
+    EXPECT_TRUE(tracker.IsUniqueMin(0));
+    EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(0), iter + 1);
+    EXPECT_EQ(tracker.GetMinClock(), iter + 1);
+  }
+  // a fast thread running ahead keeps the min clock unchanged
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(42), -1);
+  }
+  EXPECT_EQ(tracker.GetProgress(42), 15);
+  EXPECT_EQ(tracker.GetMinClock(), 5);
+}
+
+TEST_F(TestProgressTracker, ReInit) {
+  ProgressTracker tracker;
+  tracker.Init({2, 7});
+  tracker.AdvanceAndGetChangedMinClock(2);
+  tracker.AdvanceAndGetChangedMinClock(7);
+  tracker.AdvanceAndGetChangedMinClock(7);  // [1,2]
+  tracker.Init({2, 8});                     // [0,2,0]
+  EXPECT_EQ(tracker.GetMinClock(), 0);
+  EXPECT_EQ(tracker.GetNumThreads(), 3);
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(2), -1);  // [1,2,0]
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(8), 1);   // [1,2,1]
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(8), -1);  // [1,2,2]
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(2), 2);   // [2,2,2]
+}
+
+TEST_F(TestProgressTracker, RemoveThread) {
+  ProgressTracker tracker;
+  tracker.Init({1, 2, 3});
+  for (int i = 0; i < 3; ++i) {
+    tracker.AdvanceAndGetChangedMinClock(2);
+  }
+  tracker.AdvanceAndGetChangedMinClock(3);      // [0,3,1]
+  EXPECT_EQ(tracker.RemoveThread(3), -1);       // [0,3]
+  EXPECT_EQ(tracker.RemoveThread(4), -1);       // not in the trace
+  EXPECT_EQ(tracker.RemoveThread(1), 3);        // [3], skips the empty clocks
+  EXPECT_FALSE(tracker.CheckThreadValid(1));
+  EXPECT_EQ(tracker.GetNumThreads(), 1);
+  EXPECT_TRUE(tracker.IsUniqueMin(2));
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(2), 4);
+  EXPECT_EQ(tracker.RemoveThread(2), -1);       // no thread left
+  EXPECT_EQ(tracker.GetNumThreads(), 0);
+}
+
+TEST_F(TestProgressTracker, StartClocks) {
+  ProgressTracker tracker;
+  tracker.SetStartClocks({{2, 5}, {7, 6}}, 5);
+  tracker.Init({2, 7, 9});  // [5,6,5], 9 is not in the checkpoint
+  EXPECT_EQ(tracker.GetMinClock(), 5);
+  EXPECT_EQ(tracker.GetProgresses(), (std::vector<std::pair<uint32_t, int>>{{2, 5}, {7, 6}, {9, 5}}));
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(2), -1);  // [6,6,5]
+  EXPECT_EQ(tracker.AdvanceAndGetChangedMinClock(9), 6);   // [6,6,6]
+}
+
 }  // namespace
 }  // namespace csci5570
@@ -0,0 +1,43 @@
+#include "server/util/reader_pool.hpp"
+
+#include "glog/logging.h"
+
+namespace csci5570 {
+
+const int ReaderPool::kDefaultNumThreads;
+
+ReaderPool::ReaderPool(AbstractStorage* storage, ThreadsafeQueue<Message>* reply_queue, int num_threads)
+    : storage_(storage), reply_queue_(reply_queue) {
+  CHECK_GT(num_threads, 0);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.push_back(std::thread([this] { Main(); }));
+  }
+}
+
+ReaderPool::~ReaderPool() {
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    Message exit_msg;
+    exit_msg.meta.flag = Flag::kExit;
+    get_queue_.Push(exit_msg);
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ReaderPool::Serve(Message&& msg) {
+  get_queue_.Push(std::move(msg));
+}
+
+void ReaderPool::Main() {
+  while (true) {
+    Message msg;
+    get_queue_.WaitAndPop(&msg);
+    if (msg.meta.flag == Flag::kExit) {
+      break;
+    }
+    reply_queue_->Push(storage_->Get(msg));
+  }
+}
+
+}  // namespace csci5570
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "base/message.hpp"
+#include "base/threadsafe_queue.hpp"
+#include "server/abstract_storage.hpp"
+
+#include <thread>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * A group of threads answering Get requests off the server thread.
+ *
+ * Only usable with a storage whose SubGet is thread-safe (GetNumReaders() > 0), e.g., SnapshotStorage.
+ * The model decides when a Get may be answered and hands it over with Serve().
+ */
+class ReaderPool {
+ public:
+  static const int kDefaultNumThreads = 2;
+
+  ReaderPool(AbstractStorage* storage, ThreadsafeQueue<Message>* reply_queue, int num_threads);
+  ~ReaderPool();
+
+  /**
+   * Answer the Get request asynchronously
+   */
+  void Serve(Message&& msg);
+
+ private:
+  void Main();
+
+  AbstractStorage* storage_;             // not owned
+  ThreadsafeQueue<Message>* reply_queue_;  // not owned, the queue where reply messages are put
+  ThreadsafeQueue<Message> get_queue_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace csci5570
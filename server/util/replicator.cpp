@@ -0,0 +1,112 @@
+#include "server/util/replicator.hpp"
+
+#include "glog/logging.h"
+
+#include <algorithm>
+
+namespace csci5570 {
+
+const int Replicator::kDefaultMaxLag;
+
+Replicator::Replicator(uint32_t model_id, uint32_t server_id, const std::vector<uint32_t>& backup_ids,
+                       ThreadsafeQueue<Message>* send_queue, int max_lag)
+    : model_id_(model_id), server_id_(server_id), send_queue_(send_queue), max_lag_(max_lag) {
+  CHECK_GT(max_lag, 0);
+  for (uint32_t backup_id : backup_ids) {
+    acked_clocks_[backup_id] = 0;
+  }
+}
+
+void Replicator::OnAdd(const Message& msg) {
+  CHECK_EQ(msg.data.size(), 2);
+  if (acked_clocks_.empty()) {return;}
+  frames_.push_back(msg.data[0]);
+  frames_.push_back(msg.data[1]);
+}
+
+void Replicator::OnMinClock(int min_clock) {
+  if (min_clock <= shipped_clock_) {return;}
+  shipped_clock_ = min_clock;
+  size_t bytes = 0;
+  for (const auto& frame : frames_) {
+    bytes += frame.size();
+  }
+  for (const auto& kv : acked_clocks_) {
+    Message msg;
+    msg.meta.sender = server_id_;
+    msg.meta.recver = kv.first;
+    msg.meta.model_id = model_id_;
+    msg.meta.flag = Flag::kReplicate;
+    msg.AddData(third_party::SArray<int>({min_clock}));
+    // the frames are shared by all the batches and by the mailbox, nothing is copied
+    msg.data.insert(msg.data.end(), frames_.begin(), frames_.end());
+    send_queue_->Push(std::move(msg));
+    shipped_bytes_ += bytes;
+  }
+  frames_.clear();
+  max_observed_lag_ = std::max(max_observed_lag_, GetLag());
+}
+
+void Replicator::OnAck(uint32_t backup_id, int clock) {
+  auto it = acked_clocks_.find(backup_id);
+  if (it == acked_clocks_.end()) {return;}
+  it->second = std::max(it->second, clock);
+}
+
+void Replicator::RemoveBackup(uint32_t backup_id) {
+  if (acked_clocks_.erase(backup_id) > 0) {
+    LOG(WARNING) << "server " << server_id_ << " model " << model_id_ << " stops replicating to server "
+                 << backup_id;
+  }
+  if (acked_clocks_.empty()) {
+    frames_.clear();
+  }
+}
+
+int Replicator::GetLag() const {
+  int lag = 0;
+  for (const auto& kv : acked_clocks_) {
+    lag = std::max(lag, shipped_clock_ - kv.second);
+  }
+  return lag;
+}
+
+int Replicator::GetMaxLag() const {
+  return max_observed_lag_;
+}
+
+bool Replicator::IsLagging() const {
+  return GetLag() > max_lag_;
+}
+
+size_t Replicator::GetShippedBytes() const {
+  return shipped_bytes_;
+}
+
+Backup::Backup(std::unique_ptr<AbstractStorage>&& storage, ThreadsafeQueue<Message>* reply_queue)
+    : storage_(std::move(storage)), reply_queue_(reply_queue) {}
+
+void Backup::OnReplicate(const Message& msg) {
+  CHECK_GE(msg.data.size(), 1);
+  CHECK_EQ(msg.data.size() % 2, 1);
+  int clock = third_party::SArray<int>(msg.data[0])[0];
+  std::vector<third_party::SArray<Key>> keys;
+  std::vector<third_party::SArray<char>> vals;
+  for (size_t i = 1; i < msg.data.size(); i += 2) {
+    keys.push_back(third_party::SArray<Key>(msg.data[i]));
+    vals.push_back(msg.data[i + 1]);
+  }
+  storage_->SubAddBatch(keys, vals);
+  storage_->FinishIter();
+  clock_ = clock;
+
+  Message ack;
+  ack.meta.sender = msg.meta.recver;
+  ack.meta.recver = msg.meta.sender;
+  ack.meta.model_id = msg.meta.model_id;
+  ack.meta.flag = Flag::kReplicateAck;
+  ack.AddData(third_party::SArray<int>({clock}));
+  reply_queue_->Push(std::move(ack));
+}
+
+}  // namespace csci5570
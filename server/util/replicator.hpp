@@ -0,0 +1,111 @@
+#pragma once
+
+#include "base/message.hpp"
+#include "base/threadsafe_queue.hpp"
+#include "base/third_party/sarray.h"
+#include "server/abstract_storage.hpp"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace csci5570 {
+
+/**
+ * Replicates the shard of a model held by a (primary) server thread to its backups on other nodes.
+ *
+ * The Adds applied by the primary are kept as they arrived, i.e., the frames received by the
+ * mailbox are referenced rather than copied. Each time the min clock advances they are shipped to
+ * every backup as one kReplicate message: [clock][keys][vals][keys][vals]..., which the mailbox
+ * sends without copying again. The backups ack the clock of every batch they applied, and the lag
+ * of a backup is the number of shipped clocks it has not acked.
+ */
+class Replicator {
+ public:
+  /**
+   * @param model_id    the model id
+   * @param server_id   the primary server thread
+   * @param backup_ids  the server threads holding the backups
+   * @param send_queue  the queue of the sender
+   * @param max_lag     the lag in clocks beyond which the primary should wait for the backups
+   */
+  Replicator(uint32_t model_id, uint32_t server_id, const std::vector<uint32_t>& backup_ids,
+             ThreadsafeQueue<Message>* send_queue, int max_lag = kDefaultMaxLag);
+
+  /**
+   * Keep the updates of an Add message for the next batch
+   */
+  void OnAdd(const Message& msg);
+
+  /**
+   * Ship the updates kept so far if the min clock advanced
+   */
+  void OnMinClock(int min_clock);
+
+  /**
+   * Record that a backup applied the batches up to <clock>
+   */
+  void OnAck(uint32_t backup_id, int clock);
+
+  /**
+   * Stop replicating to a failed backup
+   */
+  void RemoveBackup(uint32_t backup_id);
+
+  /**
+   * Return the largest number of shipped clocks not acked by a backup, 0 without backups
+   */
+  int GetLag() const;
+  /**
+   * Return the largest lag ever observed
+   */
+  int GetMaxLag() const;
+  /**
+   * Whether the lag exceeds the bound
+   */
+  bool IsLagging() const;
+  /**
+   * Return the bytes of updates shipped to each backup
+   */
+  size_t GetShippedBytes() const;
+
+  static const int kDefaultMaxLag = 4;
+
+ private:
+  uint32_t model_id_;
+  uint32_t server_id_;
+  ThreadsafeQueue<Message>* send_queue_;
+  int max_lag_;
+  std::map<uint32_t, int> acked_clocks_;  // {backup id: the last clock it acked}
+  int shipped_clock_ = 0;                 // the clock of the last batch
+  int max_observed_lag_ = 0;
+  size_t shipped_bytes_ = 0;
+  std::vector<third_party::SArray<char>> frames_;  // keys and vals of the Adds since the last batch
+};
+
+/**
+ * The backup of the shard of a model held by a server thread on another node
+ */
+class Backup {
+ public:
+  Backup(std::unique_ptr<AbstractStorage>&& storage, ThreadsafeQueue<Message>* reply_queue);
+
+  /**
+   * Apply a batch shipped by the Replicator of the primary and ack it
+   */
+  void OnReplicate(const Message& msg);
+
+  /**
+   * Return the clock of the last batch applied
+   */
+  int GetClock() const { return clock_; }
+
+  AbstractStorage* GetStorage() { return storage_.get(); }
+
+ private:
+  std::unique_ptr<AbstractStorage> storage_;
+  ThreadsafeQueue<Message>* reply_queue_;
+  int clock_ = 0;
+};
+
+}  // namespace csci5570
@@ -0,0 +1,119 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "server/map_storage.hpp"
+#include "server/util/replicator.hpp"
+
+namespace csci5570 {
+namespace {
+
+class TestReplicator : public testing::Test {
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+};
+
+Message MakeAdd(const third_party::SArray<Key>& keys, const third_party::SArray<double>& vals) {
+  Message msg;
+  msg.meta.flag = Flag::kAdd;
+  msg.AddData(keys);
+  msg.AddData(vals);
+  return msg;
+}
+
+TEST_F(TestReplicator, ShipOneBatchPerClock) {
+  ThreadsafeQueue<Message> send_queue;
+  Replicator replicator(0, 0, {1000, 2000}, &send_queue);
+  third_party::SArray<Key> keys({1, 2});
+  third_party::SArray<double> vals({.1, .2});
+  replicator.OnAdd(MakeAdd(keys, vals));
+  replicator.OnAdd(MakeAdd(third_party::SArray<Key>({3}), third_party::SArray<double>({.3})));
+  replicator.OnMinClock(0);  // the min clock did not advance
+  EXPECT_EQ(send_queue.Size(), 0);
+  replicator.OnMinClock(1);
+
+  ASSERT_EQ(send_queue.Size(), 2);
+  for (uint32_t backup_id : {1000, 2000}) {
+    Message batch;
+    send_queue.WaitAndPop(&batch);
+    EXPECT_EQ(batch.meta.flag, Flag::kReplicate);
+    EXPECT_EQ(batch.meta.sender, 0);
+    EXPECT_EQ(batch.meta.recver, backup_id);
+    ASSERT_EQ(batch.data.size(), 5);
+    EXPECT_EQ(third_party::SArray<int>(batch.data[0])[0], 1);
+    // the frames of the Adds are shipped as they are
+    EXPECT_EQ(batch.data[1].data(), reinterpret_cast<char*>(keys.data()));
+    EXPECT_EQ(batch.data[2].data(), reinterpret_cast<char*>(vals.data()));
+  }
+  EXPECT_EQ(replicator.GetShippedBytes(), 2 * (3 * sizeof(Key) + 3 * sizeof(double)));
+
+  replicator.OnMinClock(2);  // an empty batch still advances the backups
+  ASSERT_EQ(send_queue.Size(), 2);
+  Message batch;
+  send_queue.WaitAndPop(&batch);
+  EXPECT_EQ(batch.data.size(), 1);
+}
+
+TEST_F(TestReplicator, Lag) {
+  ThreadsafeQueue<Message> send_queue;
+  Replicator replicator(0, 0, {1000, 2000}, &send_queue, 2);
+  EXPECT_EQ(replicator.GetLag(), 0);
+  for (int clock = 1; clock <= 3; ++clock) {
+    replicator.OnMinClock(clock);
+  }
+  EXPECT_EQ(replicator.GetLag(), 3);
+  EXPECT_TRUE(replicator.IsLagging());
+
+  replicator.OnAck(1000, 3);
+  replicator.OnAck(2000, 1);
+  EXPECT_EQ(replicator.GetLag(), 2);
+  EXPECT_FALSE(replicator.IsLagging());
+  replicator.OnAck(2000, 1);  // duplicated
+  replicator.OnAck(3000, 3);  // not a backup
+  EXPECT_EQ(replicator.GetLag(), 2);
+
+  replicator.RemoveBackup(2000);
+  EXPECT_EQ(replicator.GetLag(), 0);
+  EXPECT_EQ(replicator.GetMaxLag(), 3);
+}
+
+TEST_F(TestReplicator, NoBackup) {
+  ThreadsafeQueue<Message> send_queue;
+  Replicator replicator(0, 0, {1000}, &send_queue);
+  replicator.RemoveBackup(1000);
+  replicator.OnAdd(MakeAdd(third_party::SArray<Key>({1}), third_party::SArray<double>({.1})));
+  replicator.OnMinClock(1);
+  EXPECT_EQ(send_queue.Size(), 0);
+  EXPECT_FALSE(replicator.IsLagging());
+}
+
+TEST_F(TestReplicator, Backup) {
+  ThreadsafeQueue<Message> send_queue;
+  ThreadsafeQueue<Message> reply_queue;
+  Replicator replicator(0, 0, {1000}, &send_queue);
+  Backup backup(std::unique_ptr<AbstractStorage>(new MapStorage<double>()), &reply_queue);
+  replicator.OnAdd(MakeAdd(third_party::SArray<Key>({1, 2}), third_party::SArray<double>({.1, .2})));
+  replicator.OnAdd(MakeAdd(third_party::SArray<Key>({2}), third_party::SArray<double>({.2})));
+  replicator.OnMinClock(1);
+  Message batch;
+  send_queue.WaitAndPop(&batch);
+  backup.OnReplicate(batch);
+
+  EXPECT_EQ(backup.GetClock(), 1);
+  auto vals = third_party::SArray<double>(backup.GetStorage()->SubGet(third_party::SArray<Key>({1, 2})));
+  ASSERT_EQ(vals.size(), 2);
+  EXPECT_DOUBLE_EQ(vals[0], .1);
+  EXPECT_DOUBLE_EQ(vals[1], .4);
+
+  ASSERT_EQ(reply_queue.Size(), 1);
+  Message ack;
+  reply_queue.WaitAndPop(&ack);
+  EXPECT_EQ(ack.meta.flag, Flag::kReplicateAck);
+  EXPECT_EQ(ack.meta.sender, 1000);
+  EXPECT_EQ(ack.meta.recver, 0);
+  replicator.OnAck(ack.meta.sender, third_party::SArray<int>(ack.data[0])[0]);
+  EXPECT_EQ(replicator.GetLag(), 0);
+}
+
+}  // namespace
+}  // namespace csci5570
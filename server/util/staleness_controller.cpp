@@ -0,0 +1,116 @@
+#include "server/util/staleness_controller.hpp"
+
+#include "glog/logging.h"
+
+#include <algorithm>
+
+namespace csci5570 {
+
+const int StalenessController::kDefaultWindow;
+const size_t StalenessController::kMaxDecisions;
+constexpr double StalenessController::kWidenWaitRatio;
+constexpr double StalenessController::kNarrowWaitRatio;
+constexpr double StalenessController::kBalancedSkew;
+constexpr double StalenessController::kRateAlpha;
+
+namespace {
+double Seconds(StalenessController::TimePoint from, StalenessController::TimePoint to) {
+  return std::chrono::duration<double>(to - from).count();
+}
+}  // namespace
+
+StalenessController::StalenessController(int min_staleness, int max_staleness, int window)
+    : min_staleness_(min_staleness), max_staleness_(max_staleness), staleness_(min_staleness), window_(window) {
+  CHECK_GE(min_staleness, 0);
+  CHECK_LE(min_staleness, max_staleness);
+  CHECK_GT(window, 0);
+}
+
+void StalenessController::OnClock(int tid, TimePoint now) {
+  if (!window_started_) {
+    window_start_ = now;
+    window_started_ = true;
+  }
+  auto it = last_clock_.find(tid);
+  if (it != last_clock_.end()) {
+    double interval = Seconds(it->second, now);
+    auto rate = clock_interval_.find(tid);
+    if (rate == clock_interval_.end()) {
+      clock_interval_[tid] = interval;
+    } else {
+      rate->second = kRateAlpha * interval + (1 - kRateAlpha) * rate->second;
+    }
+    it->second = now;
+  } else {
+    last_clock_[tid] = now;
+  }
+}
+
+void StalenessController::OnPark(int tid, TimePoint now) {
+  // a request parked again keeps its original start time
+  parked_since_.insert({tid, now});
+}
+
+void StalenessController::OnRelease(int tid, TimePoint now) {
+  auto it = parked_since_.find(tid);
+  if (it == parked_since_.end()) {return;}
+  window_wait_ += Seconds(it->second, now);
+  parked_since_.erase(it);
+}
+
+int StalenessController::OnMinClock(int min_clock, TimePoint now) {
+  num_min_clocks_ += 1;
+  if (num_min_clocks_ < window_ || !window_started_) {
+    return staleness_;
+  }
+  // Gets still parked count up to now
+  double wait = window_wait_;
+  for (auto& parked : parked_since_) {
+    wait += Seconds(std::max(parked.second, window_start_), now);
+  }
+  double elapsed = Seconds(window_start_, now);
+  size_t num_workers = std::max<size_t>(last_clock_.size(), 1);
+  double wait_ratio = elapsed > 0 ? wait / (elapsed * num_workers) : 0;
+
+  double skew = 1;
+  if (!clock_interval_.empty()) {
+    auto minmax = std::minmax_element(
+        clock_interval_.begin(), clock_interval_.end(),
+        [](const std::pair<const int, double>& a, const std::pair<const int, double>& b) { return a.second < b.second; });
+    if (minmax.first->second > 0) {
+      skew = minmax.second->second / minmax.first->second;
+    }
+  }
+
+  int old_staleness = staleness_;
+  if (wait_ratio > kWidenWaitRatio) {
+    staleness_ = std::min(staleness_ + 1, max_staleness_);
+  } else if (wait_ratio < kNarrowWaitRatio && skew < kBalancedSkew) {
+    staleness_ = std::max(staleness_ - 1, min_staleness_);
+  }
+  if (decisions_.size() == kMaxDecisions) {
+    decisions_.pop_front();
+  }
+  decisions_.push_back({min_clock, old_staleness, staleness_, wait_ratio, skew});
+  VLOG(1) << "staleness at min clock " << min_clock << ": " << old_staleness << " -> " << staleness_
+          << ", wait ratio: " << wait_ratio << ", clock rate skew: " << skew;
+
+  // start a new window, parked time already counted moves to the new window start
+  num_min_clocks_ = 0;
+  window_wait_ = 0;
+  window_start_ = now;
+  for (auto& parked : parked_since_) {
+    parked.second = std::max(parked.second, now);
+  }
+  return staleness_;
+}
+
+int StalenessController::GetStaleness() const {
+  return staleness_;
+}
+
+const std::deque<StalenessDecision>& StalenessController::GetDecisions() const {
+  return decisions_;
+}
+
+}  // namespace csci5570
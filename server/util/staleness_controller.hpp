@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <unordered_map>
+
+namespace csci5570 {
+
+/**
+ * A decision of the StalenessController, kept as a metric for tuning
+ */
+struct StalenessDecision {
+  int min_clock;           // the min clock when the decision was taken
+  int old_staleness;
+  int new_staleness;
+  double wait_ratio;       // fraction of worker time spent on parked Gets in the window
+  double clock_rate_skew;  // slowest / fastest per-worker clock interval
+};
+
+/**
+ * Adapts the SSP staleness bound to the observed straggler behaviour.
+ *
+ * The controller tracks the clock interval of every worker (exponential moving average) and the time
+ * its Gets spend parked. Every <window> advances of the min clock it looks at the share of worker time
+ * lost waiting: a large share widens the bound to trade freshness for throughput, a small share with
+ * evenly paced workers narrows it back for convergence. The bound stays in [min_staleness, max_staleness].
+ */
+class StalenessController {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  StalenessController(int min_staleness, int max_staleness, int window = kDefaultWindow);
+
+  /**
+   * Record that a worker finished a clock
+   */
+  void OnClock(int tid, TimePoint now);
+  /**
+   * Record that a Get of a worker is parked, or released
+   */
+  void OnPark(int tid, TimePoint now);
+  void OnRelease(int tid, TimePoint now);
+  /**
+   * Called when the min clock advances
+   *
+   * @return  the staleness to use from now on
+   */
+  int OnMinClock(int min_clock, TimePoint now);
+
+  int GetStaleness() const;
+  /**
+   * Return the last kMaxDecisions decisions, the oldest first
+   */
+  const std::deque<StalenessDecision>& GetDecisions() const;
+
+  static const int kDefaultWindow = 5;
+  static const size_t kMaxDecisions = 1024;
+  static constexpr double kWidenWaitRatio = 0.2;
+  static constexpr double kNarrowWaitRatio = 0.05;
+  static constexpr double kBalancedSkew = 1.5;
+  static constexpr double kRateAlpha = 0.3;  // weight of the latest clock interval in the moving average
+
+ private:
+  int min_staleness_;
+  int max_staleness_;
+  int staleness_;
+  int window_;
+
+  int num_min_clocks_ = 0;                            // min clock advances in the current window
+  TimePoint window_start_;
+  bool window_started_ = false;
+  double window_wait_ = 0;                            // parked seconds in the current window
+  std::unordered_map<int, TimePoint> last_clock_;     // {tid: time of its last clock}
+  std::unordered_map<int, double> clock_interval_;    // {tid: average seconds per clock}
+  std::unordered_map<int, TimePoint> parked_since_;   // {tid: time its Get was parked}
+  std::deque<StalenessDecision> decisions_;          // the last kMaxDecisions
+};
+
+}  // namespace csci5570
@@ -0,0 +1,107 @@
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "server/util/staleness_controller.hpp"
+
+namespace csci5570 {
+namespace {
+
+class TestStalenessController : public testing::Test {
+ public:
+  TestStalenessController() {}
+  ~TestStalenessController() {}
+
+ protected:
+  void SetUp() {}
+  void TearDown() {}
+
+  StalenessController::TimePoint At(double seconds) {
+    return start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(seconds));
+  }
+
+  StalenessController::TimePoint start_;
+};
+
+TEST_F(TestStalenessController, Construct) {
+  StalenessController controller(1, 4);
+  EXPECT_EQ(controller.GetStaleness(), 1);
+  EXPECT_TRUE(controller.GetDecisions().empty());
+}
+
+TEST_F(TestStalenessController, WidenOnWait) {
+  StalenessController controller(0, 2, 2);
+  for (int clock = 0; clock < 6; ++clock) {
+    // worker 3 is a straggler, worker 2 waits for it half of the time
+    controller.OnClock(2, At(clock));
+    controller.OnClock(3, At(clock + 0.5));
+    controller.OnPark(2, At(clock + 0.5));
+    controller.OnRelease(2, At(clock + 1));
+    controller.OnMinClock(clock + 1, At(clock + 1));
+  }
+  EXPECT_EQ(controller.GetStaleness(), 2);  // bounded by max_staleness
+  const auto& decisions = controller.GetDecisions();
+  ASSERT_EQ(decisions.size(), 3);
+  EXPECT_EQ(decisions[0].min_clock, 2);
+  EXPECT_EQ(decisions[0].old_staleness, 0);
+  EXPECT_EQ(decisions[0].new_staleness, 1);
+  EXPECT_GT(decisions[0].wait_ratio, StalenessController::kWidenWaitRatio);
+  EXPECT_EQ(decisions[1].new_staleness, 2);
+  EXPECT_EQ(decisions[2].old_staleness, 2);
+  EXPECT_EQ(decisions[2].new_staleness, 2);
+}
+
+TEST_F(TestStalenessController, NarrowWhenBalanced) {
+  StalenessController controller(1, 3, 1);
+  // a phase with stragglers
+  controller.OnClock(2, At(0));
+  controller.OnPark(2, At(0));
+  controller.OnClock(3, At(1));
+  controller.OnRelease(2, At(1));
+  EXPECT_EQ(controller.OnMinClock(1, At(1)), 2);
+  // then the workers run at the same pace without waiting, narrowing waits for the paces to converge
+  for (int clock = 2; clock < 6; ++clock) {
+    controller.OnClock(2, At(clock));
+    controller.OnClock(3, At(clock));
+    controller.OnMinClock(clock, At(clock));
+  }
+  EXPECT_EQ(controller.GetStaleness(), 1);  // bounded by min_staleness
+  const auto& decisions = controller.GetDecisions();
+  ASSERT_EQ(decisions.size(), 5);
+  EXPECT_EQ(decisions[1].new_staleness, 2);
+  EXPECT_GT(decisions[1].clock_rate_skew, StalenessController::kBalancedSkew);
+  EXPECT_EQ(decisions[3].old_staleness, 2);
+  EXPECT_EQ(decisions[3].new_staleness, 1);
+  EXPECT_DOUBLE_EQ(decisions[3].wait_ratio, 0);
+}
+
+TEST_F(TestStalenessController, KeepWhenSkewed) {
+  StalenessController controller(0, 3, 1);
+  controller.OnClock(2, At(0));
+  controller.OnClock(3, At(0));
+  controller.OnPark(2, At(0));
+  controller.OnClock(3, At(1));
+  controller.OnRelease(2, At(1));
+  EXPECT_EQ(controller.OnMinClock(1, At(1)), 1);
+  // no Get waits, but worker 3 clocks much slower than worker 2
+  controller.OnClock(2, At(1.2));
+  controller.OnClock(3, At(5));
+  EXPECT_EQ(controller.OnMinClock(2, At(5)), 1);
+  EXPECT_GT(controller.GetDecisions().back().clock_rate_skew, StalenessController::kBalancedSkew);
+}
+
+TEST_F(TestStalenessController, KeepLastDecisions) {
+  StalenessController controller(0, 3, 1);
+  controller.OnClock(2, At(0));
+  for (size_t i = 1; i <= StalenessController::kMaxDecisions + 10; ++i) {
+    controller.OnClock(2, At(i));
+    controller.OnMinClock(i, At(i));
+  }
+  const auto& decisions = controller.GetDecisions();
+  ASSERT_EQ(decisions.size(), StalenessController::kMaxDecisions);
+  EXPECT_EQ(decisions.front().min_clock, 11);
+  EXPECT_EQ(decisions.back().min_clock, StalenessController::kMaxDecisions + 10);
+}
+
+}  // namespace
+}  // namespace csci5570
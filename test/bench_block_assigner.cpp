@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "io/block_assignment_policy.hpp"
+
+namespace csci5570 {
+
+/**
+ * A fake namenode: hosts in racks, and files of blocks with replicas placed as HDFS does by default,
+ * i.e., the first one on a random host and the other two on one other rack.
+ */
+struct FakeNamenode {
+  FakeNamenode(int num_racks, int hosts_per_rack, int num_blocks, size_t block_size, int seed) {
+    std::mt19937 gen(seed);
+    for (int r = 0; r < num_racks; ++r) {
+      for (int h = 0; h < hosts_per_rack; ++h) {
+        hosts.push_back("host" + std::to_string(r * hosts_per_rack + h));
+        racks[hosts.back()] = "/rack" + std::to_string(r);
+      }
+    }
+    std::uniform_int_distribution<int> host_dist(0, hosts.size() - 1);
+    std::uniform_int_distribution<int> rack_dist(0, num_racks - 1);
+    std::uniform_int_distribution<int> in_rack_dist(0, hosts_per_rack - 1);
+    for (int b = 0; b < num_blocks; ++b) {
+      BlockAssignmentPolicy::Block block{"/data/part-" + std::to_string(b / 16), b % 16 * block_size, block_size,
+                                         {}, {}};
+      int first = host_dist(gen);
+      int rack = (first / hosts_per_rack + 1 + rack_dist(gen) % (num_racks - 1)) % num_racks;
+      int second = rack * hosts_per_rack + in_rack_dist(gen);
+      int third = rack * hosts_per_rack + (second % hosts_per_rack + 1) % hosts_per_rack;
+      for (int h : {first, second, third}) {
+        block.hosts.push_back(hosts[h]);
+        block.racks.push_back(racks[hosts[h]]);
+      }
+      blocks.push_back(block);
+    }
+  }
+
+  std::vector<std::string> hosts;
+  std::map<std::string, std::string> racks;
+  std::vector<BlockAssignmentPolicy::Block> blocks;
+};
+
+/**
+ * Simulate the load phase with <readers_per_host> readers per host asking for blocks until there is none.
+ * A reader reads at the rate of its host, scaled down for rack-local and remote blocks. When a block
+ * completes, the reader of its other copy, if any, drops it and asks for another block.
+ */
+void Simulate(const std::string& name, const FakeNamenode& namenode, const BlockAssignmentPolicy::Options& options,
+              const std::map<std::string, double>& host_rates, int readers_per_host, int seed) {
+  const double kRackFactor = 0.6;
+  const double kRemoteFactor = 0.3;
+  BlockAssignmentPolicy policy(options);
+  std::map<std::pair<std::string, size_t>, const BlockAssignmentPolicy::Block*> blocks;
+  for (const auto& block : namenode.blocks) {
+    policy.add_block(block);
+    blocks[std::make_pair(block.filename, block.offset)] = &block;
+  }
+
+  struct Reader {
+    std::string host;
+    std::pair<std::string, size_t> block;
+    int generation;  // to drop the events of a cancelled copy
+  };
+  std::vector<Reader> readers;
+  for (const auto& host : namenode.hosts) {
+    for (int i = 0; i < readers_per_host; ++i) {
+      readers.push_back(Reader{host, {}, 0});
+    }
+  }
+  // (finish time, reader, generation)
+  using Event = std::tuple<double, int, int>;
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events;
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<double> noise(0.8, 1.2);
+  int num_local = 0, num_rack = 0, num_remote = 0;
+
+  auto ask = [&](int r, double now) {
+    Reader& reader = readers[r];
+    auto assignment = policy.assign(reader.host, now);
+    if (assignment.filename.empty()) {
+      return;
+    }
+    reader.block = std::make_pair(assignment.filename, assignment.offset);
+    const auto* block = blocks[reader.block];
+    double factor = kRemoteFactor;
+    if (std::find(block->hosts.begin(), block->hosts.end(), reader.host) != block->hosts.end()) {
+      factor = 1;
+      num_local += 1;
+    } else if (std::find(block->racks.begin(), block->racks.end(), namenode.racks.at(reader.host)) !=
+               block->racks.end()) {
+      factor = kRackFactor;
+      num_rack += 1;
+    } else {
+      num_remote += 1;
+    }
+    double seconds = block->length / (host_rates.at(reader.host) * factor) * noise(gen);
+    events.push(Event(now + seconds, r, reader.generation));
+  };
+
+  for (size_t r = 0; r < readers.size(); ++r) {
+    ask(r, 0);
+  }
+  double makespan = 0;
+  while (!events.empty()) {
+    double now;
+    int r, generation;
+    std::tie(now, r, generation) = events.top();
+    events.pop();
+    if (generation != readers[r].generation) {
+      continue;
+    }
+    auto done = readers[r].block;
+    if (policy.complete(readers[r].host, done.first, done.second, now)) {
+      makespan = now;
+      // cancel the other copy
+      for (size_t other = 0; other < readers.size(); ++other) {
+        if (static_cast<int>(other) != r && readers[other].block == done) {
+          readers[other].generation += 1;
+          readers[other].block = {};
+          ask(other, now);
+        }
+      }
+    }
+    readers[r].block = {};
+    ask(r, now);
+  }
+  CHECK(policy.is_done());
+  LOG(INFO) << name << ": makespan " << makespan << " s, local/rack/remote reads " << num_local << "/" << num_rack
+            << "/" << num_remote << ", speculative " << policy.get_num_speculative();
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  const size_t kBlockSize = 128 << 20;
+  csci5570::FakeNamenode namenode(4, 8, 2000, kBlockSize, 0);
+  // 100 MB/s per reader, with a few slow hosts
+  std::map<std::string, double> host_rates;
+  for (size_t h = 0; h < namenode.hosts.size(); ++h) {
+    host_rates[namenode.hosts[h]] = (h % 8 == 3 ? 25 : 100) * double(1 << 20);
+  }
+
+  csci5570::BlockAssignmentPolicy::Options baseline;
+  baseline.rack_aware = false;
+  baseline.rate_aware = false;
+  csci5570::BlockAssignmentPolicy::Options locality;
+  locality.rate_aware = false;
+  csci5570::BlockAssignmentPolicy::Options rate_aware;
+  csci5570::BlockAssignmentPolicy::Options speculative;
+  speculative.speculative = true;
+  for (int readers_per_host : {1, 4}) {
+    LOG(INFO) << namenode.hosts.size() << " hosts, " << namenode.blocks.size() << " blocks, " << readers_per_host
+              << " readers per host";
+    csci5570::Simulate("local only", namenode, baseline, host_rates, readers_per_host, 1);
+    csci5570::Simulate("rack-aware", namenode, locality, host_rates, readers_per_host, 1);
+    csci5570::Simulate("rate-aware", namenode, rate_aware, host_rates, readers_per_host, 1);
+    csci5570::Simulate("speculative", namenode, speculative, host_rates, readers_per_host, 1);
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "glog/logging.h"
+
+#include "server/map_storage.hpp"
+#include "server/util/checkpoint.hpp"
+#include "server/util/checkpointer.hpp"
+
+namespace csci5570 {
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Measure the checkpoint and restore throughput of a MapStorage shard on local disk
+ */
+void BenchCheckpoint(const std::string& dir, int num_keys) {
+  MapStorage<float> storage;
+  third_party::SArray<Key> keys(num_keys);
+  third_party::SArray<float> vals(num_keys);
+  for (int i = 0; i < num_keys; ++i) {
+    keys[i] = i * 3;
+    vals[i] = i * 0.5;
+  }
+  storage.SubAdd(keys, third_party::SArray<char>(vals));
+
+  // the part on the server thread
+  auto start = std::chrono::steady_clock::now();
+  third_party::SArray<Key> dump_keys;
+  third_party::SArray<char> dump_vals;
+  storage.Dump(&dump_keys, &dump_vals);
+  double dump_seconds = SecondsSince(start);
+
+  // the part on the background thread
+  start = std::chrono::steady_clock::now();
+  std::string path = CheckpointFile::GetPath(dir, 0, 0);
+  size_t bytes =
+      CheckpointFile::Write(path, CheckpointFile::kFull, 0, 0, 0, 0, sizeof(float), {0}, dump_keys, dump_vals);
+  CHECK_GT(bytes, 0);
+  double write_seconds = SecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  CheckpointData data;
+  CHECK(CheckpointFile::Read(path, &data));
+  double map_seconds = SecondsSince(start);
+  MapStorage<float> restored;
+  restored.Restore(data.keys, data.vals);
+  double restore_seconds = SecondsSince(start);
+
+  double gb = bytes / 1e9;
+  LOG(INFO) << "keys: " << num_keys << ", checkpoint size: " << gb << " GB";
+  LOG(INFO) << "dump on server thread: " << dump_seconds << "s";
+  LOG(INFO) << "write: " << write_seconds << "s, " << gb / write_seconds << " GB/s";
+  LOG(INFO) << "read (mmap): " << map_seconds << "s, restore into storage: " << restore_seconds << "s, "
+            << gb / restore_seconds << " GB/s";
+
+  // a delta after updating 1% of the keys
+  int num_updates = std::max(num_keys / 100, 1);
+  third_party::SArray<Key> update_keys(num_updates);
+  third_party::SArray<float> update_vals(num_updates, 1.0);
+  for (int i = 0; i < num_updates; ++i) {
+    update_keys[i] = i * 300;
+  }
+  storage.SubAdd(update_keys, third_party::SArray<char>(update_vals));
+  start = std::chrono::steady_clock::now();
+  storage.DumpDirty(&dump_keys, &dump_vals);
+  double dump_dirty_seconds = SecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  std::string delta_path = CheckpointFile::GetDeltaPath(dir, 0, 0, 1);
+  size_t delta_bytes = CheckpointFile::Write(delta_path, CheckpointFile::kDelta, 1, 0, 0, 1, sizeof(float), {0},
+                                             dump_keys, dump_vals);
+  CHECK_GT(delta_bytes, 0);
+  double delta_write_seconds = SecondsSince(start);
+  start = std::chrono::steady_clock::now();
+  MapStorage<float> replayed;
+  CHECK_EQ(Checkpointer::Restore(dir, 0, 0, {0}, sizeof(float), &replayed), 1);
+  double replay_seconds = SecondsSince(start);
+
+  LOG(INFO) << "delta of " << dump_keys.size() << " keys: " << delta_bytes / 1e9 << " GB, dump on server thread: "
+            << dump_dirty_seconds << "s, write: " << delta_write_seconds << "s";
+  LOG(INFO) << "restore full + delta: " << replay_seconds << "s";
+  std::remove(path.c_str());
+  std::remove(delta_path.c_str());
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  // bench_checkpoint [num_keys] [dir]
+  int num_keys = argc > 1 ? std::atoi(argv[1]) : 10000000;
+  std::string dir = argc > 2 ? argv[2] : "/tmp";
+  csci5570::BenchCheckpoint(dir, num_keys);
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "glog/logging.h"
+
+#include "io/compressed_file_splitter.hpp"
+#include "io/local_file_splitter.hpp"
+
+#ifdef WITH_ZSTD
+#include "zstd.h"
+#endif
+#ifdef WITH_LZ4
+#include "lz4frame.h"
+#endif
+
+namespace csci5570 {
+
+/**
+ * Write about <bytes> of libsvm lines compressed in independent frames of <frame_size> bytes
+ */
+size_t WriteCompressed(const std::string& path, size_t bytes, size_t frame_size,
+                       const std::function<std::string(const std::string&)>& compress) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> feature(1, 1000000);
+  std::uniform_int_distribution<int> nnz(5, 60);
+  FILE* f = fopen(path.c_str(), "w");
+  CHECK(f != nullptr) << path;
+  size_t written = 0;
+  std::string frame;
+  while (written < bytes) {
+    frame.clear();
+    while (frame.size() < frame_size) {
+      frame += std::to_string(gen() % 2);
+      for (int j = nnz(gen); j > 0; --j) {
+        frame += " " + std::to_string(feature(gen)) + ":1";
+      }
+      frame += "\n";
+    }
+    std::string compressed = compress(frame);
+    CHECK_EQ(fwrite(compressed.data(), 1, compressed.size(), f), compressed.size());
+    written += frame.size();
+  }
+  fclose(f);
+  return written;
+}
+
+void BenchDecompress(const std::string& name, const std::string& path, size_t bytes) {
+  for (int num_threads = 1; num_threads <= 2 * static_cast<int>(std::thread::hardware_concurrency());
+       num_threads *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    CompressedFileSplitter splitter(
+        std::unique_ptr<AbstractFileSplitter>(new LocalFileSplitter(1, 0, nullptr, "localhost")), num_threads);
+    splitter.load(path);
+    size_t total = 0;
+    for (boost::string_ref block = splitter.fetch_block(); !block.empty(); block = splitter.fetch_block()) {
+      total += block.size();
+    }
+    CHECK_EQ(total, bytes);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << name << " with " << num_threads << " threads: " << bytes / 1e6 / seconds << " MB/s, "
+              << splitter.get_decompressed_bytes() / 1e6 / splitter.get_decompress_seconds() << " MB/s per thread";
+  }
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  const std::string dir = argc > 1 ? argv[1] : "/tmp";
+  double gigabytes = argc > 2 ? std::atof(argv[2]) : 1;
+  size_t frame_size = 4 << 20;
+#ifdef WITH_ZSTD
+  {
+    std::string path = dir + "/bench_compressed_input.zst";
+    size_t bytes = csci5570::WriteCompressed(path, gigabytes * 1e9, frame_size, [](const std::string& data) {
+      std::string out(ZSTD_compressBound(data.size()), '\0');
+      out.resize(ZSTD_compress(&out[0], out.size(), data.data(), data.size(), 3));
+      return out;
+    });
+    csci5570::BenchDecompress("zstd", path, bytes);
+    std::remove(path.c_str());
+  }
+#endif
+#ifdef WITH_LZ4
+  {
+    std::string path = dir + "/bench_compressed_input.lz4";
+    size_t bytes = csci5570::WriteCompressed(path, gigabytes * 1e9, frame_size, [](const std::string& data) {
+      std::string out(LZ4F_compressFrameBound(data.size(), nullptr), '\0');
+      out.resize(LZ4F_compressFrame(&out[0], out.size(), data.data(), data.size(), nullptr));
+      return out;
+    });
+    csci5570::BenchDecompress("lz4", path, bytes);
+    std::remove(path.c_str());
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,132 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "io/line_input_format.hpp"
+#include "io/local_file_splitter.hpp"
+
+namespace csci5570 {
+
+/**
+ * Write about <bytes> of libsvm lines, repeating a 1MB pattern of random lines
+ */
+size_t WriteText(const std::string& path, size_t bytes) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> feature(1, 1000000);
+  std::uniform_int_distribution<int> nnz(5, 60);
+  std::string pattern;
+  while (pattern.size() < (1 << 20)) {
+    pattern += std::to_string(gen() % 2);
+    for (int j = nnz(gen); j > 0; --j) {
+      pattern += " " + std::to_string(feature(gen)) + ":1";
+    }
+    pattern += "\n";
+  }
+  FILE* f = fopen(path.c_str(), "w");
+  CHECK(f != nullptr) << path;
+  size_t written = 0;
+  while (written < bytes) {
+    CHECK_EQ(fwrite(pattern.data(), 1, pattern.size(), f), pattern.size());
+    written += pattern.size();
+  }
+  fclose(f);
+  return written;
+}
+
+void Report(const std::string& name, size_t bytes, size_t num_lines, std::chrono::steady_clock::time_point start) {
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  LOG(INFO) << name << ": " << num_lines << " lines, " << bytes / 1e9 / seconds << " GB/s";
+}
+
+/**
+ * Scan the mapped file for lines with <find>, e.g., byte by byte as LineInputFormat used to
+ */
+size_t ScanMapped(const std::string& path, size_t bytes, const std::function<const char*(const char*, const char*)>& find) {
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0);
+  const char* data = static_cast<const char*>(mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0));
+  CHECK(data != MAP_FAILED);
+  close(fd);
+  size_t num_lines = 0;
+  const char* end = data + bytes;
+  for (const char* p = data; p < end;) {
+    const char* r = find(p, end);
+    num_lines += 1;
+    p = r + 1;
+  }
+  munmap(const_cast<char*>(data), bytes);
+  return num_lines;
+}
+
+void BenchLineInputFormat(const std::string& path, size_t bytes) {
+  auto start = std::chrono::steady_clock::now();
+  size_t num_lines = ScanMapped(path, bytes, [](const char* p, const char* end) {
+    while (p != end && *p != '\n')
+      p++;
+    return p;
+  });
+  Report("byte loop scan", bytes, num_lines, start);
+
+  start = std::chrono::steady_clock::now();
+  num_lines = ScanMapped(path, bytes, [](const char* p, const char* end) {
+    const char* r = static_cast<const char*>(memchr(p, '\n', end - p));
+    return r == nullptr ? end : r;
+  });
+  Report("memchr scan", bytes, num_lines, start);
+
+  {
+    start = std::chrono::steady_clock::now();
+    LineInputFormat infmt("file://" + path, std::unique_ptr<AbstractFileSplitter>(
+                                                new LocalFileSplitter(1, 0, nullptr, "localhost")));
+    boost::string_ref record;
+    size_t count = 0;
+    while (infmt.next(record)) {
+      count += 1;
+    }
+    CHECK_EQ(count, num_lines);
+    Report("LineInputFormat::next", bytes, count, start);
+  }
+
+  {
+    start = std::chrono::steady_clock::now();
+    LineInputFormat infmt("file://" + path, std::unique_ptr<AbstractFileSplitter>(
+                                                new LocalFileSplitter(1, 0, nullptr, "localhost")));
+    std::vector<boost::string_ref> batch;
+    size_t count = 0;
+    while (size_t n = infmt.next_batch(&batch, 4096)) {
+      count += n;
+    }
+    CHECK_EQ(count, num_lines);
+    Report("LineInputFormat::next_batch", bytes, count, start);
+  }
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  const std::string path = argc > 1 ? argv[1] : "/tmp/bench_line_input_format.txt";
+  double gigabytes = argc > 2 ? std::atof(argv[2]) : 2;
+  size_t bytes = csci5570::WriteText(path, gigabytes * 1e9);
+  // the first pass also brings the file in the page cache
+  for (int i = 0; i < 2; ++i) {
+    csci5570::BenchLineInputFormat(path, bytes);
+  }
+  std::remove(path.c_str());
+  return 0;
+}
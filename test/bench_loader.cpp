@@ -0,0 +1,110 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "lib/parser.hpp"
+#include "lib/svm_loader.hpp"
+#include "lib/svm_sample.hpp"
+
+namespace csci5570 {
+
+using DataStore = std::vector<lib::SVMSample>;
+
+/**
+ * Write a libsvm file of <num_lines> samples with <num_nnz> features each
+ */
+size_t WriteLibsvm(const std::string& path, int num_lines, int num_nnz, int n_features) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> feature(1, n_features);
+  FILE* f = fopen(path.c_str(), "w");
+  CHECK(f != nullptr) << path;
+  for (int i = 0; i < num_lines; ++i) {
+    fprintf(f, "%d", i % 2);
+    for (int j = 0; j < num_nnz; ++j) {
+      fprintf(f, " %d:1", feature(gen));
+    }
+    fprintf(f, "\n");
+  }
+  size_t bytes = ftell(f);
+  fclose(f);
+  return bytes;
+}
+
+/**
+ * A local-file stand-in for the HDFS splitters: the i-th reader takes the i-th range of the file, from
+ * the line starting in it to the line crossing its end, like the lines crossing HDFS blocks
+ */
+void ReadRange(const std::string& path, size_t file_size, int i, int num_readers,
+               const std::function<void(boost::string_ref)>& on_record) {
+  size_t begin = file_size * i / num_readers;
+  size_t end = file_size * (i + 1) / num_readers;
+  int fd = open(path.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0);
+  // read one more line at each end, the range is cut at line boundaries below
+  size_t from = begin == 0 ? 0 : begin - 1;
+  std::string block(std::min(file_size, end + 4096) - from, '\0');
+  ssize_t n = pread(fd, &block[0], block.size(), from);
+  CHECK_EQ(n, static_cast<ssize_t>(block.size()));
+  close(fd);
+
+  size_t l = 0;
+  if (begin != 0) {  // skip the line started in the previous range
+    l = block.find('\n') + 1;
+  }
+  while (from + l < end) {
+    size_t r = block.find('\n', l);
+    CHECK_NE(r, std::string::npos) << "lines longer than 4KB";
+    on_record(boost::string_ref(block.data() + l, r - l));
+    l = r + 1;
+  }
+}
+
+/**
+ * Measure the load time of a local file against the number of reader/parser threads
+ */
+void BenchLoader(const std::string& path, size_t file_size, int num_lines, int n_features, int num_threads) {
+  lib::Parser<lib::SVMSample, DataStore> parser;
+  DataStore datastore;
+  auto start = std::chrono::steady_clock::now();
+  lib::DataLoader<lib::SVMSample, DataStore>::parse_parallel(
+      num_threads,
+      [&](int i, const std::function<void(boost::string_ref)>& on_record) {
+        ReadRange(path, file_size, i, num_threads, on_record);
+      },
+      parser, n_features, &datastore);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  CHECK_EQ(datastore.size(), num_lines);
+  LOG(INFO) << "threads: " << num_threads << ", load time: " << seconds << "s, " << file_size / 1e6 / seconds
+            << " MB/s, " << num_lines / seconds << " samples/s";
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  const std::string path = argc > 1 ? argv[1] : "/tmp/bench_loader.libsvm";
+  const int kNumLines = 500000;
+  const int kNumNnz = 40;
+  const int kNumFeatures = 1000000;
+  size_t file_size = csci5570::WriteLibsvm(path, kNumLines, kNumNnz, kNumFeatures);
+  int max_threads = argc > 2 ? std::atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    csci5570::BenchLoader(path, file_size, kNumLines, kNumFeatures, num_threads);
+  }
+  std::remove(path.c_str());
+  return 0;
+}
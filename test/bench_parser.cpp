@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "lib/parser.hpp"
+#include "lib/svm_sample.hpp"
+
+namespace csci5570 {
+
+using SVMParser = lib::Parser<lib::SVMSample, std::vector<lib::SVMSample>>;
+
+/**
+ * Generate a libsvm file of <num_lines> samples with <num_nnz> real-valued features each
+ */
+void WriteLibsvm(const std::string& path, int num_lines, int num_nnz, int n_features) {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> feature(1, n_features);
+  std::uniform_real_distribution<double> value(-1, 1);
+  FILE* f = fopen(path.c_str(), "w");
+  CHECK(f != nullptr) << path;
+  for (int i = 0; i < num_lines; ++i) {
+    fprintf(f, "%d", i % 2 ? 1 : -1);
+    for (int j = 0; j < num_nnz; ++j) {
+      fprintf(f, " %d:%.6g", feature(gen), value(gen));
+    }
+    fprintf(f, "\n");
+  }
+  fclose(f);
+}
+
+/**
+ * The previous parsing: a string and std::stoi/std::stod per token
+ */
+void ParseWithStrings(boost::string_ref line, lib::SVMSample* sample) {
+  sample->x_.clear();
+  size_t p = line.find(' ');
+  sample->y_ = std::stoi(line.substr(0, p).to_string());
+  while (p != boost::string_ref::npos) {
+    line.remove_prefix(p + 1);
+    p = line.find(' ');
+    boost::string_ref token = line.substr(0, p);
+    size_t colon = token.find(':');
+    sample->x_.emplace_back(std::stoi(token.substr(0, colon).to_string()),
+                            std::stod(token.substr(colon + 1).to_string()));
+  }
+}
+
+template <typename Parse>
+void BenchParse(const std::string& name, const std::vector<boost::string_ref>& lines, size_t bytes, Parse parse) {
+  lib::SVMSample sample;
+  size_t num_features = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (auto line : lines) {
+    parse(line, &sample);
+    num_features += sample.x_.size();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  LOG(INFO) << name << ": " << bytes / 1e6 / seconds << " MB/s, " << num_features / seconds / 1e6
+            << " M features/s";
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  const std::string path = argc > 1 ? argv[1] : "/tmp/bench_parser.libsvm";
+  const int kNumFeatures = 1000000;
+  csci5570::WriteLibsvm(path, 200000, 50, kNumFeatures);
+  std::ifstream in(path);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  std::string content = ss.str();
+  std::remove(path.c_str());
+
+  std::vector<boost::string_ref> lines;
+  size_t l = 0;
+  for (size_t r = content.find('\n'); r != std::string::npos; l = r + 1, r = content.find('\n', l)) {
+    lines.emplace_back(content.data() + l, r - l);
+  }
+  csci5570::BenchParse("string + stoi/stod", lines, content.size(), csci5570::ParseWithStrings);
+  csci5570::BenchParse("in-place parse_libsvm", lines, content.size(),
+                       [kNumFeatures](boost::string_ref line, csci5570::lib::SVMSample* sample) {
+                         csci5570::SVMParser::parse_libsvm(line, kNumFeatures, sample);
+                       });
+  return 0;
+}
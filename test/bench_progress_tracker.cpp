@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "server/util/progress_tracker.hpp"
+
+namespace csci5570 {
+
+/**
+ * Measure the cost of a Clock message on the server side, i.e. advancing one worker and checking
+ * whether the min clock moved, for a growing number of workers.
+ */
+void BenchProgressTracker(int num_threads, int num_iters) {
+  std::vector<uint32_t> tids(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    tids[i] = i;
+  }
+  ProgressTracker tracker;
+  tracker.Init(tids);
+
+  // clock messages of one iteration arrive in an arbitrary order
+  std::mt19937 gen(num_threads);
+  std::vector<uint32_t> order(tids);
+  int num_changes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int iter = 0; iter < num_iters; ++iter) {
+    std::shuffle(order.begin(), order.end(), gen);
+    for (auto tid : order) {
+      if (tracker.AdvanceAndGetChangedMinClock(tid) != -1) {
+        num_changes += 1;
+      }
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  CHECK_EQ(num_changes, num_iters);
+  CHECK_EQ(tracker.GetMinClock(), num_iters);
+
+  long long num_ops = static_cast<long long>(num_threads) * num_iters;
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+  LOG(INFO) << "workers: " << num_threads << ", clocks: " << num_ops << ", ns per clock: " << ns / num_ops;
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  const int kTotalClocks = 10000000;
+  for (int num_threads : {10, 100, 1000, 10000}) {
+    csci5570::BenchProgressTracker(num_threads, kTotalClocks / num_threads);
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "lib/sparse_kernels.hpp"
+
+namespace csci5570 {
+
+/**
+ * Run <f> over all the rows <repeat> times and log the rate of features per second
+ */
+void Bench(const std::string& name, size_t nnz, int repeat, const std::function<void()>& f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; ++r) {
+    f();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  LOG(INFO) << name << ": " << nnz * repeat / 1e6 / seconds << " M features/s";
+}
+
+}  // namespace csci5570
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_stderrthreshold = 0;
+  FLAGS_colorlogtostderr = true;
+
+  // rows of 5 to 60 features over <num_params> parameters, as the libsvm data of the apps
+  const size_t num_rows = argc > 1 ? std::atol(argv[1]) : 100000;
+  const size_t num_params = argc > 2 ? std::atol(argv[2]) : 1000000;
+  const int repeat = argc > 3 ? std::atoi(argv[3]) : 20;
+#if defined(__AVX2__) && defined(__FMA__)
+  LOG(INFO) << "AVX2 kernels";
+#else
+  LOG(INFO) << "scalar kernels";
+#endif
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<uint32_t> col(0, num_params - 1);
+  std::uniform_int_distribution<int> row_nnz(5, 60);
+  std::uniform_real_distribution<double> value(-1, 1);
+  std::vector<uint32_t> cols;
+  std::vector<double> values;
+  std::vector<size_t> indptr(1, 0);
+  for (size_t i = 0; i < num_rows; ++i) {
+    for (int k = row_nnz(gen); k > 0; --k) {
+      cols.push_back(col(gen));
+      values.push_back(value(gen));
+    }
+    indptr.push_back(cols.size());
+  }
+  std::vector<double> w(num_params);
+  for (auto& x : w) {
+    x = value(gen) * 0.1;
+  }
+  std::vector<double> z(num_rows), g(num_params, 0);
+  const size_t nnz = cols.size();
+
+  double check = 0;
+  csci5570::Bench("naive dot", nnz, repeat, [&] {
+    for (size_t i = 0; i < num_rows; ++i) {
+      double s = 0;
+      for (size_t k = indptr[i]; k < indptr[i + 1]; ++k) {
+        s += values[k] * w[cols[k]];
+      }
+      z[i] = s;
+    }
+    check += z[0];
+  });
+  csci5570::Bench("SparseDot", nnz, repeat, [&] {
+    for (size_t i = 0; i < num_rows; ++i) {
+      z[i] = csci5570::lib::SparseDot(cols.data() + indptr[i], values.data() + indptr[i], indptr[i + 1] - indptr[i],
+                                      w.data());
+    }
+    check += z[0];
+  });
+  csci5570::Bench("std::exp sigmoid", num_rows, repeat, [&] {
+    for (size_t i = 0; i < num_rows; ++i) {
+      z[i] = 1 / (1 + std::exp(-z[i]));
+    }
+    check += z[0];
+  });
+  csci5570::Bench("Sigmoid", num_rows, repeat, [&] {
+    csci5570::lib::Sigmoid(z.data(), num_rows, z.data());
+    check += z[0];
+  });
+  csci5570::Bench("SparseAxpy", nnz, repeat, [&] {
+    for (size_t i = 0; i < num_rows; ++i) {
+      csci5570::lib::SparseAxpy(z[i] - 0.5, cols.data() + indptr[i], values.data() + indptr[i],
+                                indptr[i + 1] - indptr[i], g.data());
+    }
+    check += g[cols[0]];
+  });
+  LOG(INFO) << "checksum " << check;
+  return 0;
+}
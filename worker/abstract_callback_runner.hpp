@@ -3,6 +3,7 @@
 #include <functional>
 
 #include "base/message.hpp"
+#include "base/third_party/sarray.h"
 
 namespace csci5570 {
 
@@ -18,6 +19,12 @@ class AbstractCallbackRunner {
    */
   virtual void RegisterRecvFinishHandle(uint32_t app_thread_id, uint32_t model_id,
                                         const std::function<void()>& recv_finish_handle) = 0;
+  /**
+   * Register a callback for when servers fail, called with their ids, nullptr to unregister
+   */
+  virtual void RegisterFailoverHandle(
+      uint32_t app_thread_id, uint32_t model_id,
+      const std::function<void(const third_party::SArray<uint32_t>&)>& failover_handle) = 0;
 
   /**
    * Register a new request which expects to receive <expected_responses> responses
@@ -33,6 +40,11 @@ class AbstractCallbackRunner {
    * Used by the worker threads on receival of messages and to invoke callbacks
    */
   virtual void AddResponse(uint32_t app_thread_id, uint32_t model_id, Message& msg) = 0;
+
+  /**
+   * Used by the worker threads on receival of a kFailover message holding the failed server ids
+   */
+  virtual void Failover(uint32_t app_thread_id, uint32_t model_id, Message& msg) = 0;
 };  // class AbstractCallbackRunner
 
 }  // namespace csci5570
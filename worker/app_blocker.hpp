@@ -26,6 +26,17 @@ public:
     recv_finish_handles_[app_thread_id] = recv_finish_handle;
   }
 
+  void RegisterFailoverHandle(
+      uint32_t app_thread_id, uint32_t model_id,
+      const std::function<void(const third_party::SArray<uint32_t>&)>& failover_handle) override {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (failover_handle) {
+      failover_handles_[{app_thread_id, model_id}] = failover_handle;
+    } else {
+      failover_handles_.erase({app_thread_id, model_id});
+    }
+  }
+
   void NewRequest(uint32_t app_thread_id, uint32_t model_id, uint32_t expected_responses) override {
     std::unique_lock<std::mutex> lk(mu_);
     tracker_[app_thread_id] = {expected_responses, 0};
@@ -55,10 +66,27 @@ public:
     }
   }
 
+  void Failover(uint32_t app_thread_id, uint32_t model_id, Message& m) override {
+    std::function<void(const third_party::SArray<uint32_t>&)> failover_handle;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      auto it = failover_handles_.find({app_thread_id, model_id});
+      if (it == failover_handles_.end()) {
+        return;
+      }
+      failover_handle = it->second;
+    }
+    // outside the lock, the handle may send requests
+    failover_handle(third_party::SArray<uint32_t>(m.data[0]));
+  }
+
 private:
   // TODO: use both app_thread_id and model_id?
   std::map<uint32_t, std::function<void(Message&)>> recv_handles_;
   std::map<uint32_t, std::function<void()>> recv_finish_handles_;
+  // a thread may hold tables of several models
+  std::map<std::pair<uint32_t, uint32_t>, std::function<void(const third_party::SArray<uint32_t>&)>>
+      failover_handles_;
 
   std::mutex mu_;
   std::condition_variable cond_;
@@ -8,7 +8,12 @@
 #include "base/threadsafe_queue.hpp"
 #include "worker/abstract_callback_runner.hpp"
 
+#include <algorithm>
 #include <cinttypes>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <type_traits>
 #include <vector>
 #include <iostream>
 
@@ -18,7 +23,10 @@ namespace csci5570 {
  * Provides the API to users, and implements the worker-side abstraction of model
  * Each model in one application is uniquely handled by one KVClientTable
  *
- * @param Val type of model parameter values
+ * The requests to a failed server are sent again to the server taking over its shard: the unanswered slices of the
+ * pending Get, and the slices added since the last Clock, which are lost unless the primary replicated them already
+ *
+ * @param Val type of model parameter values, a scalar or a trivially copyable vector, e.g., lib::Embedding
  */
 template <typename Val>
 class KVClientTable {
@@ -39,11 +47,28 @@ class KVClientTable {
         model_id_(model_id),
         sender_queue_(sender_queue),
         partition_manager_(partition_manager),
-        callback_runner_(callback_runner) {
+        callback_runner_(callback_runner),
+        outstanding_(new Outstanding()) {
+    // the handle outlives moves of the table, so it captures no member but the outstanding requests
+    Outstanding* outstanding = outstanding_.get();
+    callback_runner_->RegisterFailoverHandle(
+        app_thread_id_, model_id_,
+        [app_thread_id, model_id, sender_queue, partition_manager, outstanding](
+            const third_party::SArray<uint32_t>& failed_ids) {
+          Resend(app_thread_id, model_id, sender_queue, partition_manager, failed_ids, outstanding);
+        });
   };
+  KVClientTable(KVClientTable&&) = default;
+  ~KVClientTable() {
+    if (outstanding_) {
+      callback_runner_->RegisterFailoverHandle(app_thread_id_, model_id_, nullptr);
+    }
+  }
 
   // ========== API ========== //
   void Clock() {
+    std::lock_guard<std::mutex> lk(outstanding_->mu);
+    outstanding_->adds.clear();
     auto server_ids = partition_manager_->GetServerThreadIds();
     for (auto sid : server_ids) {
       Message m;
@@ -66,29 +91,45 @@ class KVClientTable {
   }
   // sarray version
   void Add(const third_party::SArray<Key>& keys, const third_party::SArray<Val>& vals) {
+    CHECK_EQ(keys.size(), vals.size());
     std::vector<std::pair<int, KVPairs>> sliced_pairs;
-    partition_manager_->Slice(std::make_pair(keys, vals), &sliced_pairs);
+    Slice(keys, vals, &sliced_pairs, std::is_arithmetic<Val>());
+    std::lock_guard<std::mutex> lk(outstanding_->mu);
     for (auto& server_kv : sliced_pairs) {
-      Message m;
-      m.meta.flag = Flag::kAdd;
-      m.meta.model_id = model_id_;
-      // QUESTION: should I use app_thread_id_?
-      m.meta.sender = app_thread_id_;
-      m.meta.recver = server_kv.first;
-      m.AddData(server_kv.second.first);
-      m.AddData(server_kv.second.second);
-      sender_queue_->Push(m);
+      SendAdd(app_thread_id_, model_id_, sender_queue_, server_kv.first, server_kv.second);
+      outstanding_->adds.push_back(std::move(server_kv));
     }
   }
   void Get(const third_party::SArray<Key>& keys, third_party::SArray<Val>* vals) {
+    // a failover handle run before the lock already sees the keys sliced to the new servers
+    std::unique_lock<std::mutex> lk(outstanding_->mu);
     std::vector<std::pair<int, Keys>> sliced_keys;
     partition_manager_->Slice(keys, &sliced_keys);
-    std::map<Key, Val> cache;
-    callback_runner_->RegisterRecvHandle(app_thread_id_, model_id_, [&cache](Message& msg) {
+    // the replies are written in place: the positions of the keys ordered by key, the identity if sorted
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (!std::is_sorted(keys.begin(), keys.end())) {
+      std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    }
+    size_t offset = vals->size();
+    vals->resize(offset + keys.size());
+    Val* out = vals->data() + offset;
+    // each reply holds distinct keys, so the handlers write disjoint positions
+    Outstanding* outstanding = outstanding_.get();
+    callback_runner_->RegisterRecvHandle(app_thread_id_, model_id_, [&keys, &order, out, outstanding](Message& msg) {
       Keys data_keys(msg.data[0]);
       Vals data_vals(msg.data[1]);
+      CHECK_EQ(data_keys.size(), data_vals.size());
+      outstanding->Answer(msg.meta.sender, data_keys);
+      auto pos = order.begin();
       for(uint32_t i = 0; i < data_keys.size(); i++) {
-        cache[data_keys[i]] = data_vals[i];
+        if (i > 0 && data_keys[i] < data_keys[i - 1]) {
+          pos = order.begin();
+        }
+        pos = std::lower_bound(pos, order.end(), data_keys[i], [&keys](size_t p, Key k) { return keys[p] < k; });
+        for (auto it = pos; it != order.end() && keys[*it] == data_keys[i]; ++it) {
+          out[*it] = data_vals[i];
+        }
       }
     });
     callback_runner_->RegisterRecvFinishHandle(app_thread_id_, model_id_, []() {
@@ -96,29 +137,135 @@ class KVClientTable {
     });
     callback_runner_->NewRequest(app_thread_id_, model_id_, sliced_keys.size());
     for (auto& server_keys : sliced_keys) {
-      Message m;
-      m.meta.flag = Flag::kGet;
-      m.meta.model_id = model_id_;
-      // QUESTION: should I use app_thread_id_?
-      m.meta.sender = app_thread_id_;
-      m.meta.recver = server_keys.first;
-      m.AddData(server_keys.second);
-      sender_queue_->Push(m);
+      SendGet(app_thread_id_, model_id_, sender_queue_, server_keys.first, server_keys.second);
     }
+    outstanding_->gets = std::move(sliced_keys);
+    lk.unlock();
     callback_runner_->WaitRequest(app_thread_id_, model_id_);
-    for (auto k : keys) {
-      vals->push_back(cache[k]);
-    }
   }
   // ========== API ========== //
 
  private:
+  // The requests that a failed server may have lost
+  struct Outstanding {
+    std::mutex mu;
+    std::vector<std::pair<int, Keys>> gets;    // the slices of the pending Get not answered yet
+    std::vector<std::pair<int, KVPairs>> adds;  // the slices added since the last Clock
+
+    // a server answers a slice with its keys, and may hold two slices after a failover
+    void Answer(int server_id, const Keys& keys) {
+      std::lock_guard<std::mutex> lk(mu);
+      for (auto it = gets.begin(); it != gets.end(); ++it) {
+        if (it->first == server_id && it->second.size() == keys.size() &&
+            (keys.empty() || it->second[0] == keys[0])) {
+          gets.erase(it);
+          return;
+        }
+      }
+    }
+  };
+
+  static void SendGet(uint32_t app_thread_id, uint32_t model_id, ThreadsafeQueue<Message>* sender_queue,
+                      int server_id, const Keys& keys) {
+    Message m;
+    m.meta.flag = Flag::kGet;
+    m.meta.model_id = model_id;
+    // QUESTION: should I use app_thread_id_?
+    m.meta.sender = app_thread_id;
+    m.meta.recver = server_id;
+    m.AddData(keys);
+    sender_queue->Push(m);
+  }
+  static void SendAdd(uint32_t app_thread_id, uint32_t model_id, ThreadsafeQueue<Message>* sender_queue,
+                      int server_id, const KVPairs& kvs) {
+    Message m;
+    m.meta.flag = Flag::kAdd;
+    m.meta.model_id = model_id;
+    // QUESTION: should I use app_thread_id_?
+    m.meta.sender = app_thread_id;
+    m.meta.recver = server_id;
+    m.AddData(kvs.first);
+    m.AddData(kvs.second);
+    sender_queue->Push(m);
+  }
+
+  // send the outstanding requests to the failed servers to the servers taking over their shards
+  static void Resend(uint32_t app_thread_id, uint32_t model_id, ThreadsafeQueue<Message>* sender_queue,
+                     const AbstractPartitionManager* partition_manager, const third_party::SArray<uint32_t>& failed_ids,
+                     Outstanding* outstanding) {
+    std::lock_guard<std::mutex> lk(outstanding->mu);
+    auto failed = [&failed_ids](int server_id) {
+      return std::find(failed_ids.begin(), failed_ids.end(), static_cast<uint32_t>(server_id)) != failed_ids.end();
+    };
+    // the Adds first, a Get of the same thread should see them
+    for (auto& server_kv : outstanding->adds) {
+      uint32_t owner = partition_manager->Route(server_kv.first);
+      if (failed(server_kv.first) && owner != static_cast<uint32_t>(server_kv.first)) {
+        server_kv.first = owner;
+        SendAdd(app_thread_id, model_id, sender_queue, owner, server_kv.second);
+      }
+    }
+    for (auto& server_keys : outstanding->gets) {
+      uint32_t owner = partition_manager->Route(server_keys.first);
+      if (failed(server_keys.first) && owner != static_cast<uint32_t>(server_keys.first)) {
+        server_keys.first = owner;
+        SendGet(app_thread_id, model_id, sender_queue, owner, server_keys.second);
+      }
+    }
+  }
+
+  // scalar values are sliced along the keys by the partition manager, which slices doubles
+  void Slice(const Keys& keys, const Vals& vals, std::vector<std::pair<int, KVPairs>>* sliced,
+             std::true_type) const {
+    std::vector<std::pair<int, AbstractPartitionManager::KVPairs>> sliced_doubles;
+    partition_manager_->Slice(std::make_pair(keys, ToDoubles(vals)), &sliced_doubles);
+    for (auto& server_kv : sliced_doubles) {
+      Vals server_vals;
+      FromDoubles(server_kv.second.second, &server_vals);
+      sliced->push_back({server_kv.first, KVPairs(server_kv.second.first, server_vals)});
+    }
+  }
+  // other values, e.g., lib::Embedding, are gathered from their positions sliced along the keys
+  void Slice(const Keys& keys, const Vals& vals, std::vector<std::pair<int, KVPairs>>* sliced,
+             std::false_type) const {
+    third_party::SArray<double> positions(keys.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    std::vector<std::pair<int, AbstractPartitionManager::KVPairs>> sliced_positions;
+    partition_manager_->Slice(std::make_pair(keys, positions), &sliced_positions);
+    for (auto& server_kp : sliced_positions) {
+      Vals server_vals(server_kp.second.second.size());
+      for (size_t i = 0; i < server_vals.size(); i++) {
+        server_vals[i] = vals[static_cast<size_t>(server_kp.second.second[i])];
+      }
+      sliced->push_back({server_kp.first, KVPairs(server_kp.second.first, server_vals)});
+    }
+  }
+
+  static third_party::SArray<double> ToDoubles(const third_party::SArray<double>& vals) { return vals; }
+  template <typename T>
+  static third_party::SArray<double> ToDoubles(const third_party::SArray<T>& vals) {
+    third_party::SArray<double> doubles(vals.size());
+    std::copy(vals.begin(), vals.end(), doubles.begin());
+    return doubles;
+  }
+  static void FromDoubles(const third_party::SArray<double>& doubles, third_party::SArray<double>* vals) {
+    *vals = doubles;
+  }
+  template <typename T>
+  static void FromDoubles(const third_party::SArray<double>& doubles, third_party::SArray<T>* vals) {
+    vals->resize(doubles.size());
+    for (size_t i = 0; i < doubles.size(); i++) {
+      (*vals)[i] = static_cast<T>(doubles[i]);
+    }
+  }
+
   uint32_t app_thread_id_;  // identifies the user thread
   uint32_t model_id_;       // identifies the model on servers
 
   ThreadsafeQueue<Message>* const sender_queue_;             // not owned
   AbstractCallbackRunner* const callback_runner_;            // not owned
   const AbstractPartitionManager* const partition_manager_;  // not owned
+  std::unique_ptr<Outstanding> outstanding_;                 // shared with the failover handle
 
 };  // class KVClientTable
 
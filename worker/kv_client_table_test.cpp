@@ -6,6 +6,7 @@
 #include "base/message.hpp"
 #include "base/third_party/sarray.h"
 #include "base/threadsafe_queue.hpp"
+#include "lib/embedding.hpp"
 #include "worker/kv_client_table.hpp"
 
 #include <condition_variable>
@@ -63,6 +64,14 @@ class FakeCallbackRunner : public AbstractCallbackRunner {
     EXPECT_EQ(model_id, kTestModelId);
     recv_finish_handle_ = recv_finish_handle;
   }
+  void RegisterFailoverHandle(
+      uint32_t app_thread_id, uint32_t model_id,
+      const std::function<void(const third_party::SArray<uint32_t>&)>& failover_handle) override {
+    EXPECT_EQ(app_thread_id, kTestAppThreadId);
+    EXPECT_EQ(model_id, kTestModelId);
+    std::lock_guard<std::mutex> lk(mu_);
+    failover_handle_ = failover_handle;
+  }
 
   void NewRequest(uint32_t app_thread_id, uint32_t model_id, uint32_t expected_responses) override {
     EXPECT_EQ(app_thread_id, kTestAppThreadId);
@@ -96,10 +105,22 @@ class FakeCallbackRunner : public AbstractCallbackRunner {
       }
     }
   }
+  void Failover(uint32_t app_thread_id, uint32_t model_id, Message& m) override {
+    EXPECT_EQ(app_thread_id, kTestAppThreadId);
+    EXPECT_EQ(model_id, kTestModelId);
+    std::function<void(const third_party::SArray<uint32_t>&)> failover_handle;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      failover_handle = failover_handle_;
+    }
+    ASSERT_NE(failover_handle, nullptr);
+    failover_handle(third_party::SArray<uint32_t>(m.data[0]));
+  }
 
  private:
   std::function<void(Message&)> recv_handle_;
   std::function<void()> recv_finish_handle_;
+  std::function<void(const third_party::SArray<uint32_t>&)> failover_handle_;
 
   std::mutex mu_;
   std::condition_variable cond_;
@@ -164,6 +185,27 @@ TEST_F(TestKVClientTable, Add) {
   EXPECT_DOUBLE_EQ(res_vals[2], double(0.1));
 }
 
+TEST_F(TestKVClientTable, AddInt) {
+  ThreadsafeQueue<Message> queue;
+  FakePartitionManager manager({0, 1}, 4);
+  FakeCallbackRunner callback_runner;
+  KVClientTable<int> table(kTestAppThreadId, kTestModelId, &queue, &manager, &callback_runner);
+
+  std::vector<Key> keys = {3, 4, 5};
+  std::vector<int> vals = {7, -8, 9};
+  table.Add(keys, vals);  // {3,4,5} -> {3}, {4,5}
+  Message m1, m2;
+  queue.WaitAndPop(&m1);
+  queue.WaitAndPop(&m2);
+  third_party::SArray<int> res_vals(m1.data[1]);
+  ASSERT_EQ(res_vals.size(), 1);
+  EXPECT_EQ(res_vals[0], 7);
+  res_vals = m2.data[1];
+  ASSERT_EQ(res_vals.size(), 2);
+  EXPECT_EQ(res_vals[0], -8);
+  EXPECT_EQ(res_vals[1], 9);
+}
+
 TEST_F(TestKVClientTable, Get) {
   ThreadsafeQueue<Message> queue;
   FakePartitionManager manager({0, 1}, 4);
@@ -217,4 +259,128 @@ TEST_F(TestKVClientTable, Get) {
   th.join();
 }
 
+TEST_F(TestKVClientTable, ResendOnFailover) {  // server 0 fails with a Get pending, server 1 takes over
+  ThreadsafeQueue<Message> queue;
+  FakePartitionManager manager({0, 1}, 4);
+  FakeCallbackRunner callback_runner;
+  KVClientTable<double> table(kTestAppThreadId, kTestModelId, &queue, &manager, &callback_runner);
+  table.Add(std::vector<Key>{2}, std::vector<double>{0.5});  // before the last clock, not sent again
+  table.Clock();
+  table.Add(std::vector<Key>{3, 5}, std::vector<double>{0.1, 0.2});
+  std::thread th([&table]() {
+    std::vector<double> vals;
+    table.Get(std::vector<Key>{3, 5}, &vals);
+    std::vector<double> expected{0.3, 0.4};
+    EXPECT_EQ(vals, expected);
+  });
+  Message m;
+  for (int i = 0; i < 8; ++i) {  // 2 Adds, 2 Clocks, 2 Adds, 2 Gets
+    queue.WaitAndPop(&m);
+  }
+  EXPECT_EQ(m.meta.flag, Flag::kGet);
+  Message r1;
+  r1.meta.sender = 1;
+  r1.AddData(third_party::SArray<Key>{5});
+  r1.AddData(third_party::SArray<double>{0.4});
+  callback_runner.AddResponse(kTestAppThreadId, kTestModelId, r1);
+
+  manager.Redirect(0, 1);
+  Message failover;
+  failover.meta.flag = Flag::kFailover;
+  failover.AddData(third_party::SArray<uint32_t>({0}));
+  callback_runner.Failover(kTestAppThreadId, kTestModelId, failover);
+  ASSERT_EQ(queue.Size(), 2);
+  Message add, get;
+  queue.WaitAndPop(&add);
+  queue.WaitAndPop(&get);
+  EXPECT_EQ(add.meta.flag, Flag::kAdd);
+  EXPECT_EQ(add.meta.recver, 1);
+  EXPECT_EQ(third_party::SArray<Key>(add.data[0])[0], 3);
+  EXPECT_EQ(get.meta.flag, Flag::kGet);
+  EXPECT_EQ(get.meta.recver, 1);
+  ASSERT_EQ(third_party::SArray<Key>(get.data[0]).size(), 1);
+  EXPECT_EQ(third_party::SArray<Key>(get.data[0])[0], 3);
+
+  // a repeated notice sends nothing twice
+  callback_runner.Failover(kTestAppThreadId, kTestModelId, failover);
+  EXPECT_EQ(queue.Size(), 0);
+  Message r0;
+  r0.meta.sender = 1;
+  r0.AddData(third_party::SArray<Key>{3});
+  r0.AddData(third_party::SArray<double>{0.3});
+  callback_runner.AddResponse(kTestAppThreadId, kTestModelId, r0);
+  th.join();
+}
+
+TEST_F(TestKVClientTable, AddVector) {
+  using Val = lib::Embedding<3>;
+  ThreadsafeQueue<Message> queue;
+  FakePartitionManager manager({0, 1}, 4);
+  FakeCallbackRunner callback_runner;
+  KVClientTable<Val> table(kTestAppThreadId, kTestModelId, &queue, &manager, &callback_runner);
+
+  std::vector<Key> keys = {3, 4, 5};
+  std::vector<Val> vals(3);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      vals[i][j] = i * 10 + j;
+    }
+  }
+  table.Add(keys, vals);  // {3,4,5} -> {3}, {4,5}
+  Message m1, m2;
+  queue.WaitAndPop(&m1);
+  queue.WaitAndPop(&m2);
+  EXPECT_EQ(m1.meta.recver, 0);
+  third_party::SArray<Key> res_keys(m1.data[0]);
+  third_party::SArray<Val> res_vals(m1.data[1]);
+  ASSERT_EQ(res_keys.size(), 1);
+  ASSERT_EQ(res_vals.size(), 1);
+  EXPECT_EQ(res_vals[0], vals[0]);
+  EXPECT_EQ(m2.meta.recver, 1);
+  res_keys = m2.data[0];
+  res_vals = m2.data[1];
+  ASSERT_EQ(res_keys.size(), 2);
+  ASSERT_EQ(res_vals.size(), 2);
+  EXPECT_EQ(res_keys[1], 5);
+  EXPECT_EQ(res_vals[0], vals[1]);
+  EXPECT_EQ(res_vals[1], vals[2]);
+}
+
+TEST_F(TestKVClientTable, GetVector) {
+  using Val = lib::Embedding<2, double>;
+  ThreadsafeQueue<Message> queue;
+  FakePartitionManager manager({0, 1}, 4);
+  FakeCallbackRunner callback_runner;
+  std::thread th([&queue, &manager, &callback_runner]() {
+    KVClientTable<Val> table(kTestAppThreadId, kTestModelId, &queue, &manager, &callback_runner);
+    // unsorted with a duplicate, the values follow the order of the keys
+    std::vector<Key> keys = {6, 3, 4, 6};
+    std::vector<Val> vals;
+    table.Get(keys, &vals);
+    ASSERT_EQ(vals.size(), 4);
+    EXPECT_DOUBLE_EQ(vals[0][0], 6);
+    EXPECT_DOUBLE_EQ(vals[0][1], -6);
+    EXPECT_DOUBLE_EQ(vals[1][0], 3);
+    EXPECT_DOUBLE_EQ(vals[2][1], -4);
+    EXPECT_EQ(vals[3], vals[0]);
+  });
+  Message m1, m2;
+  queue.WaitAndPop(&m1);
+  queue.WaitAndPop(&m2);
+  // reply with the keys requested, the value of key k being {k, -k}
+  for (Message* m : {&m2, &m1}) {
+    third_party::SArray<Key> req_keys(m->data[0]);
+    third_party::SArray<Val> reply_vals(req_keys.size());
+    for (size_t i = 0; i < req_keys.size(); ++i) {
+      reply_vals[i][0] = req_keys[i];
+      reply_vals[i][1] = -static_cast<double>(req_keys[i]);
+    }
+    Message reply;
+    reply.AddData(req_keys);
+    reply.AddData(reply_vals);
+    callback_runner.AddResponse(kTestAppThreadId, kTestModelId, reply);
+  }
+  th.join();
+}
+
 }  // namespace csci5570
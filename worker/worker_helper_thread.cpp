@@ -15,6 +15,8 @@ void WorkerHelperThread::Main() {
     }
     if (msg.meta.flag == Flag::kGet) {
       callback_runner_->AddResponse(msg.meta.recver, msg.meta.model_id, msg);
+    } else if (msg.meta.flag == Flag::kFailover) {
+      callback_runner_->Failover(msg.meta.recver, msg.meta.model_id, msg);
     }
   }
 }